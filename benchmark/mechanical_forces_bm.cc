@@ -0,0 +1,63 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+#include <benchmark/benchmark.h>
+#include <string>
+#include "biodynamo.h"
+
+namespace bdm {
+namespace mechanical_forces_bm {
+
+// Simulates a cube of `cells_per_dim`^3 overlapping cells that only interact
+// through mechanical forces, using the given compute target.
+inline void MechanicalForces(benchmark::State& state,
+                             const std::string& compute_target) {
+  auto cells_per_dim = state.range(0);
+  auto set_param = [&](Param* param) {
+    param->compute_target = compute_target;
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = 0;
+    param->max_bound = cells_per_dim * 20;
+  };
+  for (auto _ : state) {
+    state.PauseTiming();
+    Simulation simulation("mechanical_forces_bm", set_param);
+    auto* rm = simulation.GetResourceManager();
+    for (int64_t x = 0; x < cells_per_dim; x++) {
+      for (int64_t y = 0; y < cells_per_dim; y++) {
+        for (int64_t z = 0; z < cells_per_dim; z++) {
+          auto* cell = new Cell({x * 20.0 + 10, y * 20.0 + 10, z * 20.0 + 10});
+          cell->SetDiameter(30);
+          rm->AddAgent(cell);
+        }
+      }
+    }
+    state.ResumeTiming();
+    simulation.GetScheduler()->Simulate(10);
+  }
+}
+
+static void MechanicalForcesCpu(benchmark::State& state) {
+  MechanicalForces(state, "cpu");
+}
+
+BENCHMARK(MechanicalForcesCpu)->Arg(16)->Arg(32)->MeasureProcessCPUTime();
+
+static void MechanicalForcesCpuSoa(benchmark::State& state) {
+  MechanicalForces(state, "cpu-soa");
+}
+
+BENCHMARK(MechanicalForcesCpuSoa)->Arg(16)->Arg(32)->MeasureProcessCPUTime();
+
+}  // namespace mechanical_forces_bm
+}  // namespace bdm
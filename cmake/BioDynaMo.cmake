@@ -160,6 +160,9 @@ function(generate_rootlogon)
   # the one-definition rule
   if (dict)
     set(CONTENT "${CONTENT}\n  gROOT->ProcessLine(\"#define USE_DICT\")\;")
+    if (float_diffusion)
+      set(CONTENT "${CONTENT}\n  gROOT->ProcessLine(\"#define USE_FLOAT_DIFFUSION\")\;")
+    endif()
     set(CONTENT "${CONTENT}\n  gROOT->ProcessLine(\"R__ADD_INCLUDE_PATH($BDMSYS/include)\")\;")
     set(CONTENT "${CONTENT}\n  gROOT->ProcessLine(\"R__ADD_LIBRARY_PATH($BDMSYS/lib)\")\;")
     set(CONTENT "${CONTENT}\n  gROOT->ProcessLine(\"R__LOAD_LIBRARY(libbiodynamo)\")\;")
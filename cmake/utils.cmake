@@ -467,6 +467,7 @@ function(add_bdm_feature_properties)
     ADD_FEATURE_INFO(opencl opencl "Enable OpenCL code generation for GPU acceleration.")
     ADD_FEATURE_INFO(dict dict "Build with ROOT dictionaries.")
     ADD_FEATURE_INFO(numa numa "Enable NUMA-Awareness in BioDynaMo.")
+    ADD_FEATURE_INFO(float_diffusion float_diffusion "Store the concentrations of the diffusion grids in single precision.")
     ADD_FEATURE_INFO(paraview paraview "Enable ParaView.")
     ADD_FEATURE_INFO(sbml sbml "Enable SBML integration.")
     ADD_FEATURE_INFO(vtune vtune "Enable VTune performance analysis.")
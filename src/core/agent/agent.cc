@@ -47,6 +47,7 @@ Agent::Agent(TRootIOCtor* io_ctor) {}
 Agent::Agent(const Agent& other)
     : uid_(other.uid_),
       box_idx_(other.box_idx_),
+      interaction_type_(other.interaction_type_),
       run_behavior_loop_idx_(other.run_behavior_loop_idx_),
       propagate_staticness_neighborhood_(
           other.propagate_staticness_neighborhood_),
@@ -64,6 +65,7 @@ Agent::~Agent() {
 
 void Agent::Initialize(const NewAgentEvent& event) {
   box_idx_ = event.existing_agent->GetBoxIdx();
+  interaction_type_ = event.existing_agent->GetInteractionType();
   // copy behaviors_ to me
   InitializeBehaviors(event);
 }
@@ -114,8 +116,23 @@ void Agent::UpdateStaticness() {
   is_static_next_ts_ = param->detect_static_agents;
 }
 
+Double3 Agent::CalculateDisplacementFromForce(const Double3& neighbor_force,
+                                              uint64_t non_zero_neighbor_forces,
+                                              double dt) {
+  Log::Fatal("Agent::CalculateDisplacementFromForce",
+             "Agent type ", GetTypeName(),
+             " does not support the pairwise evaluation of mechanical forces.");
+  return {0, 0, 0};
+}
+
 void Agent::RunDiscretization() {}
 
+void Agent::RemapUids(const std::unordered_map<AgentUid, AgentUid>& new_uids) {
+  for (auto* behavior : behaviors_) {
+    behavior->RemapUids(new_uids);
+  }
+}
+
 void Agent::AssignNewUid() {
   uid_ = Simulation::GetActive()->GetAgentUidGenerator()->GenerateUid();
 }
@@ -126,6 +143,13 @@ uint32_t Agent::GetBoxIdx() const { return box_idx_; }
 
 void Agent::SetBoxIdx(uint32_t idx) { box_idx_ = idx; }
 
+void Agent::CopyEngineState(const Agent& other) {
+  box_idx_ = other.box_idx_;
+  is_static_ = other.is_static_;
+  is_static_next_ts_ = other.is_static_next_ts_;
+  propagate_staticness_neighborhood_ = other.propagate_staticness_neighborhood_;
+}
+
 // ---------------------------------------------------------------------------
 // Behaviors
 
@@ -74,6 +74,7 @@ namespace bdm {
 // -----------------------------------------------------------------------------
 
 class Behavior;
+class InPlaceExecutionContext;
 
 /// Contains code required by all agents
 class Agent {
@@ -145,6 +146,12 @@ class Agent {
 
   void AssignNewUid();
 
+  /// Returns the uid of this agent.\n
+  /// If `Param::deterministic_mode` is enabled, the uid of an agent that has
+  /// been created in the current iteration is preliminary and replaced at
+  /// the end of the iteration. Uids and `AgentPointer`s stored inside agents
+  /// and behaviors are updated with `RemapUids`, which visits all agents
+  /// (O(#agents) per iteration). Copies stored elsewhere are not updated.
   const AgentUid& GetUid() const;
 
   Spinlock* GetLock() { return &lock_; }
@@ -157,14 +164,41 @@ class Agent {
   /// \see `Param::thread_safety_mechanism`
   virtual void CriticalRegion(std::vector<AgentUid>* uids) {}
 
+  /// If `Param::deterministic_mode` is enabled, the agents that were created
+  /// in an iteration obtain their final uid at the end of this iteration.
+  /// Afterwards, this function is called for all agents with the changed
+  /// uids (old uid -> new uid).\n
+  /// Subclasses that store uids or `AgentPointer`s must override this
+  /// function and update them (\see `AgentPointer::RemapUid`).
+  /// NB: Don't forget to call the implementation of the base class, which
+  /// forwards the call to the behaviors of this agent.
+  virtual void RemapUids(
+      const std::unordered_map<AgentUid, AgentUid>& new_uids);
+
   uint32_t GetBoxIdx() const;
 
   void SetBoxIdx(uint32_t idx);
 
+  /// Returns the interaction type of this agent. The interaction types of two
+  /// agents select the parameters of the mechanical force between them
+  /// (see `Param::interaction_force_repulsion`). New agents that are created
+  /// during a `NewAgentEvent` inherit the type of the existing agent.
+  uint8_t GetInteractionType() const { return interaction_type_; }
+
+  void SetInteractionType(uint8_t type) { interaction_type_ = type; }
+
+  /// Copies the attributes that are managed by the simulation engine
+  /// (grid box index and staticness flags) from `other`. \n
+  /// Used by execution contexts that keep more than one instance of the same
+  /// agent (see `experimental::CopyExecutionContext`).
+  void CopyEngineState(const Agent& other);
+
   void SetStaticnessNextTimestep(bool value) const {
     is_static_next_ts_ = value;
   }
 
+  bool GetStaticnessNextTimestep() const { return is_static_next_ts_; }
+
   bool GetPropagateStaticness() const {
     return propagate_staticness_neighborhood_;
   }
@@ -217,6 +251,25 @@ class Agent {
   virtual Double3 CalculateDisplacement(const InteractionForce* force,
                                         double squared_radius, double dt) = 0;
 
+  /// Returns true if the mechanical forces between this agent and its
+  /// neighbors can be evaluated once per pair (see
+  /// `Param::mechanics_pairwise`). This requires that the interaction force
+  /// between two such agents is antisymmetric and that the displacement only
+  /// depends on the sum of the neighbor forces
+  /// (see `CalculateDisplacementFromForce`).
+  virtual bool SupportsPairwiseForces() const { return false; }
+
+  /// Returns true if the displacement of this agent includes the spring
+  /// forces of its bonds (see `BondNetwork`).
+  virtual bool SupportsBonds() const { return false; }
+
+  /// Calculates the displacement given the sum of the forces the neighbors
+  /// exert on this agent, and the number of neighbors with a non-zero force.
+  /// Only called if `SupportsPairwiseForces()` returns true.
+  virtual Double3 CalculateDisplacementFromForce(
+      const Double3& neighbor_force, uint64_t non_zero_neighbor_forces,
+      double dt);
+
   virtual void ApplyDisplacement(const Double3& displacement) = 0;
 
   virtual const Double3& GetPosition() const = 0;
@@ -252,10 +305,16 @@ class Agent {
   AgentUid uid_;
   /// Grid box index
   uint32_t box_idx_ = std::numeric_limits<uint32_t>::max();
+  /// Compact type id used to look up the parameters of the mechanical
+  /// interaction (see `GetInteractionType`)
+  uint8_t interaction_type_ = 0;
   /// collection of behaviors which define the internal behavior
   InlineVector<Behavior*, 2> behaviors_;
 
  private:
+  /// Assigns uids in deterministic mode (\see `Param::deterministic_mode`)
+  friend class InPlaceExecutionContext;
+
   Spinlock lock_;  //!
 
   /// Helper variable used to support removal of behaviors while
@@ -284,7 +343,7 @@ class Agent {
   /// and `NewAgentEvent::new_behaviors` to their correct value.
   void UpdateBehaviors(const NewAgentEvent& event);
 
-  BDM_CLASS_DEF(Agent, 1)
+  BDM_CLASS_DEF(Agent, 2)
 };
 
 }  // namespace bdm
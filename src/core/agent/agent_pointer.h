@@ -19,6 +19,7 @@
 #include <limits>
 #include <ostream>
 #include <type_traits>
+#include <unordered_map>
 
 #include "core/agent/agent_uid.h"
 #include "core/execution_context/in_place_exec_ctxt.h"
@@ -112,6 +113,15 @@ class AgentPointer {
 
   const TAgent* Get() const { return this->operator->(); }
 
+  /// Replaces the uid if it is contained in `new_uids` (old uid -> new uid).
+  /// \see `Agent::RemapUids`
+  void RemapUid(const std::unordered_map<AgentUid, AgentUid>& new_uids) {
+    auto it = new_uids.find(uid_);
+    if (it != new_uids.end()) {
+      uid_ = it->second;
+    }
+  }
+
  private:
   AgentUid uid_;
 
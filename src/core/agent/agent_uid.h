@@ -21,7 +21,12 @@
 namespace bdm {
 
 /// AgentUid is a unique id for agents that remains unchanged
-/// throughout the whole simulation.
+/// throughout the whole simulation.\n
+/// Exception: if `Param::deterministic_mode` is enabled, agents that are
+/// created during an iteration obtain their final uid at the end of this
+/// iteration (see `Agent::RemapUids`). If any uid changes, all agents in the
+/// simulation are visited to update the uids they store, which costs O(#agents)
+/// in each iteration that creates agents.
 class AgentUid {
  public:
   using Index_t = uint32_t;
@@ -13,6 +13,7 @@
 // -----------------------------------------------------------------------------
 
 #include "core/agent/cell.h"
+#include "core/resource_manager.h"
 
 namespace bdm {
 
@@ -41,4 +42,9 @@ Double3 Cell::TransformCoordinatesGlobalToPolar(const Double3& pos) const {
           std::atan2(local_cartesian[1], local_cartesian[0])};
 }
 
+Double3 Cell::GetBondForce() const {
+  auto* rm = Simulation::GetActive()->GetResourceManager();
+  return rm->GetBondNetwork()->GetForce(this);
+}
+
 }  // namespace bdm
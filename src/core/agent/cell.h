@@ -260,6 +260,87 @@ class Cell : public Agent {
 
   Double3 CalculateDisplacement(const InteractionForce* force,
                                 double squared_radius, double dt) override {
+    // 3) Object avoidance force
+    // -----------------------------------------------------------
+    //  (We check for every neighbor object if they touch us, i.e. push us
+    //  away)
+    Double3 translation_force_on_point_mass{0, 0, 0};
+    uint64_t non_zero_neighbor_forces = 0;
+    if (!IsStatic()) {
+      auto add_force = [&](double fx, double fy, double fz) {
+        if (fx != 0 || fy != 0 || fz != 0) {
+          non_zero_neighbor_forces++;
+          translation_force_on_point_mass[0] += fx;
+          translation_force_on_point_mass[1] += fy;
+          translation_force_on_point_mass[2] += fz;
+        }
+      };
+
+      // Spherical neighbors are collected in batches and processed with
+      // `InteractionForce::CalculateBatch`.
+      const unsigned batch_size = 64;
+      const Agent* agents[batch_size];
+      double x[batch_size] __attribute__((aligned(64)));
+      double y[batch_size] __attribute__((aligned(64)));
+      double z[batch_size] __attribute__((aligned(64)));
+      double diameter[batch_size] __attribute__((aligned(64)));
+      uint8_t type[batch_size];
+      double fx[batch_size] __attribute__((aligned(64)));
+      double fy[batch_size] __attribute__((aligned(64)));
+      double fz[batch_size] __attribute__((aligned(64)));
+      SphereBatch batch;
+      batch.agents = agents;
+      batch.x = x;
+      batch.y = y;
+      batch.z = z;
+      batch.diameter = diameter;
+      batch.type = type;
+
+      auto process_batch = [&]() {
+        force->CalculateBatch(this, batch, fx, fy, fz);
+        for (uint64_t i = 0; i < batch.size; ++i) {
+          add_force(fx[i], fy[i], fz[i]);
+        }
+        batch.size = 0;
+      };
+
+      auto* ctxt = Simulation::GetActive()->GetExecutionContext();
+      auto calculate_neighbor_forces =
+          L2F([&](Agent* neighbor, double squared_distance) {
+            if (neighbor->GetShape() != Shape::kSphere) {
+              auto neighbor_force = force->Calculate(this, neighbor);
+              add_force(neighbor_force[0], neighbor_force[1],
+                        neighbor_force[2]);
+              return;
+            }
+            auto idx = batch.size++;
+            agents[idx] = neighbor;
+            const auto& pos = neighbor->GetPosition();
+            x[idx] = pos[0];
+            y[idx] = pos[1];
+            z[idx] = pos[2];
+            diameter[idx] = neighbor->GetDiameter();
+            type[idx] = neighbor->GetInteractionType();
+            if (batch.size == batch_size) {
+              process_batch();
+            }
+          });
+      ctxt->ForEachNeighbor(calculate_neighbor_forces, *this, squared_radius);
+      process_batch();
+    }
+    return CalculateDisplacementFromForce(translation_force_on_point_mass,
+                                          non_zero_neighbor_forces, dt);
+  }
+
+  /// Returns true. Subclasses that override `CalculateDisplacement` must
+  /// return false, because the pairwise force evaluation bypasses it.
+  bool SupportsPairwiseForces() const override { return true; }
+
+  bool SupportsBonds() const override { return true; }
+
+  Double3 CalculateDisplacementFromForce(const Double3& neighbor_force,
+                                         uint64_t non_zero_neighbor_forces,
+                                         double dt) override {
     // Basically, the idea is to make the sum of all the forces acting
     // on the Point mass. It is stored in translationForceOnPointMass.
     // There is also a computation of the torque (only applied
@@ -296,33 +377,18 @@ class Cell : public Agent {
     // boundaries--------
     // 2) Spring force from my neurites (translation and
     // rotation)--------------------------
-    // 3) Object avoidance force
+    // 3) Object avoidance force (see `CalculateDisplacement`)
     // -----------------------------------------------------------
-    //  (We check for every neighbor object if they touch us, i.e. push us
-    //  away)
-
-    uint64_t non_zero_neighbor_forces = 0;
     if (!IsStatic()) {
-      auto* ctxt = Simulation::GetActive()->GetExecutionContext();
-      auto calculate_neighbor_forces =
-          L2F([&](Agent* neighbor, double squared_distance) {
-            auto neighbor_force = force->Calculate(this, neighbor);
-            if (neighbor_force[0] != 0 || neighbor_force[1] != 0 ||
-                neighbor_force[2] != 0) {
-              non_zero_neighbor_forces++;
-              translation_force_on_point_mass[0] += neighbor_force[0];
-              translation_force_on_point_mass[1] += neighbor_force[1];
-              translation_force_on_point_mass[2] += neighbor_force[2];
-            }
-          });
-      ctxt->ForEachNeighbor(calculate_neighbor_forces, *this, squared_radius);
-
+      translation_force_on_point_mass += neighbor_force;
       if (non_zero_neighbor_forces > 1) {
         SetStaticnessNextTimestep(false);
       }
     }
 
-    // 4) PhysicalBonds
+    // 4) PhysicalBonds (see `BondNetwork`)
+    translation_force_on_point_mass += GetBondForce();
+
     // How the physics influences the next displacement
     double norm_of_force = std::sqrt(translation_force_on_point_mass *
                                      translation_force_on_point_mass);
@@ -365,6 +431,10 @@ class Cell : public Agent {
   /// @return the position in local coordinates
   Double3 TransformCoordinatesGlobalToPolar(const Double3& coord) const;
 
+  /// Returns the sum of the spring forces of the bonds of this cell
+  /// calculated by `BondNetwork::CalculateForces`.
+  Double3 GetBondForce() const;
+
  private:
   /// NB: Use setter and don't assign values directly
   Double3 position_ = {{0, 0, 0}};
@@ -16,6 +16,7 @@
 #define CORE_BEHAVIOR_BEHAVIOR_H_
 
 #include <limits>
+#include <unordered_map>
 #include "core/agent/agent.h"
 #include "core/agent/new_agent_event.h"
 #include "core/util/type.h"
@@ -59,6 +60,11 @@ class Behavior {
 
   virtual void Run(Agent* agent) = 0;
 
+  /// Override this method if your Behavior subclass stores uids or
+  /// `AgentPointer`s. \see `Agent::RemapUids`
+  virtual void RemapUids(
+      const std::unordered_map<AgentUid, AgentUid>& new_uids) {}
+
   /// Always copy this behavior to new agents
   void AlwaysCopyToNew() {
     copy_mask_ = std::numeric_limits<NewAgentEventUid>::max();
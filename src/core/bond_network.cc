@@ -0,0 +1,282 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/bond_network.h"
+
+#include <algorithm>
+#include <mutex>
+#include <numeric>
+
+#include "core/agent/agent.h"
+#include "core/functor.h"
+#include "core/resource_manager.h"
+#include "core/simulation.h"
+#include "core/util/log.h"
+#include "core/util/thread_info.h"
+
+namespace bdm {
+
+// -----------------------------------------------------------------------------
+void BondNetwork::AddBond(const AgentUid& lhs, const AgentUid& rhs,
+                          double rest_length, double stiffness) {
+  std::lock_guard<Spinlock> guard(lock_);
+  bonds_.emplace_back(lhs, rhs, rest_length, stiffness);
+  modified_ = true;
+}
+
+// -----------------------------------------------------------------------------
+bool BondNetwork::RemoveBond(const AgentUid& lhs, const AgentUid& rhs) {
+  std::lock_guard<Spinlock> guard(lock_);
+  auto it = std::find_if(bonds_.begin(), bonds_.end(), [&](const Bond& b) {
+    return (b.lhs == lhs && b.rhs == rhs) || (b.lhs == rhs && b.rhs == lhs);
+  });
+  if (it == bonds_.end()) {
+    return false;
+  }
+  *it = bonds_.back();
+  bonds_.pop_back();
+  modified_ = true;
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+void BondNetwork::RemoveBonds(const AgentUid& uid) {
+  std::lock_guard<Spinlock> guard(lock_);
+  auto end = std::remove_if(bonds_.begin(), bonds_.end(), [&](const Bond& b) {
+    return b.lhs == uid || b.rhs == uid;
+  });
+  if (end != bonds_.end()) {
+    bonds_.erase(end, bonds_.end());
+    modified_ = true;
+  }
+}
+
+// -----------------------------------------------------------------------------
+bool BondNetwork::HasBond(const AgentUid& lhs, const AgentUid& rhs) const {
+  std::lock_guard<Spinlock> guard(lock_);
+  return std::any_of(bonds_.begin(), bonds_.end(), [&](const Bond& b) {
+    return (b.lhs == lhs && b.rhs == rhs) || (b.lhs == rhs && b.rhs == lhs);
+  });
+}
+
+// -----------------------------------------------------------------------------
+void BondNetwork::Clear() {
+  bonds_.clear();
+  Invalidate();
+}
+
+// -----------------------------------------------------------------------------
+void BondNetwork::RemapUids(
+    const std::unordered_map<AgentUid, AgentUid>& new_uids) {
+  bool changed = false;
+  for (auto& bond : bonds_) {
+    auto it = new_uids.find(bond.lhs);
+    if (it != new_uids.end()) {
+      bond.lhs = it->second;
+      changed = true;
+    }
+    it = new_uids.find(bond.rhs);
+    if (it != new_uids.end()) {
+      bond.rhs = it->second;
+      changed = true;
+    }
+  }
+  if (changed) {
+    Invalidate();
+  }
+}
+
+// -----------------------------------------------------------------------------
+bool BondNetwork::IsUpToDate(const std::vector<uint64_t>& offset,
+                             uint64_t num_agents) const {
+  if (modified_ || offset != offset_ || edges_.size() != bonds_.size() ||
+      adjacency_start_.size() != num_agents + 1) {
+    return false;
+  }
+  auto* rm = Simulation::GetActive()->GetResourceManager();
+  bool up_to_date = true;
+  int64_t num_bonds = bonds_.size();
+#pragma omp parallel for reduction(&& : up_to_date)
+  for (int64_t i = 0; i < num_bonds; ++i) {
+    const auto& b = bonds_[i];
+    up_to_date = up_to_date && rm->ContainsAgent(b.lhs) &&
+                 rm->ContainsAgent(b.rhs) &&
+                 rm->GetAgentHandle(b.lhs) == edges_[i].lhs &&
+                 rm->GetAgentHandle(b.rhs) == edges_[i].rhs;
+  }
+  return up_to_date;
+}
+
+// -----------------------------------------------------------------------------
+void BondNetwork::Update() {
+  auto* rm = Simulation::GetActive()->GetResourceManager();
+
+  auto num_numa_nodes = ThreadInfo::GetInstance()->GetNumaNodes();
+  std::vector<uint64_t> offset(num_numa_nodes);
+  offset[0] = 0;
+  for (int nn = 1; nn < num_numa_nodes; nn++) {
+    offset[nn] = offset[nn - 1] + rm->GetNumAgents(nn - 1);
+  }
+  uint64_t num_agents = rm->GetNumAgents();
+  if (IsUpToDate(offset, num_agents)) {
+    return;
+  }
+  offset_.swap(offset);
+  modified_ = false;
+
+  // Remove the bonds of agents that are no longer part of the simulation
+  bonds_.erase(std::remove_if(bonds_.begin(), bonds_.end(),
+                              [&](const Bond& b) {
+                                return !rm->ContainsAgent(b.lhs) ||
+                                       !rm->ContainsAgent(b.rhs);
+                              }),
+               bonds_.end());
+
+  int64_t num_bonds = bonds_.size();
+  edges_.resize(num_bonds);
+#pragma omp parallel for
+  for (int64_t i = 0; i < num_bonds; ++i) {
+    auto lhs = rm->GetAgentHandle(bonds_[i].lhs);
+    auto rhs = rm->GetAgentHandle(bonds_[i].rhs);
+    edges_[i] = Edge{lhs, rhs, GetFlatIndex(lhs), GetFlatIndex(rhs)};
+  }
+  for (const auto& e : edges_) {
+    for (auto ah : {e.lhs, e.rhs}) {
+      auto* agent = rm->GetAgent(ah);
+      if (!agent->SupportsBonds()) {
+        Log::Fatal("BondNetwork::Update", "Agent type ", agent->GetTypeName(),
+                   " does not support bonds.");
+      }
+    }
+  }
+
+  // Order the bonds by the storage location of their agents. Load balancing
+  // sorts the agents along a space-filling curve; hence, the force sweep
+  // accesses the agents (mostly) in memory order.
+  auto less = [](const Edge& a, const Edge& b) {
+    return a.lhs_idx < b.lhs_idx ||
+           (a.lhs_idx == b.lhs_idx && a.rhs_idx < b.rhs_idx);
+  };
+  if (!std::is_sorted(edges_.begin(), edges_.end(), less)) {
+    std::vector<uint64_t> order(num_bonds);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](uint64_t a, uint64_t b) {
+      return less(edges_[a], edges_[b]);
+    });
+    std::vector<Bond> sorted_bonds(num_bonds);
+    std::vector<Edge> sorted_edges(num_bonds);
+    for (int64_t i = 0; i < num_bonds; ++i) {
+      sorted_bonds[i] = bonds_[order[i]];
+      sorted_edges[i] = edges_[order[i]];
+    }
+    bonds_.swap(sorted_bonds);
+    edges_.swap(sorted_edges);
+  }
+
+  // Build the adjacency list
+  adjacency_start_.assign(num_agents + 1, 0);
+  for (const auto& e : edges_) {
+    adjacency_start_[e.lhs_idx + 1]++;
+    adjacency_start_[e.rhs_idx + 1]++;
+  }
+  for (uint64_t i = 0; i < num_agents; ++i) {
+    adjacency_start_[i + 1] += adjacency_start_[i];
+  }
+  adjacency_.resize(adjacency_start_[num_agents]);
+  std::vector<uint64_t> fill(adjacency_start_.begin(),
+                             adjacency_start_.end() - 1);
+  for (int64_t i = 0; i < num_bonds; ++i) {
+    adjacency_[fill[edges_[i].lhs_idx]++] = i;
+    adjacency_[fill[edges_[i].rhs_idx]++] = i;
+  }
+}
+
+// -----------------------------------------------------------------------------
+void BondNetwork::ForEachBond(
+    AgentHandle ah,
+    const std::function<void(const Bond&, AgentHandle)>& function) const {
+  if (adjacency_start_.empty()) {
+    return;
+  }
+  auto idx = GetFlatIndex(ah);
+  for (uint64_t a = adjacency_start_[idx]; a < adjacency_start_[idx + 1];
+       ++a) {
+    auto b = adjacency_[a];
+    const auto& e = edges_[b];
+    function(bonds_[b], e.lhs_idx == idx ? e.rhs : e.lhs);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void BondNetwork::CalculateForces() {
+  if (bonds_.empty()) {
+    Invalidate();
+    return;
+  }
+  Update();
+  auto* rm = Simulation::GetActive()->GetResourceManager();
+
+  // Spring force of each bond
+  int64_t num_bonds = bonds_.size();
+  bond_forces_.resize(num_bonds);
+#pragma omp parallel for
+  for (int64_t i = 0; i < num_bonds; ++i) {
+    const auto& bond = bonds_[i];
+    Double3 diff = rm->GetAgent(edges_[i].rhs)->GetPosition() -
+                   rm->GetAgent(edges_[i].lhs)->GetPosition();
+    double distance = diff.Norm();
+    if (distance == 0) {
+      bond_forces_[i] = {0, 0, 0};
+    } else {
+      double magnitude = bond.stiffness * (distance - bond.rest_length);
+      bond_forces_[i] = diff * (magnitude / distance);
+    }
+  }
+
+  // Sum of the spring forces of each agent
+  forces_.resize(rm->GetNumAgents());
+  auto sum_forces = L2F([&](Agent* agent, AgentHandle ah) {
+    auto idx = GetFlatIndex(ah);
+    Double3 force = {0, 0, 0};
+    for (uint64_t a = adjacency_start_[idx]; a < adjacency_start_[idx + 1];
+         ++a) {
+      auto b = adjacency_[a];
+      if (edges_[b].lhs_idx == idx) {
+        force += bond_forces_[b];
+      } else {
+        force -= bond_forces_[b];
+      }
+    }
+    forces_[idx] = force;
+    if (force[0] != 0 || force[1] != 0 || force[2] != 0) {
+      agent->SetStaticnessNextTimestep(false);
+    }
+  });
+  rm->ForEachAgentParallel(1000, sum_forces);
+}
+
+// -----------------------------------------------------------------------------
+Double3 BondNetwork::GetForce(const Agent* agent) const {
+  if (forces_.empty()) {
+    return {0, 0, 0};
+  }
+  auto* rm = Simulation::GetActive()->GetResourceManager();
+  auto idx = GetFlatIndex(rm->GetAgentHandle(agent->GetUid()));
+  if (idx >= forces_.size()) {
+    return {0, 0, 0};
+  }
+  return forces_[idx];
+}
+
+}  // namespace bdm
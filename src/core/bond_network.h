@@ -0,0 +1,192 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef CORE_BOND_NETWORK_H_
+#define CORE_BOND_NETWORK_H_
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "core/agent/agent_handle.h"
+#include "core/agent/agent_uid.h"
+#include "core/container/math_array.h"
+#include "core/util/root.h"
+#include "core/util/spinlock.h"
+
+namespace bdm {
+
+class Agent;
+
+/// A linear spring between two agents (e.g. a cell-cell adhesion bond).
+/// \see BondNetwork
+struct Bond {
+  Bond() {}
+  Bond(const AgentUid& lhs, const AgentUid& rhs, double rest_length,
+       double stiffness)
+      : lhs(lhs), rhs(rhs), rest_length(rest_length), stiffness(stiffness) {}
+
+  AgentUid lhs;
+  AgentUid rhs;
+  /// Distance between the agent centers at which the spring exerts no force
+  double rest_length = 0;
+  /// Spring constant
+  double stiffness = 0;
+
+  BDM_CLASS_DEF_NV(Bond, 1);
+};
+
+/// Persistent bonds between pairs of agents, owned by the `ResourceManager`
+/// (see `ResourceManager::GetBondNetwork`).\n
+/// Bonds are stored by `AgentUid`, so they are not affected by load
+/// balancing. For the force calculation, `Update` builds an adjacency list in
+/// compressed row format indexed by the storage location (`AgentHandle`) of
+/// the agents, and removes the bonds of agents that are no longer part of
+/// the simulation. The bonds are ordered by the storage location of their
+/// agents, so that the parallel sweep over all bonds in `CalculateForces`
+/// accesses the agents in memory order. The adjacency list is only rebuilt
+/// if bonds have been added or removed, or if a bonded agent has been
+/// removed or moved to a different storage location.\n
+/// The operation "mechanical forces" calls `CalculateForces` in each
+/// iteration and adds the spring forces to the neighbor forces of each
+/// `Cell`. Only agents that support bonds (see `Agent::SupportsBonds`) can be
+/// bonded.
+///
+///     auto* bonds = rm->GetBondNetwork();
+///     bonds->AddBond(cell1->GetUid(), cell2->GetUid(), 10, 0.5);
+class BondNetwork {
+ public:
+  BondNetwork() {}
+
+  BondNetwork(const BondNetwork& other) : bonds_(other.bonds_) {}
+
+  BondNetwork& operator=(const BondNetwork& other) {
+    bonds_ = other.bonds_;
+    Invalidate();
+    return *this;
+  }
+
+  /// Adds a spring between the agents `lhs` and `rhs`. Duplicates are not
+  /// detected. Thread-safe.
+  void AddBond(const AgentUid& lhs, const AgentUid& rhs, double rest_length,
+               double stiffness);
+
+  /// Removes the bond between the agents `lhs` and `rhs` (in any order).
+  /// Returns false if there is no such bond. Thread-safe. The runtime is
+  /// linear in the number of bonds.
+  bool RemoveBond(const AgentUid& lhs, const AgentUid& rhs);
+
+  /// Removes all bonds of agent `uid`. Thread-safe. The runtime is linear in
+  /// the number of bonds.
+  void RemoveBonds(const AgentUid& uid);
+
+  /// Returns true if there is a bond between `lhs` and `rhs` (in any order).
+  /// Thread-safe. The runtime is linear in the number of bonds.
+  bool HasBond(const AgentUid& lhs, const AgentUid& rhs) const;
+
+  uint64_t GetNumBonds() const { return bonds_.size(); }
+
+  bool IsEmpty() const { return bonds_.empty(); }
+
+  const std::vector<Bond>& GetBonds() const { return bonds_; }
+
+  void Clear();
+
+  /// Replaces the uids of bonded agents that are contained in `new_uids`
+  /// (old uid -> new uid). Not thread-safe. \see `Agent::RemapUids`
+  void RemapUids(const std::unordered_map<AgentUid, AgentUid>& new_uids);
+
+  /// Removes the bonds of agents that have been removed from the simulation
+  /// and rebuilds the adjacency list for the current storage location of the
+  /// agents. Returns early if neither the bonds nor the storage locations of
+  /// the bonded agents have changed since the last call. Not thread-safe.
+  void Update();
+
+  /// Calls `function` for each bond of the agent with handle `ah`, together
+  /// with the handle of the bonded agent. Only valid after `Update` and until
+  /// agents or bonds are added, removed, or load balanced.
+  void ForEachBond(
+      AgentHandle ah,
+      const std::function<void(const Bond&, AgentHandle)>& function) const;
+
+  /// Updates the network (see `Update`) and calculates the sum of the spring
+  /// forces for each agent in a parallel sweep over all bonds. Agents that
+  /// experience a spring force are not static in the next iteration.
+  /// Not thread-safe.
+  void CalculateForces();
+
+  /// Returns true if `CalculateForces` found at least one bond.
+  bool HasForces() const { return !forces_.empty(); }
+
+  /// Returns the sum of the spring forces on `agent` calculated in the last
+  /// `CalculateForces` call.
+  Double3 GetForce(const Agent* agent) const;
+
+  /// Returns the sum of the spring forces for each agent, indexed by the
+  /// flattened agent index (the number of agents on lower NUMA nodes plus the
+  /// element index of the `AgentHandle`). Empty if there are no bonds.
+  const std::vector<Double3>& GetForces() const { return forces_; }
+
+ private:
+  /// Storage locations of the agents of one bond
+  struct Edge {
+    AgentHandle lhs;
+    AgentHandle rhs;
+    /// Flattened agent indices
+    uint64_t lhs_idx;
+    uint64_t rhs_idx;
+  };
+
+  /// Marks the adjacency list and the forces as outdated
+  void Invalidate() {
+    modified_ = true;
+    edges_.clear();
+    adjacency_start_.clear();
+    forces_.clear();
+  }
+
+  uint64_t GetFlatIndex(AgentHandle ah) const {
+    return offset_[ah.GetNumaNode()] + ah.GetElementIdx();
+  }
+
+  /// Returns true if the adjacency list has been built for the current
+  /// bonds and storage locations of the agents.
+  bool IsUpToDate(const std::vector<uint64_t>& offset,
+                  uint64_t num_agents) const;
+
+  std::vector<Bond> bonds_;
+  mutable Spinlock lock_;  //!
+  /// True if bonds have been added or removed since the last `Update`
+  bool modified_ = true;  //!
+
+  /// Start index in the flattened agent arrays for each NUMA node
+  std::vector<uint64_t> offset_;  //!
+  /// Storage locations of the agents of each bond (same order as `bonds_`)
+  std::vector<Edge> edges_;  //!
+  /// Adjacency list in compressed row format: indices into `bonds_` for
+  /// each agent
+  std::vector<uint64_t> adjacency_start_;  //!
+  std::vector<uint64_t> adjacency_;        //!
+  /// Spring force of each bond on its `lhs` agent
+  std::vector<Double3> bond_forces_;  //!
+  /// Sum of the spring forces for each agent
+  std::vector<Double3> forces_;  //!
+
+  BDM_CLASS_DEF_NV(BondNetwork, 1);
+};
+
+}  // namespace bdm
+
+#endif  // CORE_BOND_NETWORK_H_
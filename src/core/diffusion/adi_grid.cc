@@ -0,0 +1,209 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/diffusion/adi_grid.h"
+#include <algorithm>
+#include <cstddef>
+#include "core/param/param.h"
+#include "core/simulation.h"
+
+namespace bdm {
+
+void AdiGrid::DiffuseWithClosedEdge(double dt) { Step(dt, true); }
+
+void AdiGrid::DiffuseWithOpenEdge(double dt) { Step(dt, false); }
+
+void AdiGrid::ParametersCheck(double dt) {
+  auto* param = Simulation::GetActive()->GetParam();
+  auto theta = param->diffusion_implicit_theta;
+  if (theta < 0.5 || theta > 1) {
+    Log::Fatal("AdiGrid", "Param::diffusion_implicit_theta (", theta,
+               ") must be in [0.5, 1] for the diffusion grid with substance [",
+               substance_name_, "].");
+  }
+}
+
+void AdiGrid::Step(double dt, bool closed) {
+  const auto nx = num_boxes_axis_[0];
+  const auto ny = num_boxes_axis_[1];
+  const auto nz = num_boxes_axis_[2];
+  const size_t plane_size = nx * ny;
+
+  auto* param = Simulation::GetActive()->GetParam();
+  const double theta = param->diffusion_implicit_theta;
+  const double r = (1 - dc_[0]) * dt / (box_length_ * box_length_);
+
+  // With closed edges, the values at the boundary remain unchanged. If an
+  // axis has fewer than three boxes, all boxes are at the boundary.
+  if (closed && (nx < 3 || ny < 3 || nz < 3)) {
+    return;
+  }
+
+  DiffusionReal* c1 = c1_.data();
+  DiffusionReal* c2 = c2_.data();
+
+  // x-axis: c1_ -> c2_. Lines are the rows of each z-plane. The inner loop
+  // over the rows is strided by nx.
+  ComputeFactors(closed ? nx - 2 : nx, r, theta);
+#pragma omp parallel for
+  for (size_t z = 0; z < nz; z++) {
+    const DiffusionReal* in = c1 + z * plane_size;
+    DiffusionReal* out = c2 + z * plane_size;
+    if (!closed) {
+      SolveLines(in, out, nx, ny, nx, 1, false, r, theta, 1);
+      continue;
+    }
+    // The values at the boundary remain unchanged
+    if (z == 0 || z == nz - 1) {
+      std::copy(in, in + plane_size, out);
+      continue;
+    }
+    std::copy(in, in + nx, out);
+    std::copy(in + (ny - 1) * nx, in + plane_size, out + (ny - 1) * nx);
+    SolveLines(in + nx, out + nx, nx, ny - 2, nx, 1, true, r, theta, 1);
+  }
+
+  // y-axis: c2_ -> c1_. Lines are the columns of each z-plane.
+  ComputeFactors(closed ? ny - 2 : ny, r, theta);
+#pragma omp parallel for
+  for (size_t z = 0; z < nz; z++) {
+    const DiffusionReal* in = c2 + z * plane_size;
+    DiffusionReal* out = c1 + z * plane_size;
+    if (!closed) {
+      SolveLines(in, out, ny, nx, 1, nx, false, r, theta, 1);
+      continue;
+    }
+    if (z == 0 || z == nz - 1) {
+      std::copy(in, in + plane_size, out);
+      continue;
+    }
+    for (size_t y = 0; y < ny; y++) {
+      out[y * nx] = in[y * nx];
+      out[y * nx + nx - 1] = in[y * nx + nx - 1];
+    }
+    SolveLines(in + 1, out + 1, ny, nx - 2, 1, nx, true, r, theta, 1);
+  }
+
+  // z-axis: c1_ -> c2_. Lines are the columns of each y-slab. The decay is
+  // applied to the result.
+  const double decay = 1 - mu_;
+  ComputeFactors(closed ? nz - 2 : nz, r, theta);
+#pragma omp parallel for
+  for (size_t y = 0; y < ny; y++) {
+    const DiffusionReal* in = c1 + y * nx;
+    DiffusionReal* out = c2 + y * nx;
+    if (!closed) {
+      SolveLines(in, out, nz, nx, 1, plane_size, false, r, theta, decay);
+      continue;
+    }
+    if (y == 0 || y == ny - 1) {
+      for (size_t z = 0; z < nz; z++) {
+        std::copy(in + z * plane_size, in + z * plane_size + nx,
+                  out + z * plane_size);
+      }
+      continue;
+    }
+    for (size_t z = 0; z < nz; z++) {
+      out[z * plane_size] = in[z * plane_size];
+      out[z * plane_size + nx - 1] = in[z * plane_size + nx - 1];
+    }
+    SolveLines(in + 1, out + 1, nz, nx - 2, 1, plane_size, true, r, theta,
+               decay);
+  }
+
+  c1_.swap(c2_);
+}
+
+void AdiGrid::ComputeFactors(size_t n, double r, double theta) {
+  // Tridiagonal matrix with diagonal b and off-diagonal elements a
+  const double a = -theta * r;
+  const double b = 1 + 2 * theta * r;
+  factors_.a = a;
+  factors_.cp.resize(n);
+  factors_.inv.resize(n);
+  double cp = 0;
+  for (size_t i = 0; i < n; i++) {
+    double inv = 1 / (b - a * cp);
+    cp = a * inv;
+    factors_.inv[i] = inv;
+    factors_.cp[i] = cp;
+  }
+}
+
+void AdiGrid::SolveLines(const DiffusionReal* in, DiffusionReal* out, size_t n,
+                         size_t num_lines, size_t line_stride,
+                         size_t elem_stride, bool closed, double r,
+                         double theta, double scale) const {
+  const size_t first = closed ? 1 : 0;
+  const auto m = static_cast<int64_t>(factors_.cp.size());
+  const auto es = static_cast<ptrdiff_t>(elem_stride);
+  // Weight of the explicit part
+  const double e = (1 - theta) * r;
+  const double a = factors_.a;
+  const double* cp = factors_.cp.data();
+  const double* inv = factors_.inv.data();
+
+  // Forward elimination. Stores the modified right-hand side in `out`.
+  for (int64_t k = 0; k < m; k++) {
+    const size_t i = first + k;
+    const size_t idx = i * elem_stride;
+    // Outside the grid the concentration is zero. Fixed values at the
+    // boundary move to the right-hand side.
+    const bool has_left = i > 0;
+    const bool has_right = i < n - 1;
+    const ptrdiff_t left = has_left ? -es : 0;
+    const ptrdiff_t right = has_right ? es : 0;
+    double wl = has_left ? e : 0;
+    double wr = has_right ? e : 0;
+    if (closed && k == 0) {
+      wl += theta * r;
+    }
+    if (closed && k == m - 1) {
+      wr += theta * r;
+    }
+    const ptrdiff_t prev = k > 0 ? -es : 0;
+    const double wp = k > 0 ? -a : 0;
+    const double wc = 1 - 2 * e;
+    const double ik = inv[k];
+#pragma omp simd
+    for (size_t l = 0; l < num_lines; l++) {
+      const DiffusionReal* c = in + l * line_stride + idx;
+      DiffusionReal* o = out + l * line_stride + idx;
+      o[0] = (wc * c[0] + wl * c[left] + wr * c[right] + wp * o[prev]) * ik;
+    }
+  }
+
+  // Back substitution
+  for (int64_t k = m - 2; k >= 0; k--) {
+    const size_t idx = (first + k) * elem_stride;
+    const double ck = cp[k];
+#pragma omp simd
+    for (size_t l = 0; l < num_lines; l++) {
+      DiffusionReal* o = out + l * line_stride + idx;
+      o[0] -= ck * o[es];
+    }
+  }
+
+  if (scale != 1) {
+    for (int64_t k = 0; k < m; k++) {
+      const size_t idx = (first + k) * elem_stride;
+#pragma omp simd
+      for (size_t l = 0; l < num_lines; l++) {
+        out[l * line_stride + idx] *= scale;
+      }
+    }
+  }
+}
+
+}  // namespace bdm
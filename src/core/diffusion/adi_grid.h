@@ -0,0 +1,95 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef CORE_DIFFUSION_ADI_GRID_H_
+#define CORE_DIFFUSION_ADI_GRID_H_
+
+#include <utility>
+#include <vector>
+
+#include "core/diffusion/diffusion_grid.h"
+#include "core/util/root.h"
+
+namespace bdm {
+
+/// Implicit diffusion solver based on alternating-direction (locally
+/// one-dimensional) splitting.\n
+/// Each time step consists of three sweeps, one per axis. Each sweep solves
+/// the one-dimensional theta scheme
+/// `(1 - theta r L) c' = (1 + (1 - theta) r L) c`, with `r = dt * D / h^2`
+/// and `L` the second difference along the axis, for all grid lines along
+/// this axis. The tridiagonal systems are solved with the Thomas algorithm.
+/// Lines are processed in batches of adjacent lines, and the inner loop runs
+/// over the lines of a batch. For the y- and z-sweeps, adjacent lines are
+/// adjacent in memory; hence, the inner loop is contiguous and vectorizes.
+/// For the x-sweep, adjacent lines are `nx` elements apart and the inner
+/// loop accesses memory with this stride.\n
+/// With `Param::diffusion_implicit_theta >= 0.5` the method is
+/// unconditionally stable; hence, fast-diffusing substances do not require
+/// small time steps. The decay is applied as for `EulerGrid`.\n
+/// Selected with `Param::diffusion_method = "adi"`.
+class AdiGrid : public DiffusionGrid {
+ public:
+  AdiGrid() {}
+  AdiGrid(int substance_id, std::string substance_name, double dc, double mu,
+          int resolution = 11)
+      : DiffusionGrid(substance_id, std::move(substance_name), dc, mu,
+                      resolution) {}
+
+  void DiffuseWithClosedEdge(double dt) override;
+
+  void DiffuseWithOpenEdge(double dt) override;
+
+ private:
+  /// Forward elimination factors of the Thomas algorithm for the constant
+  /// coefficient tridiagonal system of one line
+  struct ThomasFactors {
+    /// Off-diagonal element
+    double a = 0;
+    /// Modified upper diagonal
+    std::vector<double> cp;
+    /// Inverse of the modified diagonal
+    std::vector<double> inv;
+  };
+
+  /// Only checks the range of `Param::diffusion_implicit_theta`
+  void ParametersCheck(double dt) override;
+
+  /// Performs one time step. If `closed` is true, the values at the boundary
+  /// remain unchanged; otherwise, the concentration outside the grid is
+  /// zero.
+  void Step(double dt, bool closed);
+
+  /// Sets up the Thomas algorithm for lines of `n` unknowns
+  void ComputeFactors(size_t n, double r, double theta);
+
+  /// Solves `num_lines` lines of `n` elements along one axis from `in` to
+  /// `out`. Element `i` of line `l` is located at
+  /// `l * line_stride + i * elem_stride`. The inner loop runs over the
+  /// lines; it is only contiguous in memory if `line_stride` is 1. If
+  /// `closed` is true, the first and last element of each line are fixed.
+  /// The solution is multiplied by `scale`. Requires the factors for this
+  /// axis (see `ComputeFactors`).
+  void SolveLines(const DiffusionReal* in, DiffusionReal* out, size_t n,
+                  size_t num_lines, size_t line_stride, size_t elem_stride,
+                  bool closed, double r, double theta, double scale) const;
+
+  ThomasFactors factors_;  //!
+
+  BDM_CLASS_DEF_OVERRIDE(AdiGrid, 1);
+};
+
+}  // namespace bdm
+
+#endif  // CORE_DIFFUSION_ADI_GRID_H_
@@ -0,0 +1,448 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/diffusion/amr_grid.h"
+#include <algorithm>
+#include <cmath>
+#include "core/agent/agent.h"
+#include "core/functor.h"
+#include "core/param/param.h"
+#include "core/resource_manager.h"
+#include "core/simulation.h"
+
+namespace bdm {
+
+void AmrGrid::Initialize() {
+  DiffusionGrid::Initialize();
+  patches_.clear();
+  block_patch_.clear();
+}
+
+void AmrGrid::Update() {
+  auto old_num_boxes = num_boxes_axis_;
+  DiffusionGrid::Update();
+  // The coarse grid contains the values of all patches; they are rebuilt in
+  // the next step
+  if (num_boxes_axis_ != old_num_boxes) {
+    patches_.clear();
+    block_patch_.clear();
+  }
+}
+
+void AmrGrid::DiffuseWithClosedEdge(double dt) {
+  DiffuseWithPatches(dt, true);
+}
+
+void AmrGrid::DiffuseWithOpenEdge(double dt) { DiffuseWithPatches(dt, false); }
+
+void AmrGrid::DiffuseWithPatches(double dt, bool closed) {
+  Regrid(closed);
+
+  int64_t num_patches = patches_.size();
+#pragma omp parallel for schedule(dynamic)
+  for (int64_t p = 0; p < num_patches; p++) {
+    SampleHalo(patches_[p], closed, &patches_[p].halo_old);
+  }
+
+  if (closed) {
+    EulerGrid::DiffuseWithClosedEdge(dt);
+  } else {
+    EulerGrid::DiffuseWithOpenEdge(dt);
+  }
+
+  // The halo of a patch may overlap with neighboring blocks; hence, all halos
+  // are sampled before the coarse grid is modified.
+#pragma omp parallel for schedule(dynamic)
+  for (int64_t p = 0; p < num_patches; p++) {
+    SampleHalo(patches_[p], closed, &patches_[p].halo_new);
+  }
+
+  const uint64_t substeps = kRatio * kRatio * GetNumSubsteps();
+#pragma omp parallel for schedule(dynamic)
+  for (int64_t p = 0; p < num_patches; p++) {
+    AdvancePatch(&patches_[p], dt / substeps, substeps);
+    Restrict(patches_[p]);
+  }
+}
+
+void AmrGrid::Regrid(bool closed) {
+  auto* sim = Simulation::GetActive();
+  auto* param = sim->GetParam();
+
+  const uint64_t bs = std::max<uint64_t>(param->diffusion_amr_block_size, 1);
+  std::array<size_t, 3> nb;
+  for (int i = 0; i < 3; i++) {
+    nb[i] = (num_boxes_axis_[i] + bs - 1) / bs;
+  }
+  const size_t num_blocks = nb[0] * nb[1] * nb[2];
+  if (bs != block_size_ || nb != num_blocks_ || closed != closed_ ||
+      block_patch_.size() != num_blocks) {
+    patches_.clear();
+    block_patch_.assign(num_blocks, -1);
+    block_size_ = bs;
+    num_blocks_ = nb;
+    closed_ = closed;
+  }
+
+  auto block_index = [&](const std::array<size_t, 3>& box) {
+    return (box[2] / bs * nb[1] + box[1] / bs) * nb[0] + box[0] / bs;
+  };
+
+  std::vector<char> refine(num_blocks, 0);
+
+  // Agent density
+  const auto agent_threshold = param->diffusion_amr_agent_threshold;
+  if (agent_threshold > 0) {
+    std::vector<uint64_t> counts(num_blocks, 0);
+    auto count = L2F([&](Agent* agent, AgentHandle) {
+      auto coord = GetBoxCoordinates(agent->GetPosition());
+      std::array<size_t, 3> box = {coord[0], coord[1], coord[2]};
+      for (int i = 0; i < 3; i++) {
+        if (box[i] >= num_boxes_axis_[i]) {
+          return;
+        }
+      }
+      auto b = block_index(box);
+#pragma omp atomic
+      counts[b]++;
+    });
+    sim->GetResourceManager()->ForEachAgentParallel(1000, count);
+    for (size_t b = 0; b < num_blocks; b++) {
+      refine[b] = counts[b] >= agent_threshold;
+    }
+  }
+
+  // Steep gradients
+  const double gradient_threshold = param->diffusion_amr_gradient_threshold;
+  if (gradient_threshold > 0) {
+    const double max_difference = gradient_threshold * box_length_;
+    const auto nx = num_boxes_axis_[0];
+    const auto ny = num_boxes_axis_[1];
+    const auto nz = num_boxes_axis_[2];
+    const std::array<size_t, 3> stride = {1, nx, nx * ny};
+    int64_t nblocks = num_blocks;
+#pragma omp parallel for schedule(dynamic)
+    for (int64_t b = 0; b < nblocks; b++) {
+      if (refine[b]) {
+        continue;
+      }
+      size_t bx = b % nb[0];
+      size_t by = (b / nb[0]) % nb[1];
+      size_t bz = b / (nb[0] * nb[1]);
+      bool steep = false;
+      for (size_t z = bz * bs; z < std::min((bz + 1) * bs, nz) && !steep;
+           z++) {
+        for (size_t y = by * bs; y < std::min((by + 1) * bs, ny) && !steep;
+             y++) {
+          for (size_t x = bx * bs; x < std::min((bx + 1) * bs, nx); x++) {
+            std::array<size_t, 3> box = {x, y, z};
+            size_t c = x + y * nx + z * nx * ny;
+            for (int i = 0; i < 3; i++) {
+              if (box[i] + 1 < num_boxes_axis_[i] &&
+                  std::abs(c1_[c + stride[i]] - c1_[c]) >= max_difference) {
+                steep = true;
+              }
+            }
+            if (steep) {
+              break;
+            }
+          }
+        }
+      }
+      refine[b] = steep;
+    }
+  }
+
+  // Keep the patches of blocks that remain refined. The coarse grid already
+  // contains the values of removed patches.
+  std::vector<Patch> patches;
+  std::vector<size_t> new_patches;
+  for (size_t b = 0; b < num_blocks; b++) {
+    auto old = block_patch_[b];
+    block_patch_[b] = -1;
+    if (!refine[b]) {
+      continue;
+    }
+    if (old >= 0) {
+      patches.push_back(std::move(patches_[old]));
+    } else {
+      patches.emplace_back();
+      patches.back().origin = {b % nb[0] * bs, (b / nb[0]) % nb[1] * bs,
+                               b / (nb[0] * nb[1]) * bs};
+      new_patches.push_back(patches.size() - 1);
+    }
+    block_patch_[b] = patches.size() - 1;
+  }
+  patches_.swap(patches);
+
+  int64_t num_new = new_patches.size();
+#pragma omp parallel for schedule(dynamic)
+  for (int64_t i = 0; i < num_new; i++) {
+    InitializePatch(&patches_[new_patches[i]], closed);
+  }
+}
+
+void AmrGrid::InitializePatch(Patch* patch, bool closed) const {
+  auto& p = *patch;
+  for (int i = 0; i < 3; i++) {
+    int64_t boxes = std::min(block_size_, num_boxes_axis_[i] - p.origin[i]);
+    p.size[i] = kRatio * boxes;
+    p.lo[i] = 0;
+    p.hi[i] = p.size[i];
+    // The values at closed edges remain unchanged
+    if (closed && p.origin[i] == 0) {
+      p.lo[i] = kRatio;
+    }
+    if (closed && p.origin[i] + boxes == num_boxes_axis_[i]) {
+      p.hi[i] = p.size[i] - kRatio;
+    }
+  }
+
+  const size_t total = (p.size[0] + 2) * (p.size[1] + 2) * (p.size[2] + 2);
+  p.c1.resize(total);
+  p.c2.resize(total);
+  p.halo.clear();
+  p.halo_coord.clear();
+  for (int64_t z = -1; z <= p.size[2]; z++) {
+    for (int64_t y = -1; y <= p.size[1]; y++) {
+      for (int64_t x = -1; x <= p.size[0]; x++) {
+        Double3 coord = {p.origin[0] + static_cast<double>(x) / kRatio,
+                         p.origin[1] + static_cast<double>(y) / kRatio,
+                         p.origin[2] + static_cast<double>(z) / kRatio};
+        auto idx = p.Index(x, y, z);
+        p.c1[idx] = Interpolate(c1_.data(), coord, closed);
+        if (x < p.lo[0] || x >= p.hi[0] || y < p.lo[1] || y >= p.hi[1] ||
+            z < p.lo[2] || z >= p.hi[2]) {
+          p.halo.push_back(idx);
+          p.halo_coord.push_back(coord);
+        }
+      }
+    }
+  }
+  p.c2 = p.c1;
+}
+
+void AmrGrid::SampleHalo(const Patch& patch, bool closed,
+                         std::vector<double>* values) const {
+  values->resize(patch.halo.size());
+  for (size_t h = 0; h < patch.halo.size(); h++) {
+    (*values)[h] = Interpolate(c1_.data(), patch.halo_coord[h], closed);
+  }
+}
+
+void AmrGrid::AdvancePatch(Patch* patch, double dt, uint64_t substeps) const {
+  auto& p = *patch;
+  const double ibl2 = kRatio * kRatio / (box_length_ * box_length_);
+  const double d = 1 - dc_[0];
+  // The coarse grid decays by (1 - mu) per coarse substep
+  const double decay = std::pow(1 - mu_, 1.0 / (kRatio * kRatio));
+  const int64_t sy = p.size[0] + 2;
+  const int64_t sz = sy * (p.size[1] + 2);
+
+  for (uint64_t step = 0; step < substeps; step++) {
+    double alpha = static_cast<double>(step) / substeps;
+    for (size_t h = 0; h < p.halo.size(); h++) {
+      p.c1[p.halo[h]] = (1 - alpha) * p.halo_old[h] + alpha * p.halo_new[h];
+    }
+    const double* c1 = p.c1.data();
+    double* c2 = p.c2.data();
+    for (int64_t z = p.lo[2]; z < p.hi[2]; z++) {
+      for (int64_t y = p.lo[1]; y < p.hi[1]; y++) {
+        const int64_t row = p.Index(0, y, z);
+#pragma omp simd
+        for (int64_t x = p.lo[0]; x < p.hi[0]; x++) {
+          int64_t c = row + x;
+          c2[c] = (c1[c] + d * dt * (c1[c - 1] - 2 * c1[c] + c1[c + 1]) * ibl2 +
+                   d * dt * (c1[c - sy] - 2 * c1[c] + c1[c + sy]) * ibl2 +
+                   d * dt * (c1[c - sz] - 2 * c1[c] + c1[c + sz]) * ibl2) *
+                  decay;
+        }
+      }
+    }
+    p.c1.swap(p.c2);
+  }
+  for (size_t h = 0; h < p.halo.size(); h++) {
+    p.c1[p.halo[h]] = p.halo_new[h];
+  }
+}
+
+void AmrGrid::Restrict(const Patch& patch) {
+  const auto nx = num_boxes_axis_[0];
+  const auto ny = num_boxes_axis_[1];
+  // Full weighting: weight 1/2 for the fine box at the position of the coarse
+  // box and 1/4 for its two neighbors along each axis
+  static constexpr double kWeights[3] = {0.25, 0.5, 0.25};
+  for (int64_t z = 0; z < patch.size[2]; z += kRatio) {
+    for (int64_t y = 0; y < patch.size[1]; y += kRatio) {
+      for (int64_t x = 0; x < patch.size[0]; x += kRatio) {
+        if (x < patch.lo[0] || x >= patch.hi[0] || y < patch.lo[1] ||
+            y >= patch.hi[1] || z < patch.lo[2] || z >= patch.hi[2]) {
+          continue;
+        }
+        double value = 0;
+        for (int dz = -1; dz <= 1; dz++) {
+          for (int dy = -1; dy <= 1; dy++) {
+            for (int dx = -1; dx <= 1; dx++) {
+              value += kWeights[dx + 1] * kWeights[dy + 1] * kWeights[dz + 1] *
+                       patch.c1[patch.Index(x + dx, y + dy, z + dz)];
+            }
+          }
+        }
+        size_t cx = patch.origin[0] + x / kRatio;
+        size_t cy = patch.origin[1] + y / kRatio;
+        size_t cz = patch.origin[2] + z / kRatio;
+        auto idx = cz * nx * ny + cy * nx + cx;
+        c1_[idx] = value;
+        WakeTile(idx);
+      }
+    }
+  }
+}
+
+double AmrGrid::Interpolate(const DiffusionReal* c, const Double3& coord,
+                            bool closed) const {
+  std::array<int64_t, 3> n;
+  std::array<int64_t, 3> i0;
+  Double3 t;
+  for (int i = 0; i < 3; i++) {
+    n[i] = num_boxes_axis_[i];
+    double u = std::min(std::max(coord[i], -1.0), static_cast<double>(n[i]));
+    i0[i] = static_cast<int64_t>(std::floor(u));
+    t[i] = u - i0[i];
+  }
+
+  double value = 0;
+  for (int corner = 0; corner < 8; corner++) {
+    double w = 1;
+    std::array<int64_t, 3> box;
+    bool outside = false;
+    for (int i = 0; i < 3; i++) {
+      int bit = (corner >> i) & 1;
+      w *= bit ? t[i] : 1 - t[i];
+      box[i] = i0[i] + bit;
+      if (box[i] < 0 || box[i] >= n[i]) {
+        outside = true;
+        box[i] = std::min(std::max<int64_t>(box[i], 0), n[i] - 1);
+      }
+    }
+    if (w == 0 || (outside && !closed)) {
+      continue;
+    }
+    value += w * c[(box[2] * n[1] + box[1]) * n[0] + box[0]];
+  }
+  return value;
+}
+
+int64_t AmrGrid::FindPatch(const Double3& position,
+                           std::array<int64_t, 3>* fine) const {
+  if (patches_.empty()) {
+    return -1;
+  }
+  const double fine_box_length = box_length_ / kRatio;
+  std::array<size_t, 3> block;
+  for (int i = 0; i < 3; i++) {
+    auto g = static_cast<int64_t>(std::floor(
+        (std::floor(position[i]) - grid_dimensions_[2 * i]) / fine_box_length));
+    if (g < 0 || static_cast<size_t>(g / kRatio) >= num_boxes_axis_[i]) {
+      return -1;
+    }
+    (*fine)[i] = g;
+    block[i] = g / kRatio / block_size_;
+  }
+  auto idx = block_patch_[(block[2] * num_blocks_[1] + block[1]) *
+                              num_blocks_[0] +
+                          block[0]];
+  if (idx >= 0) {
+    for (int i = 0; i < 3; i++) {
+      (*fine)[i] -= patches_[idx].origin[i] * kRatio;
+    }
+  }
+  return idx;
+}
+
+bool AmrGrid::IsRefined(const Double3& position) const {
+  std::array<int64_t, 3> fine;
+  return FindPatch(position, &fine) >= 0;
+}
+
+void AmrGrid::ChangeConcentrationBy(const Double3& position, double amount) {
+  std::array<int64_t, 3> fine;
+  auto p = FindPatch(position, &fine);
+  if (p < 0) {
+    DiffusionGrid::ChangeConcentrationBy(position, amount);
+    return;
+  }
+  auto& patch = patches_[p];
+  // Keep the coarse grid consistent until the next restriction
+  auto idx = GetBoxIndex(position);
+  AtomicAdd(c1_.data() + idx, amount, lower_threshold_, upper_threshold_);
+  WakeTile(idx);
+  AtomicAdd(patch.c1.data() + patch.Index(fine[0], fine[1], fine[2]),
+            kRatio * kRatio * kRatio * amount, lower_threshold_,
+            upper_threshold_);
+}
+
+double AmrGrid::GetConcentration(const Double3& position) const {
+  std::array<int64_t, 3> fine;
+  auto p = FindPatch(position, &fine);
+  if (p < 0) {
+    return DiffusionGrid::GetConcentration(position);
+  }
+  const auto& patch = patches_[p];
+  return AtomicLoad(patch.c1.data() + patch.Index(fine[0], fine[1], fine[2]));
+}
+
+void AmrGrid::GetGradient(const Double3& position, Double3* gradient) const {
+  std::array<int64_t, 3> fine;
+  auto p = FindPatch(position, &fine);
+  if (p < 0) {
+    DiffusionGrid::GetGradient(position, gradient);
+    return;
+  }
+  const auto& patch = patches_[p];
+  const auto& c = patch.c1;
+  const double gd = kRatio / (box_length_ * 2);
+  const auto x = fine[0];
+  const auto y = fine[1];
+  const auto z = fine[2];
+  (*gradient)[0] =
+      (c[patch.Index(x + 1, y, z)] - c[patch.Index(x - 1, y, z)]) * gd;
+  (*gradient)[1] =
+      (c[patch.Index(x, y + 1, z)] - c[patch.Index(x, y - 1, z)]) * gd;
+  (*gradient)[2] =
+      (c[patch.Index(x, y, z + 1)] - c[patch.Index(x, y, z - 1)]) * gd;
+  auto norm = gradient->Norm();
+  if (norm > 1e-10) {
+    gradient->Normalize();
+  }
+}
+
+void AmrGrid::GetConcentrations(const std::vector<Double3>& positions,
+                                std::vector<double>* values) const {
+  values->resize(positions.size());
+  for (size_t p = 0; p < positions.size(); p++) {
+    (*values)[p] = GetConcentration(positions[p]);
+  }
+}
+
+void AmrGrid::GetGradients(const std::vector<Double3>& positions,
+                           std::vector<Double3>* gradients) const {
+  gradients->resize(positions.size());
+  for (size_t p = 0; p < positions.size(); p++) {
+    (*gradients)[p] = {0, 0, 0};
+    GetGradient(positions[p], &(*gradients)[p]);
+  }
+}
+
+}  // namespace bdm
@@ -0,0 +1,160 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef CORE_DIFFUSION_AMR_GRID_H_
+#define CORE_DIFFUSION_AMR_GRID_H_
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "core/diffusion/euler_grid.h"
+#include "core/util/root.h"
+
+namespace bdm {
+
+/// Diffusion grid with block-structured adaptive mesh refinement.\n
+/// The grid is divided into blocks of `Param::diffusion_amr_block_size`^3
+/// boxes. Blocks that contain at least `Param::diffusion_amr_agent_threshold`
+/// agents, or in which a component of the gradient reaches
+/// `Param::diffusion_amr_gradient_threshold`, are covered by a patch with
+/// half the box length. The refinement is updated at the beginning of each
+/// diffusion step. New patches are interpolated from the coarse grid.\n
+/// Each step first advances the coarse grid with the "euler" method. Then,
+/// each patch performs `kRatio^2` explicit substeps per coarse substep; hence,
+/// the stability limit is the same as for the coarse grid. The values around
+/// a patch (and at closed edges) are interpolated from the coarse grid in
+/// space and time. Finally, the coarse boxes covered by a patch are replaced
+/// by the full-weighting average of the fine boxes.\n
+/// `GetConcentration`, `GetGradient`, and `ChangeConcentrationBy` use the
+/// fine boxes inside patches. A change of the concentration of a fine box by
+/// `kRatio^3 * amount` changes the coarse grid by `amount`; therefore,
+/// secretion adds the same amount of substance as without refinement.\n
+/// The coarse grid holds the result of each step; exports, backups, and
+/// `CalculateGradient` use the coarse grid.\n
+/// Selected with `Param::diffusion_method = "amr"`.
+class AmrGrid : public EulerGrid {
+ public:
+  /// Ratio between the box length of the coarse grid and of the patches
+  static constexpr int kRatio = 2;
+
+  AmrGrid() {}
+  AmrGrid(int substance_id, std::string substance_name, double dc, double mu,
+          int resolution = 11)
+      : EulerGrid(substance_id, std::move(substance_name), dc, mu,
+                  resolution) {}
+
+  void Initialize() override;
+
+  void Update() override;
+
+  void DiffuseWithClosedEdge(double dt) override;
+
+  void DiffuseWithOpenEdge(double dt) override;
+
+  using DiffusionGrid::ChangeConcentrationBy;
+  void ChangeConcentrationBy(const Double3& position, double amount) override;
+
+  double GetConcentration(const Double3& position) const override;
+
+  void GetGradient(const Double3& position, Double3* gradient) const override;
+
+  void GetConcentrations(const std::vector<Double3>& positions,
+                         std::vector<double>* values) const override;
+
+  void GetGradients(const std::vector<Double3>& positions,
+                    std::vector<Double3>* gradients) const override;
+
+  /// Returns true if `position` is covered by a patch
+  bool IsRefined(const Double3& position) const;
+
+  /// Returns the number of refined blocks
+  size_t GetNumPatches() const { return patches_.size(); }
+
+ private:
+  /// Refined copy of one block
+  struct Patch {
+    /// Coordinates of the first coarse box of the block
+    std::array<size_t, 3> origin;
+    /// Number of fine boxes along each axis
+    std::array<int64_t, 3> size;
+    /// Range [lo, hi) of the fine boxes that are updated with the stencil.
+    /// The remaining boxes (at closed edges) and one layer of boxes around
+    /// the patch form the halo, which is set from the coarse grid.
+    std::array<int64_t, 3> lo;
+    std::array<int64_t, 3> hi;
+    /// Fine concentrations including the layer around the patch
+    std::vector<double> c1;
+    std::vector<double> c2;
+    /// Index into `c1` and coarse box coordinates of each halo box
+    std::vector<size_t> halo;
+    std::vector<Double3> halo_coord;
+    /// Coarse values at the halo at the beginning and end of the step
+    std::vector<double> halo_old;
+    std::vector<double> halo_new;
+
+    size_t Index(int64_t x, int64_t y, int64_t z) const {
+      return ((z + 1) * (size[1] + 2) + y + 1) * (size[0] + 2) + x + 1;
+    }
+  };
+
+  void DiffuseWithPatches(double dt, bool closed);
+
+  /// Determines the blocks that need refinement and creates or removes the
+  /// corresponding patches
+  void Regrid(bool closed);
+
+  /// Sets the geometry and the halo of `patch` and interpolates its values
+  /// from the coarse grid
+  void InitializePatch(Patch* patch, bool closed) const;
+
+  /// Interpolates the coarse concentrations at the halo of `patch`
+  void SampleHalo(const Patch& patch, bool closed,
+                  std::vector<double>* values) const;
+
+  /// Advances `patch` by `substeps` explicit substeps of `dt`. The halo is
+  /// interpolated linearly in time between `halo_old` and `halo_new`.
+  void AdvancePatch(Patch* patch, double dt, uint64_t substeps) const;
+
+  /// Replaces the coarse boxes covered by `patch` with the average of the
+  /// fine boxes
+  void Restrict(const Patch& patch);
+
+  /// Trilinear interpolation of `c` (coarse grid) at the continuous box
+  /// coordinates `coord`. Outside the grid, the concentration is the one at
+  /// the closest box if `closed` is true and zero otherwise.
+  double Interpolate(const DiffusionReal* c, const Double3& coord,
+                     bool closed) const;
+
+  /// Returns the index of the patch that covers `position` and sets `fine`
+  /// to the coordinates of the fine box. Returns -1 if `position` is not
+  /// refined.
+  int64_t FindPatch(const Double3& position,
+                    std::array<int64_t, 3>* fine) const;
+
+  /// Parameters of the current refinement
+  uint64_t block_size_ = 0;                   //!
+  std::array<size_t, 3> num_blocks_ = {{0}};  //!
+  bool closed_ = true;                        //!
+  /// Index into `patches_` for each block, or -1
+  std::vector<int64_t> block_patch_;  //!
+  std::vector<Patch> patches_;        //!
+
+  BDM_CLASS_DEF_OVERRIDE(AmrGrid, 1);
+};
+
+}  // namespace bdm
+
+#endif  // CORE_DIFFUSION_AMR_GRID_H_
@@ -13,13 +13,67 @@
 // -----------------------------------------------------------------------------
 
 #include "core/diffusion/diffusion_grid.h"
-#include <mutex>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <memory>
 #include "core/environment/environment.h"
 #include "core/simulation.h"
 #include "core/util/log.h"
 
 namespace bdm {
 
+namespace {
+
+/// Read-only memory mapping of a file
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& file_name) {
+    int fd = open(file_name.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) == -1) {
+      Log::Fatal("MappedFile", "Could not open the file '", file_name, "'");
+    }
+    size_ = st.st_size;
+    if (size_ != 0) {
+      data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data_ == MAP_FAILED) {
+        Log::Fatal("MappedFile", "Could not map the file '", file_name, "'");
+      }
+    }
+    close(fd);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+    if (data_ != nullptr) {
+      munmap(data_, size_);
+    }
+  }
+
+  template <typename T>
+  const T* GetData() const {
+    return static_cast<const T*>(data_);
+  }
+
+  size_t GetSize() const { return size_; }
+
+ private:
+  void* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+}  // namespace
+
+constexpr size_t DiffusionGrid::kTileSize;
+constexpr uint8_t DiffusionGrid::kTileIdle;
+constexpr uint8_t DiffusionGrid::kTileSync;
+constexpr uint8_t DiffusionGrid::kTileActive;
+
 void DiffusionGrid::Initialize() {
   if (resolution_ == 0) {
     Log::Fatal("DiffusionGrid::Initialize",
@@ -27,11 +81,17 @@ void DiffusionGrid::Initialize() {
                "')");
   }
 
-  // Get neighbor grid dimensions
-  auto* env = Simulation::GetActive()->GetEnvironment();
-  auto bounds = env->GetDimensionThresholds();
-
-  grid_dimensions_ = {bounds[0], bounds[1]};
+  if (has_domain_) {
+    grid_dimensions_ = domain_;
+  } else {
+    // Get neighbor grid dimensions
+    auto* env = Simulation::GetActive()->GetEnvironment();
+    auto bounds = env->GetDimensionThresholds();
+    grid_dimensions_ = {bounds[0], bounds[1], bounds[0],
+                        bounds[1], bounds[0], bounds[1]};
+  }
+  auto grid_size = GetGridSize();
+  auto max_length = *std::max_element(grid_size.begin(), grid_size.end());
 
   // Example: diffusion grid dimensions from 0-40 and resolution
   // of 4. Resolution must be adjusted otherwise one data pointer will be
@@ -44,8 +104,7 @@ void DiffusionGrid::Initialize() {
   //   data points: {0, 13.3, 26.6, 39.9}
   auto adjusted_res =
       resolution_ == 1 ? 2 : resolution_;  // avoid division by 0
-  box_length_ = (grid_dimensions_[1] - grid_dimensions_[0]) /
-                static_cast<double>(adjusted_res - 1);
+  box_length_ = max_length / static_cast<double>(adjusted_res - 1);
   // TODO(ahmad): parametrize the minimum box_length
   if (box_length_ <= 1e-15) {
     Log::Fatal("DiffusionGrid::Initialize",
@@ -54,15 +113,34 @@ void DiffusionGrid::Initialize() {
                substance_name_, "'");
   }
 
+  // The longest axis has `resolution_` boxes. The shorter axes have as many
+  // boxes as required to cover their length.
+  for (int i = 0; i < 3; i++) {
+    if (resolution_ == 1) {
+      num_boxes_axis_[i] = 1;
+      continue;
+    }
+    auto boxes = std::ceil(grid_size[i] / box_length_ - 1e-9) + 1;
+    num_boxes_axis_[i] =
+        std::min(static_cast<size_t>(std::max(boxes, 1.0)), resolution_);
+  }
+
+  inv_box_length_ = 1 / box_length_;
   box_volume_ = box_length_ * box_length_ * box_length_;
-  parity_ = resolution_ % 2;
-  total_num_boxes_ = resolution_ * resolution_ * resolution_;
+  total_num_boxes_ =
+      num_boxes_axis_[0] * num_boxes_axis_[1] * num_boxes_axis_[2];
 
   // Allocate memory for the concentration and gradient arrays
-  locks_.resize(total_num_boxes_);
+  tile_state_.clear();
   c1_.resize(total_num_boxes_);
   c2_.resize(total_num_boxes_);
-  gradients_.resize(total_num_boxes_);
+  lazy_gradients_ =
+      Simulation::GetActive()->GetParam()->diffusion_lazy_gradients;
+  if (lazy_gradients_) {
+    ParallelResizeVector<Double3>().swap(gradients_);
+  } else {
+    gradients_.resize(total_num_boxes_);
+  }
 }
 
 void DiffusionGrid::Diffuse(double dt) {
@@ -75,7 +153,7 @@ void DiffusionGrid::Diffuse(double dt) {
   // Note down last timestep
   last_dt_ = dt;
   // Set timestep for this iteration.
-  ParametersCheck(dt);
+  ParametersCheck(dt / GetNumSubsteps());
 
   auto* param = Simulation::GetActive()->GetParam();
   if (param->diffusion_boundary_condition == "closed") {
@@ -91,100 +169,158 @@ void DiffusionGrid::Diffuse(double dt) {
 }
 
 void DiffusionGrid::Update() {
+  // A user-defined domain does not grow
+  if (has_domain_) {
+    return;
+  }
   // Get neighbor grid dimensions
-  auto* env = Simulation::GetActive()->GetEnvironment();
+  auto* sim = Simulation::GetActive();
+  auto* env = sim->GetEnvironment();
   auto bounds = env->GetDimensionThresholds();
-  // Update the grid dimensions such that each dimension ranges from
-  // {bounds[0] - bounds[1]}
-  grid_dimensions_ = {bounds[0], bounds[1]};
-
-  // If the grid is not perfectly divisible along each dimension by the
-  // box length, extend the grid so that it is
-  int dimension_length = bounds[1] - bounds[0];
-  for (int i = 0; i < 1; i++) {
-    int r = fmod(dimension_length, box_length_);
-    if (r > 1e-9) {
-      // std::abs for the case that box_length_ > dimension_length
-      grid_dimensions_[2 * i + 1] += (box_length_ - r);
-    }
-  }
-
-  // Calculate new_dimension_length and new_resolution
-  int new_dimension_length = grid_dimensions_[1] - grid_dimensions_[0];
-  size_t new_resolution = std::ceil(new_dimension_length / box_length_);
 
-  if (new_resolution > resolution_) {
-    // Store the old number of boxes along each axis for comparison
-    size_t tmp_resolution = resolution_;
-
-    // Set new resolution
-    resolution_ = new_resolution;
+  // The environment grows on each side independently. The grid must be
+  // extended as soon as the environment leaves it on any side.
+  bool grown = false;
+  for (int i = 0; i < 3; i++) {
+    grown |= bounds[0] < grid_dimensions_[2 * i] ||
+             bounds[1] > grid_dimensions_[2 * i + 1];
+  }
+  if (!grown) {
+    return;
+  }
 
-    // We need to maintain the parity of the number of boxes along each
-    // dimension, otherwise copying of the substances to the increases grid
-    // will not be symmetrically done; resulting in shifting of boxes
-    // We add a box in the negative direction, because the only way the parity
-    // could have changed is because of adding a box in the positive direction
-    // (due to the grid not being perfectly divisible; see above)
-    if (resolution_ % 2 != parity_) {
-      grid_dimensions_[0] -= box_length_;
-      resolution_++;
+  // Store the old grid for comparison
+  auto old_num_boxes = num_boxes_axis_;
+  auto old_dimensions = grid_dimensions_;
+  auto headroom = sim->GetParam()->diffusion_grid_headroom;
+  resolution_ = 0;
+  for (int i = 0; i < 3; i++) {
+    // Number of boxes that are added below and above the old grid. The old
+    // boxes keep their position, such that their values can be copied.
+    size_t below = 0;
+    size_t above = 0;
+    if (bounds[0] < old_dimensions[2 * i]) {
+      below = std::ceil((old_dimensions[2 * i] - bounds[0]) *
+                            inv_box_length_ - 1e-9);
     }
+    if (bounds[1] > old_dimensions[2 * i + 1]) {
+      above = std::ceil((bounds[1] - old_dimensions[2 * i + 1]) *
+                            inv_box_length_ - 1e-9);
+    }
+    // Add the same number of extra boxes on both sides of an axis that
+    // grows, such that further growth of the environment does not require
+    // reallocating the grid
+    if (below + above > 0) {
+      auto extra = static_cast<size_t>(
+          std::ceil(0.5 * headroom * (old_num_boxes[i] + below + above)));
+      below += extra;
+      above += extra;
+    }
+    grid_dimensions_[2 * i] = std::floor(old_dimensions[2 * i] -
+                                         below * box_length_ + 0.5);
+    grid_dimensions_[2 * i + 1] = std::floor(old_dimensions[2 * i + 1] +
+                                             above * box_length_ + 0.5);
+    num_boxes_axis_[i] += below + above;
+    resolution_ = std::max(resolution_, num_boxes_axis_[i]);
+  }
 
-    // Temporarily save previous grid data
-    auto tmp_c1 = c1_;
-    auto tmp_gradients = gradients_;
-
-    c1_.clear();
-    c2_.clear();
-    gradients_.clear();
+  // Move the previous grid data out of the way (without copying it)
+  ParallelResizeVector<DiffusionReal> old_c1;
+  ParallelResizeVector<Double3> old_gradients;
+  old_c1.swap(c1_);
+  old_gradients.swap(gradients_);
+  c2_.clear();
 
-    total_num_boxes_ = resolution_ * resolution_ * resolution_;
+  total_num_boxes_ =
+      num_boxes_axis_[0] * num_boxes_axis_[1] * num_boxes_axis_[2];
 
-    CopyOldData(tmp_c1, tmp_gradients, tmp_resolution);
-  }
+  CopyOldData(old_c1, old_gradients, old_num_boxes, old_dimensions);
 }
 
 void DiffusionGrid::CopyOldData(
-    const ParallelResizeVector<double>& old_c1,
-    const ParallelResizeVector<Double3>& old_gradients, size_t old_resolution) {
+    const ParallelResizeVector<DiffusionReal>& old_c1,
+    const ParallelResizeVector<Double3>& old_gradients,
+    const std::array<size_t, 3>& old_num_boxes,
+    const std::array<int32_t, 6>& old_dimensions) {
   // Allocate more memory for the grid data arrays
-  locks_.resize(total_num_boxes_);
+  tile_state_.clear();
   c1_.resize(total_num_boxes_);
   c2_.resize(total_num_boxes_);
-  gradients_.resize(total_num_boxes_);
-
-  Log::Warning(
-      "DiffusionGrid::CopyOldData",
-      "The size of the diffusion grid "
-      "increased. BioDynaMo adds a halo around the domain filled with zeros. "
-      "Depending your use-case, this might or might not be what you want. If "
-      "you have non-zero concentrations / temperatures in the surrounding, "
-      "this is likely to cause unphysical effects at the boudary. But if your "
-      "grid values are mostly zero this is likely to work fine. Evaluate your "
-      "results carefully.");
-
-  auto incr_num_boxes = resolution_ - old_resolution;
-  int off_dim = incr_num_boxes / 2;
-
-  int num_box_xy = resolution_ * resolution_;
-  int old_box_xy = old_resolution * old_resolution;
-  int new_origin = off_dim * (num_box_xy) + off_dim * resolution_ + off_dim;
-  for (size_t k = 0; k < old_resolution; k++) {
-    int offset = new_origin + k * num_box_xy;
-    for (size_t j = 0; j < old_resolution; j++) {
-      if (j != 0) {
-        offset += resolution_;
-      }
-      for (size_t i = 0; i < old_resolution; i++) {
-        auto idx = k * old_box_xy + j * old_resolution + i;
-        c1_[offset + i] = old_c1[idx];
-        gradients_[offset + i] = old_gradients[idx];
+  if (!lazy_gradients_) {
+    gradients_.resize(total_num_boxes_);
+  }
+
+  if (halo_fill_ == HaloFill::kZero) {
+    Log::Warning(
+        "DiffusionGrid::CopyOldData",
+        "The size of the diffusion grid "
+        "increased. BioDynaMo adds a halo around the domain filled with "
+        "zeros. Depending your use-case, this might or might not be what you "
+        "want. If you have non-zero concentrations / temperatures in the "
+        "surrounding, this is likely to cause unphysical effects at the "
+        "boudary. But if your grid values are mostly zero this is likely to "
+        "work fine. Evaluate your results carefully. See "
+        "DiffusionGrid::SetHaloFill for alternatives.");
+  }
+
+  // Position of the old grid in the new one. The environment does not grow
+  // symmetrically, so the offset is determined from the coordinates.
+  std::array<int64_t, 3> off;
+  for (int i = 0; i < 3; i++) {
+    off[i] = std::lround((old_dimensions[2 * i] - grid_dimensions_[2 * i]) *
+                         inv_box_length_);
+  }
+  // Coordinate of the old grid that corresponds to coordinate `x` of the new
+  // grid along axis `axis`, clamped to the old grid. Sets `inside` to false
+  // if `x` is part of the halo.
+  auto old_coord = [&](size_t x, int axis, bool* inside) -> size_t {
+    auto o = static_cast<int64_t>(x) - off[axis];
+    if (o < 0) {
+      *inside = false;
+      return 0;
+    }
+    if (o >= static_cast<int64_t>(old_num_boxes[axis])) {
+      *inside = false;
+      return old_num_boxes[axis] - 1;
+    }
+    return o;
+  };
+
+  const auto nx = num_boxes_axis_[0];
+  const auto ny = num_boxes_axis_[1];
+  const auto nz = num_boxes_axis_[2];
+  const auto old_nx = old_num_boxes[0];
+  const auto old_ny = old_num_boxes[1];
+  const bool copy_gradients = !lazy_gradients_;
+  const auto halo_fill = halo_fill_;
+  const double halo_value =
+      halo_fill == HaloFill::kConstant ? halo_value_ : 0;
+#pragma omp parallel for collapse(2)
+  for (size_t k = 0; k < nz; k++) {
+    for (size_t j = 0; j < ny; j++) {
+      bool row_inside = true;
+      auto old_k = old_coord(k, 2, &row_inside);
+      auto old_j = old_coord(j, 1, &row_inside);
+      auto old_row = (old_k * old_ny + old_j) * old_nx;
+      auto row = (k * ny + j) * nx;
+      for (size_t i = 0; i < nx; i++) {
+        bool inside = row_inside;
+        auto old_idx = old_row + old_coord(i, 0, &inside);
+        if (inside) {
+          c1_[row + i] = old_c1[old_idx];
+        } else {
+          c1_[row + i] = halo_fill == HaloFill::kExtrapolate ? old_c1[old_idx]
+                                                              : halo_value;
+        }
+        if (copy_gradients) {
+          gradients_[row + i] =
+              inside ? old_gradients[old_idx] : Double3({0, 0, 0});
+        }
+        // The boundaries of both buffers must be equivalent
+        c2_[row + i] = c1_[row + i];
       }
     }
   }
-  // TODO: here we also need to copy c1_ into c2_ such that the boundaries are
-  // equivalent once we introduce non-zero halos.
 }
 
 void DiffusionGrid::RunInitializers() {
@@ -192,35 +328,107 @@ void DiffusionGrid::RunInitializers() {
     return;
   }
 
-  auto nx = resolution_;
-  auto ny = resolution_;
-  auto nz = resolution_;
-
-  // Apply all functions that initialize this diffusion grid
-  for (size_t f = 0; f < initializers_.size(); f++) {
-    for (uint32_t x = 0; x < nx; x++) {
-      double real_x = grid_dimensions_[0] + x * box_length_;
-      for (uint32_t y = 0; y < ny; y++) {
-        double real_y = grid_dimensions_[0] + y * box_length_;
-        for (uint32_t z = 0; z < nz; z++) {
-          double real_z = grid_dimensions_[0] + z * box_length_;
-          std::array<uint32_t, 3> box_coord = {x, y, z};
-          size_t idx = GetBoxIndex(box_coord);
-          double value = initializers_[f](real_x, real_y, real_z);
-          ChangeConcentrationBy(idx, value);
+  const auto nx = num_boxes_axis_[0];
+  const auto ny = num_boxes_axis_[1];
+  const auto nz = num_boxes_axis_[2];
+
+  // files[i] is the mapped file of initializers_[i] (nullptr for functions)
+  std::vector<std::unique_ptr<MappedFile>> files(initializers_.size());
+  for (size_t i = 0; i < initializers_.size(); i++) {
+    if (initializers_[i].function) {
+      continue;
+    }
+    const auto& file_name = initializers_[i].file_name;
+    files[i].reset(new MappedFile(file_name));
+    if (files[i]->GetSize() != total_num_boxes_ * sizeof(double)) {
+      Log::Fatal("DiffusionGrid::RunInitializers", "The file '", file_name,
+                 "' has ", files[i]->GetSize(), " bytes, but the grid of "
+                 "substance '", substance_name_, "' requires ",
+                 total_num_boxes_ * sizeof(double), " bytes (",
+                 num_boxes_axis_[0], " x ", num_boxes_axis_[1], " x ",
+                 num_boxes_axis_[2], " doubles).");
+    }
+  }
+
+  const double lower = lower_threshold_;
+  const double upper = upper_threshold_;
+  auto clamp = [&](DiffusionReal* row) {
+    for (size_t x = 0; x < nx; x++) {
+      row[x] = std::min(std::max<double>(row[x], lower), upper);
+    }
+  };
+
+  // Apply all files and functions that initialize this diffusion grid
+#pragma omp parallel for collapse(2)
+  for (size_t z = 0; z < nz; z++) {
+    for (size_t y = 0; y < ny; y++) {
+      double real_y = grid_dimensions_[2] + y * box_length_;
+      double real_z = grid_dimensions_[4] + z * box_length_;
+      size_t offset = (z * ny + y) * nx;
+      DiffusionReal* row = &c1_[offset];
+      for (size_t i = 0; i < initializers_.size(); i++) {
+        if (files[i]) {
+          const double* values = files[i]->GetData<double>() + offset;
+          for (size_t x = 0; x < nx; x++) {
+            row[x] += values[x];
+          }
+        } else {
+          initializers_[i].function(grid_dimensions_[0], real_y, real_z,
+                                    box_length_, nx, row);
         }
+        clamp(row);
       }
+      // Copy data to second array to ensure valid Dirichlet Boundary
+      // Conditions
+      std::copy(row, row + nx, &c2_[offset]);
     }
   }
-  // Copy data to second array to ensure valid Dirichlet Boundary Conditions
-  c2_ = c1_;
+  // The concentrations changed everywhere
+  tile_state_.clear();
 
   // Clear the initializer to free up space
   initializers_.clear();
   initializers_.shrink_to_fit();
 }
 
+Double3 DiffusionGrid::ComputeGradient(size_t x, size_t y, size_t z) const {
+  const std::array<size_t, 3> box = {x, y, z};
+  const std::array<size_t, 3> stride = {
+      1, num_boxes_axis_[0], num_boxes_axis_[0] * num_boxes_axis_[1]};
+  const size_t c = x * stride[0] + y * stride[1] + z * stride[2];
+  const double gd = 0.5 * inv_box_length_;
+
+  Double3 gradient;
+  for (int i = 0; i < 3; i++) {
+    const auto n = num_boxes_axis_[i];
+    // Distance of the neighbors used at the first and last box of an axis.
+    // Axes with a single box have no gradient.
+    const size_t edge = std::min<size_t>(n - 1, 2) * stride[i];
+    size_t lo, hi;
+    if (box[i] == 0) {
+      lo = c;
+      hi = c + edge;
+    } else if (box[i] == n - 1) {
+      lo = c - edge;
+      hi = c;
+    } else {
+      lo = c - stride[i];
+      hi = c + stride[i];
+    }
+    // Let the gradient point from low to high concentration
+    gradient[i] =
+        (AtomicLoad(c1_.data() + hi) - AtomicLoad(c1_.data() + lo)) * gd;
+  }
+  return gradient;
+}
+
 void DiffusionGrid::CalculateGradient() {
+  // The gradients are computed when they are requested. Until the first
+  // call, they are zero as the stored gradients (see `GetBoxGradient`).
+  if (lazy_gradients_) {
+    init_gradient_ = true;
+    return;
+  }
   // check if gradient has been calculated once
   // and if diffusion coefficient and decay constant are 0
   // i.e. if we don't need to calculate gradient update
@@ -228,56 +436,21 @@ void DiffusionGrid::CalculateGradient() {
     return;
   }
 
-  double gd = 1 / (box_length_ * 2);
+  auto nx = num_boxes_axis_[0];
+  auto ny = num_boxes_axis_[1];
+  auto nz = num_boxes_axis_[2];
 
-  auto nx = resolution_;
-  auto ny = resolution_;
-  auto nz = resolution_;
+  // The gradients of idle tiles did not change since the last call
+  const bool skip_idle = init_gradient_ && !tile_state_.empty();
 
 #pragma omp parallel for collapse(2)
   for (size_t z = 0; z < nz; z++) {
     for (size_t y = 0; y < ny; y++) {
+      if (skip_idle && tile_state_[GetTileIndex(y, z)] == kTileIdle) {
+        continue;
+      }
       for (size_t x = 0; x < nx; x++) {
-        int c, e, w, n, s, b, t;
-        c = x + y * nx + z * nx * ny;
-
-        if (x == 0) {
-          e = c;
-          w = c + 2;
-        } else if (x == nx - 1) {
-          e = c - 2;
-          w = c;
-        } else {
-          e = c - 1;
-          w = c + 1;
-        }
-
-        if (y == 0) {
-          n = c + 2 * nx;
-          s = c;
-        } else if (y == ny - 1) {
-          n = c;
-          s = c - 2 * nx;
-        } else {
-          n = c + nx;
-          s = c - nx;
-        }
-
-        if (z == 0) {
-          t = c + 2 * nx * ny;
-          b = c;
-        } else if (z == nz - 1) {
-          t = c;
-          b = c - 2 * nx * ny;
-        } else {
-          t = c + nx * ny;
-          b = c - nx * ny;
-        }
-
-        // Let the gradient point from low to high concentration
-        gradients_[c][0] = (c1_[w] - c1_[e]) * gd;
-        gradients_[c][1] = (c1_[n] - c1_[s]) * gd;
-        gradients_[c][2] = (c1_[t] - c1_[b]) * gd;
+        gradients_[x + y * nx + z * nx * ny] = ComputeGradient(x, y, z);
       }
     }
   }
@@ -300,58 +473,205 @@ void DiffusionGrid::ChangeConcentrationBy(size_t idx, double amount) {
                "the diffusion grid! The change was ignored.");
     return;
   }
-  std::lock_guard<Spinlock> guard(locks_[idx]);
-  assert(idx < locks_.size());
-  c1_[idx] += amount;
-  c1_[idx] = (c1_[idx] > upper_threshold_)
-                 ? upper_threshold_
-                 : (c1_[idx] < lower_threshold_) ? lower_threshold_ : c1_[idx];
+  // Secretion of many agents into the same box does not serialize on a lock
+  AtomicAdd(c1_.data() + idx, amount, lower_threshold_, upper_threshold_);
+  WakeTile(idx);
 }
 
-/// Get the concentration at specified position
-double DiffusionGrid::GetConcentration(const Double3& position) const {
+bool DiffusionGrid::ConcentrationAt(const Double3& position,
+                                    double* value) const {
+  if (interpolate_) {
+    std::array<size_t, 8> stencil;
+    std::array<double, 8> weights;
+    if (!GetInterpolationStencil(position, &stencil, &weights)) {
+      return false;
+    }
+    *value = 0;
+    for (int i = 0; i < 8; i++) {
+      *value += weights[i] * AtomicLoad(c1_.data() + stencil[i]);
+    }
+    return true;
+  }
   auto idx = GetBoxIndex(position);
   if (idx >= total_num_boxes_) {
-    Log::Error("DiffusionGrid::ChangeConcentrationBy",
+    return false;
+  }
+  *value = AtomicLoad(c1_.data() + idx);
+  return true;
+}
+
+bool DiffusionGrid::GradientAt(const Double3& position,
+                               Double3* gradient) const {
+  if (interpolate_) {
+    std::array<size_t, 8> stencil;
+    std::array<double, 8> weights;
+    if (!GetInterpolationStencil(position, &stencil, &weights)) {
+      return false;
+    }
+    *gradient = {0, 0, 0};
+    for (int i = 0; i < 8; i++) {
+      *gradient += GetBoxGradient(stencil[i]) * weights[i];
+    }
+    return true;
+  }
+  auto idx = GetBoxIndex(position);
+  if (idx >= total_num_boxes_) {
+    return false;
+  }
+  *gradient = GetBoxGradient(idx);
+  return true;
+}
+
+/// Get the concentration at specified position
+double DiffusionGrid::GetConcentration(const Double3& position) const {
+  double value;
+  if (!ConcentrationAt(position, &value)) {
+    Log::Error("DiffusionGrid::GetConcentration",
                "You tried to get the concentration outside the bounds of "
                "the diffusion grid!");
     return 0;
   }
-  assert(idx < locks_.size());
-  std::lock_guard<Spinlock> guard(locks_[idx]);
-  return c1_[idx];
+  return value;
 }
 
 /// Get the (normalized) gradient at specified position
 void DiffusionGrid::GetGradient(const Double3& position,
                                 Double3* gradient) const {
-  auto idx = GetBoxIndex(position);
-  if (idx >= total_num_boxes_) {
+  if (!GradientAt(position, gradient)) {
     Log::Error("DiffusionGrid::GetGradient",
                "You tried to get the gradient outside the bounds of "
                "the diffusion grid! Returning zero gradient.");
+    *gradient = {0, 0, 0};
     return;
   }
-  *gradient = gradients_[idx];
   auto norm = gradient->Norm();
   if (norm > 1e-10) {
     gradient->Normalize();
   }
 }
 
+void DiffusionGrid::GetConcentrations(const std::vector<Double3>& positions,
+                                      std::vector<double>* values) const {
+  const size_t num_positions = positions.size();
+  values->resize(num_positions);
+  size_t outside = 0;
+  if (interpolate_) {
+    for (size_t p = 0; p < num_positions; p++) {
+      if (!ConcentrationAt(positions[p], &(*values)[p])) {
+        (*values)[p] = 0;
+        outside++;
+      }
+    }
+  } else {
+    // Compute all indices first, then gather the values
+    std::vector<size_t> indices;
+    GetBoxIndices(positions, &indices);
+    for (size_t p = 0; p < num_positions; p++) {
+      if (indices[p] >= total_num_boxes_) {
+        (*values)[p] = 0;
+        outside++;
+        continue;
+      }
+      (*values)[p] = AtomicLoad(c1_.data() + indices[p]);
+    }
+  }
+  if (outside != 0) {
+    Log::Error("DiffusionGrid::GetConcentrations", outside,
+               " positions are outside the bounds of the diffusion grid!");
+  }
+}
+
+void DiffusionGrid::GetGradients(const std::vector<Double3>& positions,
+                                 std::vector<Double3>* gradients) const {
+  const size_t num_positions = positions.size();
+  gradients->resize(num_positions);
+  size_t outside = 0;
+  std::vector<size_t> indices;
+  if (!interpolate_) {
+    GetBoxIndices(positions, &indices);
+  }
+  for (size_t p = 0; p < num_positions; p++) {
+    auto& gradient = (*gradients)[p];
+    bool inside;
+    if (interpolate_) {
+      inside = GradientAt(positions[p], &gradient);
+    } else {
+      inside = indices[p] < total_num_boxes_;
+      if (inside) {
+        gradient = GetBoxGradient(indices[p]);
+      }
+    }
+    if (!inside) {
+      gradient = {0, 0, 0};
+      outside++;
+    } else if (gradient.Norm() > 1e-10) {
+      gradient.Normalize();
+    }
+  }
+  if (outside != 0) {
+    Log::Error("DiffusionGrid::GetGradients", outside,
+               " positions are outside the bounds of the diffusion grid!");
+  }
+}
+
+bool DiffusionGrid::GetInterpolationStencil(
+    const Double3& position, std::array<size_t, 8>* idx,
+    std::array<double, 8>* weights) const {
+  // Concentrations are located at the grid points
+  // `grid_dimensions_[2 * i] + k * box_length_`. Beyond the last grid point
+  // (inside the last box) the value of the last grid point is used.
+  std::array<size_t, 3> i0;
+  std::array<size_t, 3> i1;
+  std::array<double, 3> t;
+  for (int i = 0; i < 3; i++) {
+    const auto n = num_boxes_axis_[i];
+    double u = (position[i] - grid_dimensions_[2 * i]) * inv_box_length_;
+    if (!(u >= 0 && u < n)) {
+      return false;
+    }
+    if (n == 1) {
+      i0[i] = i1[i] = 0;
+      t[i] = 0;
+      continue;
+    }
+    u = std::min(u, static_cast<double>(n - 1));
+    i0[i] = std::min(static_cast<size_t>(u), n - 2);
+    i1[i] = i0[i] + 1;
+    t[i] = u - i0[i];
+  }
+  const auto nx = num_boxes_axis_[0];
+  const auto nxy = nx * num_boxes_axis_[1];
+  for (int corner = 0; corner < 8; corner++) {
+    const bool bx = corner & 1;
+    const bool by = corner & 2;
+    const bool bz = corner & 4;
+    (*idx)[corner] = (bz ? i1[2] : i0[2]) * nxy + (by ? i1[1] : i0[1]) * nx +
+                     (bx ? i1[0] : i0[0]);
+    (*weights)[corner] = (bx ? t[0] : 1 - t[0]) * (by ? t[1] : 1 - t[1]) *
+                         (bz ? t[2] : 1 - t[2]);
+  }
+  return true;
+}
+
 std::array<uint32_t, 3> DiffusionGrid::GetBoxCoordinates(
     const Double3& position) const {
   std::array<uint32_t, 3> box_coord;
-  box_coord[0] = (floor(position[0]) - grid_dimensions_[0]) / box_length_;
-  box_coord[1] = (floor(position[1]) - grid_dimensions_[0]) / box_length_;
-  box_coord[2] = (floor(position[2]) - grid_dimensions_[0]) / box_length_;
+  for (int i = 0; i < 3; i++) {
+    box_coord[i] = BoxCoordinate(position[i], grid_dimensions_[2 * i],
+                                 inv_box_length_, num_boxes_axis_[i]);
+  }
   return box_coord;
 }
 
 size_t DiffusionGrid::GetBoxIndex(
     const std::array<uint32_t, 3>& box_coord) const {
-  size_t ret = box_coord[2] * resolution_ * resolution_ +
-               box_coord[1] * resolution_ + box_coord[0];
+  for (int i = 0; i < 3; i++) {
+    if (box_coord[i] >= num_boxes_axis_[i]) {
+      return total_num_boxes_;
+    }
+  }
+  size_t ret = box_coord[2] * num_boxes_axis_[0] * num_boxes_axis_[1] +
+               box_coord[1] * num_boxes_axis_[0] + box_coord[0];
   return ret;
 }
 
@@ -361,6 +681,29 @@ size_t DiffusionGrid::GetBoxIndex(const Double3& position) const {
   return GetBoxIndex(box_coord);
 }
 
+void DiffusionGrid::GetBoxIndices(const std::vector<Double3>& positions,
+                                  std::vector<size_t>* indices) const {
+  const size_t num_positions = positions.size();
+  indices->resize(num_positions);
+  const double inv_box_length = inv_box_length_;
+  const double min_x = grid_dimensions_[0];
+  const double min_y = grid_dimensions_[2];
+  const double min_z = grid_dimensions_[4];
+  const size_t nx = num_boxes_axis_[0];
+  const size_t ny = num_boxes_axis_[1];
+  const size_t nz = num_boxes_axis_[2];
+  const size_t outside = total_num_boxes_;
+  const Double3* pos = positions.data();
+  size_t* idx = indices->data();
+#pragma omp simd
+  for (size_t p = 0; p < num_positions; p++) {
+    size_t x = BoxCoordinate(pos[p][0], min_x, inv_box_length, nx);
+    size_t y = BoxCoordinate(pos[p][1], min_y, inv_box_length, ny);
+    size_t z = BoxCoordinate(pos[p][2], min_z, inv_box_length, nz);
+    idx[p] = x < nx && y < ny && z < nz ? (z * ny + y) * nx + x : outside;
+  }
+}
+
 void DiffusionGrid::ParametersCheck(double dt) {
   if (((1 - dc_[0]) * dt) / (box_length_ * box_length_) >= (1.0 / 6)) {
     Log::Fatal(
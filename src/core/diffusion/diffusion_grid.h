@@ -15,7 +15,10 @@
 #ifndef CORE_DIFFUSION_DIFFUSION_GRID_H_
 #define CORE_DIFFUSION_DIFFUSION_GRID_H_
 
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstdint>
 #include <functional>
 #include <string>
 #include <utility>
@@ -25,12 +28,33 @@
 #include "core/container/parallel_resize_vector.h"
 #include "core/util/log.h"
 #include "core/util/root.h"
-#include "core/util/spinlock.h"
 
 namespace bdm {
 
+/// Type of the concentrations that are stored in the diffusion grids.
+/// BioDynaMo stores single-precision concentrations if it is built with
+/// `-Dfloat_diffusion=ON`, which halves the memory and the memory traffic of
+/// the stencils. The diffusion methods still compute (and accumulate
+/// secretion) in double precision and only round when they store the result.
+#ifdef USE_FLOAT_DIFFUSION
+using DiffusionReal = float;
+#else
+using DiffusionReal = double;
+#endif
+
 class DiffusionGrid {
  public:
+  /// Values of the boxes that are added around the old grid when the grid
+  /// grows with the environment (see `SetHaloFill`)
+  enum class HaloFill {
+    /// Zero concentration
+    kZero,
+    /// The value given to `SetHaloFill` (e.g. a far-field Dirichlet value)
+    kConstant,
+    /// The concentration of the closest box of the old grid
+    kExtrapolate
+  };
+
   DiffusionGrid() {}
   explicit DiffusionGrid(TRootIOCtor* p) {}
   DiffusionGrid(int substance_id, std::string substance_name, double dc,
@@ -43,12 +67,29 @@ class DiffusionGrid {
 
   virtual ~DiffusionGrid() {}
 
+  /// Restricts the grid to the box `domain` = {xmin, xmax, ymin, ymax, zmin,
+  /// zmax} instead of the cube given by the dimension thresholds of the
+  /// environment. The box length is determined by the longest axis and the
+  /// resolution; the number of boxes along the shorter axes is reduced
+  /// accordingly. E.g. a domain of 1000 x 1000 x 50 with resolution 101 has
+  /// 101 x 101 x 6 boxes. The grid does not grow with the environment.
+  /// Must be called before `Initialize`.
+  void SetDomain(const std::array<int32_t, 6>& domain) {
+    domain_ = domain;
+    has_domain_ = true;
+  }
+
   virtual void Initialize();
 
   /// Updates the grid dimensions, based on the given threshold values. The
   /// diffusion grid dimensions need always be larger than the neighbor grid
   /// dimensions, so that each simulation object can obtain its local
-  /// concentration / gradient
+  /// concentration / gradient.
+  /// The grid is extended on each side that the environment has left; the
+  /// existing boxes keep their position. Axes that grow are extended by the
+  /// fraction `Param::diffusion_grid_headroom` on both sides, so that the grid
+  /// does not need to be reallocated each time the environment grows
+  /// slightly.
   virtual void Update();
 
   void Diffuse(double dt);
@@ -56,6 +97,9 @@ class DiffusionGrid {
   virtual void DiffuseWithClosedEdge(double dt) = 0;
   virtual void DiffuseWithOpenEdge(double dt) = 0;
 
+  /// Number of substeps into which `Diffuse(dt)` splits the time step `dt`
+  virtual uint64_t GetNumSubsteps() const { return 1; }
+
   /// Calculates the gradient for each box in the diffusion grid.
   /// The gradient is calculated in each direction (x, y, z) as following:
   ///
@@ -63,30 +107,83 @@ class DiffusionGrid {
   ///
   /// where c(x) implies the concentration at position x
   ///
-  /// At the edges the gradient is the same as the box next to it
+  /// At the edges the gradient is the same as the box next to it.
+  /// If the gradients are computed on demand (see
+  /// `Param::diffusion_lazy_gradients`), only enables them: until the first
+  /// call, all gradients are zero in both modes.
   void CalculateGradient();
 
-  /// Initialize the diffusion grid according to the initialization functions
+  /// Initialize the diffusion grid according to the initialization files and
+  /// functions (see `AddInitialConcentrations` and `AddInitializer`). They
+  /// are applied in the order in which they were added. The rows of the grid
+  /// are initialized in parallel; the result is clamped to the thresholds
+  /// after each file and function. Writes both concentration buffers.
   void RunInitializers();
 
-  /// Increase the concentration at specified box with specified amount
-  void ChangeConcentrationBy(const Double3& position, double amount);
+  /// Increase the concentration at specified box with specified amount.
+  /// Thread-safe and lock-free: concurrent changes of the same box are
+  /// combined with an atomic compare-and-swap.
+  virtual void ChangeConcentrationBy(const Double3& position, double amount);
   void ChangeConcentrationBy(size_t idx, double amount);
 
-  /// Get the concentration at specified position
-  double GetConcentration(const Double3& position) const;
+  /// Get the concentration at specified position. Lock-free.
+  virtual double GetConcentration(const Double3& position) const;
 
-  /// Get the (normalized) gradient at specified position
+  /// Get the (normalized) gradient at specified position. If the gradients
+  /// are not stored (see `Param::diffusion_lazy_gradients`), the gradient is
+  /// computed from the current concentrations, which include the changes
+  /// since the last `CalculateGradient` (e.g. secretion in the same step).
   // TODO: virtual because of test
   virtual void GetGradient(const Double3& position, Double3* gradient) const;
 
+  /// Batched version of `GetConcentration`: `(*values)[i]` is set to the
+  /// concentration at `positions[i]`. Positions outside the grid get zero.
+  virtual void GetConcentrations(const std::vector<Double3>& positions,
+                                 std::vector<double>* values) const;
+
+  /// Batched version of `GetGradient`: `(*gradients)[i]` is set to the
+  /// (normalized) gradient at `positions[i]`. Positions outside the grid get
+  /// a zero gradient.
+  virtual void GetGradients(const std::vector<Double3>& positions,
+                            std::vector<Double3>* gradients) const;
+
+  /// If true, `GetConcentration`, `GetGradient`, and their batched versions
+  /// interpolate trilinearly between the eight surrounding grid points
+  /// instead of returning the value of the box that contains the position.
+  /// A coarser grid with interpolation can give the same accuracy as a finer
+  /// grid without. Default: false.
+  void SetInterpolation(bool interpolate) { interpolate_ = interpolate; }
+
+  bool GetInterpolation() const { return interpolate_; }
+
+  /// Determines the concentration of the boxes that are added when the grid
+  /// grows with the environment (see `Update`). `value` is only used for
+  /// `HaloFill::kConstant`. Default: `HaloFill::kZero`.
+  void SetHaloFill(HaloFill mode, double value = 0) {
+    halo_fill_ = mode;
+    halo_value_ = value;
+  }
+
+  HaloFill GetHaloFill() const { return halo_fill_; }
+
+  /// Returns the box coordinates of `position`. If `position` is outside of
+  /// the grid along an axis, the coordinate is the number of boxes along
+  /// this axis.
   std::array<uint32_t, 3> GetBoxCoordinates(const Double3& position) const;
 
+  /// Returns `GetNumBoxes()` if `box_coord` is outside of the grid.
   size_t GetBoxIndex(const std::array<uint32_t, 3>& box_coord) const;
 
-  /// Calculates the box index of the substance at specified position
+  /// Calculates the box index of the substance at specified position.
+  /// Returns `GetNumBoxes()` if `position` is outside of the grid.
   size_t GetBoxIndex(const Double3& position) const;
 
+  /// Batched version of `GetBoxIndex`: `(*indices)[i]` is set to the box
+  /// index of `positions[i]`. The grid constants are loaded once, and the
+  /// loop has no branches, such that the compiler can vectorize it.
+  void GetBoxIndices(const std::vector<Double3>& positions,
+                     std::vector<size_t>* indices) const;
+
   void SetDecayConstant(double mu) { mu_ = mu; }
 
   /// Return the last timestep `dt` that was used to run `Diffuse(dt)`
@@ -104,18 +201,16 @@ class DiffusionGrid {
   // Returns the lower threshold for allowed values in the diffusion grid.
   double GetLowerThreshold() const { return lower_threshold_; }
 
-  const double* GetAllConcentrations() const { return c1_.data(); }
-
-  const double* GetAllGradients() const { return gradients_.data()->data(); }
+  const DiffusionReal* GetAllConcentrations() const { return c1_.data(); }
 
-  std::array<size_t, 3> GetNumBoxesArray() const {
-    std::array<size_t, 3> ret;
-    ret[0] = resolution_;
-    ret[1] = resolution_;
-    ret[2] = resolution_;
-    return ret;
+  /// Returns nullptr if the gradients are not stored (see
+  /// `Param::diffusion_lazy_gradients`)
+  const double* GetAllGradients() const {
+    return gradients_.size() == 0 ? nullptr : gradients_.data()->data();
   }
 
+  std::array<size_t, 3> GetNumBoxesArray() const { return num_boxes_axis_; }
+
   size_t GetNumBoxes() const { return total_num_boxes_; }
 
   double GetBoxLength() const { return box_length_; }
@@ -128,34 +223,48 @@ class DiffusionGrid {
 
   const int32_t* GetDimensionsPtr() const { return grid_dimensions_.data(); }
 
-  std::array<int32_t, 6> GetDimensions() const {
-    std::array<int32_t, 6> ret;
-    ret[0] = grid_dimensions_[0];
-    ret[1] = grid_dimensions_[1];
-    ret[2] = grid_dimensions_[0];
-    ret[3] = grid_dimensions_[1];
-    ret[4] = grid_dimensions_[0];
-    ret[5] = grid_dimensions_[1];
-    return ret;
-  }
+  std::array<int32_t, 6> GetDimensions() const { return grid_dimensions_; }
 
   std::array<int32_t, 3> GetGridSize() const {
     std::array<int32_t, 3> ret;
     ret[0] = grid_dimensions_[1] - grid_dimensions_[0];
-    ret[1] = grid_dimensions_[1] - grid_dimensions_[0];
-    ret[2] = grid_dimensions_[1] - grid_dimensions_[0];
+    ret[1] = grid_dimensions_[3] - grid_dimensions_[2];
+    ret[2] = grid_dimensions_[5] - grid_dimensions_[4];
     return ret;
   }
 
   const std::array<double, 7>& GetDiffusionCoefficients() const { return dc_; }
 
+  /// Returns the number of boxes along the longest axis
   int GetResolution() const { return resolution_; }
 
   double GetBoxVolume() const { return box_volume_; }
 
+  /// Adds `function(x, y, z)` to the initial concentration of each box (see
+  /// `RunInitializers`). The rows are initialized by multiple threads; each
+  /// row uses its own copy of `function`, so that functors with a non-const
+  /// call operator are safe. Its type is kept, so that the call is inlined
+  /// into the loop over the boxes of a row.
   template <typename F>
   void AddInitializer(F function) {
-    initializers_.push_back(function);
+    initializers_.push_back(
+        {"", [function](double x, double y, double z, double dx, size_t n,
+                        DiffusionReal* row) {
+           F f = function;
+           for (size_t i = 0; i < n; i++) {
+             row[i] += f(x + i * dx, y, z);
+           }
+         }});
+  }
+
+  /// Adds the values in the file `file_name` to the initial concentration
+  /// (see `RunInitializers`). The file contains one `double` per box (in the
+  /// native byte order) without header; x is the fastest-running index,
+  /// followed by y and z (i.e. the layout of `GetAllConcentrations`). The
+  /// file is memory-mapped when the grid is initialized and must have the
+  /// size of the grid.
+  void AddInitialConcentrations(const std::string& file_name) {
+    initializers_.push_back({file_name, nullptr});
   }
 
   // retrun true if substance concentration and gradient don't evolve over time
@@ -165,27 +274,116 @@ class DiffusionGrid {
   }
 
  private:
+  friend class AdiGrid;
+  friend class AmrGrid;
   friend class RungeKuttaGrid;
   friend class EulerGrid;
   friend class TestGrid;  // class used for testing (e.g. initialization)
 
-  void ParametersCheck(double dt);
+  /// Checks the stability limit of the explicit methods
+  virtual void ParametersCheck(double dt);
+
+  /// Atomically adds `amount` to `*value` and clamps the result to
+  /// [`lower`, `upper`]
+  template <typename T>
+  static void AtomicAdd(T* value, double amount, double lower, double upper) {
+    T expected;
+    __atomic_load(value, &expected, __ATOMIC_RELAXED);
+    T desired;
+    do {
+      desired = std::min(std::max(expected + amount, lower), upper);
+    } while (!__atomic_compare_exchange(value, &expected, &desired, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  }
+
+  /// Returns the box coordinate of `x` along an axis that starts at `min`
+  /// and has `n` boxes, or `n` if `x` is outside of the axis. All lookups
+  /// of the box that contains a position (scalar and batched) use this
+  /// function, so that a position on a box border is assigned to the same
+  /// box by all of them.
+  static size_t BoxCoordinate(double x, double min, double inv_box_length,
+                              size_t n) {
+    double u = (std::floor(x) - min) * inv_box_length;
+    return u >= 0 && u < n ? static_cast<size_t>(u) : n;
+  }
+
+  /// Sets `value` to the (interpolated) concentration at `position`.
+  /// Returns false if `position` is outside the grid. Shared by
+  /// `GetConcentration` and `GetConcentrations`.
+  bool ConcentrationAt(const Double3& position, double* value) const;
+
+  /// Sets `gradient` to the (interpolated) gradient at `position` without
+  /// normalizing it. Returns false if `position` is outside the grid. Shared
+  /// by `GetGradient` and `GetGradients`.
+  bool GradientAt(const Double3& position, Double3* gradient) const;
+
+  /// Calculates the gradient of box (`x`, `y`, `z`) with central differences
+  /// (see `CalculateGradient`)
+  Double3 ComputeGradient(size_t x, size_t y, size_t z) const;
+
+  /// Returns the stored gradient of box `idx`, or computes it if the
+  /// gradients are not stored. Zero before the first `CalculateGradient`.
+  Double3 GetBoxGradient(size_t idx) const {
+    if (!lazy_gradients_) {
+      return gradients_[idx];
+    }
+    if (!init_gradient_) {
+      return {0, 0, 0};
+    }
+    const auto nx = num_boxes_axis_[0];
+    const auto ny = num_boxes_axis_[1];
+    return ComputeGradient(idx % nx, (idx / nx) % ny, idx / (nx * ny));
+  }
+
+  /// Calculates the indices and weights of the eight grid points around
+  /// `position` for the trilinear interpolation. Returns false if `position`
+  /// is outside the grid.
+  bool GetInterpolationStencil(const Double3& position,
+                               std::array<size_t, 8>* idx,
+                               std::array<double, 8>* weights) const;
+
+  /// Index of the tile that contains the row (`y`, `z`)
+  size_t GetTileIndex(size_t y, size_t z) const {
+    return (z / kTileSize) * num_tiles_[0] + y / kTileSize;
+  }
+
+  /// Marks the tile that contains box `idx` as active (see `tile_state_`)
+  void WakeTile(size_t idx) {
+    if (tile_state_.empty()) {
+      return;
+    }
+    const auto nx = num_boxes_axis_[0];
+    const auto ny = num_boxes_axis_[1];
+    auto tile = GetTileIndex((idx / nx) % ny, idx / (nx * ny));
+    __atomic_store_n(&tile_state_[tile], kTileActive, __ATOMIC_RELAXED);
+  }
+
+  /// Reads `*value`, which might be modified concurrently by `AtomicAdd`
+  template <typename T>
+  static double AtomicLoad(const T* value) {
+    T ret;
+    __atomic_load(value, &ret, __ATOMIC_RELAXED);
+    return ret;
+  }
 
   /// Copies the concentration and gradients values to the new
   /// (larger) grid. In the 2D case it looks like the following:
   ///
-  ///                             [0 0  0  0]
-  ///               [v1 v2]  -->  [0 v1 v2 0]
-  ///               [v3 v4]  -->  [0 v3 v4 0]
-  ///                             [0 0  0  0]
-  ///
-  /// The dimensions are doubled in this case from 2x2 to 4x4
-  /// If the dimensions would be increased from 2x2 to 3x3, it will still
-  /// be increased to 4x4 in order for GetBoxIndex to function correctly
+  ///                             [h h  h  h]
+  ///               [v1 v2]  -->  [h v1 v2 h]
+  ///               [v3 v4]  -->  [h v3 v4 h]
+  ///                             [h h  h  h]
   ///
-  void CopyOldData(const ParallelResizeVector<double>& old_c1,
+  /// The old grid (with the dimensions `old_dimensions`) is placed at its
+  /// position in the new grid, which need not be the center, because the
+  /// environment can grow on one side only.
+  /// The halo values `h` are determined by `SetHaloFill`; the gradients in
+  /// the halo are zero. `c2_` is set to `c1_`. The rows are copied in
+  /// parallel.
+  void CopyOldData(const ParallelResizeVector<DiffusionReal>& old_c1,
                    const ParallelResizeVector<Double3>& old_gradients,
-                   size_t old_resolution);
+                   const std::array<size_t, 3>& old_num_boxes,
+                   const std::array<int32_t, 6>& old_dimensions);
 
   /// The id of the substance of this grid
   int substance_ = 0;
@@ -193,17 +391,18 @@ class DiffusionGrid {
   std::string substance_name_ = "";
   /// The side length of each box
   double box_length_ = 0;
+  /// `1 / box_length_`
+  double inv_box_length_ = 0;
   /// the volume of each box
   double box_volume_ = 0;
-  /// Lock for each voxel used to prevent race conditions between
-  /// multiple threads
-  mutable ParallelResizeVector<Spinlock> locks_ = {};  //!
   /// The array of concentration values
-  ParallelResizeVector<double> c1_ = {};
+  ParallelResizeVector<DiffusionReal> c1_ = {};
   /// An extra concentration data buffer for faster value updating
-  ParallelResizeVector<double> c2_ = {};
-  /// The array of gradients (x, y, z)
+  ParallelResizeVector<DiffusionReal> c2_ = {};
+  /// The array of gradients (x, y, z). Empty if `lazy_gradients_` is true.
   ParallelResizeVector<Double3> gradients_ = {};
+  /// See `Param::diffusion_lazy_gradients`
+  bool lazy_gradients_ = false;
   /// The maximum concentration value that a box can have
   double upper_threshold_ = 1e15;
   /// The minimum concentration value that a box can have
@@ -212,27 +411,57 @@ class DiffusionGrid {
   std::array<double, 7> dc_ = {{0}};
   /// The decay constant
   double mu_ = 0;
-  /// The grid dimensions of the diffusion grid (cubic shaped)
-  std::array<int32_t, 2> grid_dimensions_ = {{0}};
-  /// The number of boxes at each axis [x, y, z] (same along each axis)
-  uint64_t num_boxes_axis_ = 0;
+  /// The grid dimensions of the diffusion grid
+  /// [xmin, xmax, ymin, ymax, zmin, zmax]
+  std::array<int32_t, 6> grid_dimensions_ = {{0}};
+  /// The domain set with `SetDomain`
+  std::array<int32_t, 6> domain_ = {{0}};
+  bool has_domain_ = false;
+  /// The number of boxes at each axis [x, y, z]
+  std::array<size_t, 3> num_boxes_axis_ = {{0}};
   /// The total number of boxes in the diffusion grid
   size_t total_num_boxes_ = 0;
-  /// The resolution of the diffusion grid (i.e. number of boxes along each
-  /// axis)
+  /// The resolution of the diffusion grid (i.e. number of boxes along the
+  /// longest axis)
   size_t resolution_ = 0;
   /// The last timestep `dt` used for the diffusion grid update `Diffuse(dt)`
   double last_dt_ = 0.0;
-  /// If false, grid dimensions are even; if true, they are odd
-  bool parity_ = false;
-  /// A list of functions that initialize this diffusion grid
+  /// An initialization step: either a file with initial concentrations (see
+  /// `AddInitialConcentrations`) or a function that adds the initial values
+  /// of the `n` boxes of one row along the x-axis to `row`. The first box is
+  /// at (`x`, `y`, `z`); the boxes are `dx` apart.
+  struct Initializer {
+    std::string file_name;
+    std::function<void(double x, double y, double z, double dx, size_t n,
+                       DiffusionReal* row)>
+        function;
+  };
+  /// The initialization steps in the order in which they were added.
   /// ROOT currently doesn't support IO of std::function
-  std::vector<std::function<double(double, double, double)>> initializers_ =
-      {};  //!
+  std::vector<Initializer> initializers_ = {};  //!
   // Turn to true after gradient initialization
   bool init_gradient_ = false;
-
-  BDM_CLASS_DEF(DiffusionGrid, 1);
+  /// See `SetInterpolation`
+  bool interpolate_ = false;
+  /// See `SetHaloFill`
+  HaloFill halo_fill_ = HaloFill::kZero;
+  double halo_value_ = 0;
+
+  /// Tiles consist of `kTileSize` x `kTileSize` rows along the x-axis
+  static constexpr size_t kTileSize = 16;
+  static constexpr uint8_t kTileIdle = 0;
+  static constexpr uint8_t kTileSync = 1;
+  static constexpr uint8_t kTileActive = 2;
+  /// State of each tile if the grid skips converged tiles (see
+  /// `Param::diffusion_convergence_tolerance`); otherwise empty.
+  /// Active tiles are updated. Idle tiles are skipped; `c1_` and `c2_` are
+  /// equal for them. A tile that converged is synchronized (`c1_` copied to
+  /// `c2_`) in one step before it becomes idle.
+  std::vector<uint8_t> tile_state_ = {};  //!
+  /// Number of tiles along the y- and z-axis
+  std::array<size_t, 2> num_tiles_ = {{0}};  //!
+
+  BDM_CLASS_DEF(DiffusionGrid, 5);
 };
 
 }  // namespace bdm
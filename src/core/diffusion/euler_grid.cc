@@ -13,18 +13,94 @@
 // -----------------------------------------------------------------------------
 
 #include "core/diffusion/euler_grid.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include "core/param/param.h"
+#include "core/simulation.h"
 
 namespace bdm {
 
+#define YBF 16
+
+/// Updates the interior of one row (x = 1 .. nx - 2) with the closed edge
+/// stencil. `c`, `n`, `s`, `b`, and `t` point to the beginning of the row and
+/// of its four neighboring rows. The stencil is evaluated in double precision
+/// (see `DiffusionReal`).
+static inline void ClosedEdgeRow(const DiffusionReal* c, const DiffusionReal* n,
+                                 const DiffusionReal* s, const DiffusionReal* b,
+                                 const DiffusionReal* t, DiffusionReal* out,
+                                 size_t nx, double d, double dt, double ibl2,
+                                 double mu) {
+#pragma omp simd
+  for (size_t x = 1; x < nx - 1; x++) {
+    const double cx = c[x];
+    out[x] = (cx + d * dt * (c[x - 1] - 2 * cx + c[x + 1]) * ibl2 +
+              d * dt * (s[x] - 2 * cx + n[x]) * ibl2 +
+              d * dt * (b[x] - 2 * cx + t[x]) * ibl2) *
+             (1 - mu);
+  }
+}
+
+/// Updates one row with the open edge stencil. `c`, `n`, `s`, `b`, and `t`
+/// point to the beginning of the row and of its four neighboring rows. A
+/// neighboring row outside of the grid is replaced by `c`, and the
+/// corresponding entry of `l` is zero.
+static inline void OpenEdgeRow(const DiffusionReal* c, const DiffusionReal* n,
+                               const DiffusionReal* s, const DiffusionReal* b,
+                               const DiffusionReal* t,
+                               const std::array<int, 4>& l, DiffusionReal* out,
+                               size_t nx, double d, double dt, double ibl2,
+                               double mu) {
+  // The stencil is evaluated in double precision (see `DiffusionReal`)
+  double cc = c[0];
+  out[0] = (cc + d * dt * (0 - 2 * cc + c[1]) * ibl2 +
+            d * dt * (s[0] - 2 * cc + n[0]) * ibl2 +
+            d * dt * (b[0] - 2 * cc + t[0]) * ibl2) *
+           (1 - mu);
+#pragma omp simd
+  for (size_t x = 1; x < nx - 1; x++) {
+    const double cx = c[x];
+    out[x] = (cx + d * dt * (c[x - 1] - 2 * cx + c[x + 1]) * ibl2 +
+              d * dt * (l[0] * s[x] - 2 * cx + l[1] * n[x]) * ibl2 +
+              d * dt * (l[2] * b[x] - 2 * cx + l[3] * t[x]) * ibl2) *
+             (1 - mu);
+  }
+  const size_t x = nx - 1;
+  cc = c[x];
+  out[x] = (cc + d * dt * (c[x - 1] - 2 * cc + 0) * ibl2 +
+            d * dt * (s[x] - 2 * cc + n[x]) * ibl2 +
+            d * dt * (b[x] - 2 * cc + t[x]) * ibl2) *
+           (1 - mu);
+}
+
+uint64_t EulerGrid::GetNumSubsteps() const {
+  auto* param = Simulation::GetActive()->GetParam();
+  return std::max<uint64_t>(param->diffusion_substeps, 1);
+}
+
+size_t EulerGrid::GetNumIdleTiles() const {
+  return std::count(tile_state_.begin(), tile_state_.end(), kTileIdle);
+}
+
 void EulerGrid::DiffuseWithClosedEdge(double dt) {
-  const auto nx = resolution_;
-  const auto ny = resolution_;
-  const auto nz = resolution_;
+  auto substeps = GetNumSubsteps();
+  if (substeps > 1) {
+    tile_state_.clear();
+    DiffuseBlocked(dt / substeps, substeps, true);
+    return;
+  }
 
-  const double ibl2 = 1 / (box_length_ * box_length_);
-  const double d = 1 - dc_[0];
+  auto* param = Simulation::GetActive()->GetParam();
+  if (param->diffusion_convergence_tolerance > 0) {
+    DiffuseActiveTiles(dt, true, param->diffusion_convergence_tolerance);
+    return;
+  }
+  tile_state_.clear();
+
+  const auto ny = num_boxes_axis_[1];
+  const auto nz = num_boxes_axis_[2];
 
-#define YBF 16
 #pragma omp parallel for collapse(2)
   for (size_t yy = 0; yy < ny; yy += YBF) {
     for (size_t z = 0; z < nz; z++) {
@@ -33,36 +109,7 @@ void EulerGrid::DiffuseWithClosedEdge(double dt) {
         ymax = ny;
       }
       for (size_t y = yy; y < ymax; y++) {
-        size_t x = 0;
-        int c, n, s, b, t;
-        c = x + y * nx + z * nx * ny;
-#pragma omp simd
-        for (x = 1; x < nx - 1; x++) {
-          ++c;
-          ++n;
-          ++s;
-          ++b;
-          ++t;
-
-          if (y == 0 || y == (ny - 1) || z == 0 || z == (nz - 1)) {
-            continue;
-          }
-
-          n = c - nx;
-          s = c + nx;
-          b = c - nx * ny;
-          t = c + nx * ny;
-          c2_[c] =
-              (c1_[c] + d * dt * (c1_[c - 1] - 2 * c1_[c] + c1_[c + 1]) * ibl2 +
-               d * dt * (c1_[s] - 2 * c1_[c] + c1_[n]) * ibl2 +
-               d * dt * (c1_[b] - 2 * c1_[c] + c1_[t]) * ibl2) *
-              (1 - mu_);
-        }
-        ++c;
-        ++n;
-        ++s;
-        ++b;
-        ++t;
+        DiffuseRowWithClosedEdge(y, z, dt);
       }  // tile ny
     }    // tile nz
   }      // block ny
@@ -70,15 +117,23 @@ void EulerGrid::DiffuseWithClosedEdge(double dt) {
 }
 
 void EulerGrid::DiffuseWithOpenEdge(double dt) {
-  const auto nx = resolution_;
-  const auto ny = resolution_;
-  const auto nz = resolution_;
+  auto substeps = GetNumSubsteps();
+  if (substeps > 1) {
+    tile_state_.clear();
+    DiffuseBlocked(dt / substeps, substeps, false);
+    return;
+  }
 
-  const double ibl2 = 1 / (box_length_ * box_length_);
-  const double d = 1 - dc_[0];
-  std::array<int, 4> l;
+  auto* param = Simulation::GetActive()->GetParam();
+  if (param->diffusion_convergence_tolerance > 0) {
+    DiffuseActiveTiles(dt, false, param->diffusion_convergence_tolerance);
+    return;
+  }
+  tile_state_.clear();
+
+  const auto ny = num_boxes_axis_[1];
+  const auto nz = num_boxes_axis_[2];
 
-#define YBF 16
 #pragma omp parallel for collapse(2)
   for (size_t yy = 0; yy < ny; yy += YBF) {
     for (size_t z = 0; z < nz; z++) {
@@ -87,70 +142,280 @@ void EulerGrid::DiffuseWithOpenEdge(double dt) {
         ymax = ny;
       }
       for (size_t y = yy; y < ymax; y++) {
-        size_t x = 0;
-        int c, n, s, b, t;
-        c = x + y * nx + z * nx * ny;
+        DiffuseRowWithOpenEdge(y, z, dt);
+      }  // tile ny
+    }    // tile nz
+  }      // block ny
+  c1_.swap(c2_);
+}
 
-        l.fill(1);
+void EulerGrid::DiffuseActiveTiles(double dt, bool closed, double tolerance) {
+  const auto nx = num_boxes_axis_[0];
+  const auto ny = num_boxes_axis_[1];
+  const auto nz = num_boxes_axis_[2];
+  const size_t nty = (ny + kTileSize - 1) / kTileSize;
+  const size_t ntz = (nz + kTileSize - 1) / kTileSize;
+  const size_t num_tiles = nty * ntz;
+  if (tile_state_.size() != num_tiles || num_tiles_[0] != nty ||
+      num_tiles_[1] != ntz || skipped_change_.size() != num_tiles) {
+    tile_state_.assign(num_tiles, kTileActive);
+    num_tiles_ = {nty, ntz};
+    tile_rate_.assign(num_tiles, 0);
+    skipped_change_.assign(num_tiles, 0);
+  }
+  row_change_.resize(nty * nz);
 
-        if (y == 0) {
-          n = c;
-          l[0] = 0;
-        } else {
-          n = c - nx;
-        }
+  // Boxes at the border of an active tile exchange substance with the
+  // neighboring tiles. These are updated as well, so that no substance is
+  // lost if e.g. secretion woke up a single tile.
+  active_neighbors_.assign(num_tiles, 0);
+  for (size_t tz = 0; tz < ntz; tz++) {
+    for (size_t ty = 0; ty < nty; ty++) {
+      auto t = tz * nty + ty;
+      if (tile_state_[t] != kTileActive) {
+        continue;
+      }
+      if (ty > 0) {
+        active_neighbors_[t - 1] = 1;
+      }
+      if (ty + 1 < nty) {
+        active_neighbors_[t + 1] = 1;
+      }
+      if (tz > 0) {
+        active_neighbors_[t - nty] = 1;
+      }
+      if (tz + 1 < ntz) {
+        active_neighbors_[t + nty] = 1;
+      }
+    }
+  }
+  for (size_t t = 0; t < num_tiles; t++) {
+    if (active_neighbors_[t]) {
+      tile_state_[t] = kTileActive;
+    }
+  }
 
-        if (y == ny - 1) {
-          s = c;
-          l[1] = 0;
-        } else {
-          s = c + nx;
+#pragma omp parallel for collapse(2)
+  for (size_t ty = 0; ty < nty; ty++) {
+    for (size_t z = 0; z < nz; z++) {
+      const size_t ymin = ty * kTileSize;
+      size_t ymax = ymin + kTileSize;
+      if (ymax >= ny) {
+        ymax = ny;
+      }
+      const auto state = tile_state_[(z / kTileSize) * nty + ty];
+      double change = 0;
+      if (state == kTileActive) {
+        for (size_t y = ymin; y < ymax; y++) {
+          if (closed) {
+            DiffuseRowWithClosedEdge(y, z, dt);
+          } else {
+            DiffuseRowWithOpenEdge(y, z, dt);
+          }
+          const DiffusionReal* c1 = c1_.data() + y * nx + z * nx * ny;
+          const DiffusionReal* c2 = c2_.data() + y * nx + z * nx * ny;
+#pragma omp simd reduction(max : change)
+          for (size_t x = 0; x < nx; x++) {
+            change = std::max(change, std::abs(static_cast<double>(c2[x]) -
+                                               static_cast<double>(c1[x])));
+          }
         }
+      } else if (state == kTileSync) {
+        const size_t offset = ymin * nx + z * nx * ny;
+        std::copy(c1_.data() + offset, c1_.data() + offset + (ymax - ymin) * nx,
+                  c2_.data() + offset);
+      }
+      row_change_[z * nty + ty] = change;
+    }
+  }
+  c1_.swap(c2_);
 
-        if (z == 0) {
-          b = c;
-          l[2] = 0;
-        } else {
-          b = c - nx * ny;
-        }
+  // Maximum change of each tile
+  std::vector<double> tile_change(num_tiles, 0);
+  for (size_t z = 0; z < nz; z++) {
+    for (size_t ty = 0; ty < nty; ty++) {
+      auto& tc = tile_change[(z / kTileSize) * nty + ty];
+      tc = std::max(tc, row_change_[z * nty + ty]);
+    }
+  }
 
-        if (z == nz - 1) {
-          t = c;
-          l[3] = 0;
-        } else {
-          t = c + nx * ny;
-        }
+  // A tile remains (or becomes) active if the concentrations in the tile or
+  // in one of its neighbors changed by at least `tolerance`. Skipped tiles
+  // accumulate the change of their last update for each skipped step, and
+  // become active again once the sum reaches `tolerance`. This bounds the
+  // error of a tile that converges slowly.
+  for (size_t tz = 0; tz < ntz; tz++) {
+    for (size_t ty = 0; ty < nty; ty++) {
+      auto t = tz * nty + ty;
+      bool busy = tile_change[t] >= tolerance ||
+                  (ty > 0 && tile_change[t - 1] >= tolerance) ||
+                  (ty + 1 < nty && tile_change[t + 1] >= tolerance) ||
+                  (tz > 0 && tile_change[t - nty] >= tolerance) ||
+                  (tz + 1 < ntz && tile_change[t + nty] >= tolerance);
+      auto& state = tile_state_[t];
+      if (state == kTileActive) {
+        tile_rate_[t] = tile_change[t];
+        skipped_change_[t] = 0;
+      } else {
+        skipped_change_[t] += tile_rate_[t];
+        busy = busy || skipped_change_[t] >= tolerance;
+      }
+      if (busy) {
+        state = kTileActive;
+      } else if (state == kTileActive) {
+        state = kTileSync;
+      } else {
+        state = kTileIdle;
+      }
+    }
+  }
+}
 
-        c2_[c] = (c1_[c] + d * dt * (0 - 2 * c1_[c] + c1_[c + 1]) * ibl2 +
-                  d * dt * (c1_[s] - 2 * c1_[c] + c1_[n]) * ibl2 +
-                  d * dt * (c1_[b] - 2 * c1_[c] + c1_[t]) * ibl2) *
-                 (1 - mu_);
-#pragma omp simd
-        for (x = 1; x < nx - 1; x++) {
-          ++c;
-          ++n;
-          ++s;
-          ++b;
-          ++t;
-          c2_[c] =
-              (c1_[c] + d * dt * (c1_[c - 1] - 2 * c1_[c] + c1_[c + 1]) * ibl2 +
-               d * dt * (l[0] * c1_[s] - 2 * c1_[c] + l[1] * c1_[n]) * ibl2 +
-               d * dt * (l[2] * c1_[b] - 2 * c1_[c] + l[3] * c1_[t]) * ibl2) *
-              (1 - mu_);
+void EulerGrid::DiffuseBlocked(double dt, uint64_t substeps, bool closed) {
+  const auto nx = num_boxes_axis_[0];
+  const auto ny = num_boxes_axis_[1];
+  const auto nz = num_boxes_axis_[2];
+  const size_t plane_size = nx * ny;
+
+  const double ibl2 = 1 / (box_length_ * box_length_);
+  const double d = 1 - dc_[0];
+  DiffusionReal* c1 = c1_.data();
+  DiffusionReal* c2 = c2_.data();
+  planes_.resize((substeps - 1) * 3 * plane_size);
+  DiffusionReal* planes = planes_.data();
+
+  // Time level 0 is `c1_`, time level `substeps` is `c2_`. The intermediate
+  // levels keep planes z - 1, z, and z + 1 in a ring buffer.
+  auto get_plane = [&](uint64_t level, size_t z) {
+    if (level == 0) {
+      return c1 + z * plane_size;
+    } else if (level == substeps) {
+      return c2 + z * plane_size;
+    }
+    return planes + ((level - 1) * 3 + z % 3) * plane_size;
+  };
+
+  // Wavefront: in iteration `w`, time level `level` computes plane
+  // z = w - level + 1, which depends on planes z - 1, z, and z + 1 of the
+  // previous time level. These have been computed in iteration `w` or
+  // earlier.
+#pragma omp parallel
+  for (size_t w = 0; w < nz + substeps - 1; w++) {
+    for (uint64_t level = 1; level <= substeps; level++) {
+      if (w + 1 < level || w + 1 - level >= nz) {
+        continue;
+      }
+      const size_t z = w + 1 - level;
+      DiffusionReal* out = get_plane(level, z);
+      const DiffusionReal* in = get_plane(level - 1, z);
+      if (!closed) {
+        const DiffusionReal* below = z == 0 ? in : get_plane(level - 1, z - 1);
+        const DiffusionReal* above =
+            z == nz - 1 ? in : get_plane(level - 1, z + 1);
+#pragma omp for
+        for (size_t y = 0; y < ny; y++) {
+          const size_t row = y * nx;
+          std::array<int, 4> l = {{y == 0 ? 0 : 1, y == ny - 1 ? 0 : 1,
+                                   z == 0 ? 0 : 1, z == nz - 1 ? 0 : 1}};
+          const DiffusionReal* n = y == 0 ? in + row : in + row - nx;
+          const DiffusionReal* s = y == ny - 1 ? in + row : in + row + nx;
+          OpenEdgeRow(in + row, n, s, below + row, above + row, l, out + row,
+                      nx, d, dt, ibl2, mu_);
         }
-        ++c;
-        ++n;
-        ++s;
-        ++b;
-        ++t;
-        c2_[c] = (c1_[c] + d * dt * (c1_[c - 1] - 2 * c1_[c] + 0) * ibl2 +
-                  d * dt * (c1_[s] - 2 * c1_[c] + c1_[n]) * ibl2 +
-                  d * dt * (c1_[b] - 2 * c1_[c] + c1_[t]) * ibl2) *
-                 (1 - mu_);
-      }  // tile ny
-    }    // tile nz
-  }      // block ny
+        continue;
+      }
+      // The values at the boundary remain unchanged
+      const DiffusionReal* boundary = c1 + z * plane_size;
+      if (z == 0 || z == nz - 1) {
+#pragma omp for
+        for (size_t y = 0; y < ny; y++) {
+          std::copy(boundary + y * nx, boundary + (y + 1) * nx, out + y * nx);
+        }
+        continue;
+      }
+      const DiffusionReal* below = get_plane(level - 1, z - 1);
+      const DiffusionReal* above = get_plane(level - 1, z + 1);
+#pragma omp for
+      for (size_t y = 0; y < ny; y++) {
+        const size_t row = y * nx;
+        if (y == 0 || y == ny - 1) {
+          std::copy(boundary + row, boundary + row + nx, out + row);
+          continue;
+        }
+        out[row] = boundary[row];
+        out[row + nx - 1] = boundary[row + nx - 1];
+        ClosedEdgeRow(in + row, in + row - nx, in + row + nx, below + row,
+                      above + row, out + row, nx, d, dt, ibl2, mu_);
+      }
+    }
+  }
   c1_.swap(c2_);
 }
 
+void EulerGrid::DiffuseRowWithClosedEdge(size_t y, size_t z, double dt) {
+  const auto nx = num_boxes_axis_[0];
+  const auto ny = num_boxes_axis_[1];
+  const auto nz = num_boxes_axis_[2];
+
+  // The values at the boundary remain unchanged
+  const DiffusionReal* c = c1_.data() + y * nx + z * nx * ny;
+  DiffusionReal* out = c2_.data() + y * nx + z * nx * ny;
+  if (y == 0 || y == (ny - 1) || z == 0 || z == (nz - 1)) {
+    std::copy(c, c + nx, out);
+    return;
+  }
+  out[0] = c[0];
+  out[nx - 1] = c[nx - 1];
+
+  const double ibl2 = 1 / (box_length_ * box_length_);
+  const double d = 1 - dc_[0];
+  ClosedEdgeRow(c, c - nx, c + nx, c - nx * ny, c + nx * ny, out, nx, d, dt,
+                ibl2, mu_);
+}
+
+void EulerGrid::DiffuseRowWithOpenEdge(size_t y, size_t z, double dt) {
+  const auto nx = num_boxes_axis_[0];
+  const auto ny = num_boxes_axis_[1];
+  const auto nz = num_boxes_axis_[2];
+
+  const double ibl2 = 1 / (box_length_ * box_length_);
+  const double d = 1 - dc_[0];
+  std::array<int, 4> l;
+  l.fill(1);
+
+  const DiffusionReal* c = c1_.data() + y * nx + z * nx * ny;
+  const DiffusionReal *n, *s, *b, *t;
+
+  if (y == 0) {
+    n = c;
+    l[0] = 0;
+  } else {
+    n = c - nx;
+  }
+
+  if (y == ny - 1) {
+    s = c;
+    l[1] = 0;
+  } else {
+    s = c + nx;
+  }
+
+  if (z == 0) {
+    b = c;
+    l[2] = 0;
+  } else {
+    b = c - nx * ny;
+  }
+
+  if (z == nz - 1) {
+    t = c;
+    l[3] = 0;
+  } else {
+    t = c + nx * ny;
+  }
+
+  OpenEdgeRow(c, n, s, b, t, l, c2_.data() + y * nx + z * nx * ny, nx, d, dt,
+              ibl2, mu_);
+}
+
 }  // namespace bdm
@@ -16,6 +16,7 @@
 #define CORE_DIFFUSION_EULER_GRID_H_
 
 #include <utility>
+#include <vector>
 
 #include "core/diffusion/diffusion_grid.h"
 
@@ -29,11 +30,55 @@ class EulerGrid : public DiffusionGrid {
       : DiffusionGrid(substance_id, std::move(substance_name), dc, mu,
                       resolution) {}
 
+  /// Advances the concentrations by `dt` in `GetNumSubsteps()` substeps.
+  /// Multiple substeps are computed in a single pass over the grid with
+  /// temporal blocking: a wavefront moves along the z-axis and each time
+  /// level trails the previous one by one plane. The intermediate time
+  /// levels only keep the three most recent planes, which remain in the
+  /// cache; `c1_` is read and `c2_` written once per pass instead of once
+  /// per substep. The boundary values remain unchanged.
   void DiffuseWithClosedEdge(double dt) override;
 
+  /// Same as `DiffuseWithClosedEdge`, but substances leave the grid at the
+  /// boundary.
   void DiffuseWithOpenEdge(double dt) override;
 
+  /// Returns `Param::diffusion_substeps`
+  uint64_t GetNumSubsteps() const override;
+
+  /// Returns the number of tiles that are skipped in the next step because
+  /// they have converged (see `Param::diffusion_convergence_tolerance`)
+  size_t GetNumIdleTiles() const;
+
+
  private:
+  /// Updates row (`y`, `z`) of `c2_` from `c1_`. With closed edges, the
+  /// boundary values are copied.
+  void DiffuseRowWithClosedEdge(size_t y, size_t z, double dt);
+  void DiffuseRowWithOpenEdge(size_t y, size_t z, double dt);
+
+  /// Advances the grid by `substeps` substeps of `dt` in one pass
+  /// (see `DiffuseWithClosedEdge`)
+  void DiffuseBlocked(double dt, uint64_t substeps, bool closed);
+
+  /// Performs one step of `dt` that skips idle tiles and updates the state
+  /// of the tiles (see `Param::diffusion_convergence_tolerance`)
+  void DiffuseActiveTiles(double dt, bool closed, double tolerance);
+
+  /// Ring buffers of three z-planes for each intermediate time level of
+  /// `DiffuseBlocked`
+  std::vector<DiffusionReal> planes_;  //!
+
+  /// Maximum change of the rows of each tile in each z-plane in the last
+  /// call of `DiffuseActiveTiles`
+  std::vector<double> row_change_;  //!
+  /// Maximum change of each tile in its last update
+  std::vector<double> tile_rate_;  //!
+  /// Estimated change of each tile since its last update
+  std::vector<double> skipped_change_;  //!
+  /// Tiles next to an active tile in `DiffuseActiveTiles`
+  std::vector<uint8_t> active_neighbors_;  //!
+
   BDM_CLASS_DEF_OVERRIDE(EulerGrid, 1);
 };
 
@@ -17,9 +17,9 @@
 namespace bdm {
 
 void RungeKuttaGrid::DiffuseWithClosedEdge(double dt) {
-  const auto nx = resolution_;
-  const auto ny = resolution_;
-  const auto nz = resolution_;
+  const auto nx = num_boxes_axis_[0];
+  const auto ny = num_boxes_axis_[1];
+  const auto nz = num_boxes_axis_[2];
 
   const double ibl2 = 1 / (box_length_ * box_length_);
   const double d = 1 - dc_[0];
@@ -85,9 +85,9 @@ void RungeKuttaGrid::DiffuseWithClosedEdge(double dt) {
 }
 
 void RungeKuttaGrid::DiffuseWithOpenEdge(double dt) {
-  const auto nx = resolution_;
-  const auto ny = resolution_;
-  const auto nz = resolution_;
+  const auto nx = num_boxes_axis_[0];
+  const auto ny = num_boxes_axis_[1];
+  const auto nz = num_boxes_axis_[2];
 
   const double ibl2 = 1 / (box_length_ * box_length_);
   std::array<int, 4> l;
@@ -267,6 +267,88 @@ operator()(Iterator<uint64_t>* it) {
 
 // -----------------------------------------------------------------------------
 using NeighborMutex = Environment::NeighborMutexBuilder::NeighborMutex;
+void UniformGridEnvironment::ForEachNeighborPair(
+    Functor<void, Agent*, AgentHandle, Agent*, AgentHandle, double>& lambda,
+    double squared_radius) {
+  if (squared_radius > box_length_squared_) {
+    Log::Fatal(
+        "UniformGridEnvironment::ForEachNeighborPair",
+        "The requested search radius (", std::sqrt(squared_radius), ")",
+        " of the neighborhood search exceeds the "
+        "box length (",
+        box_length_, "). The resulting neighborhood would be incomplete.");
+  }
+  auto* rm = Simulation::GetActive()->GetResourceManager();
+
+  auto process_box = [&](size_t box_idx) {
+    const Box* box = GetBoxPointer(box_idx);
+    if (box->IsEmpty(timestamp_)) {
+      return;
+    }
+    FixedSizeVector<size_t, 14> half_shell;
+    GetHalfMooreBoxIndices(&half_shell, box_idx);
+
+    for (Box::Iterator it(this, box); !it.IsAtEnd(); ++it) {
+      auto ah = *it;
+      auto* agent = rm->GetAgent(ah);
+      const auto& pos = agent->GetPosition();
+      auto visit = [&](AgentHandle nah) {
+        auto* neighbor = rm->GetAgent(nah);
+        double squared_distance =
+            SquaredEuclideanDistance(pos, neighbor->GetPosition());
+        if (squared_distance < squared_radius) {
+          lambda(agent, ah, neighbor, nah, squared_distance);
+        }
+      };
+      // agents in the same box that come later in the linked list
+      Box::Iterator nit = it;
+      for (++nit; !nit.IsAtEnd(); ++nit) {
+        visit(*nit);
+      }
+      // the remaining 13 boxes of the half shell
+      for (uint64_t i = 1; i < half_shell.size(); ++i) {
+        if (half_shell[i] >= boxes_.size()) {
+          continue;
+        }
+        for (Box::Iterator nit(this, GetBoxPointer(half_shell[i]));
+             !nit.IsAtEnd(); ++nit) {
+          visit(*nit);
+        }
+      }
+    }
+  };
+
+  // The half shell of a box spans one box in each direction along the x- and
+  // y-axis, but only one box in the positive direction along the z-axis.
+  // Boxes that are (at least) three boxes apart along the x- or y-axis, or two
+  // boxes along the z-axis, do not share any box in their half shells and can
+  // be processed in parallel. Hence, we process the boxes in 18 colors.
+  const std::array<uint64_t, 3> stride = {3, 3, 2};
+  for (uint64_t cz = 0; cz < stride[2]; ++cz) {
+    for (uint64_t cy = 0; cy < stride[1]; ++cy) {
+      for (uint64_t cx = 0; cx < stride[0]; ++cx) {
+        std::array<uint64_t, 3> color = {cx, cy, cz};
+        std::array<uint64_t, 3> num;
+        for (int d = 0; d < 3; ++d) {
+          num[d] = num_boxes_axis_[d] > color[d]
+                       ? (num_boxes_axis_[d] - color[d] + stride[d] - 1) /
+                             stride[d]
+                       : 0;
+        }
+        int64_t total = num[0] * num[1] * num[2];
+#pragma omp parallel for schedule(dynamic, 16)
+        for (int64_t i = 0; i < total; ++i) {
+          std::array<uint64_t, 3> box_coord;
+          box_coord[0] = color[0] + stride[0] * (i % num[0]);
+          box_coord[1] = color[1] + stride[1] * ((i / num[0]) % num[1]);
+          box_coord[2] = color[2] + stride[2] * (i / (num[0] * num[1]));
+          process_box(GetBoxIndex(box_coord));
+        }
+      }
+    }
+  }
+}
+
 using GridNeighborMutexBuilder =
     UniformGridEnvironment::GridNeighborMutexBuilder;
 
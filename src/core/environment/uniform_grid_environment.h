@@ -492,6 +492,25 @@ class UniformGridEnvironment : public Environment {
     process_batch();
   };
 
+  /// @brief      Applies the given lambda once to each pair of agents whose
+  ///             squared distance is smaller than `squared_radius`.
+  ///
+  /// Each box only visits half of its neighbor boxes (see
+  /// `GetHalfMooreBoxIndices`), so each pair is visited exactly once. The
+  /// boxes are processed in parallel; boxes whose neighborhoods overlap are
+  /// never processed at the same time. Therefore, concurrent invocations of
+  /// `lambda` never involve the same agent, and `lambda` can update both
+  /// agents of the pair (or data associated with them) without
+  /// synchronization.
+  ///
+  /// @param[in]  lambda    Arguments: first agent and its handle, second
+  ///                       agent and its handle, squared distance
+  /// @param      squared_radius  The squared search radius
+  ///
+  void ForEachNeighborPair(
+      Functor<void, Agent*, AgentHandle, Agent*, AgentHandle, double>& lambda,
+      double squared_radius);
+
   void ForEachNeighbor(Functor<void, Agent*>& lambda, const Agent& query,
                        void* criteria) override {
     Log::Fatal("UniformGridEnvironment::ForEachNeighbor",
@@ -13,6 +13,7 @@
 // -----------------------------------------------------------------------------
 
 #include "core/execution_context/copy_execution_context.h"
+#include <algorithm>
 #include "core/agent/agent.h"
 #include "core/resource_manager.h"
 #include "core/simulation.h"
@@ -34,20 +35,66 @@ void CopyExecutionContext::Use(Simulation* sim) {
   sim->SetAllExecCtxts(exec_ctxts);
 }
 
+// -----------------------------------------------------------------------------
+void CopyExecutionContext::Use(Simulation* sim,
+                               const CopyAttributes& copy_attributes) {
+  if (copy_attributes == nullptr) {
+    Log::Fatal("CopyExecutionContext::Use",
+               "The double-buffered mode requires a function that copies the "
+               "attributes modified by agent operations.");
+  }
+  auto size = sim->GetAllExecCtxts().size();
+  auto map = std::make_shared<
+      typename InPlaceExecutionContext::ThreadSafeAgentUidMap>();
+  std::vector<ExecutionContext*> exec_ctxts(size);
+  // In double-buffered mode the next buffer owns its agents.
+  auto agents = std::shared_ptr<std::vector<std::vector<Agent*>>>(
+      new std::vector<std::vector<Agent*>>(),
+      [](std::vector<std::vector<Agent*>>* buffer) {
+        for (auto& numa_agents : *buffer) {
+          for (auto* agent : numa_agents) {
+            if (agent != nullptr) {
+              delete agent;
+            }
+          }
+        }
+        delete buffer;
+      });
+  auto executed = std::make_shared<std::vector<std::vector<uint8_t>>>();
+#pragma omp parallel for schedule(static, 1)
+  for (uint64_t i = 0; i < size; i++) {
+    exec_ctxts[i] =
+        new CopyExecutionContext(map, agents, copy_attributes, executed);
+  }
+  sim->SetAllExecCtxts(exec_ctxts);
+}
+
 // -----------------------------------------------------------------------------
 CopyExecutionContext::CopyExecutionContext(
     const std::shared_ptr<ThreadSafeAgentUidMap>& map,
-    std::shared_ptr<std::vector<std::vector<Agent*>>> agents)
-    : InPlaceExecutionContext(map), agents_(agents) {
+    std::shared_ptr<std::vector<std::vector<Agent*>>> agents,
+    const CopyAttributes& copy_attributes,
+    std::shared_ptr<std::vector<std::vector<uint8_t>>> executed)
+    : InPlaceExecutionContext(map),
+      agents_(agents),
+      copy_attributes_(copy_attributes),
+      executed_(executed) {
   auto* tinfo = ThreadInfo::GetInstance();
 #pragma omp master
-  agents_->resize(tinfo->GetNumaNodes());
+  {
+    agents_->resize(tinfo->GetNumaNodes());
+    if (executed_) {
+      executed_->resize(tinfo->GetNumaNodes());
+    }
+  }
 
   auto* param = Simulation::GetActive()->GetParam();
-  if (param->execution_order == Param::ExecutionOrder::kForEachOpForEachAgent) {
+  if (!IsDoubleBuffered() &&
+      param->execution_order == Param::ExecutionOrder::kForEachOpForEachAgent) {
     Log::Fatal("CopyExecutionContext",
                "CopyExecutionContext does not support Param::execution_order = "
-               "Param::ExecutionOrder::kForEachOpForEachAgent");
+               "Param::ExecutionOrder::kForEachOpForEachAgent. Use the "
+               "double-buffered mode instead.");
   }
 }
 
@@ -59,17 +106,22 @@ void CopyExecutionContext::SetupIterationAll(
     const std::vector<ExecutionContext*>& all_exec_ctxts) {
   InPlaceExecutionContext::SetupIterationAll(all_exec_ctxts);
 
-  auto* rm = Simulation::GetActive()->GetResourceManager();
-  for (uint64_t n = 0; n < agents_->size(); ++n) {
-    agents_->at(n).reserve(rm->GetAgentVectorCapacity(n));
-    agents_->at(n).resize(rm->GetNumAgents(n));
-  }
+  ResizeBuffers();
+}
 
-  auto* scheduler = Simulation::GetActive()->GetScheduler();
-  if (scheduler->GetAgentFilters().size() != 0) {
-    Log::Fatal("CopyExecutionContext",
-               "CopyExecutionContext does not support simulations with agent "
-               "filters yet (see Scheduler::SetAgentFilters)");
+// -----------------------------------------------------------------------------
+void CopyExecutionContext::SetupAgentOpsAll(
+    const std::vector<ExecutionContext*>& all_exec_ctxts) {
+  InPlaceExecutionContext::SetupAgentOpsAll(all_exec_ctxts);
+  if (!IsDoubleBuffered()) {
+    // Agents that are not executed in this agent operation phase (e.g. due
+    // to agent filters or agent subsets) keep a nullptr in the next buffer.
+    ResizeBuffers();
+    return;
+  }
+  ResizeBuffers();
+  for (auto& numa_executed : *executed_) {
+    std::fill(numa_executed.begin(), numa_executed.end(), 0);
   }
 }
 
@@ -78,19 +130,124 @@ void CopyExecutionContext::TearDownAgentOpsAll(
     const std::vector<ExecutionContext*>& all_exec_ctxts) {
   auto* rm = Simulation::GetActive()->GetResourceManager();
 
-  auto del = L2F([](Agent* a) { delete a; });
-  rm->ForEachAgentParallel(del);
+  if (IsDoubleBuffered()) {
+    // Agents that have not been executed in this agent operation phase
+    // (e.g. due to agent filters) must be synchronized before the buffers
+    // are swapped.
+    auto& agents = *agents_.get();
+    auto& executed = *executed_.get();
+    auto sync = L2F([&](Agent* agent, AgentHandle ah) {
+      auto nid = ah.GetNumaNode();
+      auto idx = ah.GetElementIdx();
+      if (!executed[nid][idx]) {
+        agents[nid][idx] = SyncNextBuffer(agent, agents[nid][idx]);
+      }
+    });
+    rm->ForEachAgentParallel(sync);
+  } else {
+    auto& agents = *agents_.get();
+    auto del = L2F([&](Agent* agent, AgentHandle ah) {
+      auto*& next = agents[ah.GetNumaNode()][ah.GetElementIdx()];
+      if (next == nullptr) {
+        // not executed -> keep the current agent
+        next = agent;
+      } else {
+        delete agent;
+      }
+    });
+    rm->ForEachAgentParallel(del);
+  }
   rm->SwapAgents(agents_.get());
+  if (!IsDoubleBuffered()) {
+    // The buffer contains the previous agents, which have been deleted or
+    // moved to the ResourceManager.
+    for (auto& numa_agents : *agents_) {
+      std::fill(numa_agents.begin(), numa_agents.end(), nullptr);
+    }
+  }
+
+  InPlaceExecutionContext::TearDownAgentOpsAll(all_exec_ctxts);
 }
 
 // -----------------------------------------------------------------------------
 void CopyExecutionContext::Execute(Agent* agent, AgentHandle ah,
                                    const std::vector<Operation*>& operations) {
-  auto* copy = agent->NewCopy();
-  InPlaceExecutionContext::Execute(copy, ah, operations);
-  assert(ah.GetNumaNode() < agents_->size());
-  assert(ah.GetElementIdx() < agents_->at(ah.GetNumaNode()).size());
-  (*agents_.get())[ah.GetNumaNode()][ah.GetElementIdx()] = copy;
+  auto nid = ah.GetNumaNode();
+  auto idx = ah.GetElementIdx();
+  assert(nid < agents_->size());
+  assert(idx < agents_->at(nid).size());
+  auto*& next = (*agents_.get())[nid][idx];
+
+  if (IsDoubleBuffered()) {
+    // With Param::ExecutionOrder::kForEachOpForEachAgent and agent filters
+    // this function is called multiple times for the same agent. Only the
+    // first call synchronizes the next buffer. Consecutive calls continue
+    // with the updated state.
+    auto& executed = (*executed_.get())[nid][idx];
+    if (!executed) {
+      next = SyncNextBuffer(agent, next);
+      executed = 1;
+    }
+    InPlaceExecutionContext::Execute(next, ah, operations);
+  } else {
+    auto* copy = agent->NewCopy();
+    InPlaceExecutionContext::Execute(copy, ah, operations);
+    next = copy;
+  }
+}
+
+// -----------------------------------------------------------------------------
+void CopyExecutionContext::ForEachNeighbor(
+    Functor<void, Agent*, double>& lambda, const Agent& query,
+    double squared_radius) {
+  auto uid = query.GetUid();
+  auto for_each = L2F([&](Agent* agent, double squared_distance) {
+    if (agent->GetUid() != uid) {
+      lambda(agent, squared_distance);
+    }
+  });
+  InPlaceExecutionContext::ForEachNeighbor(for_each, query, squared_radius);
+}
+
+// -----------------------------------------------------------------------------
+void CopyExecutionContext::ResizeBuffers() {
+  auto* rm = Simulation::GetActive()->GetResourceManager();
+  for (uint64_t n = 0; n < agents_->size(); ++n) {
+    auto& numa_agents = (*agents_.get())[n];
+    auto num_agents = rm->GetNumAgents(n);
+    if (IsDoubleBuffered()) {
+      // Agents in the next buffer beyond the number of agents in the
+      // ResourceManager belong to agents that have been removed.
+      for (uint64_t i = num_agents; i < numa_agents.size(); ++i) {
+        if (numa_agents[i] != nullptr) {
+          delete numa_agents[i];
+        }
+      }
+      numa_agents.reserve(rm->GetAgentVectorCapacity(n));
+      numa_agents.resize(num_agents, nullptr);
+      (*executed_.get())[n].resize(num_agents);
+    } else {
+      numa_agents.reserve(rm->GetAgentVectorCapacity(n));
+      numa_agents.resize(num_agents);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+Agent* CopyExecutionContext::SyncNextBuffer(const Agent* current,
+                                            Agent* next) const {
+  // The ResourceManager might have moved agents to a different position
+  // (agent removal, load balancing). In this case the next buffer at this
+  // position belongs to a different agent and must be replaced.
+  if (next == nullptr || next->GetUid() != current->GetUid()) {
+    if (next != nullptr) {
+      delete next;
+    }
+    return current->NewCopy();
+  }
+  next->CopyEngineState(*current);
+  copy_attributes_(current, next);
+  return next;
 }
 
 }  // namespace experimental
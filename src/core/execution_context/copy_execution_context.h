@@ -15,6 +15,10 @@
 #ifndef CORE_EXECUTION_CONTEXT_COPY_EXECUTION_CONTEXT_H_
 #define CORE_EXECUTION_CONTEXT_COPY_EXECUTION_CONTEXT_H_
 
+#include <functional>
+#include <memory>
+#include <vector>
+
 #include "core/execution_context/in_place_exec_ctxt.h"
 
 namespace bdm {
@@ -31,33 +35,101 @@ namespace experimental {
 /// Thus, all agents see the same agent state if they read attributes from their
 /// neighbors.
 /// The value of the neighbor attributes will be from the last iteration. \n
-/// NB: This execution context does *not* support neighbor modification,
-/// `Param::ExecutionOrder::kForEachOpForEachAgent`, and agent filter
-/// `Scheduler::SetAgentFilters`.
+/// The execution context supports two modes:
+/// 1) Full copy (`Use(Simulation*)`): each agent is deep copied with
+///    `Agent::NewCopy` before the operations are executed.
+///    This mode does *not* support
+///    `Param::ExecutionOrder::kForEachOpForEachAgent`.
+///    Agents that are not executed in an agent operation phase (agent filters
+///    `Scheduler::SetAgentFilters` or agent subsets
+///    `Operation::SetAgentSubset`) are kept without copy.
+/// 2) Double-buffered (`Use(Simulation*, const CopyAttributes&)`): the
+///    execution context keeps a persistent second instance ("next" buffer)
+///    of each agent. Before the operations are executed for an agent,
+///    only the attributes that operations write (defined by the given
+///    function) and the attributes managed by the engine
+///    (`Agent::CopyEngineState`) are copied from the current to the next
+///    buffer. Both buffers are swapped in `TearDownAgentOpsAll`.
+///    Hence, agents are only allocated if they are new or have been moved by
+///    the `ResourceManager` (e.g. load balancing or agent removal).
+///    Attributes that are modified by operations, but not copied by the given
+///    function (e.g. the internal state of behaviors), might become
+///    inconsistent between the two buffers.
+///    This mode supports all execution orders and agent filters.
+///
+/// NB: This execution context does *not* support neighbor modification.
 class CopyExecutionContext : public InPlaceExecutionContext {
  public:
+  /// Copies the attributes that agent operations modify from the first to
+  /// the second agent.
+  using CopyAttributes = std::function<void(const Agent*, Agent*)>;
+
   /// Use the CopyExecutionContext for simulation `sim`.
   static void Use(Simulation* sim);
 
+  /// Use the CopyExecutionContext in double-buffered mode for simulation
+  /// `sim`. `copy_attributes` must copy all attributes that agent operations
+  /// modify. e.g. for a simulation that only changes the position and
+  /// diameter of cells:
+  ///
+  ///     CopyExecutionContext::Use(&sim, [](const Agent* src, Agent* dest) {
+  ///       dest->SetPosition(src->GetPosition());
+  ///       dest->SetDiameter(src->GetDiameter());
+  ///     });
+  static void Use(Simulation* sim, const CopyAttributes& copy_attributes);
+
   explicit CopyExecutionContext(
       const std::shared_ptr<ThreadSafeAgentUidMap>& map,
-      std::shared_ptr<std::vector<std::vector<Agent*>>> agents);
+      std::shared_ptr<std::vector<std::vector<Agent*>>> agents,
+      const CopyAttributes& copy_attributes = nullptr,
+      std::shared_ptr<std::vector<std::vector<uint8_t>>> executed = nullptr);
 
   virtual ~CopyExecutionContext();
 
   void SetupIterationAll(
       const std::vector<ExecutionContext*>& all_exec_ctxts) override;
 
+  void SetupAgentOpsAll(
+      const std::vector<ExecutionContext*>& all_exec_ctxts) override;
+
   void TearDownAgentOpsAll(
       const std::vector<ExecutionContext*>& all_exec_ctxts) override;
 
   void Execute(Agent* agent, AgentHandle ah,
                const std::vector<Operation*>& operations) override;
 
+  using InPlaceExecutionContext::ForEachNeighbor;
+
+  /// Skips the committed instance of `query`, which the environment would
+  /// otherwise return as a neighbor of its own copy.
+  void ForEachNeighbor(Functor<void, Agent*, double>& lambda,
+                       const Agent& query, double squared_radius) override;
+
+  /// Returns true if this execution context runs in double-buffered mode.
+  bool IsDoubleBuffered() const { return copy_attributes_ != nullptr; }
+
  protected:
   /// Pointer container for all agents shared between all
   /// CopyExecutionContext instances of a simulation.
+  /// In double-buffered mode, it contains the next buffer and owns the agents.
   std::shared_ptr<std::vector<std::vector<Agent*>>> agents_;
+  /// Copies the attributes that agent operations modify.
+  /// Empty if the full copy mode is used.
+  CopyAttributes copy_attributes_;
+  /// Double-buffered mode: flags that indicate if the next buffer of an
+  /// agent has already been synchronized in the current agent operation
+  /// phase. Required for `Param::ExecutionOrder::kForEachOpForEachAgent` and
+  /// agent filters.
+  std::shared_ptr<std::vector<std::vector<uint8_t>>> executed_;
+
+ private:
+  /// Resizes the buffers to match the number of agents in the
+  /// `ResourceManager`.
+  void ResizeBuffers();
+
+  /// Returns the next buffer of agent `current` after it has been
+  /// synchronized with `current`.
+  Agent* SyncNextBuffer(const Agent* current, Agent* next) const;
 };
 
 }  // namespace experimental
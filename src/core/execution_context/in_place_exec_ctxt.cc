@@ -16,6 +16,7 @@
 
 #include <algorithm>
 #include <mutex>
+#include <unordered_map>
 #include <utility>
 
 #include "core/agent/agent.h"
@@ -23,9 +24,26 @@
 #include "core/functor.h"
 #include "core/resource_manager.h"
 #include "core/scheduler.h"
+#include "core/util/counter_based_random.h"
 
 namespace bdm {
 
+namespace {
+
+/// Bit mixing function of SplitMix64
+inline uint64_t MixBits(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ull;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+inline uint64_t CombineKeys(uint64_t a, uint64_t b) {
+  return MixBits(a ^ MixBits(b));
+}
+
+}  // namespace
+
 InPlaceExecutionContext::ThreadSafeAgentUidMap::ThreadSafeAgentUidMap()
     : batches_(nullptr) {
   Resize(kBatchSize);
@@ -114,7 +132,9 @@ InPlaceExecutionContext::InPlaceExecutionContext(
     const std::shared_ptr<ThreadSafeAgentUidMap>& map)
     : new_agent_map_(map), tinfo_(ThreadInfo::GetInstance()) {
   new_agents_.reserve(1e3);
-  cache_neighbors_ = Simulation::GetActive()->GetParam()->cache_neighbors;
+  auto* param = Simulation::GetActive()->GetParam();
+  cache_neighbors_ = param->cache_neighbors;
+  deterministic_ = param->deterministic_mode;
 }
 
 InPlaceExecutionContext::~InPlaceExecutionContext() {
@@ -140,16 +160,54 @@ void InPlaceExecutionContext::TearDownIterationAll(
 }
 
 void InPlaceExecutionContext::SetupAgentOpsAll(
-    const std::vector<ExecutionContext*>& all_exec_ctxts) {}
+    const std::vector<ExecutionContext*>& all_exec_ctxts) {
+  if (!deterministic_) {
+    return;
+  }
+  auto step = Simulation::GetActive()->GetScheduler()->GetSimulatedSteps();
+  for (auto* ec : all_exec_ctxts) {
+    auto* ctxt = bdm_static_cast<InPlaceExecutionContext*>(ec);
+    if (ctxt->agent_ops_step_ != step) {
+      ctxt->agent_ops_step_ = step;
+      ctxt->agent_ops_phase_ = 0;
+    } else {
+      ctxt->agent_ops_phase_++;
+    }
+  }
+}
 
 void InPlaceExecutionContext::TearDownAgentOpsAll(
-    const std::vector<ExecutionContext*>& all_exec_ctxts) {}
+    const std::vector<ExecutionContext*>& all_exec_ctxts) {
+  if (!deterministic_) {
+    return;
+  }
+  // Random numbers that are drawn outside of agent operations use a separate
+  // stream for each thread. Otherwise, they would continue the stream of the
+  // last agent that was processed by this thread.
+  auto substream = CombineKeys(agent_ops_step_, agent_ops_phase_);
+  auto& random = Simulation::GetActive()->GetAllRandom();
+  for (uint64_t i = 0; i < random.size(); ++i) {
+    random[i]->SetStream(CounterBasedRandom::GetThreadStream(i), substream);
+  }
+}
 
 void InPlaceExecutionContext::Execute(
     Agent* agent, AgentHandle ah, const std::vector<Operation*>& operations) {
   auto* env = Simulation::GetActive()->GetEnvironment();
   auto* param = Simulation::GetActive()->GetParam();
 
+  if (deterministic_) {
+    // The random number stream and the order of new agents depend only on
+    // the agent and the executed operations, not on the thread.
+    UpdatePassKey(operations);
+    auto uid = agent->GetUid();
+    Simulation::GetActive()->GetRandom()->SetStream(
+        uid, CombineKeys(agent_ops_step_, pass_key_));
+    creation_context_.creator = uid;
+    creation_context_.pass = pass_key_;
+    creation_context_.idx = 0;
+  }
+
   if (param->thread_safety_mechanism ==
       Param::ThreadSafetyMechanism::kUserSpecified) {
     while (true) {
@@ -214,11 +272,46 @@ void InPlaceExecutionContext::Execute(
                "Invalid value for parameter thread_safety_mechanism: ",
                param->thread_safety_mechanism);
   }
+
+  if (deterministic_) {
+    // Agents that are created outside of Execute on this thread are ordered
+    // by their position in new_agents_.
+    creation_context_.creator = AgentUid();
+    creation_context_.pass = 0;
+    creation_context_.idx = new_agents_.size();
+  }
+}
+
+void InPlaceExecutionContext::UpdatePassKey(
+    const std::vector<Operation*>& operations) {
+  if (operations.empty()) {
+    pass_key_ = agent_ops_phase_;
+    return;
+  }
+  // operations don't change during one agent operation phase, unless
+  // Param::ExecutionOrder::kForEachOpForEachAgent is used
+  if (pass_key_phase_ == agent_ops_phase_ &&
+      pass_key_op_ == operations.front() &&
+      pass_key_num_ops_ == operations.size()) {
+    return;
+  }
+  pass_key_ = agent_ops_phase_;
+  std::hash<std::string> hash;
+  for (auto* op : operations) {
+    pass_key_ = CombineKeys(pass_key_, hash(op->name_));
+  }
+  pass_key_phase_ = agent_ops_phase_;
+  pass_key_op_ = operations.front();
+  pass_key_num_ops_ = operations.size();
 }
 
 void InPlaceExecutionContext::AddAgent(Agent* new_agent) {
   new_agents_.push_back(new_agent);
   new_agent_map_->Insert(new_agent->GetUid(), new_agent);
+  if (deterministic_) {
+    new_agent_order_.push_back(creation_context_);
+    creation_context_.idx++;
+  }
 }
 
 bool InPlaceExecutionContext::IsNeighborCacheValid(
@@ -240,6 +333,15 @@ void InPlaceExecutionContext::ForEachNeighbor(Functor<void, Agent*>& lambda,
                                               void* criteria) {
   // forward call to env and populate cache
   auto* env = Simulation::GetActive()->GetEnvironment();
+  if (deterministic_) {
+    auto for_each = L2F([&](Agent* agent, double) { lambda(agent); });
+    auto for_each_env = [&](Functor<void, Agent*, double>& collect) {
+      auto adapter = L2F([&](Agent* agent) { collect(agent, 0.0); });
+      env->ForEachNeighbor(adapter, query, criteria);
+    };
+    ForEachNeighborSorted(for_each, for_each_env, false);
+    return;
+  }
   auto for_each = L2F([&](Agent* agent) { lambda(agent); });
   env->ForEachNeighbor(for_each, query, criteria);
 }
@@ -264,6 +366,14 @@ void InPlaceExecutionContext::ForEachNeighbor(
   // ForEachNeighbor
   cached_squared_search_radius_ = squared_radius;
 
+  if (deterministic_) {
+    auto for_each_env = [&](Functor<void, Agent*, double>& collect) {
+      env->ForEachNeighbor(collect, query, squared_radius);
+    };
+    ForEachNeighborSorted(lambda, for_each_env, param->cache_neighbors);
+    return;
+  }
+
   // Populate the cache and execute the lambda for each neighbor
   auto for_each = L2F([&](Agent* agent, double squared_distance) {
     if (param->cache_neighbors) {
@@ -281,9 +391,46 @@ void InPlaceExecutionContext::ForEachNeighbor(
     lambda(agent, squared_distance);
   });
   auto* env = Simulation::GetActive()->GetEnvironment();
+  if (deterministic_) {
+    auto for_each_env = [&](Functor<void, Agent*, double>& collect) {
+      env->ForEachNeighbor(collect, query_position, squared_radius);
+    };
+    ForEachNeighborSorted(lambda, for_each_env, false);
+    return;
+  }
   env->ForEachNeighbor(for_each, query_position, squared_radius);
 }
 
+template <typename TForEachEnv>
+void InPlaceExecutionContext::ForEachNeighborSorted(
+    Functor<void, Agent*, double>& lambda, TForEachEnv for_each_env,
+    bool cache) {
+  // Take the buffer, because lambda might call ForEachNeighbor again.
+  std::vector<std::pair<Agent*, double>> neighbors;
+  neighbors.swap(sorted_neighbors_);
+  neighbors.clear();
+  auto collect = L2F([&](Agent* agent, double squared_distance) {
+    neighbors.push_back(std::make_pair(agent, squared_distance));
+  });
+  for_each_env(collect);
+  // The environment returns neighbors in an order that depends on the
+  // number of threads. Sorting makes reductions over neighbors (e.g.
+  // mechanical forces) reproducible.
+  std::sort(neighbors.begin(), neighbors.end(),
+            [](const std::pair<Agent*, double>& lhs,
+               const std::pair<Agent*, double>& rhs) {
+              return lhs.first->GetUid() < rhs.first->GetUid();
+            });
+  if (cache) {
+    neighbor_cache_.insert(neighbor_cache_.end(), neighbors.begin(),
+                           neighbors.end());
+  }
+  for (auto& pair : neighbors) {
+    lambda(pair.first, pair.second);
+  }
+  sorted_neighbors_.swap(neighbors);
+}
+
 Agent* InPlaceExecutionContext::GetAgent(const AgentUid& uid) {
   auto* sim = Simulation::GetActive();
   auto* rm = sim->GetResourceManager();
@@ -305,6 +452,10 @@ void InPlaceExecutionContext::RemoveAgent(const AgentUid& uid) {
 
 void InPlaceExecutionContext::AddAgentsToRm(
     const std::vector<ExecutionContext*>& all_exec_ctxts) {
+  if (deterministic_) {
+    OrderNewAgents(all_exec_ctxts);
+  }
+
   // group execution contexts by numa domain
   std::vector<uint64_t> new_agent_per_numa(tinfo_->GetNumaNodes());
   std::vector<uint64_t> thread_offsets(tinfo_->GetMaxThreads());
@@ -332,6 +483,7 @@ void InPlaceExecutionContext::AddAgentsToRm(
     uint64_t offset = thread_offsets[i] + numa_offsets[nid];
     rm->AddAgents(nid, offset, ctxt->new_agents_);
     ctxt->new_agents_.clear();
+    ctxt->new_agent_order_.clear();
   }
 
   new_agent_map_->DeleteOldCopies();
@@ -352,6 +504,21 @@ void InPlaceExecutionContext::RemoveAgentsFromRm(
   }
 
   if (num_removals != 0) {
+    if (deterministic_) {
+      // The order of the removed agents determines which agents are moved to
+      // fill the gaps. Use a single sorted list instead of one per thread.
+      auto* first = bdm_static_cast<InPlaceExecutionContext*>(all_exec_ctxts[0]);
+      for (int i = 1; i < tinfo_->GetMaxThreads(); i++) {
+        auto* ctxt =
+            bdm_static_cast<InPlaceExecutionContext*>(all_exec_ctxts[i]);
+        first->remove_.insert(first->remove_.end(), ctxt->remove_.begin(),
+                              ctxt->remove_.end());
+        ctxt->remove_.clear();
+      }
+      std::sort(first->remove_.begin(), first->remove_.end());
+      all_remove.resize(1);
+    }
+
     auto* rm = Simulation::GetActive()->GetResourceManager();
     rm->RemoveAgents(all_remove);
 
@@ -361,6 +528,74 @@ void InPlaceExecutionContext::RemoveAgentsFromRm(
     }
   }
 }
+void InPlaceExecutionContext::OrderNewAgents(
+    const std::vector<ExecutionContext*>& all_exec_ctxts) {
+  auto max_threads = tinfo_->GetMaxThreads();
+  std::vector<std::pair<NewAgentOrder, Agent*>> agents;
+  std::vector<AgentUid> uids;
+  for (int i = 0; i < max_threads; i++) {
+    auto* ctxt = bdm_static_cast<InPlaceExecutionContext*>(all_exec_ctxts[i]);
+    assert(ctxt->new_agents_.size() == ctxt->new_agent_order_.size());
+    for (uint64_t j = 0; j < ctxt->new_agents_.size(); ++j) {
+      agents.push_back(
+          std::make_pair(ctxt->new_agent_order_[j], ctxt->new_agents_[j]));
+      uids.push_back(ctxt->new_agents_[j]->GetUid());
+    }
+    ctxt->new_agents_.clear();
+    ctxt->new_agent_order_.clear();
+  }
+  if (agents.empty()) {
+    return;
+  }
+
+  // The set of uids that has been generated in this iteration is independent
+  // of the number of threads, but not the assignment to agents.
+  std::sort(agents.begin(), agents.end(),
+            [](const std::pair<NewAgentOrder, Agent*>& lhs,
+               const std::pair<NewAgentOrder, Agent*>& rhs) {
+              return lhs.first < rhs.first;
+            });
+  std::sort(uids.begin(), uids.end());
+
+  std::unordered_map<AgentUid, AgentUid> new_uids;
+  auto chunk = (agents.size() + max_threads - 1) / max_threads;
+  for (uint64_t i = 0; i < agents.size(); ++i) {
+    auto* agent = agents[i].second;
+    if (agent->uid_ != uids[i]) {
+      new_uids[agent->uid_] = uids[i];
+      agent->uid_ = uids[i];
+    }
+    auto* ctxt =
+        bdm_static_cast<InPlaceExecutionContext*>(all_exec_ctxts[i / chunk]);
+    ctxt->new_agents_.push_back(agent);
+    ctxt->new_agent_order_.push_back(agents[i].first);
+  }
+  if (new_uids.empty()) {
+    return;
+  }
+
+  // Uids and AgentPointers that were stored in this iteration (e.g. the
+  // mother-daughter relation of neurites) still refer to the old uids.
+  auto* rm = Simulation::GetActive()->GetResourceManager();
+  auto remap = L2F([&](Agent* agent) { agent->RemapUids(new_uids); });
+  rm->ForEachAgentParallel(remap);
+#pragma omp parallel for
+  for (uint64_t i = 0; i < agents.size(); ++i) {
+    agents[i].second->RemapUids(new_uids);
+  }
+  rm->GetBondNetwork()->RemapUids(new_uids);
+  // Agents might have been removed in the same iteration they were created.
+  for (int i = 0; i < max_threads; i++) {
+    auto* ctxt = bdm_static_cast<InPlaceExecutionContext*>(all_exec_ctxts[i]);
+    for (auto& uid : ctxt->remove_) {
+      auto it = new_uids.find(uid);
+      if (it != new_uids.end()) {
+        uid = it->second;
+      }
+    }
+  }
+}
+
 // TODO(lukas) Add tests for caching mechanism in ForEachNeighbor*
 
 }  // namespace bdm
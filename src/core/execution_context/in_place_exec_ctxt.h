@@ -17,6 +17,7 @@
 
 #include <atomic>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -49,7 +50,10 @@ class InPlaceExecutionContext_NeighborCacheValidity_Test;
 /// modify themselves, but also neighbors. Therefore, a protection mechanism has
 /// been added. \see `Param::thread_safety_mechanism`
 /// New agents will only be visible at the next iteration. \n
-/// Also removal of an agent happens at the end of each iteration.
+/// Also removal of an agent happens at the end of each iteration. \n
+/// If `Param::deterministic_mode` is enabled, random number streams, the
+/// insertion and removal of agents, and the order of neighbors do not depend
+/// on the number of threads.
 class InPlaceExecutionContext : public ExecutionContext {
  public:
   struct ThreadSafeAgentUidMap {
@@ -158,12 +162,68 @@ class InPlaceExecutionContext : public ExecutionContext {
   double cached_squared_search_radius_ = 0.0;
   /// Cache the value of Param::cache_neighbors
   bool cache_neighbors_ = false;
+  /// Cache the value of Param::deterministic_mode
+  bool deterministic_ = false;
+
+  /// Deterministic mode: defines the position of a new agent in the
+  /// canonical insertion order.
+  struct NewAgentOrder {
+    /// Uid of the agent whose operations created the new agent.
+    /// Invalid if the agent was created outside of `Execute`.
+    AgentUid creator;
+    /// Identifies the executed operations (\see `pass_key_`)
+    uint64_t pass = 0;
+    /// Creation index for this creator and pass
+    uint64_t idx = 0;
+
+    bool operator<(const NewAgentOrder& other) const {
+      if (creator != other.creator) {
+        return creator < other.creator;
+      } else if (pass != other.pass) {
+        return pass < other.pass;
+      }
+      return idx < other.idx;
+    }
+  };
+  /// Deterministic mode: insertion order of each element in `new_agents_`
+  std::vector<NewAgentOrder> new_agent_order_;
+  /// Deterministic mode: creation context of agents added with `AddAgent`
+  NewAgentOrder creation_context_;
+  /// Deterministic mode: simulation step and index of the current agent
+  /// operation phase within this step. (More than one phase per step if
+  /// agent filters are used.)
+  uint64_t agent_ops_step_ = std::numeric_limits<uint64_t>::max();
+  uint64_t agent_ops_phase_ = 0;
+  /// Deterministic mode: key of the agent operation phase and the executed
+  /// operations. Used to derive random number streams.
+  uint64_t pass_key_ = 0;
+  /// Operations used to calculate `pass_key_`
+  const Operation* pass_key_op_ = nullptr;
+  uint64_t pass_key_num_ops_ = 0;
+  uint64_t pass_key_phase_ = std::numeric_limits<uint64_t>::max();
+  /// Deterministic mode: buffer to sort neighbors by uid
+  std::vector<std::pair<Agent*, double>> sorted_neighbors_;
 
   /// Check whether or not the neighbors in `neighbor_cache_` were queried with
   /// the same squared radius (`cached_squared_search_radius_`) as currently
   /// being queried with (`query_squared_radius_`)
   bool IsNeighborCacheValid(double query_squared_radius);
 
+  /// Deterministic mode: updates `pass_key_` for the given operations
+  void UpdatePassKey(const std::vector<Operation*>& operations);
+
+  /// Deterministic mode: sorts new agents of all execution contexts in
+  /// canonical order, assigns their uids in this order and distributes
+  /// them evenly among the execution contexts. Stored references to the
+  /// previous uids are updated with `Agent::RemapUids`.
+  void OrderNewAgents(const std::vector<ExecutionContext*>& all_exec_ctxts);
+
+  /// Deterministic mode: collects the neighbors returned by `for_each_env`
+  /// and forwards them to `lambda` in the order of their uid.
+  template <typename TForEachEnv>
+  void ForEachNeighborSorted(Functor<void, Agent*, double>& lambda,
+                             TForEachEnv for_each_env, bool cache);
+
   virtual void AddAgentsToRm(
       const std::vector<ExecutionContext*>& all_exec_ctxts);
 
@@ -16,8 +16,10 @@
 
 #include <algorithm>
 #include <cmath>
+#include <typeinfo>
 
 #include "core/agent/agent.h"
+#include "core/param/param.h"
 #include "core/shape.h"
 #include "core/simulation.h"
 #include "core/util/log.h"
@@ -30,6 +32,97 @@ namespace bdm {
 
 using neuroscience::NeuriteElement;
 
+constexpr double InteractionForce::kSphereIofCoefficient;
+constexpr double InteractionForce::kSphereAdditionalRadius;
+
+void InteractionForce::SetParameters(const Param* param) {
+  const std::vector<const std::vector<double>*> tables = {
+      &param->interaction_force_repulsion,
+      &param->interaction_force_attraction,
+      &param->interaction_force_iof_coefficient};
+  uint64_t size = 0;
+  for (auto* table : tables) {
+    if (table->empty()) {
+      continue;
+    }
+    if (size != 0 && table->size() != size) {
+      Log::Fatal("InteractionForce::SetParameters",
+                 "All interaction force parameter tables must have the same "
+                 "number of entries.");
+    }
+    size = table->size();
+  }
+
+  uint64_t num_types = 1;
+  if (size != 0) {
+    num_types = static_cast<uint64_t>(std::round(std::sqrt(size)));
+    if (num_types * num_types != size) {
+      Log::Fatal("InteractionForce::SetParameters",
+                 "The number of entries of the interaction force parameter "
+                 "tables must be the square of the number of types (",
+                 size, " given).");
+    }
+    if (num_types > 256) {
+      Log::Fatal("InteractionForce::SetParameters",
+                 "At most 256 interaction types are supported (", num_types,
+                 " given).");
+    }
+  }
+
+  num_types_ = num_types;
+  parameters_.assign(num_types * num_types, PairParameters());
+  for (uint64_t i = 0; i < size; ++i) {
+    auto& p = parameters_[i];
+    if (!param->interaction_force_repulsion.empty()) {
+      p.repulsion = param->interaction_force_repulsion[i];
+    }
+    if (!param->interaction_force_attraction.empty()) {
+      p.attraction = param->interaction_force_attraction[i];
+    }
+    if (!param->interaction_force_iof_coefficient.empty()) {
+      p.additional_radius = 10.0 * param->interaction_force_iof_coefficient[i];
+      p.additional_radius_sum = 2 * p.additional_radius;
+    }
+  }
+
+  symmetric_ = true;
+  for (uint64_t i = 0; i < num_types; ++i) {
+    for (uint64_t j = i + 1; j < num_types; ++j) {
+      const auto& ij = parameters_[i * num_types + j];
+      const auto& ji = parameters_[j * num_types + i];
+      if (ij.repulsion != ji.repulsion || ij.attraction != ji.attraction ||
+          ij.additional_radius != ji.additional_radius) {
+        symmetric_ = false;
+      }
+    }
+  }
+
+  loaded_repulsion_ = param->interaction_force_repulsion;
+  loaded_attraction_ = param->interaction_force_attraction;
+  loaded_iof_coefficient_ = param->interaction_force_iof_coefficient;
+}
+
+bool InteractionForce::UpdateParameters(const Param* param) {
+  if (loaded_repulsion_ == param->interaction_force_repulsion &&
+      loaded_attraction_ == param->interaction_force_attraction &&
+      loaded_iof_coefficient_ == param->interaction_force_iof_coefficient) {
+    return false;
+  }
+  SetParameters(param);
+  return true;
+}
+
+bool InteractionForce::HasDefaultParameters() const {
+  PairParameters d;
+  for (const auto& p : parameters_) {
+    if (p.repulsion != d.repulsion || p.attraction != d.attraction ||
+        p.additional_radius != d.additional_radius) {
+      return false;
+    }
+  }
+  return true;
+}
+
 Double4 InteractionForce::Calculate(const Agent* lhs, const Agent* rhs) const {
   if (lhs->GetShape() == Shape::kSphere && rhs->GetShape() == Shape::kSphere) {
     Double3 result;
@@ -57,26 +150,177 @@ Double4 InteractionForce::Calculate(const Agent* lhs, const Agent* rhs) const {
   }
 }
 
+void InteractionForce::CalculateBatch(const Agent* lhs, const SphereBatch& rhs,
+                                      double* fx, double* fy,
+                                      double* fz) const {
+  if (typeid(*this) != typeid(InteractionForce) ||
+      lhs->GetShape() != Shape::kSphere) {
+    for (uint64_t i = 0; i < rhs.size; ++i) {
+      auto force = Calculate(lhs, rhs.agents[i]);
+      fx[i] = force[0];
+      fy[i] = force[1];
+      fz[i] = force[2];
+    }
+    return;
+  }
+
+  // Same computation as in `ForceBetweenSpheres`
+  const Double3& c1 = lhs->GetPosition();
+  const double c1x = c1[0];
+  const double c1y = c1[1];
+  const double c1z = c1[2];
+  const double d1 = lhs->GetDiameter();
+  const auto lhs_type = lhs->GetInteractionType();
+  // With a single interaction type, the parameters are loop invariant
+  const bool uniform = num_types_ == 1 || rhs.type == nullptr;
+  const auto& uniform_params = GetParameters(lhs_type, 0);
+  const PairParameters* params = parameters_.data();
+  const uint64_t lhs_row = (lhs_type < num_types_ ? lhs_type : 0) * num_types_;
+  const uint64_t num_types = num_types_;
+  const uint8_t* types = rhs.type;
+  bool centers_coincide = false;
+
+#pragma omp simd reduction(|| : centers_coincide)
+  for (uint64_t i = 0; i < rhs.size; ++i) {
+    const auto& p =
+        uniform ? uniform_params
+                : params[lhs_row + (types[i] < num_types ? types[i] : 0)];
+    double gamma = p.attraction;  // attraction coeff
+    double k = p.repulsion;       // repulsion coeff
+    double r1 = 0.5 * d1 + p.additional_radius;
+    double r2 = 0.5 * rhs.diameter[i] + p.additional_radius;
+    double radius_sum = 0.5 * (d1 + rhs.diameter[i]) + p.additional_radius_sum;
+    double comp1 = c1x - rhs.x[i];
+    double comp2 = c1y - rhs.y[i];
+    double comp3 = c1z - rhs.z[i];
+    double center_distance =
+        std::sqrt(comp1 * comp1 + comp2 * comp2 + comp3 * comp3);
+    double delta = radius_sum - center_distance;
+    double r = (r1 * r2) / radius_sum;
+    double f = k * delta - gamma * std::sqrt(r * std::max(delta, 0.0));
+    double module = delta < 0 ? 0.0 : f / center_distance;
+    fx[i] = module * comp1;
+    fy[i] = module * comp2;
+    fz[i] = module * comp3;
+    centers_coincide =
+        centers_coincide || (delta >= 0 && center_distance < 0.00000001);
+  }
+
+  // Rare case: random force if the centers are (almost) at the same location
+  if (centers_coincide) {
+    auto* random = Simulation::GetActive()->GetRandom();
+    for (uint64_t i = 0; i < rhs.size; ++i) {
+      double comp1 = c1x - rhs.x[i];
+      double comp2 = c1y - rhs.y[i];
+      double comp3 = c1z - rhs.z[i];
+      double center_distance =
+          std::sqrt(comp1 * comp1 + comp2 * comp2 + comp3 * comp3);
+      const auto& p = GetParameters(lhs_type, types ? types[i] : 0);
+      double radius_sum =
+          0.5 * (d1 + rhs.diameter[i]) + p.additional_radius_sum;
+      if (radius_sum - center_distance >= 0 && center_distance < 0.00000001) {
+        auto force2on1 = random->template UniformArray<3>(-3.0, 3.0);
+        fx[i] = force2on1[0];
+        fy[i] = force2on1[1];
+        fz[i] = force2on1[2];
+      }
+    }
+  }
+}
+
+void InteractionForce::CalculateCylinderBatch(const Agent* lhs,
+                                              const CylinderBatch& rhs,
+                                              double* fx, double* fy,
+                                              double* fz,
+                                              double* proportion) const {
+  if (typeid(*this) != typeid(InteractionForce) ||
+      lhs->GetShape() != Shape::kCylinder) {
+    for (uint64_t i = 0; i < rhs.size; ++i) {
+      auto force = Calculate(lhs, rhs.agents[i]);
+      fx[i] = force[0];
+      fy[i] = force[1];
+      fz[i] = force[2];
+      proportion[i] = force[3];
+    }
+    return;
+  }
+
+  // Same computation as in `ForceBetweenCylinders`, with the case
+  // distinctions replaced by selects.
+  auto* ne = bdm_static_cast<const NeuriteElement*>(lhs);
+  const auto a = ne->ProximalEnd();
+  const auto& b = ne->GetMassLocation();
+  const double r1 = 0.5 * ne->GetDiameter();
+  const double ax = a[0], ay = a[1], az = a[2];
+  const double p21x = b[0] - a[0];
+  const double p21y = b[1] - a[1];
+  const double p21z = b[2] - a[2];
+  const double d2121 = p21x * p21x + p21y * p21y + p21z * p21z;
+  bool centers_coincide = false;
+
+#pragma omp simd reduction(|| : centers_coincide)
+  for (uint64_t i = 0; i < rhs.size; ++i) {
+    double p13x = ax - rhs.px[i];
+    double p13y = ay - rhs.py[i];
+    double p13z = az - rhs.pz[i];
+    double p43x = rhs.dx[i] - rhs.px[i];
+    double p43y = rhs.dy[i] - rhs.py[i];
+    double p43z = rhs.dz[i] - rhs.pz[i];
+
+    double d1343 = p13x * p43x + p13y * p43y + p13z * p43z;
+    double d4321 = p21x * p43x + p21y * p43y + p21z * p43z;
+    double d1321 = p21x * p13x + p21y * p13y + p21z * p13z;
+    double d4343 = p43x * p43x + p43y * p43y + p43z * p43z;
+
+    double denom = d2121 * d4343 - d4321 * d4321;
+    // if the two segments are not ABSOLUTLY parallel
+    bool not_parallel = denom > 0.000000000001;
+    double mua = (d1343 * d4321 - d1321 * d4343) / (not_parallel ? denom : 1);
+    double mub = (d1343 + mua * d4321) / (not_parallel ? d4343 : 1);
+    mua = not_parallel ? std::min(std::max(mua, 0.0), 1.0) : 0.5;
+    mub = not_parallel ? std::min(std::max(mub, 0.0), 1.0) : 0.5;
+
+    // closest points on the two segments
+    double comp1 = (ax + mua * p21x) - (rhs.px[i] + mub * p43x);
+    double comp2 = (ay + mua * p21y) - (rhs.py[i] + mub * p43y);
+    double comp3 = (az + mua * p21z) - (rhs.pz[i] + mub * p43z);
+    double distance = std::sqrt(comp1 * comp1 + comp2 * comp2 + comp3 * comp3);
+
+    // We put a virtual sphere on the two cylinders
+    double overlap = r1 + 0.5 * rhs.diameter[i] - distance;
+    double module = overlap < 0 ? 0.0 : 10 * overlap / distance;
+    fx[i] = module * comp1;
+    fy[i] = module * comp2;
+    fz[i] = module * comp3;
+    proportion[i] = 1 - mua;
+    centers_coincide =
+        centers_coincide || (overlap >= 0 && distance < 0.00000001);
+  }
+
+  // Rare case: random force if the closest points are (almost) at the same
+  // location. Recompute the whole batch with the scalar version.
+  if (centers_coincide) {
+    for (uint64_t i = 0; i < rhs.size; ++i) {
+      auto force = Calculate(lhs, rhs.agents[i]);
+      fx[i] = force[0];
+      fy[i] = force[1];
+      fz[i] = force[2];
+      proportion[i] = force[3];
+    }
+  }
+}
+
 void InteractionForce::ForceBetweenSpheres(const Agent* sphere_lhs,
                                            const Agent* sphere_rhs,
                                            Double3* result) const {
-  const Double3& ref_mass_location = sphere_lhs->GetPosition();
-  double ref_diameter = sphere_lhs->GetDiameter();
-  double ref_iof_coefficient = 0.15;
-  const Double3& nb_mass_location = sphere_rhs->GetPosition();
-  double nb_diameter = sphere_rhs->GetDiameter();
-  double nb_iof_coefficient = 0.15;
-
-  auto c1 = ref_mass_location;
-  double r1 = 0.5 * ref_diameter;
-  auto c2 = nb_mass_location;
-  double r2 = 0.5 * nb_diameter;
+  const Double3& c1 = sphere_lhs->GetPosition();
+  const Double3& c2 = sphere_rhs->GetPosition();
+  const auto& params = GetParameters(sphere_lhs->GetInteractionType(),
+                                     sphere_rhs->GetInteractionType());
   // We take virtual bigger radii to have a distant interaction, to get a
   // desired density.
-  double additional_radius =
-      10.0 * std::min(ref_iof_coefficient, nb_iof_coefficient);
-  r1 += additional_radius;
-  r2 += additional_radius;
+  double r1 = 0.5 * sphere_lhs->GetDiameter() + params.additional_radius;
+  double r2 = 0.5 * sphere_rhs->GetDiameter() + params.additional_radius;
   // the 3 components of the vector c2 -> c1
   double comp1 = c1[0] - c2[0];
   double comp2 = c1[1] - c2[1];
@@ -84,7 +328,10 @@ void InteractionForce::ForceBetweenSpheres(const Agent* sphere_lhs,
   double center_distance =
       std::sqrt(comp1 * comp1 + comp2 * comp2 + comp3 * comp3);
   // the overlap distance (how much one penetrates in the other)
-  double delta = r1 + r2 - center_distance;
+  double radius_sum = 0.5 * (sphere_lhs->GetDiameter() +
+                             sphere_rhs->GetDiameter()) +
+                      params.additional_radius_sum;
+  double delta = radius_sum - center_distance;
   // if no overlap : no force
   if (delta < 0) {
     *result = {0.0, 0.0, 0.0};
@@ -99,9 +346,9 @@ void InteractionForce::ForceBetweenSpheres(const Agent* sphere_lhs,
     return;
   }
   // the force itself
-  double r = (r1 * r2) / (r1 + r2);
-  double gamma = 1;  // attraction coeff
-  double k = 2;      // repulsion coeff
+  double r = (r1 * r2) / radius_sum;
+  double gamma = params.attraction;  // attraction coeff
+  double k = params.repulsion;       // repulsion coeff
   double f = k * delta - gamma * std::sqrt(r * delta);
 
   double module = f / center_distance;
@@ -122,6 +369,16 @@ void InteractionForce::ForceOnACylinderFromASphere(const Agent* cylinder,
   auto c = sphere->GetPosition();
   double r = 0.5 * sphere->GetDiameter();
 
+  // Broad phase: all points of the cylinder that can interact with the
+  // sphere lie within a capsule around its axis. If the sphere does not
+  // touch the bounding sphere of this capsule, there is no interaction.
+  Double3 center = distal_end - axis * 0.5;
+  double bound = 0.5 * actual_length + d + r;
+  if ((c - center) * (c - center) > bound * bound) {
+    *result = Double4{0.0, 0.0, 0.0, 0.0};
+    return;
+  }
+
   // I. If the cylinder is small with respect to the sphere:
   // we only consider the interaction between the sphere and the point mass
   // (i.e. distal point) of the cylinder - that we treat as a sphere.
@@ -221,6 +478,17 @@ void InteractionForce::ForceBetweenCylinders(const Agent* cylinder1,
   auto d = c2->GetMassLocation();
   double d2 = c2->GetDiameter();
 
+  // Broad phase: compare the bounding spheres of both capsules
+  const auto& axis1 = c1->GetSpringAxis();
+  const auto& axis2 = c2->GetSpringAxis();
+  Double3 center_distance = (b - axis1 * 0.5) - (d - axis2 * 0.5);
+  double bound = 0.5 * (std::sqrt(axis1 * axis1) + std::sqrt(axis2 * axis2) +
+                        d1 + d2);
+  if (center_distance * center_distance > bound * bound) {
+    *result = Double4{0.0, 0.0, 0.0, 0.5};
+    return;
+  }
+
   double k = 0.5;  // part devoted to the distal node
 
   //  looking for closest point on them
@@ -16,12 +16,47 @@
 #define CORE_INTERACTION_FORCE_H_
 
 #include <array>
+#include <cstdint>
+#include <vector>
 
 #include "core/container/math_array.h"
 
 namespace bdm {
 
 class Agent;
+struct Param;
+
+/// A batch of spherical agents in structure of arrays layout.
+/// \see `InteractionForce::CalculateBatch`
+struct SphereBatch {
+  /// Number of agents in this batch
+  uint64_t size = 0;
+  const Agent* const* agents = nullptr;
+  const double* x = nullptr;
+  const double* y = nullptr;
+  const double* z = nullptr;
+  const double* diameter = nullptr;
+  /// Interaction types (see `Agent::GetInteractionType`). If nullptr, all
+  /// agents in this batch have type 0.
+  const uint8_t* type = nullptr;
+};
+
+/// A batch of cylindrical agents (`NeuriteElement`) in structure of arrays
+/// layout. Proximal end (`px`, `py`, `pz`) and distal end (`dx`, `dy`, `dz`)
+/// of each cylinder.
+/// \see `InteractionForce::CalculateCylinderBatch`
+struct CylinderBatch {
+  /// Number of agents in this batch
+  uint64_t size = 0;
+  const Agent* const* agents = nullptr;
+  const double* px = nullptr;
+  const double* py = nullptr;
+  const double* pz = nullptr;
+  const double* dx = nullptr;
+  const double* dy = nullptr;
+  const double* dz = nullptr;
+  const double* diameter = nullptr;
+};
 
 class InteractionForce {
  public:
@@ -29,11 +64,96 @@ class InteractionForce {
   virtual ~InteractionForce() {}
 
   virtual Double4 Calculate(const Agent* lhs, const Agent* rhs) const;
+
+  /// Calculates the forces of all spherical agents in `rhs` on `lhs` and
+  /// stores them in `fx`, `fy` and `fz` (each of size `rhs.size`).\n
+  /// If `lhs` is a sphere, the sphere-sphere forces are computed with a
+  /// vectorized kernel. Otherwise, and for subclasses that do not override
+  /// this function, it falls back to calling `Calculate` for each agent.
+  virtual void CalculateBatch(const Agent* lhs, const SphereBatch& rhs,
+                              double* fx, double* fy, double* fz) const;
+
+  /// Calculates the forces of all cylinders in `rhs` on the cylinder `lhs`
+  /// and stores them in `fx`, `fy`, `fz` and `proportion` (the fourth
+  /// element of the result of `Calculate`).\n
+  /// The closest points between the segments are computed with a vectorized
+  /// kernel. For subclasses that do not override this function, or if `lhs`
+  /// is not a cylinder, it falls back to calling `Calculate` for each agent.
+  virtual void CalculateCylinderBatch(const Agent* lhs,
+                                      const CylinderBatch& rhs, double* fx,
+                                      double* fy, double* fz,
+                                      double* proportion) const;
+
   virtual InteractionForce* NewCopy() const {
     return new InteractionForce(*this);
   }
 
+  /// Coefficient that determines the additional radius of spheres
+  /// to have a distant interaction
+  static constexpr double kSphereIofCoefficient = 0.15;
+  /// Additional radius of spheres
+  static constexpr double kSphereAdditionalRadius =
+      10.0 * kSphereIofCoefficient;
+
+  /// Parameters of the sphere-sphere force between two interaction types
+  struct PairParameters {
+    /// Repulsion coefficient
+    double repulsion = 2;
+    /// Attraction coefficient
+    double attraction = 1;
+    /// Additional radius of each sphere to have a distant interaction
+    double additional_radius = kSphereAdditionalRadius;
+    /// Precomputed sum of the additional radii of both spheres
+    double additional_radius_sum = 2 * kSphereAdditionalRadius;
+  };
+
+  /// Loads the per-type-pair parameters of the sphere-sphere force from
+  /// `Param::interaction_force_repulsion`,
+  /// `Param::interaction_force_attraction` and
+  /// `Param::interaction_force_iof_coefficient`.\n
+  /// Without this call, the default parameters are used for all pairs.
+  void SetParameters(const Param* param);
+
+  /// Calls `SetParameters` only if the parameter tables in `param` differ
+  /// from the ones loaded last. Used by the mechanical forces operations at
+  /// the beginning of each iteration. Returns true if the parameters have
+  /// been reloaded.
+  bool UpdateParameters(const Param* param);
+
+  /// Returns true if the parameters of each pair of types are the same in
+  /// both directions. Operations that evaluate each pair of agents only once
+  /// require a symmetric table.
+  bool IsSymmetric() const { return symmetric_; }
+
+  /// Returns the number of interaction types in the parameter table.
+  uint64_t GetNumInteractionTypes() const { return num_types_; }
+
+  /// Returns true if all pairs use the default parameters.
+  bool HasDefaultParameters() const;
+
+  /// Returns the parameters of the force on an agent of type `lhs_type`
+  /// from an agent of type `rhs_type`. Types outside of the table use the
+  /// parameters of type 0.
+  const PairParameters& GetParameters(uint8_t lhs_type,
+                                      uint8_t rhs_type) const {
+    uint64_t lhs = lhs_type < num_types_ ? lhs_type : 0;
+    uint64_t rhs = rhs_type < num_types_ ? rhs_type : 0;
+    return parameters_[lhs * num_types_ + rhs];
+  }
+
  private:
+  /// Number of interaction types
+  uint64_t num_types_ = 1;
+  /// Parameter table with `num_types_ * num_types_` entries in row-major
+  /// order
+  std::vector<PairParameters> parameters_ = {PairParameters()};
+  /// True if `parameters_` is symmetric
+  bool symmetric_ = true;
+  /// Parameter tables of the last `SetParameters` call
+  std::vector<double> loaded_repulsion_;
+  std::vector<double> loaded_attraction_;
+  std::vector<double> loaded_iof_coefficient_;
+
   void ForceBetweenSpheres(const Agent* sphere_lhs, const Agent* sphere_rhs,
                            Double3* result) const;
 
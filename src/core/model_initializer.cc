@@ -13,6 +13,8 @@
 // -----------------------------------------------------------------------------
 
 #include "core/model_initializer.h"
+#include "core/diffusion/adi_grid.h"
+#include "core/diffusion/amr_grid.h"
 #include "core/diffusion/diffusion_grid.h"
 #include "core/diffusion/euler_grid.h"
 #include "core/diffusion/runge_kutta_grid.h"
@@ -33,6 +35,12 @@ void ModelInitializer::DefineSubstance(size_t substance_id,
   } else if (param->diffusion_method == "runge-kutta") {
     dgrid = new RungeKuttaGrid(substance_id, substance_name, diffusion_coeff,
                                decay_constant, resolution);
+  } else if (param->diffusion_method == "adi") {
+    dgrid = new AdiGrid(substance_id, substance_name, diffusion_coeff,
+                        decay_constant, resolution);
+  } else if (param->diffusion_method == "amr") {
+    dgrid = new AmrGrid(substance_id, substance_name, diffusion_coeff,
+                        decay_constant, resolution);
   } else {
     Log::Error("ModelInitializer::DefineSubstance", "Diffusion method '",
                param->diffusion_method,
@@ -44,4 +52,15 @@ void ModelInitializer::DefineSubstance(size_t substance_id,
   rm->AddDiffusionGrid(dgrid);
 }
 
+void ModelInitializer::DefineSubstance(size_t substance_id,
+                                       const std::string& substance_name,
+                                       double diffusion_coeff,
+                                       double decay_constant, int resolution,
+                                       const std::array<int32_t, 6>& domain) {
+  DefineSubstance(substance_id, substance_name, diffusion_coeff,
+                  decay_constant, resolution);
+  auto* rm = Simulation::GetActive()->GetResourceManager();
+  rm->GetDiffusionGrid(substance_id)->SetDomain(domain);
+}
+
 }  // namespace bdm
@@ -17,6 +17,7 @@
 
 #include <Math/DistFunc.h>
 #include <omp.h>
+#include <array>
 #include <ctime>
 #include <string>
 #include <vector>
@@ -27,6 +28,8 @@
 #include "core/simulation.h"
 #include "core/util/random.h"
 
+class AdiGrid;
+class AmrGrid;
 class EulerGrid;
 class RungeKuttaGrid;
 
@@ -392,6 +395,15 @@ struct ModelInitializer {
                               double diffusion_coeff, double decay_constant,
                               int resolution = 10);
 
+  /// Same as above, but the diffusion grid covers the box `domain` =
+  /// {xmin, xmax, ymin, ymax, zmin, zmax} (see `DiffusionGrid::SetDomain`).
+  /// `resolution` is the number of boxes along the longest axis.
+  static void DefineSubstance(size_t substance_id,
+                              const std::string& substance_name,
+                              double diffusion_coeff, double decay_constant,
+                              int resolution,
+                              const std::array<int32_t, 6>& domain);
+
   template <typename F>
   static void InitializeSubstance(size_t substance_id, F function) {
     auto* sim = Simulation::GetActive();
@@ -399,6 +411,17 @@ struct ModelInitializer {
     auto diffusion_grid = rm->GetDiffusionGrid(substance_id);
     diffusion_grid->AddInitializer(function);
   }
+
+  /// Initializes the substance with the values in the file `file_name`,
+  /// which contains one `double` per box of the diffusion grid (see
+  /// `DiffusionGrid::AddInitialConcentrations`).
+  static void LoadSubstance(size_t substance_id,
+                            const std::string& file_name) {
+    auto* sim = Simulation::GetActive();
+    auto* rm = sim->GetResourceManager();
+    auto diffusion_grid = rm->GetDiffusionGrid(substance_id);
+    diffusion_grid->AddInitialConcentrations(file_name);
+  }
 };
 
 }  // namespace bdm
@@ -0,0 +1,80 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/operation/agent_subset.h"
+
+#include <omp.h>
+#include <algorithm>
+
+#include "core/param/param.h"
+#include "core/resource_manager.h"
+#include "core/simulation.h"
+#include "core/type_index.h"
+
+namespace bdm {
+
+// -----------------------------------------------------------------------------
+void AgentSubset::ForEachAgentParallel(
+    uint64_t chunk, Functor<void, Agent*, AgentHandle>& function,
+    Functor<bool, Agent*>* filter) {
+  auto* rm = Simulation::GetActive()->GetResourceManager();
+  const auto& handles = GetAgentHandles();
+  chunk = std::max(chunk, uint64_t(1));
+  int64_t size = handles.size();
+
+#pragma omp parallel for schedule(dynamic, chunk)
+  for (int64_t i = 0; i < size; ++i) {
+    auto ah = handles[i];
+    auto* agent = rm->GetAgent(ah);
+    if (!filter || (*filter)(agent)) {
+      function(agent, ah);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+bool NonStaticAgentSubset::ContainsAllAgents() const {
+  return !Simulation::GetActive()->GetParam()->detect_static_agents;
+}
+
+// -----------------------------------------------------------------------------
+const std::vector<AgentHandle>& NonStaticAgentSubset::GetAgentHandles() {
+  auto* sim = Simulation::GetActive();
+  auto* rm = sim->GetResourceManager();
+  if (outdated_) {
+    rm->ClearActiveAgents();
+    auto add_active = L2F([&](Agent* agent, AgentHandle) {
+      if (!agent->IsStatic()) {
+        rm->AddActiveAgent(agent);
+      }
+    });
+    rm->ForEachAgentParallel(sim->GetParam()->scheduling_batch_size,
+                             add_active);
+    outdated_ = false;
+  }
+  return rm->GetActiveAgents();
+}
+
+// -----------------------------------------------------------------------------
+void UpdateFromTypeIndex(TClass* tclass, std::vector<AgentHandle>* handles) {
+  auto* rm = Simulation::GetActive()->GetResourceManager();
+  const auto& agents = rm->EnableTypeIndex()->GetType(tclass);
+  handles->resize(agents.size());
+#pragma omp parallel for
+  for (uint64_t i = 0; i < agents.size(); ++i) {
+    (*handles)[i] = rm->GetAgentHandle(agents[i]->GetUid());
+  }
+}
+
+}  // namespace bdm
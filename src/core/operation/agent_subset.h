@@ -0,0 +1,114 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef CORE_OPERATION_AGENT_SUBSET_H_
+#define CORE_OPERATION_AGENT_SUBSET_H_
+
+#include <vector>
+
+#include "core/agent/agent.h"
+#include "core/agent/agent_handle.h"
+#include "core/functor.h"
+
+class TClass;
+
+namespace bdm {
+
+/// A subset of agents to which agent operations can be restricted
+/// (see `Operation::SetAgentSubset`).\n
+/// In contrast to agent filters (see `Scheduler::SetAgentFilters`), the
+/// members are not determined by evaluating a predicate for every agent in
+/// the simulation, but are maintained as a list of agent handles.
+/// Consecutive operations that are restricted to the same subset are executed
+/// in one pass over its members. The order of operations is preserved.
+class AgentSubset {
+ public:
+  virtual ~AgentSubset() {}
+
+  /// Called by the scheduler once per iteration, before any agent operation
+  /// is executed, if at least one operation that is restricted to this subset
+  /// will be executed in this iteration.
+  virtual void Update() = 0;
+
+  /// Returns true if the subset currently contains all agents. In this case
+  /// the scheduler runs the restricted operations together with the
+  /// unrestricted ones.
+  virtual bool ContainsAllAgents() const { return false; }
+
+  /// Returns the handles of all members. Called by the scheduler right before
+  /// the restricted operations are executed.
+  virtual const std::vector<AgentHandle>& GetAgentHandles() = 0;
+
+  /// Calls `function` for all members of this subset for which `filter`
+  /// evaluates to true (or all members if `filter` is a nullptr).\n
+  /// Function invocations are parallelized. Uses dynamic scheduling with
+  /// batch size `chunk`.
+  void ForEachAgentParallel(uint64_t chunk,
+                            Functor<void, Agent*, AgentHandle>& function,
+                            Functor<bool, Agent*>* filter = nullptr);
+};
+
+/// Contains all agents that are not static in the current iteration.\n
+/// The members are stored in the list of active agents of the
+/// `ResourceManager` (see `ResourceManager::GetActiveAgents`). The list is
+/// only built in iterations in which an operation restricted to this subset
+/// is executed, and only when the first of these operations is about to run.
+/// Hence, the operation "update staticness" has already been executed for
+/// the current iteration, if it is scheduled before the restricted
+/// operations (which is the default).\n
+/// If `Param::detect_static_agents` is false, the subset contains all agents.
+/// The scheduler maintains one instance of this class
+/// (see `Scheduler::GetNonStaticAgents`).
+class NonStaticAgentSubset : public AgentSubset {
+ public:
+  void Update() override { outdated_ = true; }
+
+  bool ContainsAllAgents() const override;
+
+  const std::vector<AgentHandle>& GetAgentHandles() override;
+
+ private:
+  bool outdated_ = true;
+};
+
+/// Replaces the content of `handles` with the handles of all agents whose
+/// type is exactly `tclass`. Enables the type index of the `ResourceManager`
+/// if required.
+void UpdateFromTypeIndex(TClass* tclass, std::vector<AgentHandle>* handles);
+
+/// Contains all agents whose type is exactly `TAgent` (subclasses of `TAgent`
+/// are not included).\n
+/// The subset is based on the type index of the `ResourceManager`, which is
+/// updated whenever agents are added or removed. Therefore, updating the
+/// subset is proportional to the number of members and not to the total
+/// number of agents.
+///
+///     auto* neurites = new TypeAgentSubset<NeuriteElement>();
+///     op->SetAgentSubset(neurites);
+template <typename TAgent>
+class TypeAgentSubset : public AgentSubset {
+ public:
+  void Update() override { UpdateFromTypeIndex(TAgent::Class(), &handles_); }
+
+  const std::vector<AgentHandle>& GetAgentHandles() override {
+    return handles_;
+  }
+
+ private:
+  std::vector<AgentHandle> handles_;
+};
+
+}  // namespace bdm
+
+#endif  // CORE_OPERATION_AGENT_SUBSET_H_
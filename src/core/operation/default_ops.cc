@@ -19,7 +19,9 @@
 #include "core/operation/load_balancing_op.h"
 #include "core/operation/mechanical_forces_op.h"
 #include "core/operation/mechanical_forces_op_cuda.h"
+#include "core/operation/mechanical_forces_op_implicit.h"
 #include "core/operation/mechanical_forces_op_opencl.h"
+#include "core/operation/mechanical_forces_op_soa.h"
 #include "core/operation/operation.h"
 #include "core/operation/visualization_op.h"
 
@@ -35,6 +37,11 @@ BDM_REGISTER_OP_WITH_FREQ(LoadBalancingOp, "load balancing", kCpu,
 
 BDM_REGISTER_OP(MechanicalForcesOp, "mechanical forces", kCpu);
 
+BDM_REGISTER_OP(MechanicalForcesOpSoa, "mechanical forces", kCpuSoa);
+
+BDM_REGISTER_OP(MechanicalForcesOpImplicit, "mechanical forces",
+                kCpuImplicit);
+
 #ifdef USE_CUDA
 BDM_REGISTER_OP(MechanicalForcesOpCuda, "mechanical forces", kCuda);
 #endif
@@ -0,0 +1,203 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/operation/initialize_gpu_data.h"
+
+#include <cstdlib>
+#include <vector>
+
+#include "core/agent/cell.h"
+#include "core/environment/uniform_grid_environment.h"
+#include "core/gpu/cuda_pinned_memory.h"
+#include "core/resource_manager.h"
+#include "core/shape.h"
+#include "core/simulation.h"
+#include "core/util/log.h"
+#include "core/util/thread_info.h"
+#include "core/util/type.h"
+
+namespace bdm {
+
+// -----------------------------------------------------------------------------
+void IsNonSphericalObjectPresent(const Agent* agent, bool* answer) {
+  if (agent->GetShape() != Shape::kSphere) {
+    *answer = true;
+  }
+}
+
+namespace detail {
+
+// -----------------------------------------------------------------------------
+InitializeGPUData::InitializeGPUData(bool pinned) : pinned_(pinned) {}
+
+// -----------------------------------------------------------------------------
+InitializeGPUData::~InitializeGPUData() {
+  if (current_timestamp != nullptr) {
+    Free(current_timestamp);
+    Free(num_boxes_axis);
+  }
+
+  if (allocated_num_agents != 0) {
+    FreeAgentBuffers();
+  }
+
+  if (allocated_num_boxes != 0) {
+    FreeGridBuffers();
+  }
+}
+
+// -----------------------------------------------------------------------------
+void InitializeGPUData::Initialize(
+    uint64_t num_agents, uint64_t num_boxes,
+    const std::vector<AgentHandle::ElementIdx_t>& offs,
+    UniformGridEnvironment* g) {
+  if (current_timestamp == nullptr) {
+    Alloc(&current_timestamp, 1);
+    Alloc(&num_boxes_axis, 3);
+  }
+
+  if (allocated_num_agents < num_agents) {
+    if (allocated_num_agents != 0) {
+      FreeAgentBuffers();
+    }
+    allocated_num_agents = num_agents * 1.25;
+    Alloc(&cell_movements, allocated_num_agents * 3);
+    Alloc(&cell_positions, allocated_num_agents * 3);
+    Alloc(&cell_diameters, allocated_num_agents);
+    Alloc(&cell_adherence, allocated_num_agents);
+    Alloc(&cell_tractor_force, allocated_num_agents * 3);
+    Alloc(&cell_boxid, allocated_num_agents);
+    Alloc(&mass, allocated_num_agents);
+    Alloc(&successors, allocated_num_agents);
+  }
+
+  if (allocated_num_boxes < num_boxes) {
+    if (allocated_num_boxes != 0) {
+      FreeGridBuffers();
+    }
+    allocated_num_boxes = num_boxes * 1.25;
+    Alloc(&starts, allocated_num_boxes);
+    Alloc(&lengths, allocated_num_boxes);
+    Alloc(&timestamps, allocated_num_boxes);
+  }
+
+  offset = offs;
+  grid = g;
+}
+
+// -----------------------------------------------------------------------------
+void InitializeGPUData::Update(UniformGridEnvironment* grid) {
+  auto* rm = Simulation::GetActive()->GetResourceManager();
+
+  auto num_numa_nodes = ThreadInfo::GetInstance()->GetNumaNodes();
+  std::vector<AgentHandle::ElementIdx_t> offset(num_numa_nodes);
+  offset[0] = 0;
+  for (int nn = 1; nn < num_numa_nodes; nn++) {
+    offset[nn] = offset[nn - 1] + rm->GetNumAgents(nn - 1);
+  }
+
+  auto total_num_agents = rm->GetNumAgents();
+  auto num_boxes = grid->boxes_.size();
+
+  Initialize(total_num_agents, num_boxes, offset, grid);
+  rm->ForEachAgentParallel(1000, *this);
+
+  *current_timestamp = grid->timestamp_;
+#pragma omp parallel for
+  for (uint64_t i = 0; i < grid->boxes_.size(); ++i) {
+    auto& box = grid->boxes_[i];
+    timestamps[i] = box.timestamp_;
+    if (box.timestamp_ == *current_timestamp) {
+      lengths[i] = box.length_;
+      starts[i] = offset[box.start_.GetNumaNode()] + box.start_.GetElementIdx();
+    }
+  }
+  grid->GetNumBoxesAxis(num_boxes_axis);
+}
+
+// -----------------------------------------------------------------------------
+template <typename T>
+void InitializeGPUData::Alloc(T** p, uint64_t elements) {
+  if (pinned_) {
+    CudaAllocPinned(p, elements);
+  } else {
+    *p = static_cast<T*>(std::malloc(elements * sizeof(T)));
+  }
+}
+
+// -----------------------------------------------------------------------------
+void InitializeGPUData::Free(void* p) {
+  if (pinned_) {
+    CudaFreePinned(p);
+  } else {
+    std::free(p);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void InitializeGPUData::FreeAgentBuffers() {
+  Free(cell_movements);
+  Free(cell_positions);
+  Free(cell_diameters);
+  Free(cell_adherence);
+  Free(cell_tractor_force);
+  Free(cell_boxid);
+  Free(mass);
+  Free(successors);
+}
+
+// -----------------------------------------------------------------------------
+void InitializeGPUData::FreeGridBuffers() {
+  Free(starts);
+  Free(lengths);
+  Free(timestamps);
+}
+
+// -----------------------------------------------------------------------------
+void InitializeGPUData::operator()(Agent* agent, AgentHandle ah) {
+  // Check if there are any non-spherical objects in our simulation, because
+  // GPU accelerations currently supports only sphere-sphere interactions
+  IsNonSphericalObjectPresent(agent, &is_non_spherical_object);
+  if (is_non_spherical_object) {
+    Log::Fatal("InitializeGPUData",
+               "\nWe detected a non-spherical object during the GPU or "
+               "cpu-soa execution. This is currently not supported.");
+    return;
+  }
+  auto* cell = bdm_static_cast<Cell*>(agent);
+  auto idx = offset[ah.GetNumaNode()] + ah.GetElementIdx();
+  auto idxt3 = idx * 3;
+  mass[idx] = cell->GetMass();
+  cell_diameters[idx] = cell->GetDiameter();
+  cell_adherence[idx] = cell->GetAdherence();
+  const auto& tf = cell->GetTractorForce();
+  const auto& pos = cell->GetPosition();
+
+  for (uint64_t i = 0; i < 3; ++i) {
+    cell_tractor_force[idxt3 + i] = tf[i];
+    cell_positions[idxt3 + i] = pos[i];
+  }
+
+  cell_boxid[idx] = cell->GetBoxIdx();
+
+  // populate successor list
+  auto nid = ah.GetNumaNode();
+  auto el = ah.GetElementIdx();
+  successors[idx] = offset[grid->successors_.data_[nid][el].GetNumaNode()] +
+                    grid->successors_.data_[nid][el].GetElementIdx();
+}
+
+}  // namespace detail
+
+}  // namespace bdm
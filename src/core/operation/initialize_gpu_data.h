@@ -0,0 +1,95 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef CORE_OPERATION_INITIALIZE_GPU_DATA_H_
+#define CORE_OPERATION_INITIALIZE_GPU_DATA_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "core/agent/agent.h"
+#include "core/agent/agent_handle.h"
+#include "core/functor.h"
+
+namespace bdm {
+
+class UniformGridEnvironment;
+
+namespace detail {
+
+/// Flattens the data required to calculate the mechanical forces between
+/// spherical agents (`Cell`) and the uniform grid into contiguous arrays.\n
+/// Used by the GPU implementations and the CPU structure of arrays
+/// implementation of the "mechanical forces" operation.\n
+/// Agent data is stored at index `offset[numa_node] + element_idx`, vector
+/// quantities (positions, tractor forces, movements) use three consecutive
+/// elements.
+struct InitializeGPUData : public Functor<void, Agent*, AgentHandle> {
+  bool is_non_spherical_object = false;
+
+  double* cell_movements = nullptr;
+  double* cell_positions = nullptr;
+  double* cell_diameters = nullptr;
+  double* cell_adherence = nullptr;
+  double* cell_tractor_force = nullptr;
+  uint32_t* cell_boxid = nullptr;
+  double* mass = nullptr;
+  uint32_t* successors = nullptr;
+
+  std::vector<AgentHandle::ElementIdx_t> offset;
+
+  uint32_t* starts = nullptr;
+  uint16_t* lengths = nullptr;
+  uint64_t* timestamps = nullptr;
+  uint64_t* current_timestamp = nullptr;
+  uint32_t* num_boxes_axis = nullptr;
+  UniformGridEnvironment* grid = nullptr;
+
+  uint64_t allocated_num_agents = 0;
+  uint64_t allocated_num_boxes = 0;
+
+  /// @param pinned  Allocate the buffers in page-locked host memory (required
+  ///                for CUDA). Otherwise, regular host memory is used.
+  explicit InitializeGPUData(bool pinned = true);
+
+  virtual ~InitializeGPUData();
+
+  void Initialize(uint64_t num_agents, uint64_t num_boxes,
+                  const std::vector<AgentHandle::ElementIdx_t>& offs,
+                  UniformGridEnvironment* g);
+
+  /// Allocates the buffers and copies the data of all agents and boxes of
+  /// `grid` into them.
+  void Update(UniformGridEnvironment* grid);
+
+  void operator()(Agent* agent, AgentHandle ah) override;
+
+ private:
+  bool pinned_;
+
+  template <typename T>
+  void Alloc(T** p, uint64_t elements);
+
+  void Free(void* p);
+
+  void FreeAgentBuffers();
+
+  void FreeGridBuffers();
+};
+
+}  // namespace detail
+
+}  // namespace bdm
+
+#endif  // CORE_OPERATION_INITIALIZE_GPU_DATA_H_
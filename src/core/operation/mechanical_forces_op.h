@@ -22,6 +22,7 @@
 
 #include "core/agent/agent.h"
 #include "core/environment/environment.h"
+#include "core/environment/uniform_grid_environment.h"
 #include "core/interaction_force.h"
 #include "core/operation/bound_space_op.h"
 #include "core/operation/operation.h"
@@ -34,7 +35,16 @@
 
 namespace bdm {
 
-/// Defines the 3D physical interactions between physical objects
+/// Defines the 3D physical interactions between physical objects.\n
+/// If `Param::mechanics_pairwise` is enabled and the environment is a
+/// `UniformGridEnvironment`, the forces between agents that support it (see
+/// `Agent::SupportsPairwiseForces`) are calculated once per pair in `SetUp`
+/// and accumulated for both agents. The displacement is applied afterwards
+/// for each agent. The forces are therefore based on the agent positions and
+/// sizes at the beginning of the iteration, before the behaviors have been
+/// executed. Changes made by behaviors affect the forces with a lag of one
+/// iteration. Pairs of agents that are expected to be static are skipped.
+/// All other agents use `Agent::CalculateDisplacement`.
 class MechanicalForcesOp : public AgentOperationImpl {
   BDM_OP_HEADER(MechanicalForcesOp);
 
@@ -43,6 +53,7 @@ class MechanicalForcesOp : public AgentOperationImpl {
     auto* tinfo = ThreadInfo::GetInstance();
     last_iteration_.resize(tinfo->GetMaxThreads(),
                            std::numeric_limits<uint64_t>::max());
+    last_sub_cycle_.resize(tinfo->GetMaxThreads(), 0);
     last_time_run_.resize(tinfo->GetMaxThreads(), 0);
     delta_time_.resize(tinfo->GetMaxThreads(), 0);
   }
@@ -51,7 +62,9 @@ class MechanicalForcesOp : public AgentOperationImpl {
       : squared_radius_(other.squared_radius_),
         last_time_run_(other.last_time_run_),
         delta_time_(other.delta_time_),
-        last_iteration_(other.last_iteration_) {
+        last_iteration_(other.last_iteration_),
+        last_sub_cycle_(other.last_sub_cycle_),
+        pairwise_iteration_(other.pairwise_iteration_) {
     if (other.force_) {
       force_ = other.force_->NewCopy();
     }
@@ -73,6 +86,39 @@ class MechanicalForcesOp : public AgentOperationImpl {
     force_ = force;
   }
 
+  const InteractionForce* GetInteractionForce() const { return force_; }
+
+  void SetUp() override {
+    auto* sim = Simulation::GetActive();
+    auto* param = sim->GetParam();
+    if (force_ == nullptr) {
+      Log::Fatal("MechanicalForcesOp",
+                 "No interaction force has been set (see "
+                 "MechanicalForcesOp::SetInteractionForce).");
+    }
+    force_->UpdateParameters(param);
+    // Spring forces of the bonds between agents (added to the neighbor
+    // forces in `Cell::CalculateDisplacementFromForce`)
+    sim->GetResourceManager()->GetBondNetwork()->CalculateForces();
+    if (!param->mechanics_pairwise) {
+      return;
+    }
+    if (!force_->IsSymmetric()) {
+      Log::Fatal("MechanicalForcesOp",
+                 "Param::mechanics_pairwise requires symmetric interaction "
+                 "force parameter tables.");
+    }
+    auto* grid = dynamic_cast<UniformGridEnvironment*>(sim->GetEnvironment());
+    if (grid == nullptr) {
+      Log::Warning("MechanicalForcesOp",
+                   "The pairwise evaluation of mechanical forces is only "
+                   "supported by the UniformGridEnvironment.");
+      return;
+    }
+    CalculatePairwiseForces(grid);
+    pairwise_iteration_ = sim->GetScheduler()->GetSimulatedSteps();
+  }
+
   void operator()(Agent* agent) override {
     auto* sim = Simulation::GetActive();
     auto* scheduler = sim->GetScheduler();
@@ -82,23 +128,47 @@ class MechanicalForcesOp : public AgentOperationImpl {
       return;
     }
 
-    // Update search radius and delta_time_ at beginning of each iteration, and
-    // avoid updating them within an iteration
+    // Update search radius and delta_time_ at beginning of each iteration (or
+    // sub-cycle), and avoid updating them within an iteration
     auto current_iteration = scheduler->GetSimulatedSteps();
+    auto current_sub_cycle = scheduler->GetSubCycle();
     auto tid = omp_get_thread_num();
-    if (last_iteration_[tid] != current_iteration) {
+    if (last_iteration_[tid] != current_iteration ||
+        last_sub_cycle_[tid] != current_sub_cycle) {
       last_iteration_[tid] = current_iteration;
+      last_sub_cycle_[tid] = current_sub_cycle;
 
       auto* grid = sim->GetEnvironment();
       auto search_radius = grid->GetLargestAgentSize();
       squared_radius_ = search_radius * search_radius;
-      auto current_time = (current_iteration + 1) * param->simulation_time_step;
+      auto current_time =
+          (current_iteration + 1) * param->simulation_time_step +
+          scheduler->GetSubCycleTimeOffset();
       delta_time_[tid] = current_time - last_time_run_[tid];
       last_time_run_[tid] = current_time;
     }
 
-    const auto& displacement =
-        agent->CalculateDisplacement(force_, squared_radius_, delta_time_[tid]);
+    const Double4* pairwise_force = nullptr;
+    if (pairwise_iteration_ == current_iteration &&
+        agent->SupportsPairwiseForces()) {
+      auto ah = sim->GetResourceManager()->GetAgentHandle(agent->GetUid());
+      pairwise_force = &pairwise_forces_[ah.GetNumaNode()][ah.GetElementIdx()];
+      // The agent was expected to be static, but a neighbor has moved in
+      // this iteration (see `CalculatePairwiseForces`).
+      if ((*pairwise_force)[3] < 0) {
+        pairwise_force = nullptr;
+      }
+    }
+
+    Double3 displacement;
+    if (pairwise_force != nullptr) {
+      const auto& f = *pairwise_force;
+      displacement = agent->CalculateDisplacementFromForce(
+          {f[0], f[1], f[2]}, static_cast<uint64_t>(f[3]), delta_time_[tid]);
+    } else {
+      displacement = agent->CalculateDisplacement(force_, squared_radius_,
+                                                  delta_time_[tid]);
+    }
     agent->ApplyDisplacement(displacement);
     if (param->bound_space) {
       ApplyBoundingBox(agent, param->bound_space, param->min_bound,
@@ -107,11 +177,71 @@ class MechanicalForcesOp : public AgentOperationImpl {
   }
 
  private:
+  /// Calculates the sum of the neighbor forces (and the number of non-zero
+  /// neighbor forces in the fourth element) for each agent that supports
+  /// pairwise forces.\n
+  /// Agents that will be static in this iteration don't need forces. Their
+  /// staticness is only final once all agents have propagated it. Therefore,
+  /// agents that are expected to be static are marked with -1 in the fourth
+  /// element. If such an agent turns out not to be static, `operator()`
+  /// calculates its displacement individually.
+  void CalculatePairwiseForces(UniformGridEnvironment* grid) {
+    auto* rm = Simulation::GetActive()->GetResourceManager();
+    auto num_numa_nodes = ThreadInfo::GetInstance()->GetNumaNodes();
+    pairwise_forces_.resize(num_numa_nodes);
+    for (int n = 0; n < num_numa_nodes; ++n) {
+      auto& forces = pairwise_forces_[n];
+      forces.resize(rm->GetNumAgents(n));
+#pragma omp parallel for
+      for (uint64_t i = 0; i < forces.size(); ++i) {
+        auto* agent = rm->GetAgent(AgentHandle(n, i));
+        forces[i] = {0, 0, 0, agent->GetStaticnessNextTimestep() ? -1. : 0.};
+      }
+    }
+
+    auto search_radius = grid->GetLargestAgentSize();
+    auto accumulate = [](Double4* sum, const Double4& force, double sign) {
+      if (force[0] != 0 || force[1] != 0 || force[2] != 0) {
+        (*sum)[0] += sign * force[0];
+        (*sum)[1] += sign * force[1];
+        (*sum)[2] += sign * force[2];
+        (*sum)[3] += 1;
+      }
+    };
+    // No synchronization required: concurrent invocations never involve
+    // the same agent.
+    auto calculate_pair = L2F([&](Agent* lhs, AgentHandle lhs_ah, Agent* rhs,
+                                  AgentHandle rhs_ah, double) {
+      auto& lhs_sum =
+          pairwise_forces_[lhs_ah.GetNumaNode()][lhs_ah.GetElementIdx()];
+      auto& rhs_sum =
+          pairwise_forces_[rhs_ah.GetNumaNode()][rhs_ah.GetElementIdx()];
+      bool lhs_pairwise = lhs_sum[3] >= 0 && lhs->SupportsPairwiseForces();
+      bool rhs_pairwise = rhs_sum[3] >= 0 && rhs->SupportsPairwiseForces();
+      if (lhs_pairwise && rhs_pairwise) {
+        auto force = force_->Calculate(lhs, rhs);
+        accumulate(&lhs_sum, force, 1);
+        accumulate(&rhs_sum, force, -1);
+      } else if (lhs_pairwise) {
+        accumulate(&lhs_sum, force_->Calculate(lhs, rhs), 1);
+      } else if (rhs_pairwise) {
+        accumulate(&rhs_sum, force_->Calculate(rhs, lhs), 1);
+      }
+    });
+    grid->ForEachNeighborPair(calculate_pair, search_radius * search_radius);
+  }
+
   InteractionForce* force_ = nullptr;
   double squared_radius_ = 0;
   std::vector<double> last_time_run_;
   std::vector<double> delta_time_;
   std::vector<uint64_t> last_iteration_;
+  std::vector<size_t> last_sub_cycle_;
+  /// Iteration in which `pairwise_forces_` has been calculated
+  uint64_t pairwise_iteration_ = std::numeric_limits<uint64_t>::max();
+  /// Sum of neighbor forces for each agent (indexed by AgentHandle).
+  /// The fourth element contains the number of non-zero neighbor forces.
+  std::vector<std::vector<Double4>> pairwise_forces_;
 };
 
 }  // namespace bdm
@@ -0,0 +1,284 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/operation/mechanical_forces_op_implicit.h"
+
+#include <omp.h>
+#include <algorithm>
+#include <cmath>
+
+#include "core/agent/cell.h"
+#include "core/environment/uniform_grid_environment.h"
+#include "core/functor.h"
+#include "core/operation/bound_space_op.h"
+#include "core/param/param.h"
+#include "core/resource_manager.h"
+#include "core/scheduler.h"
+#include "core/simulation.h"
+#include "core/util/log.h"
+#include "core/util/thread_info.h"
+
+namespace bdm {
+
+// -----------------------------------------------------------------------------
+MechanicalForcesOpImplicit::~MechanicalForcesOpImplicit() { delete force_; }
+
+// -----------------------------------------------------------------------------
+void MechanicalForcesOpImplicit::SetInteractionForce(InteractionForce* force) {
+  if (force == force_) {
+    return;
+  }
+  delete force_;
+  force_ = force;
+}
+
+// -----------------------------------------------------------------------------
+double MechanicalForcesOpImplicit::CalculateStiffness(const Agent* lhs,
+                                                      const Agent* rhs,
+                                                      double distance) const {
+  const auto& p = force_->GetParameters(lhs->GetInteractionType(),
+                                       rhs->GetInteractionType());
+  double r1 = 0.5 * lhs->GetDiameter() + p.additional_radius;
+  double r2 = 0.5 * rhs->GetDiameter() + p.additional_radius;
+  double delta = r1 + r2 - distance;
+  if (delta <= 0) {
+    return 0;
+  }
+  // f = k * delta - gamma * sqrt(r * delta)
+  double r = (r1 * r2) / (r1 + r2);
+  double stiffness = p.repulsion - 0.5 * p.attraction * std::sqrt(r / delta);
+  // Negative stiffness (attractive regime) would destabilize the iterations
+  return std::max(stiffness, 0.0);
+}
+
+// -----------------------------------------------------------------------------
+void MechanicalForcesOpImplicit::operator()() {
+  auto* sim = Simulation::GetActive();
+  auto* param = sim->GetParam();
+  auto* rm = sim->GetResourceManager();
+  auto* grid = dynamic_cast<UniformGridEnvironment*>(sim->GetEnvironment());
+  if (!grid) {
+    Log::Fatal("MechanicalForcesOpImplicit",
+               "MechanicalForcesOpImplicit only works with "
+               "UniformGridEnvironement.");
+  }
+
+  if (force_ == nullptr) {
+    Log::Fatal("MechanicalForcesOpImplicit",
+               "No interaction force has been set (see "
+               "MechanicalForcesOpImplicit::SetInteractionForce).");
+  }
+  force_->UpdateParameters(param);
+  if (!force_->IsSymmetric()) {
+    Log::Fatal("MechanicalForcesOpImplicit",
+               "The implicit integrator requires symmetric interaction force "
+               "parameter tables.");
+  }
+  auto* scheduler = sim->GetScheduler();
+  auto current_time =
+      (scheduler->GetSimulatedSteps() + 1) * param->simulation_time_step +
+      scheduler->GetSubCycleTimeOffset();
+  double dt = current_time - last_time_run_;
+  last_time_run_ = current_time;
+
+  auto num_numa_nodes = ThreadInfo::GetInstance()->GetNumaNodes();
+  offset_.resize(num_numa_nodes);
+  offset_[0] = 0;
+  for (int nn = 1; nn < num_numa_nodes; nn++) {
+    offset_[nn] = offset_[nn - 1] + rm->GetNumAgents(nn - 1);
+  }
+  uint64_t num_agents = rm->GetNumAgents();
+  is_implicit_.resize(num_agents);
+  mass_dt_.resize(num_agents);
+  forces_.resize(num_agents);
+  non_zero_neighbor_forces_.resize(num_agents);
+  displacements_.resize(num_agents);
+  next_displacements_.resize(num_agents);
+  diagonal_.resize(num_agents);
+  explicit_displacements_.resize(num_agents);
+
+  // 1) Initialize the agent data
+  auto init = L2F([&](Agent* agent, AgentHandle ah) {
+    auto idx = offset_[ah.GetNumaNode()] + ah.GetElementIdx();
+    auto* cell =
+        agent->SupportsPairwiseForces() ? dynamic_cast<Cell*>(agent) : nullptr;
+    is_implicit_[idx] = cell != nullptr;
+    mass_dt_[idx] = cell && !agent->IsStatic() ? cell->GetMass() / dt : 0;
+    forces_[idx] = {0, 0, 0};
+    non_zero_neighbor_forces_[idx] = 0;
+    displacements_[idx] = {0, 0, 0};
+  });
+  rm->ForEachAgentParallel(1000, init);
+
+  // 2) Calculate the forces at the current positions and collect the
+  // contacts. No synchronization required: concurrent invocations never
+  // involve the same agent.
+  auto max_threads = ThreadInfo::GetInstance()->GetMaxThreads();
+  thread_contacts_.resize(max_threads);
+  for (auto& contacts : thread_contacts_) {
+    contacts.clear();
+  }
+  auto add_force = [&](uint64_t idx, const Double4& force, double sign) {
+    if (force[0] != 0 || force[1] != 0 || force[2] != 0) {
+      forces_[idx] += Double3{force[0], force[1], force[2]} * sign;
+      non_zero_neighbor_forces_[idx]++;
+    }
+  };
+  auto calculate_pair = L2F([&](Agent* lhs, AgentHandle lhs_ah, Agent* rhs,
+                                AgentHandle rhs_ah, double squared_distance) {
+    auto lhs_idx = offset_[lhs_ah.GetNumaNode()] + lhs_ah.GetElementIdx();
+    auto rhs_idx = offset_[rhs_ah.GetNumaNode()] + rhs_ah.GetElementIdx();
+    bool lhs_implicit = is_implicit_[lhs_idx];
+    bool rhs_implicit = is_implicit_[rhs_idx];
+    if (lhs_implicit && rhs_implicit) {
+      auto force = force_->Calculate(lhs, rhs);
+      add_force(lhs_idx, force, 1);
+      add_force(rhs_idx, force, -1);
+      double distance = std::sqrt(squared_distance);
+      double stiffness = CalculateStiffness(lhs, rhs, distance);
+      if (stiffness > 0 && distance > 0) {
+        Double3 normal = lhs->GetPosition() - rhs->GetPosition();
+        normal /= distance;
+        thread_contacts_[omp_get_thread_num()].push_back(
+            Contact{lhs_idx, rhs_idx, normal, stiffness});
+      }
+    } else if (lhs_implicit) {
+      add_force(lhs_idx, force_->Calculate(lhs, rhs), 1);
+    } else if (rhs_implicit) {
+      add_force(rhs_idx, force_->Calculate(rhs, lhs), 1);
+    }
+  });
+  double search_radius = grid->GetLargestAgentSize();
+  grid->ForEachNeighborPair(calculate_pair, search_radius * search_radius);
+
+  // 3) Add the spring forces of the bonds between agents. Agents whose force
+  // does not exceed their adherence do not move due to forces.
+  auto* bonds = rm->GetBondNetwork();
+  bonds->CalculateForces();
+  const auto& bond_forces = bonds->GetForces();
+  auto check_adherence = L2F([&](Agent* agent, AgentHandle ah) {
+    auto idx = offset_[ah.GetNumaNode()] + ah.GetElementIdx();
+    if (is_implicit_[idx] && !bond_forces.empty()) {
+      forces_[idx] += bond_forces[idx];
+    }
+    if (is_implicit_[idx] && mass_dt_[idx] != 0) {
+      auto* cell = bdm_static_cast<Cell*>(agent);
+      if (forces_[idx].Norm() <= cell->GetAdherence()) {
+        mass_dt_[idx] = 0;
+      }
+    }
+  });
+  rm->ForEachAgentParallel(1000, check_adherence);
+
+  // 4) Build the contact graph
+  contacts_.clear();
+  for (auto& contacts : thread_contacts_) {
+    contacts_.insert(contacts_.end(), contacts.begin(), contacts.end());
+  }
+  adjacency_start_.assign(num_agents + 1, 0);
+  for (const auto& c : contacts_) {
+    adjacency_start_[c.lhs + 1]++;
+    adjacency_start_[c.rhs + 1]++;
+  }
+  for (uint64_t i = 0; i < num_agents; ++i) {
+    adjacency_start_[i + 1] += adjacency_start_[i];
+  }
+  adjacency_.resize(adjacency_start_[num_agents]);
+  {
+    std::vector<uint64_t> fill(adjacency_start_.begin(),
+                               adjacency_start_.end() - 1);
+    for (uint64_t c = 0; c < contacts_.size(); ++c) {
+      adjacency_[fill[contacts_[c].lhs]++] = c;
+      adjacency_[fill[contacts_[c].rhs]++] = c;
+    }
+  }
+
+  // 5) Solve (m / dt) u + sum_j s_ij n_ij n_ij^T (u_i - u_j) = F with damped
+  // Jacobi iterations. The diagonal is at least the absolute row sum of the
+  // system matrix, which makes the iterations convergent for any time step.
+  // After a fixed number of iterations the result only approximates the
+  // implicit solution; single displacements can over- or undershoot it.
+  int64_t n = num_agents;
+#pragma omp parallel for
+  for (int64_t i = 0; i < n; ++i) {
+    double sum = 0;
+    for (uint64_t a = adjacency_start_[i]; a < adjacency_start_[i + 1]; ++a) {
+      sum += contacts_[adjacency_[a]].stiffness;
+    }
+    diagonal_[i] = mass_dt_[i] + 2 * sum;
+  }
+  for (uint64_t it = 0; it < param->mechanics_implicit_iterations; ++it) {
+#pragma omp parallel for
+    for (int64_t i = 0; i < n; ++i) {
+      if (mass_dt_[i] == 0) {
+        next_displacements_[i] = {0, 0, 0};
+        continue;
+      }
+      const auto& u_i = displacements_[i];
+      Double3 residual = forces_[i] - u_i * mass_dt_[i];
+      for (uint64_t a = adjacency_start_[i]; a < adjacency_start_[i + 1];
+           ++a) {
+        const auto& c = contacts_[adjacency_[a]];
+        uint64_t j = c.lhs == static_cast<uint64_t>(i) ? c.rhs : c.lhs;
+        const auto& u_j = displacements_[j];
+        double projection = c.normal * (u_i - u_j);
+        residual -= c.normal * (c.stiffness * projection);
+      }
+      next_displacements_[i] = u_i + residual / diagonal_[i];
+    }
+    displacements_.swap(next_displacements_);
+  }
+
+  // 6) Agents that are not integrated implicitly use the explicit scheme.
+  // Calculated before any agent is moved.
+  auto calculate_explicit = L2F([&](Agent* agent, AgentHandle ah) {
+    auto idx = offset_[ah.GetNumaNode()] + ah.GetElementIdx();
+    if (!is_implicit_[idx] && !agent->IsStatic()) {
+      explicit_displacements_[idx] = agent->CalculateDisplacement(
+          force_, search_radius * search_radius, dt);
+    }
+  });
+  rm->ForEachAgentParallel(1000, calculate_explicit);
+
+  // 7) Apply the displacements
+  auto apply = L2F([&](Agent* agent, AgentHandle ah) {
+    if (agent->IsStatic()) {
+      return;
+    }
+    auto idx = offset_[ah.GetNumaNode()] + ah.GetElementIdx();
+    Double3 displacement;
+    if (is_implicit_[idx]) {
+      if (non_zero_neighbor_forces_[idx] > 1) {
+        agent->SetStaticnessNextTimestep(false);
+      }
+      // Same as in `Cell::CalculateDisplacementFromForce`
+      auto* cell = bdm_static_cast<Cell*>(agent);
+      displacement = cell->GetTractorForce() * dt + displacements_[idx];
+      if (displacements_[idx].Norm() > param->simulation_max_displacement) {
+        displacement.Normalize();
+        displacement *= param->simulation_max_displacement;
+      }
+    } else {
+      displacement = explicit_displacements_[idx];
+    }
+    agent->ApplyDisplacement(displacement);
+    if (param->bound_space) {
+      ApplyBoundingBox(agent, param->bound_space, param->min_bound,
+                       param->max_bound);
+    }
+  });
+  rm->ForEachAgentParallel(1000, apply);
+}
+
+}  // namespace bdm
@@ -0,0 +1,109 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef CORE_OPERATION_MECHANICAL_FORCES_OP_IMPLICIT_H_
+#define CORE_OPERATION_MECHANICAL_FORCES_OP_IMPLICIT_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "core/agent/agent_handle.h"
+#include "core/container/math_array.h"
+#include "core/interaction_force.h"
+#include "core/operation/operation.h"
+#include "core/operation/operation_registry.h"
+
+namespace bdm {
+
+/// Implementation of the "mechanical forces" operation with a semi-implicit
+/// (linearized backward Euler) integrator for the overdamped motion of
+/// spherical agents.\n
+/// The explicit update `u = F(x) * dt / m` becomes unstable for stiff
+/// contacts unless the time step is small. This implementation instead solves
+/// `(m / dt) u - J u = F(x)`, where `J` is the normal contact stiffness
+/// (derivative of the default sphere-sphere force law) over the contact
+/// graph, with `Param::mechanics_implicit_iterations` damped block-Jacobi
+/// iterations. It remains stable for considerably larger time steps.\n
+/// Selected with `Param::mechanics_integrator = "implicit"`. Requires the
+/// `UniformGridEnvironment`. Agents that do not support pairwise forces
+/// (see `Agent::SupportsPairwiseForces`) use the explicit
+/// `Agent::CalculateDisplacement`. As with `Param::mechanics_pairwise`, all
+/// forces are based on the agent positions at the beginning of the
+/// operation.
+struct MechanicalForcesOpImplicit : public StandaloneOperationImpl {
+  BDM_OP_HEADER(MechanicalForcesOpImplicit);
+
+ public:
+  MechanicalForcesOpImplicit() : force_(new InteractionForce()) {}
+
+  MechanicalForcesOpImplicit(const MechanicalForcesOpImplicit& other)
+      : StandaloneOperationImpl(other),
+        force_(other.force_ ? other.force_->NewCopy() : nullptr),
+        last_time_run_(other.last_time_run_) {}
+
+  virtual ~MechanicalForcesOpImplicit();
+
+  void SetInteractionForce(InteractionForce* force);
+
+  void operator()() override;
+
+ private:
+  /// A pair of agents in contact. Indices refer to the flattened agent
+  /// arrays.
+  struct Contact {
+    uint64_t lhs;
+    uint64_t rhs;
+    /// Unit vector from `rhs` to `lhs`
+    Double3 normal;
+    /// Normal stiffness of the contact
+    double stiffness;
+  };
+
+  /// Returns the stiffness `dF/d(overlap)` of the default sphere-sphere force
+  /// law between `lhs` and `rhs` at the current positions.
+  double CalculateStiffness(const Agent* lhs, const Agent* rhs,
+                            double distance) const;
+
+  InteractionForce* force_ = nullptr;
+  double last_time_run_ = 0;
+
+  /// Start index in the flattened arrays for each NUMA node
+  std::vector<AgentHandle::ElementIdx_t> offset_;
+  /// True for agents that are integrated with the implicit scheme
+  std::vector<char> is_implicit_;
+  /// `mass / dt`, or zero for agents that do not move due to forces
+  std::vector<double> mass_dt_;
+  /// Sum of the neighbor forces
+  std::vector<Double3> forces_;
+  /// Number of non-zero neighbor forces
+  std::vector<uint32_t> non_zero_neighbor_forces_;
+  /// Displacement due to neighbor forces (solution of the linear system)
+  std::vector<Double3> displacements_;
+  std::vector<Double3> next_displacements_;
+  /// Diagonal preconditioner of the Jacobi iterations
+  std::vector<double> diagonal_;
+  /// Displacements of agents that use the explicit integrator
+  std::vector<Double3> explicit_displacements_;
+  /// Contacts found by each thread
+  std::vector<std::vector<Contact>> thread_contacts_;
+  std::vector<Contact> contacts_;
+  /// Contact graph in compressed row format: indices into `contacts_` for
+  /// each agent
+  std::vector<uint64_t> adjacency_start_;
+  std::vector<uint64_t> adjacency_;
+};
+
+}  // namespace bdm
+
+#endif  // CORE_OPERATION_MECHANICAL_FORCES_OP_IMPLICIT_H_
@@ -0,0 +1,294 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/operation/mechanical_forces_op_soa.h"
+
+#include <algorithm>
+#include <cmath>
+#include <typeinfo>
+#include <vector>
+
+#include "core/agent/agent_handle.h"
+#include "core/agent/cell.h"
+#include "core/environment/uniform_grid_environment.h"
+#include "core/interaction_force.h"
+#include "core/operation/bound_space_op.h"
+#include "core/operation/initialize_gpu_data.h"
+#include "core/operation/mechanical_forces_op.h"
+#include "core/resource_manager.h"
+#include "core/scheduler.h"
+#include "core/simulation.h"
+#include "core/util/log.h"
+#include "core/util/random.h"
+#include "core/util/type.h"
+
+namespace bdm {
+
+// -----------------------------------------------------------------------------
+struct ApplySoaDisplacement : public Functor<void, Agent*, AgentHandle> {
+  const detail::InitializeGPUData* data;
+  const std::vector<uint32_t>* non_zero_neighbor_forces;
+  const Param* param;
+
+  ApplySoaDisplacement(const detail::InitializeGPUData* d,
+                       const std::vector<uint32_t>* nz, const Param* p)
+      : data(d), non_zero_neighbor_forces(nz), param(p) {}
+
+  void operator()(Agent* agent, AgentHandle ah) override {
+    if (agent->IsStatic()) {
+      return;
+    }
+    auto idx = data->offset[ah.GetNumaNode()] + ah.GetElementIdx();
+    if ((*non_zero_neighbor_forces)[idx] > 1) {
+      agent->SetStaticnessNextTimestep(false);
+    }
+    auto idxt3 = idx * 3;
+    agent->ApplyDisplacement({data->cell_movements[idxt3],
+                              data->cell_movements[idxt3 + 1],
+                              data->cell_movements[idxt3 + 2]});
+    if (param->bound_space) {
+      ApplyBoundingBox(agent, param->bound_space, param->min_bound,
+                       param->max_bound);
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+MechanicalForcesOpSoa::~MechanicalForcesOpSoa() { delete i_; }
+
+// -----------------------------------------------------------------------------
+void MechanicalForcesOpSoa::SetUp() {
+  auto* sim = Simulation::GetActive();
+  auto* grid = dynamic_cast<UniformGridEnvironment*>(sim->GetEnvironment());
+
+  if (!grid) {
+    Log::Fatal("MechanicalForcesOpSoa::SetUp",
+               "MechanicalForcesOpSoa only works with UniformGridEnvironement.");
+  }
+
+  // The kernel hard-codes the default force law. A custom force (or a
+  // subclass of the agent-based implementation) is set on the
+  // `MechanicalForcesOp` implementation of the same operation.
+  for (auto* op : sim->GetScheduler()->GetOps("mechanical forces")) {
+    if (op->GetImplementation<MechanicalForcesOpSoa>() != this) {
+      continue;
+    }
+    auto* cpu_impl = op->GetImplementation<MechanicalForcesOp>();
+    if (cpu_impl == nullptr) {
+      break;
+    }
+    auto* custom_force = cpu_impl->GetInteractionForce();
+    if (typeid(*cpu_impl) != typeid(MechanicalForcesOp) ||
+        (custom_force != nullptr &&
+         typeid(*custom_force) != typeid(InteractionForce))) {
+      Log::Fatal("MechanicalForcesOpSoa::SetUp",
+                 "MechanicalForcesOpSoa only supports the default "
+                 "InteractionForce and MechanicalForcesOp. Use the compute "
+                 "target 'cpu' for custom interaction forces.");
+    }
+    break;
+  }
+
+  force_.UpdateParameters(sim->GetParam());
+  if (!force_.HasDefaultParameters()) {
+    Log::Fatal("MechanicalForcesOpSoa::SetUp",
+               "MechanicalForcesOpSoa only supports the default interaction "
+               "force parameters.");
+  }
+
+  if (i_ == nullptr) {
+    i_ = new detail::InitializeGPUData(false);
+  }
+  i_->Update(grid);
+  sim->GetResourceManager()->GetBondNetwork()->CalculateForces();
+
+  auto* param = sim->GetParam();
+  auto* scheduler = sim->GetScheduler();
+  auto current_time =
+      (scheduler->GetSimulatedSteps() + 1) * param->simulation_time_step +
+      scheduler->GetSubCycleTimeOffset();
+  delta_time_ = current_time - last_time_run_;
+  last_time_run_ = current_time;
+}
+
+// -----------------------------------------------------------------------------
+void MechanicalForcesOpSoa::operator()() {
+  auto* sim = Simulation::GetActive();
+  auto* grid = i_->grid;
+  auto* param = sim->GetParam();
+  auto* rm = sim->GetResourceManager();
+
+  const int64_t num_agents = rm->GetNumAgents();
+  const double search_radius = grid->GetLargestAgentSize();
+  const double squared_radius = search_radius * search_radius;
+  const double dt = delta_time_;
+  const double max_displacement = param->simulation_max_displacement;
+  const uint64_t nx = i_->num_boxes_axis[0];
+  const uint64_t nxy = nx * i_->num_boxes_axis[1];
+  const uint64_t current_timestamp = *(i_->current_timestamp);
+  const double additional_radius = InteractionForce::kSphereAdditionalRadius;
+
+  const double* pos = i_->cell_positions;
+  const double* diameters = i_->cell_diameters;
+  const double* tractor_force = i_->cell_tractor_force;
+  double* movements = i_->cell_movements;
+  const auto& bond_forces = rm->GetBondNetwork()->GetForces();
+
+  non_zero_neighbor_forces_.resize(num_agents);
+
+#pragma omp parallel
+  {
+    // Neighbor data of the current agent as structure of arrays
+    std::vector<double> nx_pos, ny_pos, nz_pos, ndiam;
+
+#pragma omp for schedule(dynamic, 1000)
+    for (int64_t idx = 0; idx < num_agents; ++idx) {
+      nx_pos.clear();
+      ny_pos.clear();
+      nz_pos.clear();
+      ndiam.clear();
+
+      const double px = pos[idx * 3];
+      const double py = pos[idx * 3 + 1];
+      const double pz = pos[idx * 3 + 2];
+
+      // Gather the agents in the Moore neighborhood. Agents are never in the
+      // boundary boxes of the grid, so all 27 boxes exist.
+      uint64_t box_idx = i_->cell_boxid[idx];
+      for (int64_t z = -1; z <= 1; ++z) {
+        for (int64_t y = -1; y <= 1; ++y) {
+          for (int64_t x = -1; x <= 1; ++x) {
+            uint64_t bidx = box_idx + z * nxy + y * nx + x;
+            if (i_->timestamps[bidx] != current_timestamp) {
+              continue;
+            }
+            uint32_t nidx = i_->starts[bidx];
+            for (uint16_t n = 0; n < i_->lengths[bidx]; ++n) {
+              if (nidx != static_cast<uint64_t>(idx)) {
+                nx_pos.push_back(pos[nidx * 3]);
+                ny_pos.push_back(pos[nidx * 3 + 1]);
+                nz_pos.push_back(pos[nidx * 3 + 2]);
+                ndiam.push_back(diameters[nidx]);
+              }
+              nidx = i_->successors[nidx];
+            }
+          }
+        }
+      }
+
+      // Same computation as in `InteractionForce::CalculateBatch`
+      const uint64_t size = nx_pos.size();
+      const double* cx = nx_pos.data();
+      const double* cy = ny_pos.data();
+      const double* cz = nz_pos.data();
+      const double* cd = ndiam.data();
+      const double r1 = 0.5 * diameters[idx] + additional_radius;
+      double fx = 0, fy = 0, fz = 0;
+      uint32_t non_zero = 0;
+      bool centers_coincide = false;
+#pragma omp simd reduction(+ : fx, fy, fz, non_zero) \
+    reduction(|| : centers_coincide)
+      for (uint64_t i = 0; i < size; ++i) {
+        double comp1 = px - cx[i];
+        double comp2 = py - cy[i];
+        double comp3 = pz - cz[i];
+        double d2 = comp1 * comp1 + comp2 * comp2 + comp3 * comp3;
+        double r2 = 0.5 * cd[i] + additional_radius;
+        double center_distance = std::sqrt(d2);
+        double delta = r1 + r2 - center_distance;
+        double r = (r1 * r2) / (r1 + r2);
+        double f = 2 * delta - std::sqrt(r * std::max(delta, 0.0));
+        bool active = d2 < squared_radius && delta >= 0;
+        double module = active ? f / center_distance : 0.0;
+        double f1 = module * comp1;
+        double f2 = module * comp2;
+        double f3 = module * comp3;
+        fx += f1;
+        fy += f2;
+        fz += f3;
+        non_zero += (f1 != 0 || f2 != 0 || f3 != 0) ? 1 : 0;
+        centers_coincide =
+            centers_coincide || (active && center_distance < 0.00000001);
+      }
+
+      // Rare case: random force if the centers are (almost) at the same
+      // location
+      if (centers_coincide) {
+        auto* random = sim->GetRandom();
+        fx = fy = fz = 0;
+        non_zero = 0;
+        for (uint64_t i = 0; i < size; ++i) {
+          double comp1 = px - cx[i];
+          double comp2 = py - cy[i];
+          double comp3 = pz - cz[i];
+          double d2 = comp1 * comp1 + comp2 * comp2 + comp3 * comp3;
+          double r2 = 0.5 * cd[i] + additional_radius;
+          double center_distance = std::sqrt(d2);
+          double delta = r1 + r2 - center_distance;
+          if (d2 >= squared_radius || delta < 0) {
+            continue;
+          }
+          Double3 force;
+          if (center_distance < 0.00000001) {
+            force = random->template UniformArray<3>(-3.0, 3.0);
+          } else {
+            double r = (r1 * r2) / (r1 + r2);
+            double module = (2 * delta - std::sqrt(r * delta)) /
+                            center_distance;
+            force = {module * comp1, module * comp2, module * comp3};
+          }
+          fx += force[0];
+          fy += force[1];
+          fz += force[2];
+          if (force[0] != 0 || force[1] != 0 || force[2] != 0) {
+            non_zero++;
+          }
+        }
+      }
+
+      if (!bond_forces.empty()) {
+        fx += bond_forces[idx][0];
+        fy += bond_forces[idx][1];
+        fz += bond_forces[idx][2];
+      }
+
+      // Same computation as in `Cell::CalculateDisplacementFromForce`
+      Double3 movement = {tractor_force[idx * 3] * dt,
+                          tractor_force[idx * 3 + 1] * dt,
+                          tractor_force[idx * 3 + 2] * dt};
+      double norm_of_force = std::sqrt(fx * fx + fy * fy + fz * fz);
+      if (norm_of_force > i_->cell_adherence[idx]) {
+        double mh = dt / i_->mass[idx];
+        movement += Double3{fx, fy, fz} * mh;
+        if (norm_of_force * mh > max_displacement) {
+          movement.Normalize();
+          movement *= max_displacement;
+        }
+      }
+      movements[idx * 3] = movement[0];
+      movements[idx * 3 + 1] = movement[1];
+      movements[idx * 3 + 2] = movement[2];
+      non_zero_neighbor_forces_[idx] = non_zero;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void MechanicalForcesOpSoa::TearDown() {
+  auto* sim = Simulation::GetActive();
+  ApplySoaDisplacement apply(i_, &non_zero_neighbor_forces_, sim->GetParam());
+  sim->GetResourceManager()->ForEachAgentParallel(1000, apply);
+}
+
+}  // namespace bdm
@@ -0,0 +1,76 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef CORE_OPERATION_MECHANICAL_FORCES_OP_SOA_H_
+#define CORE_OPERATION_MECHANICAL_FORCES_OP_SOA_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "core/interaction_force.h"
+#include "core/operation/operation.h"
+#include "core/operation/operation_registry.h"
+
+namespace bdm {
+
+namespace detail {
+
+struct InitializeGPUData;
+
+}  // namespace detail
+
+/// CPU implementation of the "mechanical forces" operation that uses the same
+/// data-parallel algorithm as the GPU implementations
+/// (`MechanicalForcesOpCuda`).\n
+/// In `SetUp` the agent and grid data is flattened into contiguous arrays
+/// (`detail::InitializeGPUData`). `operator()` calculates the displacement of
+/// each agent with OpenMP over agents and SIMD over the neighbors.
+/// `TearDown` applies the displacements.\n
+/// Selected with `Param::compute_target = "cpu-soa"`.
+/// Only supports the `UniformGridEnvironment`, spherical agents derived from
+/// `Cell` and the default `InteractionForce` with the default parameters.
+/// In contrast to `MechanicalForcesOp`, all forces are based on the agent
+/// positions at the beginning of the operation.
+struct MechanicalForcesOpSoa : public StandaloneOperationImpl {
+  BDM_OP_HEADER(MechanicalForcesOpSoa);
+
+ public:
+  MechanicalForcesOpSoa() {}
+
+  MechanicalForcesOpSoa(const MechanicalForcesOpSoa& other)
+      : StandaloneOperationImpl(other), force_(other.force_) {}
+
+  virtual ~MechanicalForcesOpSoa();
+
+  void SetUp() override;
+
+  void operator()() override;
+
+  void TearDown() override;
+
+ private:
+  detail::InitializeGPUData* i_ = nullptr;
+  /// Used to check that the interaction force parameters are the defaults
+  InteractionForce force_;
+  /// Simulated time at the last execution of this operation
+  double last_time_run_ = 0;
+  /// Time step that is used in the current execution
+  double delta_time_ = 0;
+  /// Number of non-zero neighbor forces for each agent
+  std::vector<uint32_t> non_zero_neighbor_forces_;
+};
+
+}  // namespace bdm
+
+#endif  // CORE_OPERATION_MECHANICAL_FORCES_OP_SOA_H_
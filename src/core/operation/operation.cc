@@ -13,6 +13,9 @@
 // -----------------------------------------------------------------------------
 
 #include "core/operation/operation.h"
+#include <algorithm>
+#include "core/param/param.h"
+#include "core/simulation.h"
 
 namespace bdm {
 
@@ -73,6 +76,55 @@ void Operation::SelectComputeTarget(OpComputeTarget target) {
   active_target_ = target;
 }
 
+void Operation::SetAdaptiveFrequency(const std::function<double()> &metric,
+                                     double lower_threshold,
+                                     double upper_threshold,
+                                     size_t min_frequency,
+                                     size_t max_frequency) {
+  if (lower_threshold > upper_threshold || min_frequency == 0 ||
+      min_frequency > max_frequency) {
+    Log::Fatal("Operation::SetAdaptiveFrequency",
+               "Invalid parameters for operation ", name_,
+               ". Requirements: lower_threshold <= upper_threshold and 0 < "
+               "min_frequency <= max_frequency");
+  }
+  adaptive_metric_ = metric;
+  adaptive_lower_threshold_ = lower_threshold;
+  adaptive_upper_threshold_ = upper_threshold;
+  adaptive_min_frequency_ = min_frequency;
+  adaptive_max_frequency_ = max_frequency;
+  frequency_ = std::min(std::max(frequency_, min_frequency), max_frequency);
+  last_frequency_update_ = std::numeric_limits<uint64_t>::max();
+}
+
+void Operation::UpdateFrequency(uint64_t step) {
+  if (!adaptive_metric_ || !IsDue(step) || last_frequency_update_ == step) {
+    return;
+  }
+  last_frequency_update_ = step;
+  auto value = adaptive_metric_();
+  if (value < adaptive_lower_threshold_) {
+    frequency_ = std::min(frequency_ * 2, adaptive_max_frequency_);
+  } else if (value > adaptive_upper_threshold_) {
+    frequency_ = std::max(frequency_ / 2, adaptive_min_frequency_);
+  }
+}
+
+void Operation::SetSubCycles(size_t sub_cycles, bool update_environment) {
+  if (sub_cycles == 0) {
+    Log::Fatal("Operation::SetSubCycles",
+               "The number of sub-cycles of operation ", name_,
+               " must be larger than zero.");
+  }
+  sub_cycles_ = sub_cycles;
+  sub_cycle_update_environment_ = update_environment;
+}
+
+double Operation::GetTimeStep() const {
+  auto* param = Simulation::GetActive()->GetParam();
+  return param->simulation_time_step * frequency_ / sub_cycles_;
+}
+
 void Operation::SetUp() { implementations_[active_target_]->SetUp(); }
 
 void Operation::TearDown() { implementations_[active_target_]->TearDown(); }
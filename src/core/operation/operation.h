@@ -16,6 +16,7 @@
 #define CORE_OPERATION_OPERATION_H_
 
 #include <functional>
+#include <limits>
 #include <set>
 #include <string>
 #include <vector>
@@ -26,8 +27,9 @@
 namespace bdm {
 
 class Agent;
+class AgentSubset;
 
-enum OpComputeTarget { kCpu, kCuda, kOpenCl };
+enum OpComputeTarget { kCpu, kCuda, kOpenCl, kCpuSoa, kCpuImplicit };
 
 inline std::string OpComputeTargetString(OpComputeTarget t) {
   switch (t) {
@@ -37,6 +39,10 @@ inline std::string OpComputeTargetString(OpComputeTarget t) {
       return "kCuda";
     case OpComputeTarget::kOpenCl:
       return "kOpenCl";
+    case OpComputeTarget::kCpuSoa:
+      return "kCpuSoa";
+    case OpComputeTarget::kCpuImplicit:
+      return "kCpuImplicit";
     default:
       return "Invalid";
   }
@@ -188,11 +194,79 @@ struct Operation {
     exclude_filters_ = exclude_filters;
   }
 
+  /// Restricts this agent operation to the members of `subset`. The subset is
+  /// not owned by this operation and must outlive it.
+  /// A nullptr (default) runs the operation for all agents.
+  /// \see AgentSubset
+  void SetAgentSubset(AgentSubset *subset) { agent_subset_ = subset; }
+
+  AgentSubset *GetAgentSubset() const { return agent_subset_; }
+
+  /// Adapts `frequency_` at runtime based on a user-defined `metric`.\n
+  /// Each time this operation is due, the scheduler evaluates `metric` before
+  /// the operation is executed. If the value is below `lower_threshold`, the
+  /// frequency is doubled (i.e. the operation runs less often); if it is
+  /// above `upper_threshold`, the frequency is halved. The frequency is kept
+  /// within [`min_frequency`, `max_frequency`]. The new frequency takes
+  /// effect immediately: the operation is only executed in this iteration if
+  /// it is also due with the new frequency.
+  ///
+  ///     // run mechanics less often if agents hardly move
+  ///     op->SetAdaptiveFrequency([&]() { return mean_displacement; },
+  ///                              0.01, 0.1, 1, 16);
+  void SetAdaptiveFrequency(const std::function<double()> &metric,
+                            double lower_threshold, double upper_threshold,
+                            size_t min_frequency = 1,
+                            size_t max_frequency = 64);
+
+  /// Removes the adaptive frequency. `frequency_` keeps its current value.
+  void ClearAdaptiveFrequency() { adaptive_metric_ = nullptr; }
+
+  bool HasAdaptiveFrequency() const { return adaptive_metric_ != nullptr; }
+
+  /// Returns true if this operation should be executed in iteration `step`.
+  bool IsDue(uint64_t step) const {
+    return frequency_ != 0 && step % frequency_ == 0;
+  }
+
+  /// Updates `frequency_` if an adaptive frequency has been set and this
+  /// operation is due in iteration `step`. Evaluates the metric at most once
+  /// per iteration.
+  void UpdateFrequency(uint64_t step);
+
+  /// Executes this operation `sub_cycles` times each time it is due, with a
+  /// time step of `GetTimeStep()`. This way, fast processes (e.g. mechanics
+  /// or diffusion) can be integrated with a smaller time step than the
+  /// remaining operations, without executing a whole simulation step for each
+  /// sub-cycle. During sub-cycle `i` of `n`, `Scheduler::GetSimulatedTime`
+  /// (and `Scheduler::GetSubCycleTimeOffset`) are interpolated linearly
+  /// between the previous and the current execution of this operation.\n
+  /// `SetUp` and `TearDown` are called for each sub-cycle. If
+  /// `update_environment` is true, the environment is updated between two
+  /// sub-cycles. Otherwise, the neighbor information from the beginning of the
+  /// iteration is reused, which is only accurate if the agents move less than
+  /// the environment's box length during all sub-cycles.\n
+  /// Only supported for scheduled agent and standalone operations. Pre- and
+  /// post-scheduled operations are executed once.
+  ///
+  ///     // four mechanics steps per behavior step
+  ///     scheduler->GetOps("mechanical forces")[0]->SetSubCycles(4, true);
+  void SetSubCycles(size_t sub_cycles, bool update_environment = false);
+
+  /// Returns the time step with which one sub-cycle of this operation
+  /// advances: `simulation_time_step * frequency_ / sub_cycles_`
+  double GetTimeStep() const;
+
   /// Specifies how often this operation will be executed.\n
   /// 1: every timestep\n
   /// 2: every second timestep\n
   /// ...
   size_t frequency_ = 1;
+  /// Number of times this operation is executed each time it is due
+  /// (see `SetSubCycles`)
+  size_t sub_cycles_ = 1;
+  /// If true, the environment is updated between two sub-cycles
+  bool sub_cycle_update_environment_ = false;
   /// Operation name / unique identifier
   std::string name_;
   /// The compute target that this operation will be executed on
@@ -202,6 +276,17 @@ struct Operation {
 
   /// If this is an agent operation don't run it for this list of filters
   std::set<Functor<bool, Agent *> *> exclude_filters_;
+
+  /// If this is an agent operation only run it for the agents in this subset
+  AgentSubset *agent_subset_ = nullptr;
+
+  /// Parameters of the adaptive frequency (see `SetAdaptiveFrequency`)
+  std::function<double()> adaptive_metric_;
+  double adaptive_lower_threshold_ = 0;
+  double adaptive_upper_threshold_ = 0;
+  size_t adaptive_min_frequency_ = 1;
+  size_t adaptive_max_frequency_ = 1;
+  uint64_t last_frequency_update_ = std::numeric_limits<uint64_t>::max();
 };
 
 }  // namespace bdm
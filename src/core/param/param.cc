@@ -145,6 +145,24 @@ void Param::MergeJsonPatch(const std::string& patch) {
   Restore(std::move(*restored));
 }
 
+// -----------------------------------------------------------------------------
+void Param::Validate() const {
+  if (mechanics_integrator != "explicit" &&
+      mechanics_integrator != "implicit") {
+    Log::Fatal("Param::Validate",
+               Concat("Parameter mechanics_integrator was set to an invalid "
+                      "value (",
+                      mechanics_integrator,
+                      "). Supported values are explicit and implicit."));
+  }
+  if (!(diffusion_grid_headroom >= 0)) {
+    Log::Fatal("Param::Validate",
+               Concat("Parameter diffusion_grid_headroom must not be "
+                      "negative (",
+                      diffusion_grid_headroom, " given)."));
+  }
+}
+
 // -----------------------------------------------------------------------------
 void AssignThreadSafetyMechanism(const std::shared_ptr<cpptoml::table>& config,
                                  Param* param) {
@@ -225,6 +243,7 @@ void Param::AssignFromConfig(const std::shared_ptr<cpptoml::table>& config) {
 
   // simulation group
   BDM_ASSIGN_CONFIG_VALUE(random_seed, "simulation.random_seed");
+  BDM_ASSIGN_CONFIG_VALUE(deterministic_mode, "simulation.deterministic_mode");
   BDM_ASSIGN_CONFIG_VALUE(output_dir, "simulation.output_dir");
   BDM_ASSIGN_CONFIG_VALUE(environment, "simulation.environment");
   BDM_ASSIGN_CONFIG_VALUE(nanoflann_depth, "simulation.nanoflann_depth");
@@ -240,8 +259,23 @@ void Param::AssignFromConfig(const std::shared_ptr<cpptoml::table>& config) {
   BDM_ASSIGN_CONFIG_VALUE(diffusion_boundary_condition,
                           "simulation.diffusion_boundary_condition");
   BDM_ASSIGN_CONFIG_VALUE(diffusion_method, "simulation.diffusion_method");
+  BDM_ASSIGN_CONFIG_VALUE(diffusion_implicit_theta,
+                          "simulation.diffusion_implicit_theta");
+  BDM_ASSIGN_CONFIG_VALUE(diffusion_substeps, "simulation.diffusion_substeps");
+  BDM_ASSIGN_CONFIG_VALUE(diffusion_convergence_tolerance,
+                          "simulation.diffusion_convergence_tolerance");
+  BDM_ASSIGN_CONFIG_VALUE(diffusion_grid_headroom,
+                          "simulation.diffusion_grid_headroom");
+  BDM_ASSIGN_CONFIG_VALUE(diffusion_amr_block_size,
+                          "simulation.diffusion_amr_block_size");
+  BDM_ASSIGN_CONFIG_VALUE(diffusion_amr_agent_threshold,
+                          "simulation.diffusion_amr_agent_threshold");
+  BDM_ASSIGN_CONFIG_VALUE(diffusion_amr_gradient_threshold,
+                          "simulation.diffusion_amr_gradient_threshold");
   BDM_ASSIGN_CONFIG_VALUE(calculate_gradients,
                           "simulation.calculate_gradients");
+  BDM_ASSIGN_CONFIG_VALUE(diffusion_lazy_gradients,
+                          "simulation.diffusion_lazy_gradients");
   AssignBoundSpaceMode(config, this);
   AssignThreadSafetyMechanism(config, this);
 
@@ -325,6 +359,30 @@ void Param::AssignFromConfig(const std::shared_ptr<cpptoml::table>& config) {
     }
   }
 
+  BDM_ASSIGN_CONFIG_VALUE(mechanics_integrator,
+                          "simulation.mechanics_integrator");
+  BDM_ASSIGN_CONFIG_VALUE(mechanics_implicit_iterations,
+                          "simulation.mechanics_implicit_iterations");
+  BDM_ASSIGN_CONFIG_VALUE(mechanics_sub_cycles,
+                          "simulation.mechanics_sub_cycles");
+  BDM_ASSIGN_CONFIG_VALUE(diffusion_sub_cycles,
+                          "simulation.diffusion_sub_cycles");
+
+  // interaction force parameters
+  if (config->get_table("simulation")) {
+    auto assign_table = [&](const std::string& key,
+                            std::vector<double>* table) {
+      auto values = config->get_table("simulation")->get_array_of<double>(key);
+      if (values) {
+        table->assign(values->begin(), values->end());
+      }
+    };
+    assign_table("interaction_force_repulsion", &interaction_force_repulsion);
+    assign_table("interaction_force_attraction", &interaction_force_attraction);
+    assign_table("interaction_force_iof_coefficient",
+                 &interaction_force_iof_coefficient);
+  }
+
   // unschedule_default_operations
   if (config->get_table("simulation")) {
     auto disabled_ops =
@@ -341,6 +399,7 @@ void Param::AssignFromConfig(const std::shared_ptr<cpptoml::table>& config) {
   BDM_ASSIGN_CONFIG_VALUE(detect_static_agents,
                           "performance.detect_static_agents");
   BDM_ASSIGN_CONFIG_VALUE(cache_neighbors, "performance.cache_neighbors");
+  BDM_ASSIGN_CONFIG_VALUE(mechanics_pairwise, "performance.mechanics_pairwise");
   BDM_ASSIGN_CONFIG_VALUE(
       agent_uid_defragmentation_low_watermark,
       "performance.agent_uid_defragmentation_low_watermark");
@@ -357,6 +416,15 @@ void Param::AssignFromConfig(const std::shared_ptr<cpptoml::table>& config) {
   BDM_ASSIGN_CONFIG_VALUE(minimize_memory_while_rebalancing,
                           "performance.minimize_memory_while_rebalancing");
   AssignMappedDataArrayMode(config, this);
+  BDM_ASSIGN_CONFIG_VALUE(thread_pinning, "performance.thread_pinning");
+  if (config->get_table("performance")) {
+    auto cpus =
+        config->get_table("performance")->get_array_of<int64_t>(
+            "thread_pinning_cpus");
+    if (cpus) {
+      thread_pinning_cpus.assign(cpus->begin(), cpus->end());
+    }
+  }
 
   // development group
   BDM_ASSIGN_CONFIG_VALUE(statistics, "development.statistics");
@@ -54,6 +54,10 @@ struct Param {
   /// `ToJsonString()`.
   void MergeJsonPatch(const std::string& patch);
 
+  /// Stops the simulation with `Log::Fatal` if a parameter has an invalid
+  /// value. Called by `Simulation` after all parameters have been assigned.
+  void Validate() const;
+
   template <typename TParamGroup>
   const TParamGroup* Get() const {
     if (groups_.find(TParamGroup::kUid) != groups_.end()) {
@@ -88,6 +92,30 @@ struct Param {
   ///     random_seed = 4357
   uint64_t random_seed = 4357;
 
+  /// Makes simulation results independent of the number of threads and the
+  /// order in which threads process agents.\n
+  /// If enabled,
+  /// 1) each thread uses a `CounterBasedRandom` generator. Before the agent
+  ///    operations are executed for an agent, the generator is set to a
+  ///    stream keyed by the agent uid and the simulation step.
+  /// 2) new agents are added to the simulation in a deterministic order and
+  ///    obtain their uid in this order. Uids and AgentPointers that were
+  ///    stored in the same iteration are updated with `Agent::RemapUids`,
+  ///    which visits all agents in each iteration that creates agents.
+  ///    Custom agents and behaviors that store uids must override it.
+  /// 3) agents are removed in a deterministic order.
+  /// 4) neighbors are iterated in the order of their uid.
+  ///
+  /// Agent operations must not depend on updates of other agents within the
+  /// same iteration (\see `experimental::CopyExecutionContext`).
+  /// Otherwise, the results still depend on the execution order.\n
+  /// Default value: `false`\n
+  /// TOML config file:
+  ///
+  ///     [simulation]
+  ///     deterministic_mode = false
+  bool deterministic_mode = false;
+
   /// List of default operation names that should not be scheduled by default
   /// Default value: `{}`\n
   /// TOML config file:
@@ -192,6 +220,87 @@ struct Param {
   ///     max_displacement = 3.0
   double simulation_max_displacement = 3.0;
 
+  /// Repulsion coefficient of the sphere-sphere force of the default
+  /// `InteractionForce` for each pair of interaction types
+  /// (see `Agent::SetInteractionType`).\n
+  /// For `n` interaction types the table has `n * n` entries in row-major
+  /// order: the entry at index `lhs_type * n + rhs_type` is used for the
+  /// force on an agent of type `lhs_type` from an agent of type `rhs_type`.
+  /// An empty table uses the default value for all pairs. Agents whose type
+  /// is outside of the table use the parameters of type 0.
+  /// The table must be symmetric if `mechanics_pairwise` is enabled or
+  /// `mechanics_integrator` is `"implicit"`.\n
+  /// Default value: `[]` (`2` for all pairs)\n
+  /// TOML config file:
+  ///
+  ///     [simulation]
+  ///     interaction_force_repulsion = [2.0, 1.5, 1.5, 2.0]
+  std::vector<double> interaction_force_repulsion;
+
+  /// Attraction coefficient of the sphere-sphere force of the default
+  /// `InteractionForce` for each pair of interaction types.
+  /// Same layout as `interaction_force_repulsion`.\n
+  /// Default value: `[]` (`1` for all pairs)\n
+  /// TOML config file:
+  ///
+  ///     [simulation]
+  ///     interaction_force_attraction = [1.0, 0.2, 0.2, 1.0]
+  std::vector<double> interaction_force_attraction;
+
+  /// Coefficient that determines the additional radius of spheres for a
+  /// distant interaction (`10 * coefficient`), for each pair of interaction
+  /// types. Same layout as `interaction_force_repulsion`.\n
+  /// Default value: `[]` (`0.15` for all pairs)\n
+  /// TOML config file:
+  ///
+  ///     [simulation]
+  ///     interaction_force_iof_coefficient = [0.15, 0.1, 0.1, 0.15]
+  std::vector<double> interaction_force_iof_coefficient;
+
+  /// Integrator of the operation "mechanical forces".\n
+  /// `"explicit"`: explicit first-order update of each agent
+  /// (`MechanicalForcesOp`).\n
+  /// `"implicit"`: semi-implicit update of spherical agents over the contact
+  /// graph (`MechanicalForcesOpImplicit`). Stable for larger values of
+  /// `simulation_time_step`.\n
+  /// Other values are rejected by `Validate`.\n
+  /// Default value: `"explicit"`\n
+  /// TOML config file:
+  ///
+  ///     [simulation]
+  ///     mechanics_integrator = "explicit"
+  std::string mechanics_integrator = "explicit";
+
+  /// Number of Jacobi iterations per time step of the implicit mechanics
+  /// integrator (see `mechanics_integrator`).\n
+  /// Default value: `5`\n
+  /// TOML config file:
+  ///
+  ///     [simulation]
+  ///     mechanics_implicit_iterations = 5
+  uint64_t mechanics_implicit_iterations = 5;
+
+  /// Number of sub-cycles of the operation "mechanical forces" per
+  /// execution. Each sub-cycle advances the agents by
+  /// `simulation_time_step / mechanics_sub_cycles` (see
+  /// `Operation::SetSubCycles`). The environment is updated between two
+  /// sub-cycles.\n
+  /// Default value: `1`\n
+  /// TOML config file:
+  ///
+  ///     [simulation]
+  ///     mechanics_sub_cycles = 1
+  uint64_t mechanics_sub_cycles = 1;
+
+  /// Number of sub-cycles of the operation "diffusion" per execution (see
+  /// `Operation::SetSubCycles`).\n
+  /// Default value: `1`\n
+  /// TOML config file:
+  ///
+  ///     [simulation]
+  ///     diffusion_sub_cycles = 1
+  uint64_t diffusion_sub_cycles = 1;
+
   enum BoundSpaceMode {
     /// The simulation space grows to encapsulate all agents.
     kOpen = 0,
@@ -243,7 +352,11 @@ struct Param {
   std::string diffusion_boundary_condition = "open";
 
   /// A string for determining diffusion type within the simulation space.
-  /// current inputs include "euler" and "runge-kutta".
+  /// current inputs include "euler", "runge-kutta", "adi", and "amr". The
+  /// explicit methods "euler", "runge-kutta", and "amr" require
+  /// `dt * diffusion_coefficient / box_length^2 < 1/6`. The implicit method
+  /// "adi" (see `AdiGrid`) has no such limit. "amr" (see `AmrGrid`) refines
+  /// the "euler" grid around agents and steep gradients.
   /// Default value: `"euler"`\n
   /// TOML config file:
   ///
@@ -253,6 +366,90 @@ struct Param {
 
   std::string diffusion_method = "euler";
 
+  /// Weight of the implicit part of the "adi" diffusion method (see
+  /// `AdiGrid`). `1` (backward Euler) is unconditionally stable and does not
+  /// produce negative concentrations. `0.5` (Crank-Nicolson) is second-order
+  /// accurate in time, but oscillates if the time step exceeds the explicit
+  /// stability limit by far. Values must be in [0.5, 1].\n
+  /// Default value: `1`\n
+  /// TOML config file:
+  ///
+  ///     [simulation]
+  ///     diffusion_implicit_theta = 1
+  double diffusion_implicit_theta = 1;
+
+  /// Number of explicit substeps of `dt / diffusion_substeps` into which the
+  /// "euler" method splits each diffusion step. All substeps are advanced in
+  /// a single pass over the grid (temporal blocking, see
+  /// `EulerGrid::DiffuseWithClosedEdge`). Larger values relax the
+  /// stability limit of the time step and, for large grids, shift the
+  /// stencil from being memory bound towards being compute bound.\n
+  /// Default value: `1`\n
+  /// TOML config file:
+  ///
+  ///     [simulation]
+  ///     diffusion_substeps = 1
+  uint64_t diffusion_substeps = 1;
+
+  /// If larger than zero, the "euler" method skips tiles of the grid that
+  /// have converged: a tile whose concentrations, and those of its
+  /// neighboring tiles, changed by less than this value in the last step is
+  /// not updated (and its gradient not recalculated) until a neighboring
+  /// tile changes again or the concentration inside the tile is changed
+  /// (e.g. by secretion). Tiles next to an updated tile are always updated
+  /// as well, so no substance is lost at tile borders. A skipped tile is
+  /// updated again once the change of its last update, summed over the
+  /// skipped steps, reaches this value. Only applies to single substeps (see
+  /// `diffusion_substeps`).\n
+  /// Default value: `0` (disabled)\n
+  /// TOML config file:
+  ///
+  ///     [simulation]
+  ///     diffusion_convergence_tolerance = 0
+  double diffusion_convergence_tolerance = 0;
+
+  /// Fraction of extra boxes that is added to an axis of a diffusion grid
+  /// when it grows with the environment (see `DiffusionGrid::Update`). Half
+  /// of the extra boxes are added on each side. E.g. a value of 0.5 grows an
+  /// axis that needs 40 boxes to 60 boxes. Larger values reduce the number of
+  /// reallocations of the grid for a steadily growing environment at the
+  /// cost of memory and diffusion time. Negative values are rejected by
+  /// `Validate`.\n
+  /// Default value: `0`\n
+  /// TOML config file:
+  ///
+  ///     [simulation]
+  ///     diffusion_grid_headroom = 0
+  double diffusion_grid_headroom = 0;
+
+  /// Number of boxes along each axis of the blocks that the "amr" diffusion
+  /// method (see `AmrGrid`) refines.\n
+  /// Default value: `8`\n
+  /// TOML config file:
+  ///
+  ///     [simulation]
+  ///     diffusion_amr_block_size = 8
+  uint64_t diffusion_amr_block_size = 8;
+
+  /// The "amr" diffusion method refines each block that contains at least
+  /// this many agents. `0` disables this criterion.\n
+  /// Default value: `1`\n
+  /// TOML config file:
+  ///
+  ///     [simulation]
+  ///     diffusion_amr_agent_threshold = 1
+  uint64_t diffusion_amr_agent_threshold = 1;
+
+  /// The "amr" diffusion method refines each block in which the magnitude of
+  /// a component of the concentration gradient reaches this value. `0`
+  /// disables this criterion.\n
+  /// Default value: `0`\n
+  /// TOML config file:
+  ///
+  ///     [simulation]
+  ///     diffusion_amr_gradient_threshold = 0
+  double diffusion_amr_gradient_threshold = 0;
+
   /// Calculate the diffusion gradient for each substance.\n
   /// TOML config file:
   /// Default value: `true`\n
@@ -261,6 +458,25 @@ struct Param {
   ///     calculate_gradients = true
   bool calculate_gradients = true;
 
+  /// If true, the diffusion grids do not store the gradients. Instead,
+  /// `DiffusionGrid::GetGradient` computes the gradient of the requested box
+  /// from the concentrations when it is called. This saves the memory of the
+  /// gradients and the sweep over all boxes in each step (see
+  /// `calculate_gradients`), which pays off if only few boxes are queried.
+  /// The gradients are not exported for visualization.
+  /// The computed gradients are based on the current concentrations and
+  /// therefore include substance secreted earlier in the same step, whereas
+  /// stored gradients are only updated after the diffusion step. The two
+  /// modes only agree if the concentrations did not change since then.
+  /// If `calculate_gradients` is false, the gradients are zero in both
+  /// modes.\n
+  /// Default value: `false`\n
+  /// TOML config file:
+  ///
+  ///     [simulation]
+  ///     diffusion_lazy_gradients = false
+  bool diffusion_lazy_gradients = false;
+
   /// List of thread-safety mechanisms \n
   /// `kNone`: \n
   /// `kUserSpecified`: The user has to define all agent that must
@@ -459,6 +675,15 @@ struct Param {
   /// on. However, the detection mechanism introduces an overhead. For dynamic
   /// simulations where agents move and grow, the overhead outweighs the
   /// benefits.\n
+  /// If turned on, the operation "mechanical forces" skips static agents
+  /// within the regular pass over all agents. To iterate only over the
+  /// non-static agents (see `ResourceManager::GetActiveAgents`) instead,
+  /// restrict the operation with
+  /// `op->SetAgentSubset(scheduler->GetNonStaticAgents())`. The list of
+  /// non-static agents is only built in iterations in which such an operation
+  /// is executed. Restricted operations run in a separate pass, which changes
+  /// the results if agents observe the updates of their neighbors (e.g. with
+  /// `CopyExecutionContext`).\n
   /// Default value: `false`\n
   /// TOML config file:
   ///
@@ -476,6 +701,23 @@ struct Param {
   ///     cache_neighbors = false
   bool cache_neighbors = false;
 
+  /// Calculate the mechanical forces between two agents only once per pair
+  /// and apply the opposite force to the neighbor (Newton's third law).
+  /// Roughly halves the number of force calculations.\n
+  /// Only supported by the `UniformGridEnvironment` and by agents for which
+  /// `Agent::SupportsPairwiseForces` returns true (e.g. `Cell`). Requires
+  /// that the interaction force is antisymmetric. Forces are calculated from
+  /// the agent positions and sizes at the beginning of the iteration, before
+  /// the behaviors are executed. Hence, changes made by behaviors (e.g.
+  /// growth) affect the forces one iteration later than without this option.
+  /// \see `MechanicalForcesOp`\n
+  /// Default value: `false`\n
+  /// TOML config file:
+  ///
+  ///     [performance]
+  ///     mechanics_pairwise = false
+  bool mechanics_pairwise = false;
+
   /// If the utilization in the AgentUidMap inside ResourceManager falls below
   /// this watermark, defragmentation will be turned on.\n
   /// Default value: `0.5`\n
@@ -571,6 +813,30 @@ struct Param {
   Param::MappedDataArrayMode mapped_data_array_mode =
       MappedDataArrayMode::kZeroCopy;
 
+  /// Pins the OpenMP threads to CPUs. This ensures that threads do not
+  /// migrate between NUMA nodes, without relying on `OMP_PROC_BIND`.\n
+  /// Possible values: none, compact, scatter, list\n
+  /// `compact`: fill one NUMA node after another\n
+  /// `scatter`: distribute consecutive threads round-robin over NUMA nodes\n
+  /// `list`: use the CPUs in `thread_pinning_cpus`\n
+  /// Requires NUMA support. \see `ThreadInfo::SetPinning`\n
+  /// Default value: `none`\n
+  /// TOML config file:
+  ///
+  ///     [performance]
+  ///     thread_pinning = "none"
+  std::string thread_pinning = "none";
+
+  /// CPUs that are used if `thread_pinning` is set to `list`. OpenMP thread
+  /// `i` is pinned to CPU `thread_pinning_cpus[i % thread_pinning_cpus.size()]`
+  /// \n
+  /// Default value: `[]`\n
+  /// TOML config file:
+  ///
+  ///     [performance]
+  ///     thread_pinning_cpus = [0, 2, 4, 6]
+  std::vector<int> thread_pinning_cpus;
+
   // development values --------------------------------------------------------
   /// Statistics of profiling data; keeps track of the execution time of each
   /// operation at every timestep.\n
@@ -617,7 +883,10 @@ struct Param {
   // experimental group
 
   /// Run the simulation partially on the GPU for improved performance.
-  /// Possible values: "cpu", "cuda", "opencl"
+  /// Possible values: "cpu", "cuda", "opencl", "cpu-soa"\n
+  /// "cpu-soa" runs operations that provide a structure of arrays
+  /// implementation (e.g. "mechanical forces") with the data-parallel
+  /// algorithm of the GPU implementations on the CPU.
   /// Default value: `"cpu"`\n
   /// TOML config file:
   ///     [experimental]
@@ -35,6 +35,7 @@ ResourceManager::ResourceManager() {
   }
   agents_.resize(numa_num_configured_nodes());
   agents_lb_.resize(numa_num_configured_nodes());
+  tl_active_agents_.resize(thread_info_->GetMaxThreads());
 
   auto* param = Simulation::GetActive()->GetParam();
   if (param->export_visualization || param->insitu_visualization) {
@@ -578,6 +579,33 @@ size_t ResourceManager::GetAgentVectorCapacity(int numa_node) {
 }
 
 // -----------------------------------------------------------------------------
+void ResourceManager::ClearActiveAgents() {
+  auto max_threads = static_cast<size_t>(thread_info_->GetMaxThreads());
+  if (tl_active_agents_.size() < max_threads) {
+    tl_active_agents_.resize(max_threads);
+  }
+  for (auto& tl_agents : tl_active_agents_) {
+    tl_agents.clear();
+  }
+  active_agents_.clear();
+}
+
+void ResourceManager::AddActiveAgent(const Agent* agent) {
+  auto tid = thread_info_->GetMyThreadId();
+  assert(static_cast<size_t>(tid) < tl_active_agents_.size());
+  tl_active_agents_[tid].push_back(uid_ah_map_[agent->GetUid()]);
+}
+
+const std::vector<AgentHandle>& ResourceManager::GetActiveAgents() {
+  // Merge agents that have been added since the last call
+  for (auto& tl_agents : tl_active_agents_) {
+    active_agents_.insert(active_agents_.end(), tl_agents.begin(),
+                          tl_agents.end());
+    tl_agents.clear();
+  }
+  return active_agents_;
+}
+
 void ResourceManager::SwapAgents(std::vector<std::vector<Agent*>>* agents) {
   agents_.swap(*agents);
 }
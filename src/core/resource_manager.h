@@ -32,6 +32,7 @@
 #include "core/agent/agent_handle.h"
 #include "core/agent/agent_uid.h"
 #include "core/agent/agent_uid_generator.h"
+#include "core/bond_network.h"
 #include "core/container/agent_uid_map.h"
 #include "core/diffusion/diffusion_grid.h"
 #include "core/functor.h"
@@ -307,6 +308,8 @@ class ResourceManager {
     if (type_index_) {
       type_index_->Clear();
     }
+    ClearActiveAgents();
+    bond_network_.Clear();
   }
 
   /// Reorder agents such that, agents are distributed to NUMA
@@ -421,6 +424,42 @@ class ResourceManager {
 
   const TypeIndex* GetTypeIndex() const { return type_index_; }
 
+  /// Creates the type index if it does not exist yet. By default, it is only
+  /// created if visualization is enabled.\n
+  /// NB: This method is not thread-safe!
+  const TypeIndex* EnableTypeIndex() {
+    if (!type_index_) {
+      type_index_ = new TypeIndex();
+      for (auto& numa_agents : agents_) {
+        for (auto* agent : numa_agents) {
+          type_index_->Add(agent);
+        }
+      }
+    }
+    return type_index_;
+  }
+
+  /// Removes all agents from the list of active agents.\n
+  /// Called by `NonStaticAgentSubset` before it rebuilds the list.
+  void ClearActiveAgents();
+
+  /// Adds `agent` to the list of active agents. Thread-safe.\n
+  /// Called by `NonStaticAgentSubset` for each agent that is not static in
+  /// the current iteration.
+  void AddActiveAgent(const Agent* agent);
+
+  /// Returns the persistent bonds between agents (see `BondNetwork`).
+  BondNetwork* GetBondNetwork() { return &bond_network_; }
+
+  /// Returns the handles of all agents that are not static in the current
+  /// iteration. Agent operations can iterate over this list instead of
+  /// checking `Agent::IsStatic` for each agent (see `NonStaticAgentSubset`).
+  /// The list is only built if `Param::detect_static_agents` is enabled and
+  /// an operation restricted to `Scheduler::GetNonStaticAgents` is executed
+  /// in the current iteration. It is valid until the next time agents are
+  /// added, removed, or load balanced.
+  const std::vector<AgentHandle>& GetActiveAgents();
+
  protected:
   /// Adding and removing agents does not immediately reflect in the state of
   /// the environment. This function sets a flag in the envrionment such that
@@ -435,11 +474,18 @@ class ResourceManager {
   std::vector<std::vector<Agent*>> agents_lb_;  //!
   /// Maps a diffusion grid ID to the pointer to the diffusion grid
   std::unordered_map<uint64_t, DiffusionGrid*> diffusion_grids_;
+  /// Bonds between agents
+  BondNetwork bond_network_;
 
   ThreadInfo* thread_info_ = ThreadInfo::GetInstance();  //!
 
   TypeIndex* type_index_ = nullptr;
 
+  /// Thread-local lists of active agents (see `AddActiveAgent`)
+  std::vector<std::vector<AgentHandle>> tl_active_agents_;  //!
+  /// Compact list of active agents (see `GetActiveAgents`)
+  std::vector<AgentHandle> active_agents_;  //!
+
   struct ParallelRemovalAuxData {
     std::vector<std::vector<uint64_t>> to_right;
     std::vector<std::vector<uint64_t>> not_to_left;
@@ -450,7 +496,7 @@ class ResourceManager {
 
   friend class SimulationBackup;
   friend std::ostream& operator<<(std::ostream& os, const ResourceManager& rm);
-  BDM_CLASS_DEF_NV(ResourceManager, 2);
+  BDM_CLASS_DEF_NV(ResourceManager, 3);
 };
 
 inline std::ostream& operator<<(std::ostream& os, const ResourceManager& rm) {
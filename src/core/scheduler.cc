@@ -18,6 +18,7 @@
 #include <string>
 #include <utility>
 #include "core/execution_context/in_place_exec_ctxt.h"
+#include "core/operation/agent_subset.h"
 #include "core/operation/bound_space_op.h"
 #include "core/operation/diffusion_op.h"
 #include "core/operation/mechanical_forces_op.h"
@@ -40,6 +41,7 @@ Scheduler::Scheduler() {
     restore_point_ = backup_->GetSimulationStepsFromBackup();
   }
   root_visualization_ = new RootAdaptor();
+  non_static_agents_ = new NonStaticAgentSubset();
 
   // Operations are scheduled in the following order (sub categorated by their
   // operation implementation type, so that actual order may vary)
@@ -112,6 +114,17 @@ Scheduler::Scheduler() {
     ScheduleOp(NewOperation(def_op), OpType::kPostSchedule);
   }
 
+  if (param->mechanics_sub_cycles != 1) {
+    for (auto* op : GetOps("mechanical forces")) {
+      op->SetSubCycles(param->mechanics_sub_cycles, true);
+    }
+  }
+  if (param->diffusion_sub_cycles != 1) {
+    for (auto* op : GetOps("diffusion")) {
+      op->SetSubCycles(param->diffusion_sub_cycles);
+    }
+  }
+
   if (!GetOps("visualize").empty()) {
     GetOps("visualize")[0]->GetImplementation<VisualizationOp>()->Initialize();
   }
@@ -125,6 +138,7 @@ Scheduler::~Scheduler() {
   delete backup_;
   delete root_visualization_;
   delete progress_bar_;
+  delete non_static_agents_;
 }
 
 void Scheduler::Simulate(uint64_t steps) {
@@ -159,7 +173,9 @@ void Scheduler::FinalizeInitialization() {
 
 uint64_t Scheduler::GetSimulatedSteps() const { return total_steps_; }
 
-double Scheduler::GetSimulatedTime() const { return simulated_time_; }
+double Scheduler::GetSimulatedTime() const {
+  return std::max(simulated_time_ + sub_cycle_time_offset_, 0.0);
+}
 
 TimingAggregator* Scheduler::GetOpTimes() { return &op_times_; }
 
@@ -248,6 +264,23 @@ const std::vector<Functor<bool, Agent*>*>& Scheduler::GetAgentFilters() const {
   return agent_filters_;
 }
 
+// -----------------------------------------------------------------------------
+// Returns true if `op` must be executed in a separate pass over its subset
+static bool RunsOnSubset(Operation* op) {
+  auto* subset = op->GetAgentSubset();
+  return subset != nullptr && !subset->ContainsAllAgents();
+}
+
+// -----------------------------------------------------------------------------
+bool Scheduler::UsesAgentSubsets() const {
+  for (auto* op : scheduled_agent_ops_) {
+    if (RunsOnSubset(op)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 struct RunAllScheduledOps : Functor<void, Agent*, AgentHandle> {
   explicit RunAllScheduledOps(std::vector<Operation*>& scheduled_ops)
       : scheduled_ops_(scheduled_ops) {
@@ -264,7 +297,8 @@ struct RunAllScheduledOps : Functor<void, Agent*, AgentHandle> {
 
 void Scheduler::SetUpOps() {
   ForEachScheduledOperation([&](Operation* op) {
-    if (op->frequency_ != 0 && total_steps_ % op->frequency_ == 0) {
+    // Sub-cycled operations are set up in `RunSubCycles`
+    if (op->IsDue(total_steps_) && op->sub_cycles_ == 1) {
       Timing::Time(op->name_, [&]() { op->SetUp(); });
     }
   });
@@ -272,7 +306,7 @@ void Scheduler::SetUpOps() {
 
 void Scheduler::TearDownOps() {
   ForEachScheduledOperation([&](Operation* op) {
-    if (op->frequency_ != 0 && total_steps_ % op->frequency_ == 0) {
+    if (op->IsDue(total_steps_) && op->sub_cycles_ == 1) {
       Timing::Time(op->name_, [&]() { op->TearDown(); });
     }
   });
@@ -287,58 +321,151 @@ void Scheduler::RunPreScheduledOps() {
 }
 
 // -----------------------------------------------------------------------------
-void Scheduler::RunAgentOps(Functor<bool, Agent*>* filter) {
+void Scheduler::RunAgentOps() {
+  auto run = [&](const std::vector<Operation*>& ops) {
+    if (agent_filters_.size() == 0) {
+      RunAgentOps(ops, nullptr);
+    } else {
+      for (auto* filter : agent_filters_) {
+        RunAgentOps(ops, filter);
+      }
+    }
+  };
+  // Sub-cycled operations split the agent operations into segments that are
+  // executed in the scheduled order.
+  std::vector<Operation*> segment;
+  bool executed = false;
+  for (auto* op : scheduled_agent_ops_) {
+    if (op->sub_cycles_ == 1 || !op->IsDue(total_steps_)) {
+      segment.push_back(op);
+      continue;
+    }
+    if (!segment.empty()) {
+      run(segment);
+      segment.clear();
+    }
+    std::vector<Operation*> sub_cycled_op = {op};
+    RunSubCycles(op, [&]() { run(sub_cycled_op); });
+    executed = true;
+  }
+  if (!segment.empty() || !executed) {
+    run(segment);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void Scheduler::RunAgentOps(const std::vector<Operation*>& ops,
+                            Functor<bool, Agent*>* filter) {
+  // Consecutive operations that run on the same agents are executed in one
+  // pass. Hence, operations that are restricted to a subset split the list of
+  // operations into multiple passes, but keep their order.
+  std::vector<Operation*> agent_ops;
+  AgentSubset* subset = nullptr;
+  bool executed = false;
+  for (auto* op : ops) {
+    if (!op->IsDue(total_steps_) || op->IsExcluded(filter)) {
+      continue;
+    }
+    auto* op_subset = RunsOnSubset(op) ? op->GetAgentSubset() : nullptr;
+    if (!agent_ops.empty() && op_subset != subset) {
+      RunAgentOps(agent_ops, subset, filter);
+      agent_ops.clear();
+      executed = true;
+    }
+    subset = op_subset;
+    agent_ops.push_back(op);
+  }
+  if (!agent_ops.empty() || !executed) {
+    RunAgentOps(agent_ops, subset, filter);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void Scheduler::RunAgentOps(const std::vector<Operation*>& agent_ops,
+                            AgentSubset* subset,
+                            Functor<bool, Agent*>* filter) {
   auto* sim = Simulation::GetActive();
   auto* rm = sim->GetResourceManager();
   auto* param = sim->GetParam();
   auto batch_size = param->scheduling_batch_size;
 
-  std::vector<Operation*> agent_ops;
-  for (auto* op : scheduled_agent_ops_) {
-    if (op->frequency_ != 0 && total_steps_ % op->frequency_ == 0 &&
-        !op->IsExcluded(filter)) {
-      agent_ops.push_back(op);
+  auto for_each_agent = [&](Functor<void, Agent*, AgentHandle>& functor) {
+    if (subset != nullptr) {
+      subset->ForEachAgentParallel(batch_size, functor, filter);
+    } else {
+      rm->ForEachAgentParallel(batch_size, functor, filter);
     }
-  }
+  };
 
   const auto& all_exec_ctxts = sim->GetAllExecCtxts();
   all_exec_ctxts[0]->SetupAgentOpsAll(all_exec_ctxts);
 
   if (param->execution_order == Param::ExecutionOrder::kForEachAgentForEachOp) {
-    RunAllScheduledOps functor(agent_ops);
-    Timing::Time("agent ops", [&]() {
-      rm->ForEachAgentParallel(batch_size, functor, filter);
-    });
+    std::vector<Operation*> ops = agent_ops;
+    RunAllScheduledOps functor(ops);
+    Timing::Time("agent ops", [&]() { for_each_agent(functor); });
   } else {
     for (auto* op : agent_ops) {
-      decltype(agent_ops) ops = {op};
+      std::vector<Operation*> ops = {op};
       RunAllScheduledOps functor(ops);
-      Timing::Time(op->name_, [&]() {
-        rm->ForEachAgentParallel(batch_size, functor, filter);
-      });
+      Timing::Time(op->name_, [&]() { for_each_agent(functor); });
     }
   }
 
   all_exec_ctxts[0]->TearDownAgentOpsAll(all_exec_ctxts);
 }
 
+// -----------------------------------------------------------------------------
+void Scheduler::RunSubCycles(Operation* op, const std::function<void()>& run) {
+  auto* env = Simulation::GetActive()->GetEnvironment();
+  auto num_sub_cycles = op->sub_cycles_;
+  auto time_step = op->GetTimeStep();
+  for (size_t i = 0; i < num_sub_cycles; ++i) {
+    sub_cycle_ = i;
+    sub_cycle_time_offset_ = -time_step * (num_sub_cycles - 1 - i);
+    Timing::Time(op->name_, [&]() { op->SetUp(); });
+    run();
+    Timing::Time(op->name_, [&]() { op->TearDown(); });
+    if (op->sub_cycle_update_environment_ && i + 1 != num_sub_cycles) {
+      env->ForcedUpdate();
+    }
+  }
+  sub_cycle_ = 0;
+  sub_cycle_time_offset_ = 0;
+}
+
+// -----------------------------------------------------------------------------
+void Scheduler::UpdateAgentSubsets() {
+  std::vector<AgentSubset*> updated;
+  for (auto* op : scheduled_agent_ops_) {
+    auto* subset = op->GetAgentSubset();
+    if (subset == nullptr || !op->IsDue(total_steps_) ||
+        std::find(updated.begin(), updated.end(), subset) != updated.end()) {
+      continue;
+    }
+    subset->Update();
+    updated.push_back(subset);
+  }
+}
+
 // -----------------------------------------------------------------------------
 void Scheduler::RunScheduledOps() {
+  UpdateAgentSubsets();
   SetUpOps();
 
   // Run the agent operations
-  if (agent_filters_.size() == 0) {
-    RunAgentOps(nullptr);
-  } else {
-    for (auto* filter : agent_filters_) {
-      RunAgentOps(filter);
-    }
-  }
+  RunAgentOps();
 
   // Run the column-wise operations
   for (auto* op : scheduled_standalone_ops_) {
-    if (op->frequency_ != 0 && total_steps_ % op->frequency_ == 0) {
+    if (!op->IsDue(total_steps_)) {
+      continue;
+    }
+    if (op->sub_cycles_ == 1) {
       Timing::Time(op->name_, [&]() { (*op)(); });
+    } else {
+      RunSubCycles(op,
+                   [&]() { Timing::Time(op->name_, [&]() { (*op)(); }); });
     }
   }
 
@@ -487,14 +614,21 @@ void Scheduler::ScheduleOps() {
     auto op_type = it->first;
     auto* op = it->second;
 
-    // Enable GPU operation implementations (if available) if CUDA or OpenCL
-    // flags are set
-    if (param->compute_target == "cuda" &&
+    // Enable the implicit mechanics integrator if requested. Otherwise,
+    // enable GPU operation implementations (if available) if CUDA or OpenCL
+    // flags are set, or the structure of arrays CPU implementations
+    if (param->mechanics_integrator == "implicit" &&
+        op->IsComputeTargetSupported(kCpuImplicit)) {
+      op->SelectComputeTarget(kCpuImplicit);
+    } else if (param->compute_target == "cuda" &&
         op->IsComputeTargetSupported(kCuda)) {
       op->SelectComputeTarget(kCuda);
     } else if (param->compute_target == "opencl" &&
                op->IsComputeTargetSupported(kOpenCl)) {
       op->SelectComputeTarget(kOpenCl);
+    } else if (param->compute_target == "cpu-soa" &&
+               op->IsComputeTargetSupported(kCpuSoa)) {
+      op->SelectComputeTarget(kCpuSoa);
     } else {
       op->SelectComputeTarget(kCpu);
     }
@@ -539,6 +673,11 @@ void Scheduler::ScheduleOps() {
   label:
     it = unschedule_ops_.erase(it);
   }
+
+  // Adapt the frequency of operations before the due operations are
+  // determined for this iteration
+  ForEachOperation(
+      [&](Operation* op) { op->UpdateFrequency(total_steps_); });
 }
 
 }  // namespace bdm
@@ -33,6 +33,8 @@ namespace bdm {
 
 class SchedulerTest;
 class Agent;
+class AgentSubset;
+class NonStaticAgentSubset;
 class SimulationBackup;
 class VisualizationAdaptor;
 class RootAdaptor;
@@ -76,9 +78,22 @@ class Scheduler {
   uint64_t GetSimulatedSteps() const;
 
   /// This function returns the time that has been simulated until this
-  /// point of the simulation.
+  /// point of the simulation. During the sub-cycles of an operation (see
+  /// `Operation::SetSubCycles`) the time is interpolated: it includes
+  /// `GetSubCycleTimeOffset()` and is clamped to zero.
   double GetSimulatedTime() const;
 
+  /// Returns the index of the sub-cycle that is currently executed, or zero
+  /// if no sub-cycled operation is running.
+  size_t GetSubCycle() const { return sub_cycle_; }
+
+  /// Returns the (non-positive) time offset of the sub-cycle that is
+  /// currently executed relative to the end of the operation's time step.
+  /// Zero for the last sub-cycle, and if no sub-cycled operation is running.
+  /// Operations that compute their time step from the elapsed time add this
+  /// offset to obtain the time step of the sub-cycle.
+  double GetSubCycleTimeOffset() const { return sub_cycle_time_offset_; }
+
   /// Adds the given operation to the list of to be scheduled
   /// operations.
   /// Scheduler takes over ownership of the object `op`.
@@ -99,6 +114,18 @@ class Scheduler {
 
   const std::vector<Functor<bool, Agent*>*>& GetAgentFilters() const;
 
+  /// Returns the subset of agents that are not static in the current
+  /// iteration. Agent operations can be restricted to it with
+  /// `Operation::SetAgentSubset`.
+  ///
+  ///     op->SetAgentSubset(scheduler->GetNonStaticAgents());
+  /// \see NonStaticAgentSubset
+  NonStaticAgentSubset* GetNonStaticAgents() { return non_static_agents_; }
+
+  /// Returns true if at least one scheduled agent operation is restricted to
+  /// a subset of agents (see `Operation::SetAgentSubset`).
+  bool UsesAgentSubsets() const;
+
   RootAdaptor* GetRootVisualization() { return root_visualization_; }
 
   TimingAggregator* GetOpTimes();
@@ -158,6 +185,14 @@ class Scheduler {
   /// agent operations will be executed for each agents in the simulation.
   std::vector<Functor<bool, Agent*>*> agent_filters_;  //!
 
+  /// Subset of agents that are not static in the current iteration
+  NonStaticAgentSubset* non_static_agents_ = nullptr;  //!
+
+  /// Index of the sub-cycle that is currently executed
+  size_t sub_cycle_ = 0;  //!
+  /// See `GetSubCycleTimeOffset`
+  double sub_cycle_time_offset_ = 0;  //!
+
   /// Backup the simulation. Backup interval based on `Param::backup_interval`
   void Backup();
 
@@ -214,7 +249,27 @@ class Scheduler {
   // Run the operations in pre_scheduled_ops_ (executed before RunScheduledOps)
   void RunPreScheduledOps();
 
-  void RunAgentOps(Functor<bool, Agent*>* filter);
+  /// Runs all scheduled agent operations that are due for each agent filter.
+  /// Sub-cycled operations are executed separately, in the order in which
+  /// they have been scheduled.
+  void RunAgentOps();
+
+  void RunAgentOps(const std::vector<Operation*>& ops,
+                   Functor<bool, Agent*>* filter);
+
+  /// Runs `agent_ops` for all agents in `subset`, or all agents in the
+  /// simulation if `subset` is a nullptr.
+  void RunAgentOps(const std::vector<Operation*>& agent_ops,
+                   AgentSubset* subset, Functor<bool, Agent*>* filter);
+
+  /// Executes the `Operation::sub_cycles_` sub-cycles of `op`. `run`
+  /// executes one sub-cycle. `SetUp` and `TearDown` are called for each
+  /// sub-cycle.
+  void RunSubCycles(Operation* op, const std::function<void()>& run);
+
+  /// Calls `AgentSubset::Update` for each subset that is used by an agent
+  /// operation that will be executed in this iteration.
+  void UpdateAgentSubsets();
 
   // Run the operations in post_scheduled_ops_ (executed after RunScheduledOps)
   void RunPostScheduledOps();
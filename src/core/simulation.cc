@@ -41,6 +41,7 @@
 #include "core/param/param.h"
 #include "core/resource_manager.h"
 #include "core/scheduler.h"
+#include "core/util/counter_based_random.h"
 #include "core/util/filesystem.h"
 #include "core/util/io.h"
 #include "core/util/log.h"
@@ -336,6 +337,16 @@ void Simulation::InitializeMembers() {
                                  param_->mem_mgr_max_mem_per_thread_factor);
   }
   agent_uid_generator_ = new AgentUidGenerator();
+  auto* thread_info = ThreadInfo::GetInstance();
+  auto pinning = ThreadInfo::ParsePinning(param_->thread_pinning);
+  if (pinning != thread_info->GetPinning() || pinning == ThreadInfo::kList) {
+    // verifies the placement
+    thread_info->SetPinning(pinning, param_->thread_pinning_cpus);
+  } else if (pinning != ThreadInfo::kNoPinning &&
+             !thread_info->VerifyPinning()) {
+    Log::Warning("Simulation::InitializeMembers",
+                 "Threads are not running on the CPUs they were pinned to.");
+  }
   if (param_->debug_numa) {
     std::cout << "ThreadInfo:\n" << *ThreadInfo::GetInstance() << std::endl;
   }
@@ -344,7 +355,13 @@ void Simulation::InitializeMembers() {
 #pragma omp parallel for schedule(static, 1)
   for (uint64_t i = 0; i < random_.size(); i++) {
     random_[i] = new Random();
-    random_[i]->SetSeed(param_->random_seed * (i + 1));
+    if (param_->deterministic_mode) {
+      // All threads share the seed. The stream is selected for each agent.
+      random_[i]->SetGenerator(new CounterBasedRandom(param_->random_seed));
+      random_[i]->SetStream(CounterBasedRandom::GetThreadStream(i), 0);
+    } else {
+      random_[i]->SetSeed(param_->random_seed * (i + 1));
+    }
   }
   exec_ctxt_.resize(omp_get_max_threads());
   auto map = std::make_shared<
@@ -462,8 +479,11 @@ void Simulation::InitializeRuntimeParams(
   }
 
   set_param(param_);
+  param_->Validate();
 
-  if (!is_gpu_environment_initialized_ && param_->compute_target != "cpu") {
+  if (!is_gpu_environment_initialized_ &&
+      (param_->compute_target == "cuda" ||
+       param_->compute_target == "opencl")) {
     GpuHelper::GetInstance()->InitializeGPUEnvironment();
     is_gpu_environment_initialized_ = true;
   }
@@ -0,0 +1,114 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/util/counter_based_random.h"
+
+namespace bdm {
+
+namespace {
+
+// Philox4x32 constants
+constexpr uint32_t kPhiloxM0 = 0xD2511F53;
+constexpr uint32_t kPhiloxM1 = 0xCD9E8D57;
+constexpr uint32_t kPhiloxW0 = 0x9E3779B9;
+constexpr uint32_t kPhiloxW1 = 0xBB67AE85;
+constexpr int kPhiloxRounds = 10;
+
+inline void MulHiLo(uint32_t a, uint32_t b, uint32_t* hi, uint32_t* lo) {
+  uint64_t product = static_cast<uint64_t>(a) * static_cast<uint64_t>(b);
+  *hi = static_cast<uint32_t>(product >> 32);
+  *lo = static_cast<uint32_t>(product);
+}
+
+}  // namespace
+
+// -----------------------------------------------------------------------------
+CounterBasedRandom::CounterBasedRandom(uint64_t seed) : seed_(seed) {}
+
+// -----------------------------------------------------------------------------
+CounterBasedRandom::~CounterBasedRandom() {}
+
+// -----------------------------------------------------------------------------
+void CounterBasedRandom::SetStream(uint64_t stream, uint64_t substream) {
+  stream_ = stream;
+  substream_ = substream;
+  block_ = 0;
+  buffer_idx_ = 4;
+}
+
+// -----------------------------------------------------------------------------
+Double_t CounterBasedRandom::Rndm() {
+  // Combine two 32-bit numbers to a 53-bit mantissa. Adding 0.5 excludes zero
+  // from the interval, as for the other TRandom implementations.
+  uint64_t a = Next32() >> 5;
+  uint64_t b = Next32() >> 6;
+  return ((a << 26) + b + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+// -----------------------------------------------------------------------------
+void CounterBasedRandom::RndmArray(Int_t n, Float_t* array) {
+  for (Int_t i = 0; i < n; ++i) {
+    array[i] = static_cast<Float_t>(Rndm());
+  }
+}
+
+// -----------------------------------------------------------------------------
+void CounterBasedRandom::RndmArray(Int_t n, Double_t* array) {
+  for (Int_t i = 0; i < n; ++i) {
+    array[i] = Rndm();
+  }
+}
+
+// -----------------------------------------------------------------------------
+void CounterBasedRandom::SetSeed(ULong_t seed) {
+  seed_ = seed;
+  SetStream(stream_, substream_);
+}
+
+// -----------------------------------------------------------------------------
+UInt_t CounterBasedRandom::GetSeed() const {
+  return static_cast<UInt_t>(seed_);
+}
+
+// -----------------------------------------------------------------------------
+void CounterBasedRandom::NextBlock() {
+  // counter: stream, lower half of the substream, and block index
+  // key: seed mixed with the upper half of the substream
+  uint32_t c0 = static_cast<uint32_t>(stream_);
+  uint32_t c1 = static_cast<uint32_t>(stream_ >> 32);
+  uint32_t c2 = static_cast<uint32_t>(substream_);
+  uint32_t c3 = block_++;
+  uint32_t k0 = static_cast<uint32_t>(seed_);
+  uint32_t k1 = static_cast<uint32_t>(seed_ >> 32) ^
+                static_cast<uint32_t>(substream_ >> 32);
+
+  for (int r = 0; r < kPhiloxRounds; ++r) {
+    uint32_t hi0, lo0, hi1, lo1;
+    MulHiLo(kPhiloxM0, c0, &hi0, &lo0);
+    MulHiLo(kPhiloxM1, c2, &hi1, &lo1);
+    c0 = hi1 ^ c1 ^ k0;
+    c1 = lo1;
+    c2 = hi0 ^ c3 ^ k1;
+    c3 = lo0;
+    k0 += kPhiloxW0;
+    k1 += kPhiloxW1;
+  }
+  buffer_[0] = c0;
+  buffer_[1] = c1;
+  buffer_[2] = c2;
+  buffer_[3] = c3;
+  buffer_idx_ = 0;
+}
+
+}  // namespace bdm
@@ -0,0 +1,88 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#ifndef CORE_UTIL_COUNTER_BASED_RANDOM_H_
+#define CORE_UTIL_COUNTER_BASED_RANDOM_H_
+
+#include <TRandom.h>
+#include <cstdint>
+#include <limits>
+#include "core/util/root.h"
+
+namespace bdm {
+
+/// Counter-based random number generator (Philox4x32-10). \n
+/// Contrary to `TRandom3`, the generator does not carry a state that depends
+/// on all previous draws. Each random number is a function of the seed, the
+/// selected stream and the position within the stream. Therefore, switching
+/// to a different stream (e.g. one stream for each agent and time step) is
+/// cheap and the generated numbers do not depend on the order in which
+/// streams are processed, or by which thread.\n
+/// All distributions of `TRandom` are supported, because they are derived from
+/// `Rndm`.
+/// \see J. K. Salmon et al., "Parallel random numbers: as easy as 1, 2, 3",
+/// SC'11
+class CounterBasedRandom : public TRandom {
+ public:
+  explicit CounterBasedRandom(uint64_t seed = 4357);
+  virtual ~CounterBasedRandom();
+
+  /// Returns the stream that is reserved for random numbers that thread `tid`
+  /// draws outside of agent operations. Does not collide with streams keyed
+  /// by a valid `AgentUid`.
+  static uint64_t GetThreadStream(int tid) {
+    return std::numeric_limits<uint64_t>::max() - tid;
+  }
+
+  /// Restarts the generator at the beginning of the stream that is identified
+  /// by `stream` and `substream`. (e.g. agent uid and time step)
+  void SetStream(uint64_t stream, uint64_t substream);
+
+  /// Returns a uniform deviate on the interval (0, 1)
+  Double_t Rndm() override;
+  void RndmArray(Int_t n, Float_t* array) override;
+  void RndmArray(Int_t n, Double_t* array) override;
+
+  /// Sets the seed and restarts the current stream.
+  void SetSeed(ULong_t seed = 0) override;
+  UInt_t GetSeed() const override;
+
+ private:
+  uint64_t seed_ = 0;
+  uint64_t stream_ = 0;
+  uint64_t substream_ = 0;
+  /// Index of the next block of four random numbers within the stream
+  uint32_t block_ = 0;
+  /// Random numbers of the current block
+  uint32_t buffer_[4];  //!
+  /// Index of the next unused element in `buffer_`
+  uint32_t buffer_idx_ = 4;  //!
+
+  /// Generates the next block of four 32-bit random numbers
+  void NextBlock();
+
+  /// Returns the next 32-bit random number
+  uint32_t Next32() {
+    if (buffer_idx_ == 4) {
+      NextBlock();
+    }
+    return buffer_[buffer_idx_++];
+  }
+
+  BDM_CLASS_DEF_OVERRIDE(CounterBasedRandom, 1);
+};
+
+}  // namespace bdm
+
+#endif  // CORE_UTIL_COUNTER_BASED_RANDOM_H_
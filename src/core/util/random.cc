@@ -18,6 +18,7 @@
 #include <TF3.h>
 #include <TRandom3.h>
 #include "core/simulation.h"
+#include "core/util/counter_based_random.h"
 
 namespace bdm {
 
@@ -54,6 +55,7 @@ Random& Random::operator=(const Random& other) {
       delete generator_;
     }
     generator_ = static_cast<TRandom*>(other.generator_->Clone());
+    counter_based_generator_ = nullptr;
   }
   return *this;
 }
@@ -124,6 +126,23 @@ void Random::SetGenerator(TRandom* new_generator) {
     delete generator_;
   }
   generator_ = new_generator;
+  counter_based_generator_ = nullptr;
+}
+
+// -----------------------------------------------------------------------------
+void Random::SetStream(uint64_t stream, uint64_t substream) {
+  // Called before each agent is executed in deterministic mode. Avoid a
+  // dynamic_cast for each call.
+  if (counter_based_generator_ == nullptr) {
+    counter_based_generator_ = dynamic_cast<CounterBasedRandom*>(generator_);
+    if (counter_based_generator_ == nullptr) {
+      Log::Fatal("Random::SetStream",
+                 "Random streams require a CounterBasedRandom generator. See "
+                 "Random::SetGenerator");
+      return;
+    }
+  }
+  counter_based_generator_->SetStream(stream, substream);
 }
 
 // -----------------------------------------------------------------------------
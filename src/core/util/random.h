@@ -27,6 +27,8 @@ class TF3;
 
 namespace bdm {
 
+class CounterBasedRandom;
+
 // -----------------------------------------------------------------------------
 /// Random number generator that generates samples from a distribution
 template <typename TSample>
@@ -342,6 +344,11 @@ class Random {
   /// for a list of available choices
   void SetGenerator(TRandom* new_rng);
 
+  /// Restarts the random number generator at the beginning of the stream
+  /// identified by `stream` and `substream`.\n
+  /// Requires a `CounterBasedRandom` generator (\see `SetGenerator`).
+  void SetStream(uint64_t stream, uint64_t substream);
+
   /// Returns a random number generator that draws samples from a
   /// uniform distribution with given parameters.
   UniformRng GetUniformRng(double min = 0, double max = 1);
@@ -423,6 +430,9 @@ class Random {
   friend class DistributionRng<int>;
 
   TRandom* generator_ = nullptr;
+  /// `generator_` if it is a `CounterBasedRandom`. Determined by the first
+  /// call to `SetStream` after the generator has been set.
+  CounterBasedRandom* counter_based_generator_ = nullptr;  //!
   /// Stores TF1 pointers that have been created for a specific user-defined
   /// 1D distribution
   std::unordered_map<UserDefinedDist, TF1*> udd_tf1_map_;  //!
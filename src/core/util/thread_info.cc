@@ -14,6 +14,11 @@
 
 #include "core/util/thread_info.h"
 
+#include <algorithm>
+#include <set>
+
+#include "core/util/log.h"
+
 namespace bdm {
 
 std::atomic<uint64_t> ThreadInfo::thread_counter_;
@@ -28,4 +33,213 @@ uint64_t ThreadInfo::GetUniversalThreadId() const {
   return kTid;
 }
 
+void ThreadInfo::SetPinning(ThreadPinning policy,
+                            const std::vector<int>& cpus) {
+#ifndef USE_NUMA
+  if (policy != kNoPinning) {
+    Log::Warning("ThreadInfo::SetPinning",
+                 "Thread pinning requires BioDynaMo to be built with NUMA "
+                 "support. Threads will not be pinned.");
+    return;
+  }
+#else
+  if (policy == kList) {
+    if (cpus.empty()) {
+      Log::Fatal("ThreadInfo::SetPinning",
+                 "Thread pinning policy 'list' requires a non-empty cpu list.");
+    }
+    for (int cpu : cpus) {
+      if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        Log::Fatal("ThreadInfo::SetPinning", "CPU ", cpu,
+                   " in the cpu list of thread pinning policy 'list' is out "
+                   "of range [0, ", CPU_SETSIZE, ").");
+      } else if (std::find(allowed_cpus_.begin(), allowed_cpus_.end(),
+                           cpu) == allowed_cpus_.end()) {
+        Log::Fatal("ThreadInfo::SetPinning", "CPU ", cpu,
+                   " in the cpu list of thread pinning policy 'list' is not "
+                   "available to this process (see "
+                   "ThreadInfo::GetAllowedCpus).");
+      }
+    }
+  }
+#endif  // USE_NUMA
+  bool was_pinned = pinning_ != kNoPinning;
+  pinning_ = policy;
+  pinning_cpus_ = cpus;
+  if (policy == kNoPinning && was_pinned) {
+    // restore the initial affinity
+    thread_cpu_.assign(omp_get_max_threads(), -1);
+    ApplyPinning();
+  }
+  Renew();
+  if (policy != kNoPinning && !VerifyPinning()) {
+    Log::Warning("ThreadInfo::SetPinning",
+                 "Threads are not running on the CPUs they were pinned to.");
+  }
+}
+
+std::vector<int> ThreadInfo::ComputePlacement(
+    ThreadPinning policy, const std::vector<int>& cpus) const {
+  int max_threads = omp_get_max_threads();
+  std::vector<int> placement(max_threads, -1);
+  if (policy == kNoPinning) {
+    return placement;
+  } else if (policy == kList) {
+    for (int t = 0; t < max_threads; ++t) {
+      placement[t] = cpus[t % cpus.size()];
+    }
+    return placement;
+  }
+
+  // group allowed cpus by numa node
+  std::vector<std::vector<int>> node_cpus(numa_num_configured_nodes());
+  for (int cpu : allowed_cpus_) {
+    auto node = numa_node_of_cpu(cpu);
+    if (node >= 0 && node < static_cast<int>(node_cpus.size())) {
+      node_cpus[node].push_back(cpu);
+    }
+  }
+  node_cpus.erase(
+      std::remove_if(node_cpus.begin(), node_cpus.end(),
+                     [](const std::vector<int>& v) { return v.empty(); }),
+      node_cpus.end());
+  if (node_cpus.empty()) {
+    Log::Fatal("ThreadInfo::ComputePlacement",
+               "Could not determine the CPUs available to this process.");
+  }
+
+  if (policy == kCompact) {
+    std::vector<int> flat;
+    for (auto& node : node_cpus) {
+      flat.insert(flat.end(), node.begin(), node.end());
+    }
+    for (int t = 0; t < max_threads; ++t) {
+      placement[t] = flat[t % flat.size()];
+    }
+  } else if (policy == kScatter) {
+    // Take one cpu from each numa node in turn. Nodes that have no unused cpu
+    // left are skipped, because numa nodes might differ in size.
+    uint64_t max_node_size = 0;
+    for (auto& node : node_cpus) {
+      max_node_size = std::max<uint64_t>(max_node_size, node.size());
+    }
+    std::vector<int> flat;
+    for (uint64_t i = 0; i < max_node_size; ++i) {
+      for (auto& node : node_cpus) {
+        if (i < node.size()) {
+          flat.push_back(node[i]);
+        }
+      }
+    }
+    for (int t = 0; t < max_threads; ++t) {
+      placement[t] = flat[t % flat.size()];
+    }
+  }
+  return placement;
+}
+
+void ThreadInfo::ApplyPinning() {
+#ifdef USE_NUMA
+  bool success = true;
+#pragma omp parallel reduction(&& : success)
+  {
+    int tid = omp_get_thread_num();
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (thread_cpu_[tid] >= 0) {
+      CPU_SET(thread_cpu_[tid], &mask);
+    } else if (static_cast<size_t>(tid) < initial_thread_cpus_.size() &&
+               !initial_thread_cpus_[tid].empty()) {
+      for (int cpu : initial_thread_cpus_[tid]) {
+        CPU_SET(cpu, &mask);
+      }
+    } else {
+      // threads that did not exist at construction
+      for (int cpu : allowed_cpus_) {
+        CPU_SET(cpu, &mask);
+      }
+    }
+    if (sched_setaffinity(0, sizeof(mask), &mask) != 0) {
+      // The thread keeps its previous affinity
+      thread_cpu_[tid] = -1;
+      success = false;
+    }
+  }
+  if (!success) {
+    Log::Error("ThreadInfo::ApplyPinning",
+               "Could not set the CPU affinity of all threads. These threads "
+               "are not pinned.");
+  }
+#endif  // USE_NUMA
+}
+
+void ThreadInfo::DetectAllowedCpus() {
+  allowed_cpus_.clear();
+  initial_thread_cpus_.clear();
+#ifdef USE_NUMA
+  std::set<int> cpus;
+  initial_thread_cpus_.resize(omp_get_max_threads());
+  auto add_affinity = [&](std::vector<int>* thread_cpus) {
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) != 0) {
+      return;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &mask)) {
+        if (thread_cpus != nullptr) {
+          thread_cpus->push_back(cpu);
+        }
+#pragma omp critical
+        cpus.insert(cpu);
+      }
+    }
+  };
+  add_affinity(nullptr);
+#pragma omp parallel
+  add_affinity(&initial_thread_cpus_[omp_get_thread_num()]);
+  allowed_cpus_.assign(cpus.begin(), cpus.end());
+#else
+  for (int cpu = 0; cpu < numa_num_configured_cpus(); ++cpu) {
+    allowed_cpus_.push_back(cpu);
+  }
+#endif  // USE_NUMA
+}
+
+bool ThreadInfo::VerifyPinning() const {
+  bool success = true;
+  int max_threads = omp_get_max_threads();
+  if (max_threads != max_threads_) {
+    return false;
+  }
+#pragma omp parallel reduction(&& : success)
+  {
+    int tid = omp_get_thread_num();
+    int cpu = sched_getcpu();
+    if (thread_cpu_[tid] >= 0 && cpu != thread_cpu_[tid]) {
+      success = false;
+    }
+    if (numa_node_of_cpu(cpu) != thread_numa_mapping_[tid]) {
+      success = false;
+    }
+  }
+  return success;
+}
+
+ThreadInfo::ThreadPinning ThreadInfo::ParsePinning(const std::string& policy) {
+  if (policy == "none") {
+    return kNoPinning;
+  } else if (policy == "compact") {
+    return kCompact;
+  } else if (policy == "scatter") {
+    return kScatter;
+  } else if (policy == "list") {
+    return kList;
+  }
+  Log::Fatal("ThreadInfo::ParsePinning", "Thread pinning policy '", policy,
+             "' does not exist. Supported values: none, compact, scatter, "
+             "list.");
+  return kNoPinning;
+}
+
 }  // namespace bdm
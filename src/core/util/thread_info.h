@@ -18,6 +18,7 @@
 #include <omp.h>
 #include <sched.h>
 #include <atomic>
+#include <string>
 #include <vector>
 
 #include "core/util/log.h"
@@ -27,9 +28,19 @@ namespace bdm {
 
 /// \brief This class stores information about each thread. (e.g. to which NUMA
 /// node it belongs to.)
-/// NB: Threads **must** be bound to CPUs using `OMP_PROC_BIND=true`.
+/// NB: Threads **must** be bound to CPUs using `OMP_PROC_BIND=true`, or
+/// pinned by BioDynaMo (see `SetPinning` and `Param::thread_pinning`).
 class ThreadInfo {
  public:
+  /// Policies to pin OpenMP threads to CPUs (see `SetPinning`).\n
+  /// `kNoPinning`: threads are not pinned by BioDynaMo\n
+  /// `kCompact`: consecutive threads are placed on consecutive CPUs. NUMA
+  ///             nodes are filled one after another.\n
+  /// `kScatter`: consecutive threads are distributed round-robin over the
+  ///             NUMA nodes.\n
+  /// `kList`: thread `i` is placed on CPU `cpus[i % cpus.size()]`.
+  enum ThreadPinning { kNoPinning = 0, kCompact, kScatter, kList };
+
   static ThreadInfo* GetInstance();
 
   ThreadInfo(const ThreadInfo&) = delete;
@@ -65,6 +76,43 @@ class ThreadInfo {
   /// Return the maximum number of threads.
   int GetMaxThreads() const { return max_threads_; }
 
+  /// Returns the CPU the given openmp thread is pinned to, or -1 if threads
+  /// are not pinned by BioDynaMo.
+  int GetCpu(int omp_thread_id) const { return thread_cpu_[omp_thread_id]; }
+
+  /// Returns the current thread pinning policy.
+  ThreadPinning GetPinning() const { return pinning_; }
+
+  /// Returns the CPUs the process was allowed to run on when ThreadInfo was
+  /// created (e.g. restricted by the job scheduler).
+  const std::vector<int>& GetAllowedCpus() const { return allowed_cpus_; }
+
+  /// Pins the OpenMP threads to CPUs according to `policy`, updates the
+  /// metadata and verifies the placement (see `VerifyPinning`). A warning is
+  /// printed if a thread does not run on its CPU.\n
+  /// `cpus` is only used for `kList`. All of them must be contained in
+  /// `GetAllowedCpus()`; otherwise, `Log::Fatal` is called. `kCompact` and
+  /// `kScatter` only use the CPUs returned by `GetAllowedCpus()`.\n
+  /// `kNoPinning` restores the CPU affinity each OpenMP thread had when
+  /// ThreadInfo was created. Threads that did not exist at that time may run
+  /// on any CPU of `GetAllowedCpus()`.\n
+  /// The policy is reapplied in `Renew()`, e.g. if the number of threads
+  /// changes.
+  void SetPinning(ThreadPinning policy, const std::vector<int>& cpus = {});
+
+  /// Returns the CPU placement of each OpenMP thread for the given policy
+  /// without applying it.
+  std::vector<int> ComputePlacement(ThreadPinning policy,
+                                    const std::vector<int>& cpus) const;
+
+  /// Checks if each OpenMP thread runs on the NUMA node (and the CPU if
+  /// threads are pinned) that is stored in the metadata.
+  bool VerifyPinning() const;
+
+  /// Converts a string ("none", "compact", "scatter", "list") to a
+  /// `ThreadPinning` policy.
+  static ThreadPinning ParsePinning(const std::string& policy);
+
   /// Returns a unique thread id even for parallel regions that
   /// don't use OpenMP.
   uint64_t GetUniversalThreadId() const;
@@ -87,10 +135,20 @@ class ThreadInfo {
     numa_thread_id_.resize(max_threads_, 0);
     threads_in_numa_.resize(numa_nodes_, 0);
 
+    // (openmp thread id -> cpu)
+    if (pinning_ != kNoPinning) {
+      thread_cpu_ = ComputePlacement(pinning_, pinning_cpus_);
+      ApplyPinning();
+    } else {
+      thread_cpu_.assign(max_threads_, -1);
+    }
+
 // (openmp thread id -> numa node)
 #pragma omp parallel
     {
       int tid = omp_get_thread_num();
+      // Use the cpu the thread actually runs on, even if it has been pinned.
+      // sched_setaffinity migrates the calling thread before it returns.
       thread_numa_mapping_[tid] = numa_node_of_cpu(sched_getcpu());
     }
 
@@ -127,6 +185,11 @@ class ThreadInfo {
     for (auto& el : ti.threads_in_numa_) {
       str << el << " ";
     }
+
+    str << "\nthread to cpu mapping\t: ";
+    for (auto& el : ti.thread_cpu_) {
+      str << el << " ";
+    }
     str << "\n";
     return str;
   }
@@ -155,6 +218,26 @@ class ThreadInfo {
   /// vector value number of threads
   std::vector<int> threads_in_numa_;
 
+  /// Contains the mapping omp_thread_id -> cpu \n
+  /// vector value: -1 if threads are not pinned by BioDynaMo
+  std::vector<int> thread_cpu_;
+
+  /// Thread pinning policy (see `SetPinning`)
+  ThreadPinning pinning_ = kNoPinning;
+  /// CPU list for `ThreadPinning::kList`
+  std::vector<int> pinning_cpus_;
+  /// CPUs the process was allowed to run on at construction
+  std::vector<int> allowed_cpus_;
+  /// CPU affinity of each OpenMP thread at construction
+  std::vector<std::vector<int>> initial_thread_cpus_;
+
+  /// Sets the CPU affinity of each OpenMP thread to `thread_cpu_`, or to
+  /// `initial_thread_cpus_` if threads are not pinned.
+  void ApplyPinning();
+
+  /// Determines `allowed_cpus_` and `initial_thread_cpus_`
+  void DetectAllowedCpus();
+
   ThreadInfo() {
     auto proc_bind = omp_get_proc_bind();
     if (proc_bind != 1 && proc_bind != 4) {
@@ -166,8 +249,10 @@ class ThreadInfo {
       Log::Warning(
           "ThreadInfo::ThreadInfo",
           "The environment variable OMP_PROC_BIND must be set to "
-          "true prior to running BioDynaMo ('export OMP_PROC_BIND=true')");
+          "true prior to running BioDynaMo ('export OMP_PROC_BIND=true'), "
+          "or threads must be pinned with Param::thread_pinning");
     }
+    DetectAllowedCpus();
     Renew();
   }
 };
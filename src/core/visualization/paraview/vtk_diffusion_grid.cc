@@ -18,17 +18,26 @@
 #include <vtkCPInputDataDescription.h>
 #include <vtkDoubleArray.h>
 #include <vtkExtentTranslator.h>
+#include <vtkFloatArray.h>
 #include <vtkNew.h>
 #include <vtkPointData.h>
 #include <vtkPoints.h>
+#include <type_traits>
 // BioDynaMo
 #include "core/param/param.h"
 #include "core/simulation.h"
+#include "core/util/log.h"
 #include "core/util/thread_info.h"
 #include "core/visualization/paraview/parallel_vti_writer.h"
 
 namespace bdm {
 
+/// VTK array that wraps the concentrations of a diffusion grid without
+/// copying them
+using vtkConcentrationArray =
+    std::conditional<std::is_same<DiffusionReal, float>::value, vtkFloatArray,
+                     vtkDoubleArray>::type;
+
 // -----------------------------------------------------------------------------
 VtkDiffusionGrid::VtkDiffusionGrid(const std::string& name,
                                    vtkCPDataDescription* data_description) {
@@ -55,15 +64,25 @@ VtkDiffusionGrid::VtkDiffusionGrid(const std::string& name,
     }
   }
 
+  // Lazy gradients are not stored (see `Param::diffusion_lazy_gradients`)
+  bool export_gradient = vd->gradient;
+  if (export_gradient && param->diffusion_lazy_gradients) {
+    Log::Warning("VtkDiffusionGrid",
+                 "The gradients of substance '", name,
+                 "' are not exported, because they are computed on demand "
+                 "(Param::diffusion_lazy_gradients).");
+    export_gradient = false;
+  }
+
   for (uint64_t i = 0; i < data_.size(); ++i) {
     // Add attribute data
     if (vd->concentration) {
-      vtkNew<vtkDoubleArray> concentration;
+      vtkNew<vtkConcentrationArray> concentration;
       concentration->SetName("Substance Concentration");
       concentration_array_idx_ =
           data_[i]->GetPointData()->AddArray(concentration.GetPointer());
     }
-    if (vd->gradient) {
+    if (export_gradient) {
       vtkNew<vtkDoubleArray> gradient;
       gradient->SetName("Diffusion Gradient");
       gradient->SetNumberOfComponents(3);
@@ -118,9 +137,9 @@ void VtkDiffusionGrid::Update(const DiffusionGrid* grid) {
     data_[0]->SetSpacing(box_length, box_length, box_length);
 
     if (concentration_array_idx_ != -1) {
-      auto* co_ptr = const_cast<double*>(grid->GetAllConcentrations());
+      auto* co_ptr = const_cast<DiffusionReal*>(grid->GetAllConcentrations());
       auto elements = static_cast<vtkIdType>(total_boxes);
-      auto* array = static_cast<vtkDoubleArray*>(
+      auto* array = static_cast<vtkConcentrationArray*>(
           data_[0]->GetPointData()->GetArray(concentration_array_idx_));
       array->SetArray(co_ptr, elements, 1);
     }
@@ -154,9 +173,9 @@ void VtkDiffusionGrid::Update(const DiffusionGrid* grid) {
     data_[i]->SetSpacing(box_length, box_length, box_length);
 
     if (concentration_array_idx_ != -1) {
-      auto* co_ptr = const_cast<double*>(grid->GetAllConcentrations());
+      auto* co_ptr = const_cast<DiffusionReal*>(grid->GetAllConcentrations());
       auto elements = static_cast<vtkIdType>(piece_elements);
-      auto* array = static_cast<vtkDoubleArray*>(
+      auto* array = static_cast<vtkConcentrationArray*>(
           data_[i]->GetPointData()->GetArray(concentration_array_idx_));
       if (i < num_pieces_ - 1) {
         array->SetArray(co_ptr + (elements * i), elements, 1);
@@ -175,6 +175,14 @@ class NeuriteElement : public Agent, public NeuronOrNeurite {
     }
   }
 
+  void RemapUids(
+      const std::unordered_map<AgentUid, AgentUid>& new_uids) override {
+    Base::RemapUids(new_uids);
+    mother_.RemapUid(new_uids);
+    daughter_left_.RemapUid(new_uids);
+    daughter_right_.RemapUid(new_uids);
+  }
+
   Shape GetShape() const override { return Shape::kCylinder; }
 
   /// Returns the data members that are required to visualize this simulation
@@ -630,6 +638,18 @@ class NeuriteElement : public Agent, public NeuronOrNeurite {
     bool& has_neurite_neighbor;
     uint64_t& non_zero_neighbor_force;
 
+    /// Small enough to keep the functor on the stack of each
+    /// `CalculateDisplacement` call, large enough to fill the SIMD lanes of
+    /// `InteractionForce::CalculateCylinderBatch`.
+    static constexpr uint64_t kBatchSize = 16;
+    CylinderBatch batch;
+    const Agent* agents[kBatchSize];
+    double px[kBatchSize], py[kBatchSize], pz[kBatchSize];
+    double dx[kBatchSize], dy[kBatchSize], dz[kBatchSize];
+    double diameter[kBatchSize];
+    double fx[kBatchSize], fy[kBatchSize], fz[kBatchSize];
+    double proportion[kBatchSize];
+
     MechanicalForcesFunctor(const InteractionForce* force,
                             NeuriteElement* neurite,
                             Double3& force_from_neighbors,
@@ -642,7 +662,21 @@ class NeuriteElement : public Agent, public NeuronOrNeurite {
           force_on_my_mothers_point_mass(force_on_my_mothers_point_mass),
           h_over_m(h_over_m),
           has_neurite_neighbor(has_neurite_neighbor),
-          non_zero_neighbor_force(non_zero_neighbor_force) {}
+          non_zero_neighbor_force(non_zero_neighbor_force) {
+      batch.agents = agents;
+      batch.px = px;
+      batch.py = py;
+      batch.pz = pz;
+      batch.dx = dx;
+      batch.dy = dy;
+      batch.dz = dz;
+      batch.diameter = diameter;
+    }
+
+    MechanicalForcesFunctor(const MechanicalForcesFunctor&) = delete;
+
+    /// Processes the remaining cylinders of the current batch.
+    ~MechanicalForcesFunctor() { Flush(); }
 
     void operator()(Agent* neighbor, double squared_distance) override {
       // if neighbor is a NeuriteElement
@@ -658,6 +692,24 @@ class NeuriteElement : public Agent, public NeuronOrNeurite {
             (ne->GetMother() == neighbor)) {
           return;
         }
+        // Cylinder neighbors are collected in batches and processed with
+        // `InteractionForce::CalculateCylinderBatch`
+        auto* cylinder = bdm_static_cast<const NeuriteElement*>(neighbor);
+        auto proximal_end = cylinder->ProximalEnd();
+        const auto& distal_end = cylinder->DistalEnd();
+        auto idx = batch.size++;
+        agents[idx] = neighbor;
+        px[idx] = proximal_end[0];
+        py[idx] = proximal_end[1];
+        pz[idx] = proximal_end[2];
+        dx[idx] = distal_end[0];
+        dy[idx] = distal_end[1];
+        dz[idx] = distal_end[2];
+        diameter[idx] = cylinder->GetDiameter();
+        if (batch.size == kBatchSize) {
+          Flush();
+        }
+        return;
       } else if (auto* neighbor_soma =
                      dynamic_cast<const NeuronSoma*>(neighbor)) {
         // if neighbor is NeuronSoma
@@ -667,11 +719,26 @@ class NeuriteElement : public Agent, public NeuronOrNeurite {
         }
       }
 
-      Double4 force_from_neighbor = force->Calculate(ne, neighbor);
+      AddForce(force->Calculate(ne, neighbor), false);
+    }
 
+    /// Calculates the forces of the cylinders in the current batch.
+    /// Called if the batch is full and by the destructor.
+    void Flush() {
+      if (batch.size == 0) {
+        return;
+      }
+      force->CalculateCylinderBatch(ne, batch, fx, fy, fz, proportion);
+      for (uint64_t i = 0; i < batch.size; ++i) {
+        AddForce({fx[i], fy[i], fz[i], proportion[i]}, true);
+      }
+      batch.size = 0;
+    }
+
+    void AddForce(Double4 force_from_neighbor, bool neighbor_is_cylinder) {
       // hack: if the neighbour is a neurite, we need to reduce the force from
       // that neighbour in order to avoid kink behaviour
-      if (neighbor->GetShape() == Shape::kCylinder) {
+      if (neighbor_is_cylinder) {
         force_from_neighbor = force_from_neighbor * h_over_m;
         has_neurite_neighbor = true;
       }
@@ -740,11 +807,15 @@ class NeuriteElement : public Agent, public NeuronOrNeurite {
     //  (We check for every neighbor object if they touch us, i.e. push us away)
     if (!IsStatic()) {
       has_neurite_neighbor_ = false;
-      MechanicalForcesFunctor calculate_neighbor_forces(
-          force, this, force_from_neighbors, force_on_my_mothers_point_mass,
-          h_over_m, has_neurite_neighbor_, non_zero_neighbor_force);
-      auto* ctxt = Simulation::GetActive()->GetExecutionContext();
-      ctxt->ForEachNeighbor(calculate_neighbor_forces, *this, squared_radius);
+      {
+        // The forces are complete once the functor has been destroyed
+        MechanicalForcesFunctor calculate_neighbor_forces(
+            force, this, force_from_neighbors, force_on_my_mothers_point_mass,
+            h_over_m, has_neurite_neighbor_, non_zero_neighbor_force);
+        auto* ctxt = Simulation::GetActive()->GetExecutionContext();
+        ctxt->ForEachNeighbor(calculate_neighbor_forces, *this,
+                              squared_radius);
+      }
 
       if (non_zero_neighbor_force > 1) {
         SetStaticnessNextTimestep(false);
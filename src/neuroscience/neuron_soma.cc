@@ -15,6 +15,8 @@
 #include "neuroscience/neuron_soma.h"
 
 #include <algorithm>
+#include <utility>
+#include <vector>
 
 #include "core/resource_manager.h"
 #include "neuroscience/neurite_element.h"
@@ -136,5 +138,27 @@ void NeuronSoma::CriticalRegion(std::vector<AgentUid>* uids) {
   }
 }
 
+void NeuronSoma::RemapUids(
+    const std::unordered_map<AgentUid, AgentUid>& new_uids) {
+  Base::RemapUids(new_uids);
+  for (auto& daughter : daughters_) {
+    daughter.RemapUid(new_uids);
+  }
+  // Remove all changed keys first, because two daughters might swap uids.
+  std::vector<std::pair<AgentUid, Double3>> changed;
+  for (auto it = daughters_coord_.begin(); it != daughters_coord_.end();) {
+    auto new_uid = new_uids.find(it->first);
+    if (new_uid != new_uids.end()) {
+      changed.push_back(std::make_pair(new_uid->second, it->second));
+      it = daughters_coord_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  for (auto& el : changed) {
+    daughters_coord_[el.first] = el.second;
+  }
+}
+
 }  // namespace neuroscience
 }  // namespace bdm
@@ -63,6 +63,9 @@ class NeuronSoma : public Cell, public NeuronOrNeurite {
 
   void CriticalRegion(std::vector<AgentUid>* uids) override;
 
+  void RemapUids(
+      const std::unordered_map<AgentUid, AgentUid>& new_uids) override;
+
   // ***************************************************************************
   //      METHODS FOR NEURON TREE STRUCTURE *
   // ***************************************************************************
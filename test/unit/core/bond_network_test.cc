@@ -0,0 +1,210 @@
+// -----------------------------------------------------------------------------
+//
+// Copyright (C) 2021 CERN & University of Surrey for the benefit of the
+// BioDynaMo collaboration. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+//
+// See the LICENSE file distributed with this work for details.
+// See the NOTICE file distributed with this work for additional information
+// regarding copyright ownership.
+//
+// -----------------------------------------------------------------------------
+
+#include "core/bond_network.h"
+#include "core/agent/cell.h"
+#include "core/environment/environment.h"
+#include "core/resource_manager.h"
+#include "core/scheduler.h"
+#include "gtest/gtest.h"
+#include "neuroscience/module.h"
+#include "neuroscience/neurite_element.h"
+#include "unit/test_util/test_util.h"
+
+namespace bdm {
+
+TEST(BondNetwork, AddRemove) {
+  Simulation simulation(TEST_NAME);
+  auto* bonds = simulation.GetResourceManager()->GetBondNetwork();
+
+  AgentUid a(0), b(1), c(2);
+  EXPECT_TRUE(bonds->IsEmpty());
+  bonds->AddBond(a, b, 5, 2);
+  bonds->AddBond(b, c, 10, 1);
+  EXPECT_EQ(2u, bonds->GetNumBonds());
+  EXPECT_TRUE(bonds->HasBond(b, a));
+  EXPECT_TRUE(bonds->HasBond(b, c));
+  EXPECT_FALSE(bonds->HasBond(a, c));
+
+  EXPECT_FALSE(bonds->RemoveBond(a, c));
+  EXPECT_TRUE(bonds->RemoveBond(c, b));
+  EXPECT_EQ(1u, bonds->GetNumBonds());
+
+  bonds->AddBond(b, c, 10, 1);
+  bonds->RemoveBonds(b);
+  EXPECT_TRUE(bonds->IsEmpty());
+}
+
+TEST(BondNetwork, Forces) {
+  Simulation simulation(TEST_NAME);
+  auto* rm = simulation.GetResourceManager();
+  auto* bonds = rm->GetBondNetwork();
+
+  auto* a = new Cell({0, 0, 0});
+  auto* b = new Cell({10, 0, 0});
+  auto* c = new Cell({10, 10, 0});
+  auto* d = new Cell({20, 20, 0});
+  rm->AddAgent(a);
+  rm->AddAgent(b);
+  rm->AddAgent(c);
+  rm->AddAgent(d);
+  // stretched
+  bonds->AddBond(b->GetUid(), a->GetUid(), 5, 2);
+  // relaxed
+  bonds->AddBond(b->GetUid(), c->GetUid(), 10, 1);
+  // compressed
+  bonds->AddBond(c->GetUid(), d->GetUid(), 20, 0.5);
+
+  bonds->CalculateForces();
+  ASSERT_TRUE(bonds->HasForces());
+  double l = std::sqrt(200.0);
+  double f = 0.5 * (l - 20) / l;
+  auto expect_force = [&](const Double3& expected, const Agent* agent) {
+    auto force = bonds->GetForce(agent);
+    for (int i = 0; i < 3; ++i) {
+      EXPECT_NEAR(expected[i], force[i], abs_error<double>::value);
+    }
+  };
+  expect_force({10, 0, 0}, a);
+  expect_force({-10, 0, 0}, b);
+  expect_force({10 * f, 10 * f, 0}, c);
+  expect_force({-10 * f, -10 * f, 0}, d);
+
+  uint64_t num_bonds = 0;
+  bonds->ForEachBond(rm->GetAgentHandle(b->GetUid()),
+                     [&](const Bond& bond, AgentHandle other) {
+                       auto* agent = rm->GetAgent(other);
+                       EXPECT_TRUE(agent == a || agent == c);
+                       num_bonds++;
+                     });
+  EXPECT_EQ(2u, num_bonds);
+}
+
+TEST(BondNetwork, AgentRemovalAndLoadBalancing) {
+  Simulation simulation(TEST_NAME);
+  auto* rm = simulation.GetResourceManager();
+  auto* bonds = rm->GetBondNetwork();
+
+  std::vector<Cell*> cells;
+  for (int i = 0; i < 10; ++i) {
+    cells.push_back(new Cell({10.0 * (9 - i), 0, 0}));
+    rm->AddAgent(cells.back());
+  }
+  for (int i = 0; i < 9; ++i) {
+    bonds->AddBond(cells[i]->GetUid(), cells[i + 1]->GetUid(), 5, 1);
+  }
+  auto last_uid = cells[9]->GetUid();
+  rm->RemoveAgent(last_uid);
+  cells.pop_back();
+  simulation.GetEnvironment()->Update();
+  rm->LoadBalance();
+
+  bonds->CalculateForces();
+  EXPECT_EQ(8u, bonds->GetNumBonds());
+  EXPECT_FALSE(bonds->HasBond(cells[8]->GetUid(), last_uid));
+  // Chain of stretched springs: only the end points experience a force
+  for (int i = 0; i < 9; ++i) {
+    auto* cell = rm->GetAgent(cells[i]->GetUid());
+    auto force = bonds->GetForce(cell);
+    double expected = i == 0 ? -5 : (i == 8 ? 5 : 0);
+    EXPECT_NEAR(expected, force[0], abs_error<double>::value);
+    EXPECT_NEAR(0, force[1], abs_error<double>::value);
+  }
+}
+
+// The adjacency list is reused while nothing changes, and must be rebuilt
+// once bonded agents are removed or moved to a different storage location.
+TEST(BondNetwork, ChangesBetweenIterations) {
+  Simulation simulation(TEST_NAME);
+  auto* rm = simulation.GetResourceManager();
+  auto* bonds = rm->GetBondNetwork();
+
+  std::vector<AgentUid> uids;
+  for (int i = 0; i < 10; ++i) {
+    auto* cell = new Cell({10.0 * (9 - i), 0, 0});
+    rm->AddAgent(cell);
+    uids.push_back(cell->GetUid());
+  }
+  for (int i = 0; i < 9; ++i) {
+    bonds->AddBond(uids[i], uids[i + 1], 5, 1);
+  }
+  auto expect_forces = [&](uint64_t num_cells) {
+    for (uint64_t i = 0; i < num_cells; ++i) {
+      auto force = bonds->GetForce(rm->GetAgent(uids[i]));
+      double expected = i == 0 ? -5 : (i == num_cells - 1 ? 5 : 0);
+      EXPECT_NEAR(expected, force[0], abs_error<double>::value);
+    }
+  };
+
+  bonds->CalculateForces();
+  expect_forces(10);
+  bonds->CalculateForces();
+  expect_forces(10);
+
+  rm->RemoveAgent(uids[9]);
+  simulation.GetEnvironment()->Update();
+  rm->LoadBalance();
+  bonds->CalculateForces();
+  EXPECT_EQ(8u, bonds->GetNumBonds());
+  expect_forces(9);
+
+  bonds->RemoveBond(uids[7], uids[8]);
+  bonds->CalculateForces();
+  expect_forces(8);
+  EXPECT_NEAR(0, bonds->GetForce(rm->GetAgent(uids[8]))[0],
+              abs_error<double>::value);
+}
+
+TEST(BondNetworkDeathTest, UnsupportedAgent) {
+  ASSERT_DEATH(
+      {
+        neuroscience::InitModule();
+        Simulation simulation(TEST_NAME);
+        auto* rm = simulation.GetResourceManager();
+        auto* cell = new Cell(10);
+        auto* neurite = new neuroscience::NeuriteElement();
+        rm->AddAgent(cell);
+        rm->AddAgent(neurite);
+        rm->GetBondNetwork()->AddBond(cell->GetUid(), neurite->GetUid(), 10,
+                                      1);
+        rm->GetBondNetwork()->CalculateForces();
+      },
+      ".*does not support bonds.*");
+}
+
+TEST(BondNetwork, MechanicalForces) {
+  Simulation simulation(TEST_NAME);
+  auto* rm = simulation.GetResourceManager();
+
+  auto* a = new Cell({0, 0, 0});
+  auto* b = new Cell({30, 0, 0});
+  a->SetDiameter(5);
+  b->SetDiameter(5);
+  rm->AddAgent(a);
+  rm->AddAgent(b);
+  auto a_uid = a->GetUid();
+  auto b_uid = b->GetUid();
+  rm->GetBondNetwork()->AddBond(a_uid, b_uid, 10, 1);
+
+  simulation.GetScheduler()->Simulate(1);
+
+  // The stretched spring pulls both cells towards each other
+  auto a_pos = rm->GetAgent(a_uid)->GetPosition();
+  auto b_pos = rm->GetAgent(b_uid)->GetPosition();
+  EXPECT_LT(0, a_pos[0]);
+  EXPECT_GT(30, b_pos[0]);
+  EXPECT_NEAR(30, a_pos[0] + b_pos[0], abs_error<double>::value);
+}
+
+}  // namespace bdm
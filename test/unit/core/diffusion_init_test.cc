@@ -13,6 +13,8 @@
 // -----------------------------------------------------------------------------
 
 #include "diffusion_init_test.h"
+#include <cstdio>
+#include <fstream>
 #include "core/agent/cell.h"
 #include "core/diffusion/diffusion_grid.h"
 #include "core/environment/environment.h"
@@ -128,4 +130,221 @@ TEST(DiffusionInitTest, InitBothArrays) {
   EXPECT_TRUE(test_grid->ComapareArrayWithValue(0.5));
   EXPECT_TRUE(test_grid->CompareArrays());
 }
+
+// Tests the values of the boxes that are added when the grid grows, and that
+// the headroom avoids growing the grid again
+TEST(DiffusionInitTest, HaloFill) {
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+    param->diffusion_grid_headroom = 0.5;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* param = const_cast<Param*>(simulation.GetParam());
+  simulation.GetEnvironment()->Update();
+
+  TestGrid extrapolated(0, "Extrapolated", 0, 0, 5);
+  extrapolated.Initialize();
+  extrapolated.AddInitializer([](double x, double y, double z) { return x; });
+  extrapolated.RunInitializers();
+  extrapolated.SetHaloFill(DiffusionGrid::HaloFill::kExtrapolate);
+
+  TestGrid constant(1, "Constant", 0, 0, 5);
+  constant.Initialize();
+  constant.AddInitializer([](double x, double y, double z) { return 1; });
+  constant.RunInitializers();
+  constant.SetHaloFill(DiffusionGrid::HaloFill::kConstant, 3);
+
+  // 5 boxes grow to 7 boxes plus two boxes of headroom on each side
+  param->min_bound = -140;
+  param->max_bound = 140;
+  simulation.GetEnvironment()->ForcedUpdate();
+  extrapolated.Update();
+  constant.Update();
+
+  auto num_boxes = extrapolated.GetNumBoxesArray();
+  EXPECT_EQ(11u, num_boxes[0]);
+  EXPECT_EQ(11u, num_boxes[1]);
+  EXPECT_EQ(11u, num_boxes[2]);
+  EXPECT_EQ(-250, extrapolated.GetDimensions()[0]);
+  EXPECT_EQ(250, extrapolated.GetDimensions()[1]);
+
+  // The old grid starts at box 3
+  using Box = std::array<uint32_t, 3>;
+  auto* conc = extrapolated.GetAllConcentrations();
+  EXPECT_EQ(-100, conc[extrapolated.GetBoxIndex(Box{3, 3, 3})]);
+  EXPECT_EQ(100, conc[extrapolated.GetBoxIndex(Box{7, 5, 5})]);
+  EXPECT_EQ(-100, conc[extrapolated.GetBoxIndex(Box{0, 5, 5})]);
+  EXPECT_EQ(100, conc[extrapolated.GetBoxIndex(Box{10, 0, 10})]);
+  EXPECT_TRUE(extrapolated.CompareArrays());
+
+  conc = constant.GetAllConcentrations();
+  EXPECT_EQ(1, conc[constant.GetBoxIndex(Box{3, 3, 3})]);
+  EXPECT_EQ(1, conc[constant.GetBoxIndex(Box{7, 7, 7})]);
+  EXPECT_EQ(3, conc[constant.GetBoxIndex(Box{2, 5, 5})]);
+  EXPECT_EQ(3, conc[constant.GetBoxIndex(Box{5, 5, 8})]);
+  EXPECT_TRUE(constant.CompareArrays());
+
+  // The environment grows within the headroom
+  param->min_bound = -200;
+  param->max_bound = 200;
+  simulation.GetEnvironment()->ForcedUpdate();
+  extrapolated.Update();
+  EXPECT_EQ(num_boxes, extrapolated.GetNumBoxesArray());
+  EXPECT_EQ(-250, extrapolated.GetDimensions()[0]);
+}
+
+// Tests that the grid follows an environment that grows on one side only,
+// even if the number of boxes would still fit into the headroom
+TEST(DiffusionInitTest, OneSidedGrowth) {
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+    param->diffusion_grid_headroom = 0.5;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* param = const_cast<Param*>(simulation.GetParam());
+  simulation.GetEnvironment()->Update();
+
+  TestGrid dgrid(0, "Substance", 0, 0, 5);
+  dgrid.Initialize();
+  dgrid.AddInitializer([](double x, double y, double z) { return x; });
+  dgrid.RunInitializers();
+  dgrid.SetHaloFill(DiffusionGrid::HaloFill::kConstant, 3);
+
+  // 5 boxes grow to 7 boxes plus two boxes of headroom on each side:
+  // [-250, 250]
+  param->min_bound = -140;
+  param->max_bound = 140;
+  simulation.GetEnvironment()->ForcedUpdate();
+  dgrid.Update();
+  ASSERT_EQ(11u, dgrid.GetNumBoxesArray()[0]);
+
+  // The environment grows beyond the grid on the positive side, although
+  // the length of the environment (540) is still covered by 11 boxes
+  param->max_bound = 400;
+  simulation.GetEnvironment()->ForcedUpdate();
+  dgrid.Update();
+
+  auto dims = dgrid.GetDimensions();
+  for (int i = 0; i < 3; i++) {
+    EXPECT_GE(-140, dims[2 * i]);
+    EXPECT_LE(400, dims[2 * i + 1]);
+  }
+  // The old boxes keep their position
+  EXPECT_EQ(-100, dgrid.GetConcentration({-100, 0, 0}));
+  EXPECT_EQ(0, dgrid.GetConcentration({0, 0, 0}));
+  EXPECT_EQ(100, dgrid.GetConcentration({100, 0, 0}));
+  EXPECT_EQ(3, dgrid.GetConcentration({-250, 0, 0}));
+  // Agents on the side that grew are inside the grid
+  Double3 pos = {390, 390, 390};
+  ASSERT_GT(dgrid.GetNumBoxes(), dgrid.GetBoxIndex(pos));
+  EXPECT_EQ(3, dgrid.GetConcentration(pos));
+  EXPECT_TRUE(dgrid.CompareArrays());
+  dgrid.ChangeConcentrationBy(pos, 1);
+  EXPECT_EQ(4, dgrid.GetConcentration(pos));
+}
+
+// Tests initialization from a file together with an initialization function
+TEST(DiffusionInitTest, InitialConcentrationFile) {
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetEnvironment()->Update();
+
+  TestGrid dgrid(0, "Substance", 0, 0, 5);
+  dgrid.Initialize();
+  auto num_boxes = dgrid.GetNumBoxes();
+  ASSERT_EQ(125u, num_boxes);
+
+  std::vector<double> values(num_boxes);
+  for (size_t i = 0; i < num_boxes; i++) {
+    values[i] = i;
+  }
+  std::string file_name = std::string(TEST_NAME) + ".raw";
+  {
+    std::ofstream ofs(file_name, std::ios::binary);
+    ofs.write(reinterpret_cast<const char*>(values.data()),
+              values.size() * sizeof(double));
+  }
+
+  dgrid.SetUpperThreshold(100);
+  dgrid.AddInitialConcentrations(file_name);
+  dgrid.AddInitializer([](double x, double y, double z) { return z; });
+  dgrid.RunInitializers();
+
+  auto* conc = dgrid.GetAllConcentrations();
+  auto dims = dgrid.GetDimensions();
+  for (uint32_t z = 0; z < 5; z++) {
+    for (uint32_t y = 0; y < 5; y++) {
+      for (uint32_t x = 0; x < 5; x++) {
+        auto idx = dgrid.GetBoxIndex(std::array<uint32_t, 3>{x, y, z});
+        double expected = std::min(idx + dims[4] + z * 50.0, 100.0);
+        EXPECT_EQ(expected, conc[idx]);
+      }
+    }
+  }
+  EXPECT_TRUE(dgrid.CompareArrays());
+  std::remove(file_name.c_str());
+}
+
+// Tests that files and functions are applied in the order in which they were
+// added, and that each row uses its own copy of a stateful functor
+TEST(DiffusionInitTest, InitializerOrder) {
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetEnvironment()->Update();
+
+  TestGrid dgrid(0, "Substance", 0, 0, 5);
+  dgrid.Initialize();
+  auto num_boxes = dgrid.GetNumBoxes();
+  ASSERT_EQ(125u, num_boxes);
+
+  std::vector<double> values(num_boxes);
+  for (size_t i = 0; i < num_boxes; i++) {
+    values[i] = i;
+  }
+  std::string file_name = std::string(TEST_NAME) + ".raw";
+  {
+    std::ofstream ofs(file_name, std::ios::binary);
+    ofs.write(reinterpret_cast<const char*>(values.data()),
+              values.size() * sizeof(double));
+  }
+
+  // Returns the number of previous calls, i.e. the x index within a row
+  struct Counter {
+    double operator()(double x, double y, double z) { return calls++; }
+    int calls = 0;
+  };
+
+  dgrid.SetLowerThreshold(0);
+  dgrid.SetUpperThreshold(1000);
+  // Clamped to the lower threshold before the file is added
+  dgrid.AddInitializer([](double x, double y, double z) { return -50; });
+  dgrid.AddInitialConcentrations(file_name);
+  dgrid.AddInitializer(Counter());
+  dgrid.RunInitializers();
+
+  auto* conc = dgrid.GetAllConcentrations();
+  for (uint32_t z = 0; z < 5; z++) {
+    for (uint32_t y = 0; y < 5; y++) {
+      for (uint32_t x = 0; x < 5; x++) {
+        auto idx = dgrid.GetBoxIndex(std::array<uint32_t, 3>{x, y, z});
+        EXPECT_EQ(static_cast<double>(idx + x), conc[idx]);
+      }
+    }
+  }
+  EXPECT_TRUE(dgrid.CompareArrays());
+  std::remove(file_name.c_str());
+}
+
 }  // namespace bdm
@@ -15,6 +15,8 @@
 #include <fstream>
 
 #include "core/agent/cell.h"
+#include "core/diffusion/adi_grid.h"
+#include "core/diffusion/amr_grid.h"
 #include "core/diffusion/diffusion_grid.h"
 #include "core/diffusion/euler_grid.h"
 #include "core/diffusion/runge_kutta_grid.h"
@@ -108,14 +110,18 @@ TEST(DiffusionTest, UpdateGrid) {
 
   dgrid->Update();
 
+  // The environment grew from [-40, 140] to [-60, 200]. The grid is extended
+  // by whole boxes (30) on each side, such that the old boxes keep their
+  // position.
   auto d_dims = dgrid->GetDimensions();
 
-  EXPECT_EQ(-60, d_dims[0]);
-  EXPECT_EQ(-60, d_dims[2]);
-  EXPECT_EQ(-60, d_dims[4]);
-  EXPECT_EQ(210, d_dims[1]);
-  EXPECT_EQ(210, d_dims[3]);
-  EXPECT_EQ(210, d_dims[5]);
+  EXPECT_EQ(-70, d_dims[0]);
+  EXPECT_EQ(-70, d_dims[2]);
+  EXPECT_EQ(-70, d_dims[4]);
+  EXPECT_EQ(200, d_dims[1]);
+  EXPECT_EQ(200, d_dims[3]);
+  EXPECT_EQ(200, d_dims[5]);
+  EXPECT_EQ(10u, dgrid->GetNumBoxesArray()[0]);
 
   delete dgrid;
 }
@@ -160,6 +166,99 @@ TEST(DiffusionTest, FalseUpdateGrid) {
   delete dgrid;
 }
 
+// Tests a flat, non-cubic diffusion grid
+TEST(DiffusionTest, AnisotropicDomain) {
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetEnvironment()->Update();
+
+  EulerGrid dgrid(0, "Kalium", 0.4, 0, 101);
+  dgrid.SetDomain({0, 1000, -500, 500, 0, 50});
+  dgrid.Initialize();
+
+  EXPECT_EQ(10, dgrid.GetBoxLength());
+  std::array<size_t, 3> expected_num_boxes = {101, 101, 6};
+  EXPECT_EQ(expected_num_boxes, dgrid.GetNumBoxesArray());
+  EXPECT_EQ(101u * 101u * 6u, dgrid.GetNumBoxes());
+  std::array<int32_t, 6> expected_dims = {0, 1000, -500, 500, 0, 50};
+  EXPECT_EQ(expected_dims, dgrid.GetDimensions());
+  std::array<int32_t, 3> expected_size = {1000, 1000, 50};
+  EXPECT_EQ(expected_size, dgrid.GetGridSize());
+  EXPECT_EQ(2u * 101 * 101 + 50 * 101 + 30,
+            dgrid.GetBoxIndex(Double3({300, 0, 25})));
+
+  // Linear profile: the gradient in the interior is exact
+  dgrid.AddInitializer(
+      [](double x, double y, double z) { return x + 2 * y + 3 * z; });
+  dgrid.RunInitializers();
+  auto idx = dgrid.GetBoxIndex(Double3({300, 0, 25}));
+  EXPECT_NEAR(300 + 0 + 60, dgrid.GetAllConcentrations()[idx],
+              abs_error<double>::value);
+  dgrid.CalculateGradient();
+  auto* gradients = dgrid.GetAllGradients();
+  EXPECT_NEAR(1, gradients[3 * idx], abs_error<double>::value);
+  EXPECT_NEAR(2, gradients[3 * idx + 1], abs_error<double>::value);
+  EXPECT_NEAR(3, gradients[3 * idx + 2], abs_error<double>::value);
+
+  // The domain does not grow with the environment
+  dgrid.Update();
+  EXPECT_EQ(expected_num_boxes, dgrid.GetNumBoxesArray());
+}
+
+// Tests that agents outside of a user-defined domain do not change the
+// concentration of boxes inside the domain
+TEST(DiffusionTest, OutsideOfDomain) {
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -2000;
+    param->max_bound = 2000;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+  simulation.GetEnvironment()->Update();
+
+  EulerGrid dgrid(0, "Kalium", 0.4, 0, 101);
+  dgrid.SetDomain({0, 1000, -500, 500, 0, 50});
+  dgrid.Initialize();
+  const auto num_boxes = dgrid.GetNumBoxes();
+
+  // Outside of the domain along a single axis. Without the per-axis check,
+  // these positions would wrap around to a box in a neighboring row or
+  // plane.
+  std::vector<Double3> outside = {
+      {1200, 0, 25}, {-50, 0, 25}, {300, 600, 25}, {300, 0, 80}};
+  for (const auto& position : outside) {
+    auto* cell = new Cell(position);
+    rm->AddAgent(cell);
+    EXPECT_EQ(num_boxes, dgrid.GetBoxIndex(cell->GetPosition()));
+    auto coord = dgrid.GetBoxCoordinates(cell->GetPosition());
+    bool outside_along_axis = false;
+    for (int i = 0; i < 3; i++) {
+      outside_along_axis |= coord[i] == dgrid.GetNumBoxesArray()[i];
+    }
+    EXPECT_TRUE(outside_along_axis);
+    dgrid.ChangeConcentrationBy(cell->GetPosition(), 1);
+  }
+
+  auto* concentrations = dgrid.GetAllConcentrations();
+  for (size_t i = 0; i < num_boxes; i++) {
+    ASSERT_EQ(0, concentrations[i]);
+  }
+
+  EXPECT_EQ(0, dgrid.GetConcentration(outside[0]));
+  Double3 gradient = {1, 1, 1};
+  dgrid.GetGradient(outside[0], &gradient);
+  EXPECT_EQ(Double3({0, 0, 0}), gradient);
+
+  // Inside of the domain
+  dgrid.ChangeConcentrationBy(Double3{300, 0, 25}, 1);
+  EXPECT_EQ(1, concentrations[dgrid.GetBoxIndex(Double3{300, 0, 25})]);
+}
+
 // Tests if the concentration / gradient values are correctly copied
 // after the env has grown and DiffusionGrid::CopyOldData is called
 TEST(DiffusionTest, CopyOldData) {
@@ -348,6 +447,256 @@ TEST(DiffusionTest, Thresholds) {
   delete dgrid;
 }
 
+TEST(DiffusionTest, Interpolation) {
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetEnvironment()->Update();
+  EulerGrid dgrid(0, "Kalium", 0.4, 0, 21);
+  dgrid.Initialize();
+  dgrid.AddInitializer(
+      [](double x, double y, double z) { return x * x + y * y + 3 * z; });
+  dgrid.RunInitializers();
+  dgrid.CalculateGradient();
+
+  // Grid points are located at multiples of the box length (10)
+  Double3 pos = {13, 27, -41};
+  EXPECT_FALSE(dgrid.GetInterpolation());
+  EXPECT_DOUBLE_EQ(100 + 400 - 150, dgrid.GetConcentration(pos));
+  Double3 gradient;
+  dgrid.GetGradient(pos, &gradient);
+  Double3 expected = {20, 40, 3};
+  expected.Normalize();
+  for (int i = 0; i < 3; i++) {
+    EXPECT_NEAR(expected[i], gradient[i], abs_error<double>::value);
+  }
+
+  dgrid.SetInterpolation(true);
+  // Linear interpolation of x^2 between 10 and 20 at 13: 100 + 0.3 * 300
+  EXPECT_NEAR(190 + 750 - 123, dgrid.GetConcentration(pos),
+              ConcentrationError(1e-9, 817));
+  // The central differences of x^2 (2x) are exact and linear
+  dgrid.GetGradient(pos, &gradient);
+  expected = {26, 54, 3};
+  expected.Normalize();
+  for (int i = 0; i < 3; i++) {
+    EXPECT_NEAR(expected[i], gradient[i], abs_error<double>::value);
+  }
+  // At grid points the interpolation returns the value of the grid point
+  EXPECT_NEAR(400 + 100 - 30, dgrid.GetConcentration({20, -10, -10}),
+              ConcentrationError(1e-9, 470));
+}
+
+TEST(DiffusionTest, BatchedQueries) {
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetEnvironment()->Update();
+  auto* random = simulation.GetRandom();
+  EulerGrid dgrid(0, "Kalium", 0.4, 0, 21);
+  dgrid.Initialize();
+  dgrid.AddInitializer([](double x, double y, double z) {
+    return std::exp(-(x * x + y * y + z * z) / 2000);
+  });
+  dgrid.RunInitializers();
+  dgrid.CalculateGradient();
+
+  std::vector<Double3> positions;
+  for (int i = 0; i < 1000; i++) {
+    positions.push_back(random->UniformArray<3>(-99.5, 99.5));
+  }
+
+  // Positions on the box borders and at the edges of the grid are assigned
+  // to the same box by the scalar and the batched lookup
+  std::vector<Double3> borders;
+  for (int i = -1; i <= 21; i++) {
+    double x = -100 + i * dgrid.GetBoxLength();
+    borders.push_back({x, 0, 0});
+    borders.push_back({0, x - 1e-9, 0});
+    borders.push_back({0, 0, x + 1e-9});
+  }
+  std::vector<size_t> indices;
+  dgrid.GetBoxIndices(borders, &indices);
+  ASSERT_EQ(borders.size(), indices.size());
+  for (size_t i = 0; i < borders.size(); i++) {
+    EXPECT_EQ(dgrid.GetBoxIndex(borders[i]), indices[i]);
+    EXPECT_EQ(dgrid.GetBoxIndex(dgrid.GetBoxCoordinates(borders[i])),
+              indices[i]);
+  }
+  positions.insert(positions.end(), borders.begin(), borders.end());
+
+  for (bool interpolate : {false, true}) {
+    dgrid.SetInterpolation(interpolate);
+    std::vector<double> concentrations;
+    std::vector<Double3> gradients;
+    dgrid.GetConcentrations(positions, &concentrations);
+    dgrid.GetGradients(positions, &gradients);
+    ASSERT_EQ(positions.size(), concentrations.size());
+    ASSERT_EQ(positions.size(), gradients.size());
+    for (size_t i = 0; i < positions.size(); i++) {
+      EXPECT_NEAR(dgrid.GetConcentration(positions[i]), concentrations[i],
+                  abs_error<double>::value);
+      Double3 gradient;
+      dgrid.GetGradient(positions[i], &gradient);
+      for (int d = 0; d < 3; d++) {
+        EXPECT_NEAR(gradient[d], gradients[i][d], abs_error<double>::value);
+      }
+    }
+  }
+}
+
+// Tests that gradients computed on demand match the stored gradients
+TEST(DiffusionTest, LazyGradients) {
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* param = const_cast<Param*>(simulation.GetParam());
+  simulation.GetEnvironment()->Update();
+  auto* random = simulation.GetRandom();
+  auto init = [](double x, double y, double z) {
+    return std::exp(-((x - 30) * (x - 30) + y * y + z * z) / 2000);
+  };
+
+  EulerGrid eager(0, "Eager", 0.4, 0.01, 21);
+  eager.Initialize();
+  eager.AddInitializer(init);
+  eager.RunInitializers();
+
+  param->diffusion_lazy_gradients = true;
+  EulerGrid lazy(1, "Lazy", 0.4, 0.01, 21);
+  lazy.Initialize();
+  lazy.AddInitializer(init);
+  lazy.RunInitializers();
+
+  EXPECT_NE(nullptr, eager.GetAllGradients());
+  EXPECT_EQ(nullptr, lazy.GetAllGradients());
+
+  // CalculateGradient does not compute anything for the lazy grid, which
+  // reflects the concentrations after the step
+  for (auto* dgrid : {&eager, &lazy}) {
+    dgrid->Diffuse(1);
+    dgrid->CalculateGradient();
+  }
+  EXPECT_EQ(nullptr, lazy.GetAllGradients());
+
+  std::vector<Double3> positions;
+  for (int i = 0; i < 1000; i++) {
+    positions.push_back(random->UniformArray<3>(-100, 100));
+  }
+  // Boxes at the edges of the grid
+  positions.push_back({-100, -100, -100});
+  positions.push_back({100, 0, 100});
+
+  for (bool interpolate : {false, true}) {
+    eager.SetInterpolation(interpolate);
+    lazy.SetInterpolation(interpolate);
+    std::vector<Double3> expected;
+    std::vector<Double3> actual;
+    eager.GetGradients(positions, &expected);
+    lazy.GetGradients(positions, &actual);
+    for (size_t i = 0; i < positions.size(); i++) {
+      Double3 gradient;
+      lazy.GetGradient(positions[i], &gradient);
+      for (int d = 0; d < 3; d++) {
+        EXPECT_NEAR(expected[i][d], actual[i][d],
+                    ConcentrationError(abs_error<double>::value));
+        EXPECT_NEAR(expected[i][d], gradient[d],
+                    ConcentrationError(abs_error<double>::value));
+      }
+    }
+  }
+}
+
+// Tests that lazy gradients are zero until CalculateGradient is called (i.e.
+// if `Param::calculate_gradients` is false), and that they include changes of
+// the concentrations since the last call, unlike stored gradients
+TEST(DiffusionTest, LazyGradientsConsistency) {
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* param = const_cast<Param*>(simulation.GetParam());
+  simulation.GetEnvironment()->Update();
+  auto init = [](double x, double y, double z) { return x + 2 * y + 3 * z; };
+
+  EulerGrid eager(0, "Eager", 0.4, 0, 21);
+  param->diffusion_lazy_gradients = true;
+  EulerGrid lazy(1, "Lazy", 0.4, 0, 21);
+  for (auto* dgrid : {&eager, &lazy}) {
+    dgrid->Initialize();
+    dgrid->AddInitializer(init);
+    dgrid->RunInitializers();
+  }
+
+  Double3 pos = {0, 0, 0};
+  Double3 zero = {0, 0, 0};
+  Double3 gradient;
+  for (auto* dgrid : {&eager, &lazy}) {
+    dgrid->GetGradient(pos, &gradient);
+    EXPECT_EQ(zero, gradient);
+  }
+
+  Double3 expected = {1, 2, 3};
+  expected.Normalize();
+  for (auto* dgrid : {&eager, &lazy}) {
+    dgrid->CalculateGradient();
+    dgrid->GetGradient(pos, &gradient);
+    for (int i = 0; i < 3; i++) {
+      EXPECT_NEAR(expected[i], gradient[i],
+                  ConcentrationError(abs_error<double>::value));
+    }
+  }
+
+  // Secretion in the box in front of `pos` along the x-axis
+  Double3 east = {eager.GetBoxLength(), 0, 0};
+  for (auto* dgrid : {&eager, &lazy}) {
+    dgrid->ChangeConcentrationBy(east, 1000);
+  }
+  eager.GetGradient(pos, &gradient);
+  for (int i = 0; i < 3; i++) {
+    EXPECT_NEAR(expected[i], gradient[i],
+                ConcentrationError(abs_error<double>::value));
+  }
+  lazy.GetGradient(pos, &gradient);
+  EXPECT_LT(expected[0], gradient[0]);
+}
+
+// Tests that concurrent changes of the same box are not lost
+TEST(DiffusionTest, ConcurrentSecretion) {
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetEnvironment()->Update();
+  EulerGrid dgrid(0, "Kalium", 0.4, 0, 50);
+  dgrid.Initialize();
+  dgrid.SetUpperThreshold(15000);
+
+  Double3 pos({0, 0, 0});
+  Double3 pos_clamped({10, 10, 10});
+#pragma omp parallel for
+  for (int i = 0; i < 20000; i++) {
+    dgrid.ChangeConcentrationBy(pos, 0.5);
+    dgrid.ChangeConcentrationBy(pos_clamped, 1);
+  }
+
+  EXPECT_DOUBLE_EQ(10000, dgrid.GetConcentration(pos));
+  EXPECT_DOUBLE_EQ(15000, dgrid.GetConcentration(pos_clamped));
+}
+
 #ifdef USE_DICT
 
 // Test if all the data members of the diffusion grid are correctly serialized
@@ -526,6 +875,447 @@ TEST(DiffusionTest, EulerConvergence) {
   delete dgrid8;
 }
 
+TEST(DiffusionTest, AdiConvergence) {
+  double simulation_time_step{1.0};
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+    param->diffusion_boundary_condition = "closed";
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetEnvironment()->Update();
+
+  double diff_coef = 0.5;
+  std::vector<DiffusionGrid*> dgrids = {
+      new AdiGrid(0, "Kalium1", diff_coef, 0, 21),
+      new AdiGrid(1, "Kalium4", diff_coef, 0, 41),
+      new AdiGrid(2, "Kalium8", diff_coef, 0, 81)};
+
+  // instantaneous point source
+  int init = 1e5;
+  Double3 source = {{0, 0, 0}};
+  Double3 marker = {10.0, 10.0, 10.0};
+  int tot = 100;
+  std::vector<double> errors;
+  for (auto* dgrid : dgrids) {
+    dgrid->Initialize();
+    dgrid->ChangeConcentrationBy(source, init / pow(dgrid->GetBoxLength(), 3));
+    for (int t = 0; t < tot; t++) {
+      dgrid->Diffuse(simulation_time_step);
+    }
+    auto rc = GetRealCoordinates(dgrid->GetBoxCoordinates(source),
+                                 dgrid->GetBoxCoordinates(marker),
+                                 dgrid->GetBoxLength());
+    auto real_val =
+        CalculateAnalyticalSolution(init, rc[0], rc[1], rc[2], diff_coef, tot);
+    auto conc = dgrid->GetAllConcentrations()[dgrid->GetBoxIndex(marker)];
+    errors.push_back(std::abs(real_val - conc) / std::abs(real_val));
+  }
+
+  EXPECT_TRUE(errors[1] < errors[0]);
+  EXPECT_TRUE(errors[2] < errors[1]);
+  EXPECT_NEAR(errors[2], 0.025, 0.01);
+
+  for (auto* dgrid : dgrids) {
+    delete dgrid;
+  }
+}
+
+// Tests that the implicit method remains stable and accurate for time steps
+// that exceed the stability limit of the explicit methods
+TEST(DiffusionTest, AdiLargeTimeStep) {
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+    param->diffusion_boundary_condition = "closed";
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetEnvironment()->Update();
+  auto* param = const_cast<Param*>(simulation.GetParam());
+
+  double diff_coef = 0.5;
+  int init = 1e5;
+  Double3 source = {{0, 0, 0}};
+  Double3 marker = {10.0, 10.0, 10.0};
+  // dt * diff_coef / box_length^2 = 0.8 > 1/6
+  double dt = 10;
+  int tot = 100;
+
+  for (double theta : {1.0, 0.5}) {
+    param->diffusion_implicit_theta = theta;
+    AdiGrid dgrid(0, "Kalium", diff_coef, 0, 81);
+    dgrid.Initialize();
+    dgrid.ChangeConcentrationBy(source, init / pow(dgrid.GetBoxLength(), 3));
+    for (int t = 0; t < tot / dt; t++) {
+      dgrid.Diffuse(dt);
+    }
+
+    auto rc = GetRealCoordinates(dgrid.GetBoxCoordinates(source),
+                                 dgrid.GetBoxCoordinates(marker),
+                                 dgrid.GetBoxLength());
+    auto real_val =
+        CalculateAnalyticalSolution(init, rc[0], rc[1], rc[2], diff_coef, tot);
+    auto* conc = dgrid.GetAllConcentrations();
+    auto error =
+        std::abs(real_val - conc[dgrid.GetBoxIndex(marker)]) / real_val;
+    if (theta == 1) {
+      EXPECT_LT(error, 0.15);
+      for (size_t i = 0; i < dgrid.GetNumBoxes(); i++) {
+        ASSERT_LE(0, conc[i]);
+      }
+    } else {
+      EXPECT_LT(error, 0.03);
+    }
+  }
+}
+
+// Tests the implicit method for grids with a single box along an axis
+TEST(DiffusionTest, AdiSingleBoxAxis) {
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* param = const_cast<Param*>(simulation.GetParam());
+  simulation.GetEnvironment()->Update();
+
+  for (std::string bc : {"closed", "open"}) {
+    param->diffusion_boundary_condition = bc;
+    // A thin domain with one box along the z-axis and a grid with
+    // resolution 1
+    AdiGrid thin(0, "Thin", 0.5, 0, 21);
+    thin.SetDomain({-100, 100, -100, 100, 0, 0});
+    AdiGrid single(1, "Single", 0.5, 0, 1);
+    for (auto* dgrid : {&thin, &single}) {
+      dgrid->Initialize();
+      dgrid->AddInitializer([](double x, double y, double z) { return 1; });
+      dgrid->RunInitializers();
+      for (int t = 0; t < 5; t++) {
+        dgrid->Diffuse(10);
+      }
+      auto* conc = dgrid->GetAllConcentrations();
+      for (size_t i = 0; i < dgrid->GetNumBoxes(); i++) {
+        if (bc == "closed") {
+          // All boxes are at the boundary
+          ASSERT_EQ(1, conc[i]);
+        } else {
+          // Substance leaves the grid
+          ASSERT_LT(0, conc[i]);
+          ASSERT_GT(1, conc[i]);
+        }
+      }
+    }
+    EXPECT_EQ(1u, thin.GetNumBoxesArray()[2]);
+    EXPECT_EQ(1u, single.GetNumBoxes());
+  }
+}
+
+// Tests that the temporally blocked stencil gives the same result as
+// advancing each substep in a separate sweep
+void RunTemporalBlockingTest(const char* sim_name,
+                             const std::string& boundary_condition) {
+  auto set_param = [&](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+    param->diffusion_boundary_condition = boundary_condition;
+  };
+  Simulation simulation(sim_name, set_param);
+  simulation.GetEnvironment()->Update();
+  auto* param = const_cast<Param*>(simulation.GetParam());
+
+  std::vector<EulerGrid*> grids;
+  for (int i = 0; i < 2; ++i) {
+    auto* dgrid = new EulerGrid(0, "Substance", 1, 0.01, 21);
+    dgrid->Initialize();
+    dgrid->AddInitializer([](double x, double y, double z) {
+      return std::exp(-(x * x + y * y + z * z) / 2000) + 0.1 * z;
+    });
+    dgrid->RunInitializers();
+    grids.push_back(dgrid);
+  }
+
+  // With four substeps the time step exceeds the stability limit of a single
+  // step
+  double dt = 30;
+  for (int t = 0; t < 5; t++) {
+    // Both methods must treat changes of boundary boxes the same way
+    for (auto* dgrid : grids) {
+      dgrid->ChangeConcentrationBy(Double3{-99, 0, 0}, 0.5);
+      dgrid->ChangeConcentrationBy(Double3{0, 0, 99}, 0.5);
+    }
+    param->diffusion_substeps = 1;
+    for (int s = 0; s < 4; s++) {
+      grids[0]->Diffuse(dt / 4);
+    }
+    param->diffusion_substeps = 4;
+    grids[1]->Diffuse(dt);
+  }
+
+  EXPECT_EQ(4u, grids[1]->GetNumSubsteps());
+  auto* expected = grids[0]->GetAllConcentrations();
+  auto* actual = grids[1]->GetAllConcentrations();
+  for (size_t b = 0; b < grids[0]->GetNumBoxes(); ++b) {
+    ASSERT_DOUBLE_EQ(expected[b], actual[b]);
+  }
+
+  for (auto* dgrid : grids) {
+    delete dgrid;
+  }
+}
+
+TEST(DiffusionTest, TemporalBlockingClosedEdge) {
+  RunTemporalBlockingTest(TEST_NAME, "closed");
+}
+
+TEST(DiffusionTest, TemporalBlockingOpenEdge) {
+  RunTemporalBlockingTest(TEST_NAME, "open");
+}
+
+// Tests that skipping converged tiles does not change the result noticeably
+// and that secretion wakes idle tiles up
+TEST(DiffusionTest, ConvergedTiles) {
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+    param->diffusion_boundary_condition = "closed";
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetEnvironment()->Update();
+  auto* param = const_cast<Param*>(simulation.GetParam());
+
+  std::vector<EulerGrid*> grids;
+  for (int i = 0; i < 2; ++i) {
+    // 49 boxes along each axis: 4 x 4 tiles
+    auto* dgrid = new EulerGrid(0, "Substance", 1, 0, 49);
+    dgrid->Initialize();
+    dgrid->AddInitializer([](double x, double y, double z) {
+      x += 80;
+      y += 80;
+      z += 80;
+      return std::exp(-(x * x + y * y + z * z) / 100);
+    });
+    dgrid->RunInitializers();
+    grids.push_back(dgrid);
+  }
+
+  auto diffuse = [&]() {
+    param->diffusion_convergence_tolerance = 0;
+    grids[0]->Diffuse(1);
+    grids[0]->CalculateGradient();
+    param->diffusion_convergence_tolerance = 1e-8;
+    grids[1]->Diffuse(1);
+    grids[1]->CalculateGradient();
+  };
+  auto compare = [&]() {
+    auto* expected = grids[0]->GetAllConcentrations();
+    auto* actual = grids[1]->GetAllConcentrations();
+    auto* expected_gradients = grids[0]->GetAllGradients();
+    auto* actual_gradients = grids[1]->GetAllGradients();
+    for (size_t b = 0; b < grids[0]->GetNumBoxes(); ++b) {
+      ASSERT_NEAR(expected[b], actual[b], ConcentrationError(1e-10));
+      for (int i = 0; i < 3; i++) {
+        ASSERT_NEAR(expected_gradients[3 * b + i], actual_gradients[3 * b + i],
+                    ConcentrationError(1e-10));
+      }
+    }
+  };
+
+  for (int t = 0; t < 10; t++) {
+    diffuse();
+  }
+  EXPECT_EQ(0u, grids[0]->GetNumIdleTiles());
+  auto idle_tiles = grids[1]->GetNumIdleTiles();
+  EXPECT_LT(0u, idle_tiles);
+  EXPECT_GT(16u, idle_tiles);
+  compare();
+
+  // Secretion far away from the initial peak
+  Double3 pos = {80, 80, 80};
+  for (auto* dgrid : grids) {
+    dgrid->ChangeConcentrationBy(pos, 1);
+  }
+  diffuse();
+  EXPECT_GT(idle_tiles, grids[1]->GetNumIdleTiles());
+  Double3 neighbor = {80 + grids[1]->GetBoxLength(), 80, 80};
+  EXPECT_LT(0.05, grids[1]->GetConcentration(neighbor));
+  compare();
+
+  for (auto* dgrid : grids) {
+    delete dgrid;
+  }
+}
+
+// Tests that secretion at the border of a tile does not lose substance if
+// converged tiles are skipped
+TEST(DiffusionTest, ConvergedTilesMassConservation) {
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+    param->diffusion_boundary_condition = "closed";
+    param->diffusion_convergence_tolerance = 1e-8;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetEnvironment()->Update();
+
+  // 49 boxes along each axis: 4 x 4 tiles of 16 x 16 rows
+  EulerGrid dgrid(0, "Substance", 1, 0, 49);
+  dgrid.Initialize();
+  dgrid.RunInitializers();
+  for (int t = 0; t < 3; t++) {
+    dgrid.Diffuse(1);
+  }
+  EXPECT_EQ(16u, dgrid.GetNumIdleTiles());
+
+  // Box in the last row (y = 15) of its tile
+  const auto& num_boxes = dgrid.GetNumBoxesArray();
+  size_t idx = (24 * num_boxes[1] + 15) * num_boxes[0] + 24;
+  dgrid.ChangeConcentrationBy(idx, 1);
+
+  auto total = [&]() {
+    double sum = 0;
+    auto* concentrations = dgrid.GetAllConcentrations();
+    for (size_t b = 0; b < dgrid.GetNumBoxes(); b++) {
+      sum += concentrations[b];
+    }
+    return sum;
+  };
+  for (int t = 0; t < 5; t++) {
+    dgrid.Diffuse(1);
+    EXPECT_NEAR(1, total(), ConcentrationError(1e-6));
+  }
+  // Substance has crossed the tile border
+  size_t neighbor = (24 * num_boxes[1] + 16) * num_boxes[0] + 24;
+  EXPECT_LT(0, dgrid.GetAllConcentrations()[neighbor]);
+}
+
+// Tests that the patches of the "amr" method are created around agents and
+// preserve the (steady) linear profile
+TEST(DiffusionTest, AmrAgentRefinement) {
+  auto set_param = [](auto* param) {
+    param->diffusion_boundary_condition = "closed";
+    param->diffusion_amr_block_size = 8;
+    param->diffusion_amr_agent_threshold = 1;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetResourceManager()->AddAgent(new Cell({100, 100, 100}));
+
+  AmrGrid dgrid(0, "Substance", 1, 0, 21);
+  dgrid.SetDomain({0, 200, 0, 200, 0, 200});
+  dgrid.Initialize();
+  dgrid.AddInitializer(
+      [](double x, double y, double z) { return x + 2 * y + 3 * z; });
+  dgrid.RunInitializers();
+  EXPECT_EQ(0u, dgrid.GetNumPatches());
+
+  for (int t = 0; t < 10; t++) {
+    dgrid.Diffuse(1);
+  }
+
+  EXPECT_EQ(1u, dgrid.GetNumPatches());
+  EXPECT_TRUE(dgrid.IsRefined({100, 100, 100}));
+  EXPECT_FALSE(dgrid.IsRefined({10, 10, 10}));
+
+  // Inside the patch, the concentration is resolved with half the box length
+  EXPECT_NEAR(605, dgrid.GetConcentration({105, 100, 100}),
+              ConcentrationError(1e-9, 605));
+  EXPECT_NEAR(600, dgrid.GetConcentration({100, 100, 100}),
+              ConcentrationError(1e-9, 600));
+  EXPECT_NEAR(60, dgrid.GetConcentration({10, 10, 10}),
+              ConcentrationError(1e-9, 60));
+  Double3 gradient;
+  dgrid.GetGradient({105, 100, 100}, &gradient);
+  Double3 expected = {1, 2, 3};
+  expected.Normalize();
+  for (int i = 0; i < 3; i++) {
+    EXPECT_NEAR(expected[i], gradient[i],
+                ConcentrationError(abs_error<double>::value));
+  }
+  // The coarse grid holds the average of the fine boxes
+  auto idx = dgrid.GetBoxIndex(Double3({100, 100, 100}));
+  EXPECT_NEAR(600, dgrid.GetAllConcentrations()[idx],
+              ConcentrationError(1e-9, 600));
+}
+
+// Tests that secretion into a patch adds the same amount of substance as
+// without refinement
+TEST(DiffusionTest, AmrSecretion) {
+  auto set_param = [](auto* param) {
+    param->diffusion_boundary_condition = "closed";
+    param->diffusion_amr_block_size = 8;
+    param->diffusion_amr_agent_threshold = 1;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetResourceManager()->AddAgent(new Cell({120, 120, 120}));
+
+  AmrGrid dgrid(0, "Substance", 1, 0, 21);
+  dgrid.SetDomain({0, 200, 0, 200, 0, 200});
+  dgrid.Initialize();
+  dgrid.Diffuse(1);
+  ASSERT_TRUE(dgrid.IsRefined({120, 120, 120}));
+
+  dgrid.ChangeConcentrationBy({120, 120, 120}, 1);
+  EXPECT_NEAR(8, dgrid.GetConcentration({120, 120, 120}),
+              ConcentrationError(1e-9, 8));
+  EXPECT_NEAR(0, dgrid.GetConcentration({125, 120, 120}),
+              ConcentrationError(1e-9));
+
+  for (int t = 0; t < 5; t++) {
+    dgrid.Diffuse(1);
+  }
+  auto* c = dgrid.GetAllConcentrations();
+  double sum = 0;
+  for (size_t b = 0; b < dgrid.GetNumBoxes(); b++) {
+    sum += c[b];
+  }
+  EXPECT_NEAR(1, sum, ConcentrationError(1e-6));
+  // The substance spreads symmetrically in the patch
+  EXPECT_LT(0, dgrid.GetConcentration({125, 120, 120}));
+  EXPECT_NEAR(dgrid.GetConcentration({125, 120, 120}),
+              dgrid.GetConcentration({115, 120, 120}),
+              ConcentrationError(1e-6));
+  EXPECT_NEAR(dgrid.GetConcentration({120, 125, 120}),
+              dgrid.GetConcentration({120, 120, 115}),
+              ConcentrationError(1e-6));
+}
+
+// Tests the refinement of steep gradients and the removal of patches
+TEST(DiffusionTest, AmrGradientRefinement) {
+  auto set_param = [](auto* param) {
+    param->diffusion_boundary_condition = "closed";
+    param->diffusion_amr_block_size = 8;
+    param->diffusion_amr_agent_threshold = 0;
+    param->diffusion_amr_gradient_threshold = 2.5;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* param = const_cast<Param*>(simulation.GetParam());
+
+  AmrGrid dgrid(0, "Substance", 1, 0, 21);
+  dgrid.SetDomain({0, 200, 0, 200, 0, 200});
+  dgrid.Initialize();
+  dgrid.AddInitializer(
+      [](double x, double y, double z) { return x + 2 * y + 3 * z; });
+  dgrid.RunInitializers();
+
+  // The z-component of the gradient (3) exceeds the threshold everywhere
+  dgrid.Diffuse(1);
+  EXPECT_EQ(27u, dgrid.GetNumPatches());
+  EXPECT_NEAR(5 + 10 + 15, dgrid.GetConcentration({5, 5, 5}),
+              ConcentrationError(1e-9, 30));
+
+  param->diffusion_amr_gradient_threshold = 4;
+  dgrid.Diffuse(1);
+  EXPECT_EQ(0u, dgrid.GetNumPatches());
+  EXPECT_NEAR(0, dgrid.GetConcentration({5, 5, 5}), ConcentrationError(1e-9));
+  EXPECT_NEAR(600, dgrid.GetConcentration({105, 100, 100}),
+              ConcentrationError(1e-9, 600));
+}
+
 TEST(DiffusionTest, DynamicTimeStepping) {
   auto set_param = [](auto* param) {
     param->bound_space = Param::BoundSpaceMode::kClosed;
@@ -588,6 +1378,37 @@ TEST(DiffusionTest, DynamicTimeStepping) {
   EXPECT_FLOAT_EQ(0.3, dgrid->GetLastTimestep());
 }
 
+// Tests that the concentrations are stored in the precision selected with
+// -Dfloat_diffusion, and that secreted substance is not lost in either
+TEST(DiffusionTest, Precision) {
+#ifdef USE_FLOAT_DIFFUSION
+  EXPECT_TRUE((std::is_same<DiffusionReal, float>::value));
+#else
+  EXPECT_TRUE((std::is_same<DiffusionReal, double>::value));
+#endif
+  auto set_param = [](auto* param) {
+    param->bound_space = Param::BoundSpaceMode::kClosed;
+    param->min_bound = -100;
+    param->max_bound = 100;
+    param->diffusion_boundary_condition = "closed";
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetEnvironment()->Update();
+
+  EulerGrid dgrid(0, "Substance", 1, 0, 21);
+  dgrid.Initialize();
+  dgrid.ChangeConcentrationBy(Double3({0, 0, 0}), 1);
+  for (int t = 0; t < 10; t++) {
+    dgrid.Diffuse(1);
+  }
+  double sum = 0;
+  auto* concentrations = dgrid.GetAllConcentrations();
+  for (size_t b = 0; b < dgrid.GetNumBoxes(); b++) {
+    sum += concentrations[b];
+  }
+  EXPECT_NEAR(1, sum, ConcentrationError(1e-6));
+}
+
 TEST(DISABLED_DiffusionTest, RungeKuttaConvergence) {
   auto set_param = [](auto* param) {
     param->bound_space = Param::BoundSpaceMode::kClosed;
@@ -722,7 +1543,7 @@ TEST(DISABLED_DiffusionTest, ModelInitializer) {
   double expected = ROOT::Math::normal_pdf(0, sigma, mean);
   Double3 marker = {0, 0, 0};
   size_t idx = rm->GetDiffusionGrid(kSubstance1)->GetBoxIndex(marker);
-  EXPECT_NEAR(expected, conc->GetTuple(idx)[0], 1e-9);
+  EXPECT_NEAR(expected, conc->GetTuple(idx)[0], ConcentrationError(1e-9));
   remove(filename.c_str());
 }
 
@@ -13,8 +13,11 @@
 // -----------------------------------------------------------------------------
 
 #include "core/environment/uniform_grid_environment.h"
+#include <atomic>
+#include <set>
 #include <sstream>
 #include <string>
+#include <utility>
 #include "core/agent/cell.h"
 #include "core/environment/environment.h"
 #include "core/functor.h"
@@ -329,6 +332,58 @@ TEST(UniformGridEnvironmentDeathTest, CustomBoxLength) {
       "");
 }
 
+TEST(UniformGridEnvironmentTest, ForEachNeighborPair) {
+  Simulation simulation(TEST_NAME);
+  auto* rm = simulation.GetResourceManager();
+  auto* grid =
+      static_cast<UniformGridEnvironment*>(simulation.GetEnvironment());
+
+  CellFactory(rm, 7);
+  grid->Update();
+
+  // expected pairs
+  std::set<std::pair<AgentUid, AgentUid>> expected;
+  rm->ForEachAgent([&](Agent* agent) {
+    auto uid = agent->GetUid();
+    auto add_pair = L2F([&](Agent* neighbor, double) {
+      auto nuid = neighbor->GetUid();
+      if (uid < nuid) {
+        expected.insert({uid, nuid});
+      }
+    });
+    grid->ForEachNeighbor(add_pair, *agent, 900);
+  });
+
+  std::vector<std::atomic<bool>> in_use(rm->GetNumAgents());
+  for (auto& el : in_use) {
+    el = false;
+  }
+  std::vector<std::pair<AgentUid, AgentUid>> actual;
+  std::atomic<bool> concurrent_access(false);
+  auto record_pair = L2F([&](Agent* lhs, AgentHandle lhs_ah, Agent* rhs,
+                             AgentHandle rhs_ah, double squared_distance) {
+    EXPECT_EQ(lhs, rm->GetAgent(lhs_ah));
+    EXPECT_EQ(rhs, rm->GetAgent(rhs_ah));
+    auto lidx = lhs->GetUid().GetIndex();
+    auto ridx = rhs->GetUid().GetIndex();
+    if (in_use[lidx].exchange(true) || in_use[ridx].exchange(true)) {
+      concurrent_access = true;
+    }
+#pragma omp critical
+    actual.push_back(std::minmax(lhs->GetUid(), rhs->GetUid()));
+    in_use[lidx] = false;
+    in_use[ridx] = false;
+  });
+  grid->ForEachNeighborPair(record_pair, 900);
+
+  EXPECT_FALSE(concurrent_access);
+  // each pair must be visited exactly once
+  EXPECT_EQ(expected.size(), actual.size());
+  std::set<std::pair<AgentUid, AgentUid>> actual_set(actual.begin(),
+                                                     actual.end());
+  EXPECT_EQ(expected, actual_set);
+}
+
 struct ZOrderCallback : Functor<void, const AgentHandle&> {
   std::vector<std::set<AgentUid>> zorder;
   uint64_t box_cnt = 0;
@@ -33,6 +33,22 @@ struct CopyExecCtxtOp : public AgentOperationImpl {
 
 BDM_REGISTER_OP(CopyExecCtxtOp, "CopyExecCtxtOp", kCpu);
 
+// -----------------------------------------------------------------------------
+struct CopyExecCtxtGrowOp : public AgentOperationImpl {
+  BDM_OP_HEADER(CopyExecCtxtGrowOp);
+
+  void operator()(Agent* agent) override {
+    agent->SetDiameter(agent->GetDiameter() + 1);
+  }
+};
+
+BDM_REGISTER_OP(CopyExecCtxtGrowOp, "CopyExecCtxtGrowOp", kCpu);
+
+// -----------------------------------------------------------------------------
+void CopyDiameter(const Agent* src, Agent* dest) {
+  dest->SetDiameter(src->GetDiameter());
+}
+
 // -----------------------------------------------------------------------------
 TEST(CopyExecutionContext, Execute) {
   Simulation sim(TEST_NAME);
@@ -68,5 +84,232 @@ TEST(CopyExecutionContext, Execute) {
   delete op;
 }
 
+// -----------------------------------------------------------------------------
+TEST(CopyExecutionContext, DoubleBufferedExecute) {
+  Simulation sim(TEST_NAME);
+  CopyExecutionContext::Use(&sim, CopyDiameter);
+
+  auto* ctxt = sim.GetExecutionContext();
+  auto* rm = sim.GetResourceManager();
+  const auto& all_ctxts = sim.GetAllExecCtxts();
+
+  auto* cell = new Cell(10);
+  auto uid = cell->GetUid();
+  ctxt->AddAgent(cell);
+  ctxt->SetupIterationAll(all_ctxts);
+
+  auto* op = NewOperation("CopyExecCtxtGrowOp");
+  std::vector<Operation*> operations = {op};
+
+  ctxt->SetupAgentOpsAll(all_ctxts);
+  ctxt->Execute(rm->GetAgent(uid), AgentHandle(0, 0), operations);
+  EXPECT_NEAR(10., rm->GetAgent(uid)->GetDiameter(), abs_error<double>::value);
+  ctxt->TearDownAgentOpsAll(all_ctxts);
+  EXPECT_NEAR(11., rm->GetAgent(uid)->GetDiameter(), abs_error<double>::value);
+  auto* next = rm->GetAgent(uid);
+  EXPECT_NE(cell, next);
+
+  // The second agent operation phase must reuse the instance from the first
+  // phase instead of allocating a new copy.
+  ctxt->SetupAgentOpsAll(all_ctxts);
+  ctxt->Execute(rm->GetAgent(uid), AgentHandle(0, 0), operations);
+  EXPECT_NEAR(11., rm->GetAgent(uid)->GetDiameter(), abs_error<double>::value);
+  ctxt->TearDownAgentOpsAll(all_ctxts);
+  EXPECT_NEAR(12., rm->GetAgent(uid)->GetDiameter(), abs_error<double>::value);
+  EXPECT_EQ(cell, rm->GetAgent(uid));
+  EXPECT_EQ(1u, rm->GetNumAgents());
+
+  delete op;
+}
+
+// -----------------------------------------------------------------------------
+TEST(CopyExecutionContext, DoubleBufferedForEachOpForEachAgent) {
+  auto set_param = [](Param* param) {
+    param->execution_order = Param::ExecutionOrder::kForEachOpForEachAgent;
+  };
+  Simulation sim(TEST_NAME, set_param);
+  CopyExecutionContext::Use(&sim, CopyDiameter);
+
+  auto* ctxt = sim.GetExecutionContext();
+  auto* rm = sim.GetResourceManager();
+  const auto& all_ctxts = sim.GetAllExecCtxts();
+
+  auto* cell = new Cell(10);
+  auto uid = cell->GetUid();
+  ctxt->AddAgent(cell);
+  ctxt->SetupIterationAll(all_ctxts);
+
+  auto* op1 = NewOperation("CopyExecCtxtGrowOp");
+  auto* op2 = NewOperation("CopyExecCtxtGrowOp");
+
+  ctxt->SetupAgentOpsAll(all_ctxts);
+  ctxt->Execute(rm->GetAgent(uid), AgentHandle(0, 0), {op1});
+  ctxt->Execute(rm->GetAgent(uid), AgentHandle(0, 0), {op2});
+  EXPECT_NEAR(10., rm->GetAgent(uid)->GetDiameter(), abs_error<double>::value);
+  ctxt->TearDownAgentOpsAll(all_ctxts);
+  EXPECT_NEAR(12., rm->GetAgent(uid)->GetDiameter(), abs_error<double>::value);
+
+  delete op1;
+  delete op2;
+}
+
+// -----------------------------------------------------------------------------
+TEST(CopyExecutionContext, DoubleBufferedSubsetOfAgents) {
+  Simulation sim(TEST_NAME);
+  CopyExecutionContext::Use(&sim, CopyDiameter);
+
+  auto* ctxt = sim.GetExecutionContext();
+  auto* rm = sim.GetResourceManager();
+  const auto& all_ctxts = sim.GetAllExecCtxts();
+
+  auto* cell0 = new Cell(10);
+  auto* cell1 = new Cell(20);
+  auto uid0 = cell0->GetUid();
+  auto uid1 = cell1->GetUid();
+  ctxt->AddAgent(cell0);
+  ctxt->AddAgent(cell1);
+  ctxt->SetupIterationAll(all_ctxts);
+
+  auto* op = NewOperation("CopyExecCtxtGrowOp");
+  std::vector<Operation*> operations = {op};
+
+  // Simulate an agent filter that only selects one agent per phase.
+  ctxt->SetupAgentOpsAll(all_ctxts);
+  auto ah0 = rm->GetAgentHandle(uid0);
+  ctxt->Execute(rm->GetAgent(uid0), ah0, operations);
+  ctxt->TearDownAgentOpsAll(all_ctxts);
+  EXPECT_NEAR(11., rm->GetAgent(uid0)->GetDiameter(),
+              abs_error<double>::value);
+  EXPECT_NEAR(20., rm->GetAgent(uid1)->GetDiameter(),
+              abs_error<double>::value);
+
+  ctxt->SetupAgentOpsAll(all_ctxts);
+  auto ah1 = rm->GetAgentHandle(uid1);
+  ctxt->Execute(rm->GetAgent(uid1), ah1, operations);
+  ctxt->TearDownAgentOpsAll(all_ctxts);
+  EXPECT_NEAR(11., rm->GetAgent(uid0)->GetDiameter(),
+              abs_error<double>::value);
+  EXPECT_NEAR(21., rm->GetAgent(uid1)->GetDiameter(),
+              abs_error<double>::value);
+
+  delete op;
+}
+
+// -----------------------------------------------------------------------------
+TEST(CopyExecutionContext, SubsetOfAgents) {
+  Simulation sim(TEST_NAME);
+  CopyExecutionContext::Use(&sim);
+
+  auto* ctxt = sim.GetExecutionContext();
+  auto* rm = sim.GetResourceManager();
+  const auto& all_ctxts = sim.GetAllExecCtxts();
+
+  auto* cell0 = new Cell(10);
+  auto* cell1 = new Cell(20);
+  auto uid0 = cell0->GetUid();
+  auto uid1 = cell1->GetUid();
+  ctxt->AddAgent(cell0);
+  ctxt->AddAgent(cell1);
+  ctxt->SetupIterationAll(all_ctxts);
+
+  auto* op = NewOperation("CopyExecCtxtGrowOp");
+  std::vector<Operation*> operations = {op};
+
+  // Agents that are not executed must be kept without copy.
+  ctxt->SetupAgentOpsAll(all_ctxts);
+  auto ah0 = rm->GetAgentHandle(uid0);
+  ctxt->Execute(rm->GetAgent(uid0), ah0, operations);
+  ctxt->TearDownAgentOpsAll(all_ctxts);
+  EXPECT_NEAR(11., rm->GetAgent(uid0)->GetDiameter(),
+              abs_error<double>::value);
+  EXPECT_NEAR(20., rm->GetAgent(uid1)->GetDiameter(),
+              abs_error<double>::value);
+  EXPECT_NE(cell0, rm->GetAgent(uid0));
+  EXPECT_EQ(cell1, rm->GetAgent(uid1));
+
+  ctxt->SetupAgentOpsAll(all_ctxts);
+  auto ah1 = rm->GetAgentHandle(uid1);
+  ctxt->Execute(rm->GetAgent(uid1), ah1, operations);
+  ctxt->TearDownAgentOpsAll(all_ctxts);
+  EXPECT_NEAR(11., rm->GetAgent(uid0)->GetDiameter(),
+              abs_error<double>::value);
+  EXPECT_NEAR(21., rm->GetAgent(uid1)->GetDiameter(),
+              abs_error<double>::value);
+  EXPECT_EQ(2u, rm->GetNumAgents());
+
+  delete op;
+}
+
+// -----------------------------------------------------------------------------
+struct CopyExecCtxtGrowLeftOp : public AgentOperationImpl {
+  BDM_OP_HEADER(CopyExecCtxtGrowLeftOp);
+
+  void operator()(Agent* agent) override {
+    if (agent->GetPosition()[0] < 350) {
+      agent->SetDiameter(agent->GetDiameter() + 2);
+    }
+  }
+};
+
+BDM_REGISTER_OP(CopyExecCtxtGrowLeftOp, "CopyExecCtxtGrowLeftOp", kCpu);
+
+// -----------------------------------------------------------------------------
+/// Simulates an overlapping pair of growing cells, an isolated growing cell
+/// and three isolated cells that become static. Returns the position and
+/// diameter of each cell in the order of their uid.
+std::vector<std::pair<Double3, double>> SimulateStaticAgents(
+    const std::string& name, bool copy_ctxt, bool detect_static_agents) {
+  auto set_param = [&](Param* param) {
+    param->detect_static_agents = detect_static_agents;
+  };
+  Simulation sim(name, set_param);
+  if (copy_ctxt) {
+    CopyExecutionContext::Use(&sim);
+  }
+  auto* rm = sim.GetResourceManager();
+  for (double x : {0., 20., 300., 500., 600., 700.}) {
+    auto* cell = new Cell({x, 0, 0});
+    cell->SetDiameter(30);
+    rm->AddAgent(cell);
+  }
+  auto* scheduler = sim.GetScheduler();
+  scheduler->ScheduleOp(NewOperation("CopyExecCtxtGrowLeftOp"));
+  scheduler->Simulate(5);
+
+  std::vector<std::pair<Double3, double>> result(rm->GetNumAgents());
+  rm->ForEachAgent([&](Agent* agent) {
+    result[agent->GetUid().GetIndex()] =
+        std::make_pair(agent->GetPosition(), agent->GetDiameter());
+  });
+  return result;
+}
+
+// -----------------------------------------------------------------------------
+TEST(CopyExecutionContext, StaticAgents) {
+  // Skipping static agents must not change the results. In particular, the
+  // agent operations must run in a single pass, so that the mechanical forces
+  // are calculated with the state of the neighbors before the iteration.
+  auto with_detection = SimulateStaticAgents(TEST_NAME, true, true);
+  auto without_detection = SimulateStaticAgents(TEST_NAME, true, false);
+  // The overlapping pair behaves differently with InPlaceExecutionContext,
+  // because the second cell observes the update of the first one.
+  auto in_place = SimulateStaticAgents(TEST_NAME, false, true);
+
+  ASSERT_EQ(6u, with_detection.size());
+  for (uint64_t i = 0; i < with_detection.size(); ++i) {
+    EXPECT_EQ(without_detection[i].first, with_detection[i].first);
+    EXPECT_EQ(without_detection[i].second, with_detection[i].second);
+    if (i >= 2) {
+      EXPECT_EQ(in_place[i].first, with_detection[i].first);
+      EXPECT_EQ(in_place[i].second, with_detection[i].second);
+    }
+  }
+  // The pair has been pushed apart and the cells on the left have grown.
+  EXPECT_LT(with_detection[0].first[0], 0);
+  EXPECT_GT(with_detection[1].first[0], 20);
+  EXPECT_NEAR(40., with_detection[2].second, abs_error<double>::value);
+  EXPECT_NEAR(30., with_detection[5].second, abs_error<double>::value);
+}
+
 }  // namespace experimental
 }  // namespace bdm
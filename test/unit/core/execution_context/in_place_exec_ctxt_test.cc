@@ -15,6 +15,7 @@
 #include <gtest/gtest.h>
 
 #include "core/agent/cell.h"
+#include "core/behavior/behavior.h"
 #include "core/environment/environment.h"
 #include "core/execution_context/in_place_exec_ctxt.h"
 #include "core/model_initializer.h"
@@ -471,5 +472,203 @@ TEST(InPlaceExecutionContext, ForEachNeighbor) {
   all_exec_ctxts[0]->ForEachNeighbor(for_each, *agent0, 400);
 }
 
+struct DeterministicDivideOp : public AgentOperationImpl {
+  BDM_OP_HEADER(DeterministicDivideOp);
+
+  void operator()(Agent* agent) override {
+    auto* daughter = new Cell(agent->GetDiameter() + 1);
+    Simulation::GetActive()->GetExecutionContext()->AddAgent(daughter);
+  }
+};
+
+BDM_REGISTER_OP(DeterministicDivideOp, "DeterministicDivideOp", kCpu);
+
+TEST(InPlaceExecutionContext, DeterministicNewAgentOrder) {
+  Simulation sim(TEST_NAME,
+                 [](Param* param) { param->deterministic_mode = true; });
+  auto* rm = sim.GetResourceManager();
+  auto* ctxt = sim.GetExecutionContext();
+
+  auto* cell_0 = new Cell(10);
+  auto* cell_1 = new Cell(20);
+  rm->AddAgent(cell_0);
+  rm->AddAgent(cell_1);
+  auto uid_1 = cell_1->GetUid();
+
+  auto* op = NewOperation("DeterministicDivideOp");
+  std::vector<Operation*> operations = {op};
+  // Process the agents in reverse order
+  ctxt->Execute(cell_1, rm->GetAgentHandle(uid_1), operations);
+  ctxt->Execute(cell_0, rm->GetAgentHandle(cell_0->GetUid()), operations);
+  ctxt->TearDownIterationAll(sim.GetAllExecCtxts());
+
+  // The daughter of cell_0 must obtain the lower uid
+  ASSERT_EQ(4u, rm->GetNumAgents());
+  EXPECT_EQ(11, rm->GetAgent(uid_1 + 1)->GetDiameter());
+  EXPECT_EQ(21, rm->GetAgent(uid_1 + 2)->GetDiameter());
+
+  delete op;
+}
+
+/// Stores a pointer to the daughter that was created in the same iteration
+struct DaughterPointer : public Behavior {
+  DaughterPointer() {}
+
+  virtual ~DaughterPointer() {}
+
+  void Run(Agent* agent) override {}
+
+  Behavior* New() const override { return new DaughterPointer(); }
+  Behavior* NewCopy() const override { return new DaughterPointer(*this); }
+
+  void RemapUids(
+      const std::unordered_map<AgentUid, AgentUid>& new_uids) override {
+    daughter_.RemapUid(new_uids);
+  }
+
+  AgentPointer<Cell> daughter_;
+};
+
+struct DeterministicDividePointerOp : public AgentOperationImpl {
+  BDM_OP_HEADER(DeterministicDividePointerOp);
+
+  void operator()(Agent* agent) override {
+    auto* daughter = new Cell(agent->GetDiameter() + 1);
+    Simulation::GetActive()->GetExecutionContext()->AddAgent(daughter);
+    auto* behavior =
+        bdm_static_cast<DaughterPointer*>(agent->GetAllBehaviors()[0]);
+    behavior->daughter_ = daughter->GetAgentPtr<Cell>();
+  }
+};
+
+BDM_REGISTER_OP(DeterministicDividePointerOp, "DeterministicDividePointerOp",
+                kCpu);
+
+TEST(InPlaceExecutionContext, DeterministicNewAgentPointers) {
+  Simulation sim(TEST_NAME,
+                 [](Param* param) { param->deterministic_mode = true; });
+  auto* rm = sim.GetResourceManager();
+  auto* ctxt = sim.GetExecutionContext();
+
+  auto* cell_0 = new Cell(10);
+  auto* cell_1 = new Cell(20);
+  cell_0->AddBehavior(new DaughterPointer());
+  cell_1->AddBehavior(new DaughterPointer());
+  rm->AddAgent(cell_0);
+  rm->AddAgent(cell_1);
+
+  auto* op = NewOperation("DeterministicDividePointerOp");
+  std::vector<Operation*> operations = {op};
+  // Process the agents in reverse order. The daughters swap their uids.
+  ctxt->Execute(cell_1, rm->GetAgentHandle(cell_1->GetUid()), operations);
+  ctxt->Execute(cell_0, rm->GetAgentHandle(cell_0->GetUid()), operations);
+  ctxt->TearDownIterationAll(sim.GetAllExecCtxts());
+
+  ASSERT_EQ(4u, rm->GetNumAgents());
+  auto* behavior_0 =
+      bdm_static_cast<DaughterPointer*>(cell_0->GetAllBehaviors()[0]);
+  auto* behavior_1 =
+      bdm_static_cast<DaughterPointer*>(cell_1->GetAllBehaviors()[0]);
+  EXPECT_EQ(cell_1->GetUid() + 1, behavior_0->daughter_.GetUid());
+  EXPECT_EQ(11, behavior_0->daughter_->GetDiameter());
+  EXPECT_EQ(21, behavior_1->daughter_->GetDiameter());
+
+  delete op;
+}
+
+/// Stores a pointer to each new daughter in the behavior of `observer_`
+struct DeterministicObserverOp : public AgentOperationImpl {
+  BDM_OP_HEADER(DeterministicObserverOp);
+
+  void operator()(Agent* agent) override {
+    auto* daughter = new Cell(agent->GetDiameter() + 1);
+    Simulation::GetActive()->GetExecutionContext()->AddAgent(daughter);
+    if (agent->GetDiameter() == 20) {
+      auto* behavior =
+          bdm_static_cast<DaughterPointer*>(observer_->GetAllBehaviors()[0]);
+      behavior->daughter_ = daughter->GetAgentPtr<Cell>();
+    }
+  }
+
+  AgentPointer<Cell> observer_;
+};
+
+BDM_REGISTER_OP(DeterministicObserverOp, "DeterministicObserverOp", kCpu);
+
+TEST(InPlaceExecutionContext, DeterministicRemapStoredPointer) {
+  Simulation sim(TEST_NAME,
+                 [](Param* param) { param->deterministic_mode = true; });
+  auto* rm = sim.GetResourceManager();
+  auto* ctxt = sim.GetExecutionContext();
+
+  // The observer is not involved in the creation of the new agents
+  auto* observer = new Cell(5);
+  observer->AddBehavior(new DaughterPointer());
+  rm->AddAgent(observer);
+  auto* cell_0 = new Cell(10);
+  auto* cell_1 = new Cell(20);
+  rm->AddAgent(cell_0);
+  rm->AddAgent(cell_1);
+  auto cell_1_ptr = cell_1->GetAgentPtr<Cell>();
+
+  auto* op = NewOperation("DeterministicObserverOp");
+  op->GetImplementation<DeterministicObserverOp>()->observer_ =
+      observer->GetAgentPtr<Cell>();
+  std::vector<Operation*> operations = {op};
+  // Process the agents in reverse order. The daughters swap their uids.
+  ctxt->Execute(cell_1, rm->GetAgentHandle(cell_1->GetUid()), operations);
+  ctxt->Execute(cell_0, rm->GetAgentHandle(cell_0->GetUid()), operations);
+  auto preliminary_uid =
+      bdm_static_cast<DaughterPointer*>(observer->GetAllBehaviors()[0])
+          ->daughter_.GetUid();
+  ctxt->TearDownIterationAll(sim.GetAllExecCtxts());
+
+  ASSERT_EQ(5u, rm->GetNumAgents());
+  auto& daughter =
+      bdm_static_cast<DaughterPointer*>(observer->GetAllBehaviors()[0])
+          ->daughter_;
+  EXPECT_NE(preliminary_uid, daughter.GetUid());
+  EXPECT_EQ(cell_1->GetUid() + 2, daughter.GetUid());
+  EXPECT_EQ(21, daughter->GetDiameter());
+  EXPECT_EQ(rm->GetAgent(daughter.GetUid()), daughter.Get());
+  // Pointers to agents that existed before the iteration are unaffected
+  EXPECT_EQ(cell_1, cell_1_ptr.Get());
+
+  delete op;
+}
+
+struct DeterministicRandomOp : public AgentOperationImpl {
+  BDM_OP_HEADER(DeterministicRandomOp);
+
+  void operator()(Agent* agent) override {
+    agent->SetDiameter(Simulation::GetActive()->GetRandom()->Uniform());
+  }
+};
+
+BDM_REGISTER_OP(DeterministicRandomOp, "DeterministicRandomOp", kCpu);
+
+TEST(InPlaceExecutionContext, DeterministicRandomStreams) {
+  Simulation sim(TEST_NAME,
+                 [](Param* param) { param->deterministic_mode = true; });
+  auto* ctxt = sim.GetExecutionContext();
+
+  Cell cell_0;
+  Cell cell_1;
+
+  auto* op = NewOperation("DeterministicRandomOp");
+  std::vector<Operation*> operations = {op};
+  ctxt->Execute(&cell_0, AgentHandle(0, 0), operations);
+  ctxt->Execute(&cell_1, AgentHandle(0, 1), operations);
+  auto first = cell_0.GetDiameter();
+  EXPECT_NE(first, cell_1.GetDiameter());
+
+  // The random numbers depend on the agent, not on the previous draws of
+  // this thread
+  ctxt->Execute(&cell_0, AgentHandle(0, 0), operations);
+  EXPECT_EQ(first, cell_0.GetDiameter());
+
+  delete op;
+}
+
 }  // namespace in_place_exec_ctxt_detail
 }  // namespace bdm
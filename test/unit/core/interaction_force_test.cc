@@ -13,6 +13,7 @@
 // -----------------------------------------------------------------------------
 
 #include "core/interaction_force.h"
+#include <cmath>
 #include "core/agent/cell.h"
 #include "gtest/gtest.h"
 #include "neuroscience/module.h"
@@ -88,6 +89,212 @@ TEST(InteractionForce, AllAtSamePositionSphere) {
   EXPECT_NEAR(0, result[2], 3);
 }
 
+/// Tests if the batch version computes the same forces as `Calculate`
+TEST(InteractionForce, SphereBatch) {
+  Simulation simulation(TEST_NAME);
+  auto* random = simulation.GetRandom();
+
+  Cell cell({1.1, 1.0, 0.9});
+  cell.SetDiameter(8);
+
+  const uint64_t size = 37;
+  std::vector<Cell> neighbors;
+  neighbors.reserve(size);
+  std::vector<const Agent*> agents;
+  std::vector<double> x, y, z, diameter;
+  for (uint64_t i = 0; i < size; ++i) {
+    // includes overlapping and non-overlapping neighbors
+    neighbors.emplace_back(random->UniformArray<3>(-10, 10));
+    neighbors.back().SetDiameter(random->Uniform(2, 10));
+  }
+  // centers at the same location
+  neighbors[5].SetPosition(cell.GetPosition());
+  for (auto& nb : neighbors) {
+    agents.push_back(&nb);
+    x.push_back(nb.GetPosition()[0]);
+    y.push_back(nb.GetPosition()[1]);
+    z.push_back(nb.GetPosition()[2]);
+    diameter.push_back(nb.GetDiameter());
+  }
+  SphereBatch batch;
+  batch.size = size;
+  batch.agents = agents.data();
+  batch.x = x.data();
+  batch.y = y.data();
+  batch.z = z.data();
+  batch.diameter = diameter.data();
+
+  InteractionForce force;
+  std::vector<double> fx(size), fy(size), fz(size);
+  force.CalculateBatch(&cell, batch, fx.data(), fy.data(), fz.data());
+
+  for (uint64_t i = 0; i < size; ++i) {
+    if (i == 5) {
+      // random number must be in interval [-3.0, 3.0]
+      EXPECT_NEAR(0, fx[i], 3);
+      EXPECT_NEAR(0, fy[i], 3);
+      EXPECT_NEAR(0, fz[i], 3);
+      continue;
+    }
+    auto expected = force.Calculate(&cell, &neighbors[i]);
+    EXPECT_NEAR(expected[0], fx[i], abs_error<double>::value);
+    EXPECT_NEAR(expected[1], fy[i], abs_error<double>::value);
+    EXPECT_NEAR(expected[2], fz[i], abs_error<double>::value);
+  }
+}
+
+/// Tests the per-type-pair parameters of the sphere-sphere force
+TEST(InteractionForce, TypeParameters) {
+  auto set_param = [](Param* param) {
+    param->interaction_force_repulsion = {2, 3, 3, 2};
+    param->interaction_force_attraction = {1, 0.5, 0.5, 1};
+    param->interaction_force_iof_coefficient = {0.15, 0.1, 0.1, 0.15};
+  };
+  Simulation simulation(TEST_NAME, set_param);
+
+  Cell cell({1.1, 1.0, 0.9});
+  cell.SetDiameter(8);
+  Cell nb({0, 0, 0});
+  nb.SetDiameter(5);
+
+  InteractionForce force;
+  force.SetParameters(simulation.GetParam());
+  EXPECT_EQ(2u, force.GetNumInteractionTypes());
+  EXPECT_FALSE(force.HasDefaultParameters());
+
+  // type pair (0, 0) uses the default parameters
+  auto result = force.Calculate(&cell, &nb);
+  EXPECT_NEAR(7.1429184067241138, result[0], abs_error<double>::value);
+  EXPECT_NEAR(6.4935621879310119, result[1], abs_error<double>::value);
+  EXPECT_NEAR(5.8442059691379109, result[2], abs_error<double>::value);
+
+  nb.SetInteractionType(1);
+  result = force.Calculate(&cell, &nb);
+  double r1 = 4 + 1;
+  double r2 = 2.5 + 1;
+  double distance = std::sqrt(1.1 * 1.1 + 1.0 * 1.0 + 0.9 * 0.9);
+  double delta = r1 + r2 - distance;
+  double module =
+      (3 * delta - 0.5 * std::sqrt(r1 * r2 / (r1 + r2) * delta)) / distance;
+  EXPECT_NEAR(module * 1.1, result[0], abs_error<double>::value);
+  EXPECT_NEAR(module * 1.0, result[1], abs_error<double>::value);
+  EXPECT_NEAR(module * 0.9, result[2], abs_error<double>::value);
+
+  // the batch version must use the same parameters
+  const Agent* agents[2] = {&nb, &nb};
+  double x[2] = {0, 0};
+  double y[2] = {0, 0};
+  double z[2] = {0, 0};
+  double diameter[2] = {5, 5};
+  uint8_t type[2] = {0, 1};
+  SphereBatch batch;
+  batch.size = 2;
+  batch.agents = agents;
+  batch.x = x;
+  batch.y = y;
+  batch.z = z;
+  batch.diameter = diameter;
+  batch.type = type;
+  double fx[2], fy[2], fz[2];
+  force.CalculateBatch(&cell, batch, fx, fy, fz);
+  EXPECT_NEAR(7.1429184067241138, fx[0], abs_error<double>::value);
+  EXPECT_NEAR(module * 1.1, fx[1], abs_error<double>::value);
+  EXPECT_NEAR(module * 1.0, fy[1], abs_error<double>::value);
+  EXPECT_NEAR(module * 0.9, fz[1], abs_error<double>::value);
+
+  // types outside of the table use the parameters of type 0
+  nb.SetInteractionType(7);
+  result = force.Calculate(&cell, &nb);
+  EXPECT_NEAR(7.1429184067241138, result[0], abs_error<double>::value);
+}
+
+TEST(InteractionForce, UpdateParameters) {
+  Simulation simulation(TEST_NAME);
+  auto* param = const_cast<Param*>(simulation.GetParam());
+
+  InteractionForce force;
+  EXPECT_FALSE(force.UpdateParameters(param));
+  EXPECT_TRUE(force.IsSymmetric());
+
+  param->interaction_force_repulsion = {2, 1.5, 1, 2};
+  EXPECT_TRUE(force.UpdateParameters(param));
+  EXPECT_EQ(2u, force.GetNumInteractionTypes());
+  EXPECT_FALSE(force.IsSymmetric());
+  EXPECT_FALSE(force.UpdateParameters(param));
+
+  param->interaction_force_repulsion = {2, 1.5, 1.5, 2};
+  EXPECT_TRUE(force.UpdateParameters(param));
+  EXPECT_TRUE(force.IsSymmetric());
+}
+
+/// Tests if the cylinder batch version computes the same forces as
+/// `Calculate`
+TEST(InteractionForce, CylinderBatch) {
+  neuroscience::InitModule();
+  Simulation simulation(TEST_NAME);
+  auto* random = simulation.GetRandom();
+
+  NeuriteElement cylinder;
+  cylinder.SetMassLocation({1, 2, 3});
+  cylinder.SetSpringAxis({-6, 1, 2});
+  cylinder.SetDiameter(3);
+
+  const uint64_t size = 41;
+  std::vector<NeuriteElement> neighbors(size);
+  for (uint64_t i = 0; i < size; ++i) {
+    // includes overlapping and non-overlapping neighbors
+    neighbors[i].SetMassLocation(random->UniformArray<3>(-8, 8));
+    neighbors[i].SetSpringAxis(random->UniformArray<3>(-5, 5));
+    neighbors[i].SetDiameter(random->Uniform(1, 4));
+  }
+  // parallel to the reference cylinder
+  neighbors[3].SetMassLocation({1, 4, 3});
+  neighbors[3].SetSpringAxis({-6, 1, 2});
+
+  std::vector<const Agent*> agents;
+  std::vector<double> px, py, pz, dx, dy, dz, diameter;
+  for (auto& nb : neighbors) {
+    agents.push_back(&nb);
+    px.push_back(nb.ProximalEnd()[0]);
+    py.push_back(nb.ProximalEnd()[1]);
+    pz.push_back(nb.ProximalEnd()[2]);
+    dx.push_back(nb.DistalEnd()[0]);
+    dy.push_back(nb.DistalEnd()[1]);
+    dz.push_back(nb.DistalEnd()[2]);
+    diameter.push_back(nb.GetDiameter());
+  }
+  CylinderBatch batch;
+  batch.size = size;
+  batch.agents = agents.data();
+  batch.px = px.data();
+  batch.py = py.data();
+  batch.pz = pz.data();
+  batch.dx = dx.data();
+  batch.dy = dy.data();
+  batch.dz = dz.data();
+  batch.diameter = diameter.data();
+
+  InteractionForce force;
+  std::vector<double> fx(size), fy(size), fz(size), proportion(size);
+  force.CalculateCylinderBatch(&cylinder, batch, fx.data(), fy.data(),
+                               fz.data(), proportion.data());
+
+  uint64_t num_non_zero = 0;
+  for (uint64_t i = 0; i < size; ++i) {
+    auto expected = force.Calculate(&cylinder, &neighbors[i]);
+    EXPECT_NEAR(expected[0], fx[i], 1e-8);
+    EXPECT_NEAR(expected[1], fy[i], 1e-8);
+    EXPECT_NEAR(expected[2], fz[i], 1e-8);
+    // the proportion is only relevant for non-zero forces
+    if (expected[0] != 0 || expected[1] != 0 || expected[2] != 0) {
+      EXPECT_NEAR(expected[3], proportion[i], 1e-8);
+      num_non_zero++;
+    }
+  }
+  EXPECT_LT(0u, num_non_zero);
+  EXPECT_GT(size, num_non_zero);
+}
+
 /// Tests the forces that are created between the reference sphere and its
 /// overlapping cylinder
 TEST(DISABLED_Force, GeneralSphereCylinder) {
@@ -26,5 +26,309 @@ TEST(DisplacementOpTest, ComputeNewUniformGrid) { RunTest2("uniform_grid"); }
 TEST(DisplacementOpTest, ComputeNewKDTree) { RunTest2("kd_tree"); }
 TEST(DisplacementOpTest, ComputeNewOctree) { RunTest2("octree"); }
 
+TEST(DisplacementOpTest, ComputePairwise) {
+  auto set_param = [&](auto* param) {
+    param->environment = "uniform_grid";
+    param->mechanics_pairwise = true;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+
+  Cell* cell0 = new Cell();
+  cell0->SetAdherence(0.3);
+  cell0->SetDiameter(9);
+  cell0->SetMass(1.4);
+  cell0->SetPosition({0, 0, 0});
+  rm->AddAgent(cell0);
+
+  Cell* cell1 = new Cell();
+  cell1->SetAdherence(0.4);
+  cell1->SetDiameter(11);
+  cell1->SetMass(1.1);
+  cell1->SetPosition({0, 5, 0});
+  rm->AddAgent(cell1);
+
+  simulation.GetEnvironment()->Update();
+
+  auto uid0 = cell0->GetUid();
+  auto uid1 = cell1->GetUid();
+  auto* ctxt = simulation.GetExecutionContext();
+  auto* op = NewOperation("mechanical forces");
+  op->SetUp();
+  ctxt->Execute(rm->GetAgent(uid0), rm->GetAgentHandle(uid0), {op});
+  ctxt->Execute(rm->GetAgent(uid1), rm->GetAgentHandle(uid1), {op});
+  op->TearDown();
+
+  // The force is calculated once from the initial positions. Therefore,
+  // the result for cell 0 is the same as in `RunTest`, and cell 1 is pushed
+  // away with the opposite force.
+  auto displacement0 = -0.07797206232558615;
+  auto displacement1 = -displacement0 * cell0->GetMass() / cell1->GetMass();
+  EXPECT_ARR_NEAR(rm->GetAgent(uid0)->GetPosition(), {0, displacement0, 0});
+  EXPECT_ARR_NEAR(rm->GetAgent(uid1)->GetPosition(),
+                  {0, 5 + displacement1, 0});
+
+  delete op;
+}
+
+TEST(DisplacementOpTest, PairwiseAntisymmetry) {
+  auto set_param = [&](auto* param) {
+    param->environment = "uniform_grid";
+    param->mechanics_pairwise = true;
+    param->simulation_max_displacement = 1e6;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+
+  // Overlapping cells of different sizes and masses
+  for (int x = 0; x < 3; ++x) {
+    for (int y = 0; y < 3; ++y) {
+      for (int z = 0; z < 3; ++z) {
+        Cell* cell = new Cell();
+        cell->SetAdherence(0);
+        cell->SetDiameter(9 + (x + 2 * y + 3 * z) % 4);
+        cell->SetMass(1 + 0.1 * ((x + y + z) % 3));
+        cell->SetPosition({x * 8. + 0.1 * y, y * 8. + 0.2 * z, z * 8.});
+        rm->AddAgent(cell);
+      }
+    }
+  }
+  simulation.GetEnvironment()->Update();
+
+  // The interaction force must be antisymmetric
+  InteractionForce force;
+  rm->ForEachAgent([&](Agent* lhs) {
+    rm->ForEachAgent([&](Agent* rhs) {
+      if (lhs == rhs) {
+        return;
+      }
+      auto f_lhs = force.Calculate(lhs, rhs);
+      auto f_rhs = force.Calculate(rhs, lhs);
+      for (int i = 0; i < 3; ++i) {
+        EXPECT_NEAR(f_lhs[i], -f_rhs[i], abs_error<double>::value);
+      }
+    });
+  });
+
+  std::vector<Double3> positions;
+  rm->ForEachAgent(
+      [&](Agent* agent) { positions.push_back(agent->GetPosition()); });
+
+  auto* ctxt = simulation.GetExecutionContext();
+  auto* op = NewOperation("mechanical forces");
+  op->SetUp();
+  rm->ForEachAgent([&](Agent* agent, AgentHandle ah) {
+    ctxt->Execute(agent, ah, {op});
+  });
+  op->TearDown();
+
+  // Each pair of forces cancels out: the total momentum is zero
+  Double3 momentum = {0, 0, 0};
+  uint64_t idx = 0;
+  rm->ForEachAgent([&](Agent* agent) {
+    auto* cell = bdm_static_cast<Cell*>(agent);
+    momentum += (cell->GetPosition() - positions[idx++]) * cell->GetMass();
+  });
+  EXPECT_ARR_NEAR(momentum, {0, 0, 0});
+
+  delete op;
+}
+
+TEST(DisplacementOpTest, ComputeSoa) {
+  auto set_param = [&](auto* param) {
+    param->environment = "uniform_grid";
+    param->compute_target = "cpu-soa";
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+
+  Cell* cell0 = new Cell();
+  cell0->SetAdherence(0.3);
+  cell0->SetDiameter(9);
+  cell0->SetMass(1.4);
+  cell0->SetPosition({0, 0, 0});
+  rm->AddAgent(cell0);
+
+  Cell* cell1 = new Cell();
+  cell1->SetAdherence(0.4);
+  cell1->SetDiameter(11);
+  cell1->SetMass(1.1);
+  cell1->SetPosition({0, 5, 0});
+  rm->AddAgent(cell1);
+
+  simulation.GetEnvironment()->Update();
+
+  auto uid0 = cell0->GetUid();
+  auto uid1 = cell1->GetUid();
+  auto* op = NewOperation("mechanical forces");
+  ASSERT_TRUE(op->IsComputeTargetSupported(kCpuSoa));
+  op->SelectComputeTarget(kCpuSoa);
+  ASSERT_TRUE(op->IsStandalone());
+  op->SetUp();
+  (*op)();
+  op->TearDown();
+
+  // All forces are calculated from the initial positions (same result as
+  // in `ComputePairwise`)
+  auto displacement0 = -0.07797206232558615;
+  auto displacement1 = -displacement0 * cell0->GetMass() / cell1->GetMass();
+  EXPECT_ARR_NEAR(rm->GetAgent(uid0)->GetPosition(), {0, displacement0, 0});
+  EXPECT_ARR_NEAR(rm->GetAgent(uid1)->GetPosition(),
+                  {0, 5 + displacement1, 0});
+
+  delete op;
+}
+
+struct NoForce : public InteractionForce {
+  Double4 Calculate(const Agent* lhs, const Agent* rhs) const override {
+    return {0, 0, 0, 0};
+  }
+  InteractionForce* NewCopy() const override { return new NoForce(*this); }
+};
+
+TEST(DisplacementOpDeathTest, SoaCustomForce) {
+  ASSERT_DEATH(
+      {
+        auto set_param = [&](auto* param) {
+          param->environment = "uniform_grid";
+          param->compute_target = "cpu-soa";
+        };
+        Simulation simulation(TEST_NAME, set_param);
+        simulation.GetResourceManager()->AddAgent(new Cell(10));
+        auto* scheduler = simulation.GetScheduler();
+        auto* op = scheduler->GetOps("mechanical forces")[0];
+        op->GetImplementation<MechanicalForcesOp>()->SetInteractionForce(
+            new NoForce());
+        scheduler->Simulate(1);
+      },
+      ".*only supports the default InteractionForce.*");
+}
+
+TEST(DisplacementOpDeathTest, NullForce) {
+  ASSERT_DEATH(
+      {
+        Simulation simulation(TEST_NAME);
+        simulation.GetResourceManager()->AddAgent(new Cell(10));
+        auto* scheduler = simulation.GetScheduler();
+        auto* op = scheduler->GetOps("mechanical forces")[0];
+        op->GetImplementation<MechanicalForcesOp>()->SetInteractionForce(
+            nullptr);
+        scheduler->Simulate(1);
+      },
+      ".*No interaction force has been set.*");
+}
+
+TEST(DisplacementOpTest, ComputeImplicit) {
+  auto set_param = [&](auto* param) {
+    param->environment = "uniform_grid";
+    param->mechanics_integrator = "implicit";
+    param->simulation_time_step = 1.0;
+  };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+
+  Cell* cell0 = new Cell();
+  cell0->SetAdherence(0.3);
+  cell0->SetDiameter(9);
+  cell0->SetMass(1.4);
+  cell0->SetPosition({0, 0, 0});
+  rm->AddAgent(cell0);
+
+  Cell* cell1 = new Cell();
+  cell1->SetAdherence(0.4);
+  cell1->SetDiameter(11);
+  cell1->SetMass(1.1);
+  cell1->SetPosition({0, 5, 0});
+  rm->AddAgent(cell1);
+
+  simulation.GetEnvironment()->Update();
+
+  auto uid0 = cell0->GetUid();
+  auto uid1 = cell1->GetUid();
+  auto* op = NewOperation("mechanical forces");
+  ASSERT_TRUE(op->IsComputeTargetSupported(kCpuImplicit));
+  op->SelectComputeTarget(kCpuImplicit);
+  ASSERT_TRUE(op->IsStandalone());
+  op->SetUp();
+  (*op)();
+  op->TearDown();
+
+  // With this time step the explicit update would push the cells far beyond
+  // their equilibrium distance (approx. 12.19). The implicit update
+  // separates them without overshooting.
+  auto pos0 = rm->GetAgent(uid0)->GetPosition();
+  auto pos1 = rm->GetAgent(uid1)->GetPosition();
+  EXPECT_NEAR(-2.1469946738787526, pos0[1], 1e-8);
+  EXPECT_NEAR(5 + 2.5988954400797315, pos1[1], 1e-8);
+  EXPECT_NEAR(0, pos0[0], abs_error<double>::value);
+  EXPECT_NEAR(0, pos1[2], abs_error<double>::value);
+  EXPECT_LT(pos1[1] - pos0[1], 12.19);
+
+  delete op;
+}
+
+// Returns the distance between the two cells of `ComputeImplicit` after each
+// of `steps` iterations
+std::vector<double> RunTwoCells(const std::string& integrator, double dt,
+                                uint64_t steps) {
+  auto set_param = [&](auto* param) {
+    param->environment = "uniform_grid";
+    param->mechanics_integrator = integrator;
+    param->simulation_time_step = dt;
+    // Don't mask the instability of the explicit update
+    param->simulation_max_displacement = 1e6;
+  };
+  Simulation simulation("mechanical_forces_op_test_RunTwoCells", set_param);
+  auto* rm = simulation.GetResourceManager();
+
+  Cell* cell0 = new Cell();
+  cell0->SetAdherence(0.3);
+  cell0->SetDiameter(9);
+  cell0->SetMass(1.4);
+  cell0->SetPosition({0, 0, 0});
+  rm->AddAgent(cell0);
+
+  Cell* cell1 = new Cell();
+  cell1->SetAdherence(0.4);
+  cell1->SetDiameter(11);
+  cell1->SetMass(1.1);
+  cell1->SetPosition({0, 5, 0});
+  rm->AddAgent(cell1);
+
+  auto uid0 = cell0->GetUid();
+  auto uid1 = cell1->GetUid();
+  std::vector<double> distances;
+  for (uint64_t i = 0; i < steps; ++i) {
+    simulation.GetScheduler()->Simulate(1);
+    auto diff = rm->GetAgent(uid1)->GetPosition() -
+                rm->GetAgent(uid0)->GetPosition();
+    distances.push_back(diff.Norm());
+  }
+  return distances;
+}
+
+TEST(DisplacementOpTest, ImplicitLargeTimeStep) {
+  // Equilibrium distance of the two cells (approx. 12.19). The interaction
+  // range (sum of the radii including the additional radius) is 13.
+  double equilibrium = 12.19;
+  double dt = 10;
+
+  // The explicit update throws the cells out of their interaction range.
+  auto explicit_distances = RunTwoCells("explicit", dt, 20);
+  EXPECT_GT(explicit_distances.back(), 2 * equilibrium);
+
+  // The implicit update separates the cells without overshooting and
+  // converges towards the equilibrium distance. The remaining gap is caused
+  // by the adherence, which stops the cells once the force is small enough.
+  auto implicit_distances = RunTwoCells("implicit", dt, 20);
+  double previous = 5;
+  for (auto distance : implicit_distances) {
+    EXPECT_GE(distance, previous - abs_error<double>::value);
+    EXPECT_LT(distance, 13);
+    previous = distance;
+  }
+  EXPECT_NEAR(equilibrium, implicit_distances.back(), 0.5);
+}
+
 }  // namespace mechanical_forces_op_test_internal
 }  // namespace bdm
@@ -22,6 +22,41 @@ namespace bdm {
 
 TEST(ResourceManagerTest, ForEachAgent) { RunForEachAgentTest(); }
 
+TEST(ResourceManagerTest, ActiveAgents) {
+  Simulation simulation(TEST_NAME);
+  auto* rm = simulation.GetResourceManager();
+
+  for (int i = 0; i < 10; ++i) {
+    rm->AddAgent(new TestAgent(i));
+  }
+
+  rm->ClearActiveAgents();
+  EXPECT_EQ(0u, rm->GetActiveAgents().size());
+
+  // add all agents with odd data in parallel
+  auto add = L2F([&](Agent* a) {
+    if (bdm_static_cast<TestAgent*>(a)->GetData() % 2 == 1) {
+      rm->AddActiveAgent(a);
+    }
+  });
+  rm->ForEachAgentParallel(add);
+
+  const auto& active = rm->GetActiveAgents();
+  ASSERT_EQ(5u, active.size());
+  std::set<int> data;
+  for (auto ah : active) {
+    data.insert(bdm_static_cast<TestAgent*>(rm->GetAgent(ah))->GetData());
+  }
+  EXPECT_EQ(std::set<int>({1, 3, 5, 7, 9}), data);
+
+  // agents that are added later are appended
+  rm->AddActiveAgent(rm->GetAgent(AgentHandle(0, 0)));
+  EXPECT_EQ(6u, rm->GetActiveAgents().size());
+
+  rm->ClearActiveAgents();
+  EXPECT_EQ(0u, rm->GetActiveAgents().size());
+}
+
 TEST(ResourceManagerTest, ForEachAgentFilter) {
   Simulation simulation(TEST_NAME);
   auto* rm = simulation.GetResourceManager();
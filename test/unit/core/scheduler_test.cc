@@ -13,8 +13,12 @@
 // -----------------------------------------------------------------------------
 
 #include "unit/core/scheduler_test.h"
+
+#include <algorithm>
+
 #include "core/environment/uniform_grid_environment.h"
 #include "core/model_initializer.h"
+#include "core/operation/agent_subset.h"
 #include "core/operation/operation_registry.h"
 #include "unit/test_util/test_agent.h"
 
@@ -575,6 +579,291 @@ TEST_F(SchedulerTest, Filters) {
   EXPECT_EQ(1u, op3_impl->counter);
 }
 
+// -----------------------------------------------------------------------------
+TEST_F(SchedulerTest, AdaptiveFrequency) {
+  Simulation simulation(TEST_NAME);
+  simulation.GetResourceManager()->AddAgent(new Cell(10));
+
+  auto* op = NewOperation("test_op");
+  auto* op_impl = op->GetImplementation<TestOp>();
+  double metric = 0;
+  op->SetAdaptiveFrequency([&]() { return metric; }, 1, 2, 1, 4);
+
+  auto* scheduler = simulation.GetScheduler();
+  scheduler->ScheduleOp(op);
+
+  // metric below the lower threshold: frequency 1 -> 2 (step 0) -> 4 (step 2)
+  // -> op is executed in steps 0 and 4
+  scheduler->Simulate(5);
+  EXPECT_EQ(4u, op->frequency_);
+  EXPECT_EQ(2u, op_impl->counter);
+
+  // metric above the upper threshold: frequency 4 -> 2 (step 8)
+  metric = 3;
+  scheduler->Simulate(4);
+  EXPECT_EQ(2u, op->frequency_);
+  EXPECT_EQ(3u, op_impl->counter);
+
+  // metric within the thresholds: frequency remains unchanged
+  metric = 1.5;
+  scheduler->Simulate(4);
+  EXPECT_EQ(2u, op->frequency_);
+  EXPECT_EQ(5u, op_impl->counter);
+}
+
+// -----------------------------------------------------------------------------
+struct SubCycleTestOp : public StandaloneOperationImpl {
+  BDM_OP_HEADER(SubCycleTestOp);
+
+  void SetUp() override { set_up_calls++; }
+
+  void operator()() override {
+    auto* scheduler = Simulation::GetActive()->GetScheduler();
+    times.push_back(scheduler->GetSimulatedTime());
+    sub_cycles.push_back(scheduler->GetSubCycle());
+  }
+
+  void TearDown() override { tear_down_calls++; }
+
+  uint64_t set_up_calls = 0;
+  uint64_t tear_down_calls = 0;
+  std::vector<double> times;
+  std::vector<size_t> sub_cycles;
+};
+
+BDM_REGISTER_OP(SubCycleTestOp, "sub_cycle_test_op", kCpu)
+
+TEST_F(SchedulerTest, SubCycles) {
+  auto set_param = [](Param* param) { param->simulation_time_step = 1; };
+  Simulation simulation(TEST_NAME, set_param);
+  simulation.GetResourceManager()->AddAgent(new Cell(10));
+
+  auto* agent_op = NewOperation("test_op");
+  auto* agent_op_impl = agent_op->GetImplementation<TestOp>();
+  agent_op->SetSubCycles(3);
+  auto* standalone_op = NewOperation("sub_cycle_test_op");
+  auto* standalone_op_impl =
+      standalone_op->GetImplementation<SubCycleTestOp>();
+  standalone_op->frequency_ = 2;
+  standalone_op->SetSubCycles(4, true);
+  EXPECT_NEAR(0.5, standalone_op->GetTimeStep(), abs_error<double>::value);
+
+  auto* scheduler = simulation.GetScheduler();
+  scheduler->ScheduleOp(agent_op);
+  scheduler->ScheduleOp(standalone_op);
+
+  scheduler->Simulate(3);
+  EXPECT_EQ(9u, agent_op_impl->counter);
+  // standalone op: executed in steps 0 and 2
+  EXPECT_EQ(8u, standalone_op_impl->set_up_calls);
+  EXPECT_EQ(8u, standalone_op_impl->tear_down_calls);
+  std::vector<size_t> expected_sub_cycles = {0, 1, 2, 3, 0, 1, 2, 3};
+  EXPECT_EQ(expected_sub_cycles, standalone_op_impl->sub_cycles);
+  // the interpolated time is clamped to zero in the first iteration
+  std::vector<double> expected_times = {0, 0, 0, 0, 0.5, 1, 1.5, 2};
+  ASSERT_EQ(expected_times.size(), standalone_op_impl->times.size());
+  for (size_t i = 0; i < expected_times.size(); ++i) {
+    EXPECT_NEAR(expected_times[i], standalone_op_impl->times[i],
+                abs_error<double>::value);
+  }
+  // outside of sub-cycles the time is not interpolated
+  EXPECT_EQ(0u, scheduler->GetSubCycle());
+  EXPECT_EQ(0, scheduler->GetSubCycleTimeOffset());
+  EXPECT_NEAR(3, scheduler->GetSimulatedTime(), abs_error<double>::value);
+}
+
+// -----------------------------------------------------------------------------
+TEST_F(SchedulerTest, NonStaticAgentSubset) {
+  auto set_param = [](Param* param) { param->detect_static_agents = true; };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+  auto* scheduler = simulation.GetScheduler();
+  // no interference from mechanical forces operation
+  scheduler->UnscheduleOp(scheduler->GetOps("mechanical forces")[0]);
+
+  auto* cell0 = new Cell(10);
+  auto* cell1 = new Cell(10);
+  cell1->SetPosition({1000, 0, 0});
+  auto cell0_ptr = cell0->GetAgentPtr<Cell>();
+  rm->AddAgent(cell0);
+  rm->AddAgent(cell1);
+
+  auto* op = NewOperation("test_op");
+  auto* op_impl = op->GetImplementation<TestOp>();
+  op->SetAgentSubset(scheduler->GetNonStaticAgents());
+  scheduler->ScheduleOp(op);
+
+  // all agents are non-static in the first iteration
+  scheduler->Simulate(1);
+  EXPECT_TRUE(scheduler->UsesAgentSubsets());
+  EXPECT_EQ(2u, op_impl->counter);
+
+  // agents have not been modified -> static
+  scheduler->Simulate(1);
+  EXPECT_EQ(2u, op_impl->counter);
+
+  cell0_ptr->SetDiameter(20);
+  scheduler->Simulate(1);
+  EXPECT_EQ(3u, op_impl->counter);
+}
+
+// -----------------------------------------------------------------------------
+struct RecordStaticnessOp : public AgentOperationImpl {
+  BDM_OP_HEADER(RecordStaticnessOp);
+
+  void operator()(Agent* agent) override {
+    if (agent->IsStatic()) {
+#pragma omp atomic
+      static_agents++;
+    }
+  }
+
+  uint64_t static_agents = 0;
+};
+
+BDM_REGISTER_OP(RecordStaticnessOp, "record staticness", kCpu)
+
+// -----------------------------------------------------------------------------
+TEST_F(SchedulerTest, OpsOnActiveAgents) {
+  auto set_param = [](Param* param) { param->detect_static_agents = true; };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+  auto* scheduler = simulation.GetScheduler();
+
+  // Static agents are skipped within the pass over all agents
+  auto* mechanics = scheduler->GetOps("mechanical forces")[0];
+  EXPECT_EQ(nullptr, mechanics->GetAgentSubset());
+
+  for (int i = 0; i < 10; ++i) {
+    rm->AddAgent(new Cell({i * 100., 0, 0}));
+  }
+
+  // Opt-in: executed only on the active agents
+  auto* op = NewOperation("record staticness");
+  auto* op_impl = op->GetImplementation<RecordStaticnessOp>();
+  op->SetAgentSubset(scheduler->GetNonStaticAgents());
+  scheduler->ScheduleOp(op);
+
+  scheduler->Simulate(1);
+  EXPECT_EQ(10u, rm->GetActiveAgents().size());
+
+  // isolated agents become static -> the active list is empty
+  scheduler->Simulate(1);
+  EXPECT_EQ(0u, rm->GetActiveAgents().size());
+
+  // moving an agent reactivates it
+  rm->GetAgent(AgentHandle(0, 0))->SetPosition({0, 50, 0});
+  scheduler->Simulate(1);
+  EXPECT_EQ(1u, rm->GetActiveAgents().size());
+
+  // static agents must never be visited
+  EXPECT_EQ(0u, op_impl->static_agents);
+
+}
+
+// -----------------------------------------------------------------------------
+TEST_F(SchedulerTest, NonStaticAgentSubsetNeighborWakeUp) {
+  auto set_param = [](Param* param) { param->detect_static_agents = true; };
+  Simulation simulation(TEST_NAME, set_param);
+  auto* rm = simulation.GetResourceManager();
+  auto* scheduler = simulation.GetScheduler();
+
+  auto* cell0 = new Cell(10);
+  auto* cell1 = new Cell(10);
+  auto* cell2 = new Cell(10);
+  cell1->SetPosition({11, 0, 0});
+  cell2->SetPosition({1000, 0, 0});
+  auto cell0_ptr = cell0->GetAgentPtr<Cell>();
+  rm->AddAgent(cell0);
+  rm->AddAgent(cell1);
+  rm->AddAgent(cell2);
+
+  // the list is only built if an operation restricted to the subset runs
+  scheduler->Simulate(1);
+  EXPECT_EQ(0u, rm->GetActiveAgents().size());
+
+  auto* op = NewOperation("record staticness");
+  auto* op_impl = op->GetImplementation<RecordStaticnessOp>();
+  op->SetAgentSubset(scheduler->GetNonStaticAgents());
+  scheduler->ScheduleOp(op);
+
+  // let the agents settle
+  for (int i = 0; i < 100; ++i) {
+    scheduler->Simulate(1);
+    if (rm->GetActiveAgents().size() == 0u) {
+      break;
+    }
+  }
+  ASSERT_EQ(0u, rm->GetActiveAgents().size());
+
+  // growing cell0 also wakes up its neighbor cell1, but not cell2
+  cell0_ptr->SetDiameter(12);
+  scheduler->Simulate(1);
+  std::vector<AgentUid> active;
+  for (auto ah : rm->GetActiveAgents()) {
+    active.push_back(rm->GetAgent(ah)->GetUid());
+  }
+  std::sort(active.begin(), active.end());
+  std::vector<AgentUid> expected = {cell0->GetUid(), cell1->GetUid()};
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(expected, active);
+  EXPECT_EQ(0u, op_impl->static_agents);
+}
+
+// -----------------------------------------------------------------------------
+TEST_F(SchedulerTest, NonStaticAgentSubsetWithoutStaticDetection) {
+  Simulation simulation(TEST_NAME);
+  auto* rm = simulation.GetResourceManager();
+  auto* scheduler = simulation.GetScheduler();
+
+  rm->AddAgent(new Cell(10));
+  rm->AddAgent(new Cell(10));
+
+  auto* op = NewOperation("test_op");
+  auto* op_impl = op->GetImplementation<TestOp>();
+  op->SetAgentSubset(scheduler->GetNonStaticAgents());
+  scheduler->ScheduleOp(op);
+
+  // subset contains all agents -> no separate pass
+  scheduler->Simulate(3);
+  EXPECT_FALSE(scheduler->UsesAgentSubsets());
+  EXPECT_EQ(6u, op_impl->counter);
+}
+
+// -----------------------------------------------------------------------------
+TEST_F(SchedulerTest, TypeAgentSubset) {
+  Simulation simulation(TEST_NAME);
+  auto* rm = simulation.GetResourceManager();
+  auto* scheduler = simulation.GetScheduler();
+
+  rm->AddAgent(new Cell(10));
+  rm->AddAgent(new TestAgent({10, 0, 0}));
+  rm->AddAgent(new TestAgent({20, 0, 0}));
+
+  auto* op1 = NewOperation("test_op");
+  auto* op2 = NewOperation("test_op");
+  auto* op1_impl = op1->GetImplementation<TestOp>();
+  auto* op2_impl = op2->GetImplementation<TestOp>();
+
+  TypeAgentSubset<TestAgent> test_agents;
+  op2->SetAgentSubset(&test_agents);
+  scheduler->ScheduleOp(op1);
+  scheduler->ScheduleOp(op2);
+
+  scheduler->Simulate(1);
+  EXPECT_EQ(3u, op1_impl->counter);
+  EXPECT_EQ(2u, op2_impl->counter);
+
+  // subset must reflect added agents
+  rm->AddAgent(new TestAgent({30, 0, 0}));
+  scheduler->Simulate(1);
+  EXPECT_EQ(7u, op1_impl->counter);
+  EXPECT_EQ(5u, op2_impl->counter);
+
+  // must be reset before `test_agents` goes out of scope
+  op2->SetAgentSubset(nullptr);
+}
+
 // -----------------------------------------------------------------------------
 struct ExecutionOrderTestOp : public AgentOperationImpl {
   BDM_OP_HEADER(ExecutionOrderTestOp);
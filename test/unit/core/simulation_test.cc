@@ -45,11 +45,25 @@ class SimulationTest : public ::testing::Test {
       "backup_interval = 3600\n"
       "time_step = 0.0125\n"
       "max_displacement = 2.0\n"
+      "interaction_force_repulsion = [2.0, 1.5, 1.5, 2.0]\n"
+      "interaction_force_attraction = [1.0, 0.2, 0.2, 1.0]\n"
+      "interaction_force_iof_coefficient = [0.15, 0.1, 0.1, 0.15]\n"
+      "mechanics_sub_cycles = 3\n"
+      "diffusion_sub_cycles = 2\n"
+      "diffusion_substeps = 4\n"
+      "diffusion_convergence_tolerance = 1e-6\n"
+      "diffusion_grid_headroom = 0.5\n"
+      "diffusion_lazy_gradients = true\n"
+      "diffusion_amr_block_size = 4\n"
+      "diffusion_amr_agent_threshold = 3\n"
+      "diffusion_amr_gradient_threshold = 0.25\n"
       "bound_space = 0\n"
       "min_bound = -100\n"
       "max_bound =  200\n"
       "diffusion_method = \"runge-kutta\"\n"
+      "diffusion_implicit_theta = 0.5\n"
       "thread_safety_mechanism = \"automatic\"\n"
+      "deterministic_mode = true\n"
       "\n"
       "[visualization]\n"
       "insitu = false\n"
@@ -80,6 +94,7 @@ class SimulationTest : public ::testing::Test {
       "scheduling_batch_size = 123\n"
       "detect_static_agents = true\n"
       "cache_neighbors = true\n"
+      "mechanics_pairwise = true\n"
       "agent_uid_defragmentation_low_watermark = 0.123\n"
       "agent_uid_defragmentation_high_watermark = 0.456\n"
       "use_bdm_mem_mgr = false\n"
@@ -88,6 +103,8 @@ class SimulationTest : public ::testing::Test {
       "mem_mgr_max_mem_per_thread_factor = 3\n"
       "minimize_memory_while_rebalancing = false\n"
       "mapped_data_array_mode = \"cache\"\n"
+      "thread_pinning = \"compact\"\n"
+      "thread_pinning_cpus = [0, 2]\n"
       "\n"
       "[development]\n"
       "# this is a comment\n"
@@ -119,14 +136,31 @@ class SimulationTest : public ::testing::Test {
 
   void ValidateNonCLIParameter(const Param* param) {
     EXPECT_EQ(123u, param->random_seed);
+    EXPECT_TRUE(param->deterministic_mode);
     EXPECT_EQ("paraview", param->visualization_engine);
     EXPECT_EQ("result-dir", param->output_dir);
     EXPECT_EQ("runge-kutta", param->diffusion_method);
+    EXPECT_EQ(0.5, param->diffusion_implicit_theta);
     EXPECT_EQ(3600u, param->backup_interval);
     EXPECT_EQ(0.0125, param->simulation_time_step);
     EXPECT_EQ(1u, param->unschedule_default_operations.size());
     EXPECT_EQ("mechanical forces", param->unschedule_default_operations[0]);
     EXPECT_EQ(2.0, param->simulation_max_displacement);
+    EXPECT_EQ(std::vector<double>({2.0, 1.5, 1.5, 2.0}),
+              param->interaction_force_repulsion);
+    EXPECT_EQ(std::vector<double>({1.0, 0.2, 0.2, 1.0}),
+              param->interaction_force_attraction);
+    EXPECT_EQ(std::vector<double>({0.15, 0.1, 0.1, 0.15}),
+              param->interaction_force_iof_coefficient);
+    EXPECT_EQ(3u, param->mechanics_sub_cycles);
+    EXPECT_EQ(2u, param->diffusion_sub_cycles);
+    EXPECT_EQ(4u, param->diffusion_substeps);
+    EXPECT_EQ(1e-6, param->diffusion_convergence_tolerance);
+    EXPECT_EQ(0.5, param->diffusion_grid_headroom);
+    EXPECT_TRUE(param->diffusion_lazy_gradients);
+    EXPECT_EQ(4u, param->diffusion_amr_block_size);
+    EXPECT_EQ(3u, param->diffusion_amr_agent_threshold);
+    EXPECT_EQ(0.25, param->diffusion_amr_gradient_threshold);
     EXPECT_EQ(0, param->bound_space);
     EXPECT_EQ(-100, param->min_bound);
     EXPECT_EQ(200, param->max_bound);
@@ -178,6 +212,7 @@ class SimulationTest : public ::testing::Test {
     EXPECT_EQ(123u, param->scheduling_batch_size);
     EXPECT_TRUE(param->detect_static_agents);
     EXPECT_TRUE(param->cache_neighbors);
+    EXPECT_TRUE(param->mechanics_pairwise);
     EXPECT_NEAR(0.123, param->agent_uid_defragmentation_low_watermark,
                 abs_error<double>::value);
     EXPECT_NEAR(0.456, param->agent_uid_defragmentation_high_watermark,
@@ -189,6 +224,8 @@ class SimulationTest : public ::testing::Test {
     EXPECT_FALSE(param->minimize_memory_while_rebalancing);
     EXPECT_EQ(Param::MappedDataArrayMode::kCache,
               param->mapped_data_array_mode);
+    EXPECT_EQ("compact", param->thread_pinning);
+    EXPECT_EQ(std::vector<int>({0, 2}), param->thread_pinning_cpus);
 
     // development group
     EXPECT_FALSE(param->statistics);
@@ -580,4 +617,26 @@ TEST(Simulation, SetEnvironmentSame) {
   env->Clear();
 }
 
+TEST(SimulationDeathTest, InvalidMechanicsIntegrator) {
+  ASSERT_DEATH(
+      {
+        auto set_param = [](Param* param) {
+          param->mechanics_integrator = "implict";
+        };
+        Simulation sim(TEST_NAME, set_param);
+      },
+      ".*mechanics_integrator was set to an invalid value.*");
+}
+
+TEST(SimulationDeathTest, NegativeDiffusionGridHeadroom) {
+  ASSERT_DEATH(
+      {
+        auto set_param = [](Param* param) {
+          param->diffusion_grid_headroom = -0.5;
+        };
+        Simulation sim(TEST_NAME, set_param);
+      },
+      ".*diffusion_grid_headroom must not be negative.*");
+}
+
 }  // namespace bdm
@@ -18,6 +18,8 @@
 #include <TRandom3.h>
 #include <gtest/gtest.h>
 #include <limits>
+#include <vector>
+#include "core/util/counter_based_random.h"
 #include "unit/test_util/io_test.h"
 #include "unit/test_util/test_util.h"
 
@@ -408,6 +410,49 @@ TEST(RandomTest, Sphere) {
   }
 }
 
+TEST(CounterBasedRandomTest, KnownAnswer) {
+  // Philox4x32-10 with zero key and counter returns
+  // 0x6627e8d5 0xe169c58d 0xbc57ac4c 0x9b00dbd8
+  CounterBasedRandom rng(0);
+  EXPECT_DOUBLE_EQ(0.3990464723148957, rng.Rndm());
+}
+
+TEST(CounterBasedRandomTest, Streams) {
+  CounterBasedRandom rng(42);
+
+  rng.SetStream(3, 7);
+  std::vector<double> stream_3_7(10);
+  for (auto& el : stream_3_7) {
+    el = rng.Rndm();
+    EXPECT_LT(0.0, el);
+    EXPECT_GT(1.0, el);
+  }
+
+  // other streams must differ
+  rng.SetStream(4, 7);
+  EXPECT_NE(stream_3_7[0], rng.Rndm());
+  rng.SetStream(3, 8);
+  EXPECT_NE(stream_3_7[0], rng.Rndm());
+
+  // restarting a stream must reproduce the random numbers
+  rng.SetStream(3, 7);
+  for (auto el : stream_3_7) {
+    EXPECT_EQ(el, rng.Rndm());
+  }
+}
+
+TEST(RandomTest, SetStream) {
+  Simulation simulation(TEST_NAME);
+  auto* random = simulation.GetRandom();
+  random->SetGenerator(new CounterBasedRandom(42));
+
+  random->SetStream(1, 2);
+  auto expected = random->Gaus();
+  random->Uniform();
+  random->SetStream(1, 2);
+  EXPECT_EQ(expected, random->Gaus());
+}
+
 #ifdef USE_DICT
 TEST_F(IOTest, Random) {
   Random random;
@@ -13,6 +13,8 @@
 // -----------------------------------------------------------------------------
 
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <map>
 #include <set>
 
 #include "core/util/thread_info.h"
@@ -88,4 +90,152 @@ TEST(ThreadInfoTest, Renew) {
   ThreadInfo::GetInstance()->Renew();
 }
 
+TEST(ThreadInfoTest, ComputePlacement) {
+  auto* ti = ThreadInfo::GetInstance();
+  auto max_threads = static_cast<uint64_t>(omp_get_max_threads());
+  const auto& allowed = ti->GetAllowedCpus();
+  ASSERT_FALSE(allowed.empty());
+
+  auto none = ti->ComputePlacement(ThreadInfo::kNoPinning, {});
+  EXPECT_EQ(max_threads, none.size());
+  EXPECT_TRUE(std::all_of(none.begin(), none.end(),
+                          [](int cpu) { return cpu == -1; }));
+
+  auto list = ti->ComputePlacement(ThreadInfo::kList, {3, 1});
+  EXPECT_EQ(max_threads, list.size());
+  for (uint64_t t = 0; t < list.size(); ++t) {
+    EXPECT_EQ(t % 2 == 0 ? 3 : 1, list[t]);
+  }
+
+  for (auto policy : {ThreadInfo::kCompact, ThreadInfo::kScatter}) {
+    auto placement = ti->ComputePlacement(policy, {});
+    EXPECT_EQ(max_threads, placement.size());
+    std::set<int> used;
+    for (uint64_t t = 0; t < placement.size(); ++t) {
+      EXPECT_NE(allowed.end(),
+                std::find(allowed.begin(), allowed.end(), placement[t]));
+      used.insert(placement[t]);
+    }
+    // threads only share a cpu if there are more threads than cpus
+    EXPECT_EQ(std::min(max_threads, allowed.size()), used.size());
+  }
+
+  // compact: numa nodes are filled one after another
+  auto compact = ti->ComputePlacement(ThreadInfo::kCompact, {});
+  for (uint64_t t = 1; t < std::min(max_threads, allowed.size()); ++t) {
+    EXPECT_LE(numa_node_of_cpu(compact[t - 1]), numa_node_of_cpu(compact[t]));
+  }
+
+  // scatter: threads are distributed evenly over the numa nodes. A node can
+  // only have fewer threads than another one if all its cpus are used.
+  auto scatter = ti->ComputePlacement(ThreadInfo::kScatter, {});
+  std::map<int, uint64_t> cpus_in_node;
+  std::map<int, uint64_t> threads_in_node;
+  for (int cpu : allowed) {
+    cpus_in_node[numa_node_of_cpu(cpu)]++;
+    threads_in_node[numa_node_of_cpu(cpu)] = 0;
+  }
+  for (uint64_t t = 0; t < std::min(max_threads, allowed.size()); ++t) {
+    threads_in_node[numa_node_of_cpu(scatter[t])]++;
+  }
+  for (auto& lhs : threads_in_node) {
+    for (auto& rhs : threads_in_node) {
+      if (lhs.second + 1 < rhs.second) {
+        EXPECT_EQ(cpus_in_node[lhs.first], lhs.second);
+      }
+    }
+  }
+}
+
+#ifdef USE_NUMA
+TEST(ThreadInfoTest, SetPinning) {
+  auto* ti = ThreadInfo::GetInstance();
+  const auto& allowed = ti->GetAllowedCpus();
+
+  std::vector<std::pair<ThreadInfo::ThreadPinning, std::vector<int>>>
+      policies = {{ThreadInfo::kCompact, {}},
+                  {ThreadInfo::kScatter, {}},
+                  {ThreadInfo::kList, {allowed.back(), allowed.front()}}};
+  for (auto& el : policies) {
+    ti->SetPinning(el.first, el.second);
+    EXPECT_EQ(el.first, ti->GetPinning());
+    auto expected = ti->ComputePlacement(el.first, el.second);
+    for (int t = 0; t < ti->GetMaxThreads(); ++t) {
+      EXPECT_EQ(expected[t], ti->GetCpu(t));
+    }
+    EXPECT_TRUE(ti->VerifyPinning());
+    RunAllChecks(*ti);
+  }
+
+  // pinning is reapplied if the number of threads changes
+  ti->SetPinning(ThreadInfo::kCompact);
+  auto omp_max_threads = omp_get_max_threads();
+  omp_set_num_threads(1);
+  ti->Renew();
+  EXPECT_EQ(ti->ComputePlacement(ThreadInfo::kCompact, {})[0], ti->GetCpu(0));
+  EXPECT_TRUE(ti->VerifyPinning());
+  RunAllChecks(*ti);
+  omp_set_num_threads(omp_max_threads);
+
+  ti->SetPinning(ThreadInfo::kNoPinning);
+  for (int t = 0; t < ti->GetMaxThreads(); ++t) {
+    EXPECT_EQ(-1, ti->GetCpu(t));
+  }
+  RunAllChecks(*ti);
+}
+
+// Returns the CPU affinity of each OpenMP thread
+std::vector<std::vector<int>> GetThreadAffinities() {
+  std::vector<std::vector<int>> affinities(omp_get_max_threads());
+#pragma omp parallel
+  {
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    sched_getaffinity(0, sizeof(mask), &mask);
+    auto& cpus = affinities[omp_get_thread_num()];
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &mask)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  return affinities;
+}
+
+TEST(ThreadInfoTest, NoPinningRestoresAffinity) {
+  auto* ti = ThreadInfo::GetInstance();
+  ti->SetPinning(ThreadInfo::kNoPinning);
+  auto initial = GetThreadAffinities();
+
+  ti->SetPinning(ThreadInfo::kCompact);
+  ti->SetPinning(ThreadInfo::kNoPinning);
+  EXPECT_EQ(initial, GetThreadAffinities());
+}
+
+TEST(ThreadInfoDeathTest, SetPinningInvalidCpus) {
+  auto* ti = ThreadInfo::GetInstance();
+  const auto& allowed = ti->GetAllowedCpus();
+  ASSERT_DEATH({ ti->SetPinning(ThreadInfo::kList, {}); },
+               ".*requires a non-empty cpu list.*");
+  ASSERT_DEATH({ ti->SetPinning(ThreadInfo::kList, {allowed[0], -1}); },
+               ".*CPU -1 in the cpu list.*out of range.*");
+  ASSERT_DEATH({ ti->SetPinning(ThreadInfo::kList, {CPU_SETSIZE}); },
+               ".*out of range.*");
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (std::find(allowed.begin(), allowed.end(), cpu) == allowed.end()) {
+      ASSERT_DEATH({ ti->SetPinning(ThreadInfo::kList, {cpu}); },
+                   ".*is not available to this process.*");
+      break;
+    }
+  }
+}
+#endif  // USE_NUMA
+
+TEST(ThreadInfoTest, ParsePinning) {
+  EXPECT_EQ(ThreadInfo::kNoPinning, ThreadInfo::ParsePinning("none"));
+  EXPECT_EQ(ThreadInfo::kCompact, ThreadInfo::ParsePinning("compact"));
+  EXPECT_EQ(ThreadInfo::kScatter, ThreadInfo::ParsePinning("scatter"));
+  EXPECT_EQ(ThreadInfo::kList, ThreadInfo::ParsePinning("list"));
+}
+
 }  // namespace bdm
@@ -15,6 +15,8 @@
 #ifndef UNIT_TEST_UTIL_TEST_UTIL_H_
 #define UNIT_TEST_UTIL_TEST_UTIL_H_
 
+#include <algorithm>
+#include <cmath>
 #include <type_traits>
 #include "gtest/gtest.h"
 
@@ -40,6 +42,19 @@ struct abs_error<double> {
   static constexpr double value = 1e-9;
 };
 
+/// Returns the tolerance of a test that compares a concentration of a
+/// diffusion grid (or a quantity derived from it) of magnitude `value`.
+/// `error` is the tolerance in double precision. If the concentrations are
+/// stored in single precision (`-Dfloat_diffusion=ON`), the tolerance is
+/// relaxed to the precision of `float`.
+inline double ConcentrationError(double error, double value = 1) {
+#ifdef USE_FLOAT_DIFFUSION
+  return std::max(error, 1e-5 * std::max(1.0, std::abs(value)));
+#else
+  return error;
+#endif
+}
+
 // -----------------------------------------------------------------------------
 template <typename T, size_t N>
 void EXPECT_ARR_EQ(const MathArray<T, N>& expected,  // NOLINT